@@ -26,6 +26,7 @@
 #include "mv.h"
 #include "slice.h"
 #include "param.h"
+#include "threadpool.h"
 
 #include <signal.h>
 #include <errno.h>
@@ -51,6 +52,16 @@ namespace X265_NS {
         m_numActiveEncodes.set(numEncodes);
         m_queueSize = (numEncodes > 1) ? X265_INPUT_QUEUE_SIZE : 1;
         m_passEnc = X265_MALLOC(PassEncoder*, m_numEncodes);
+        m_scaleSrc = X265_MALLOC(int, m_numEncodes);
+        m_picSrc = X265_MALLOC(int, m_numEncodes);
+        m_picConsumers = X265_MALLOC(int, m_numEncodes);
+        if (!m_passEnc || !m_scaleSrc || !m_picSrc || !m_picConsumers)
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Unable to allocate memory for abr encoder\n");
+            ret = 4;
+            return;
+        }
+        buildInputGraph(cliopt);
 
         for (uint8_t i = 0; i < m_numEncodes; i++)
         {
@@ -60,20 +71,136 @@ namespace X265_NS {
                 x265_log(NULL, X265_LOG_ERROR, "Unable to allocate memory for passEncoder\n");
                 ret = 4;
             }
-            m_passEnc[i]->init(ret);
         }
 
+        /* a scaled pass may read from any other pass, so all must exist first */
+        bool bOpened = true;
+        for (uint8_t i = 0; i < m_numEncodes && bOpened; i++)
+            bOpened = m_passEnc[i]->init(ret) > 0;
+
         if (!allocBuffers())
         {
             x265_log(NULL, X265_LOG_ERROR, "Unable to allocate memory for buffers\n");
             ret = 4;
         }
 
+        if (!bOpened)
+        {
+            /* an encoder failed to open, start no threads and close the
+             * encoders of the passes before it */
+            for (uint8_t pass = 0; pass < m_numEncodes; pass++)
+            {
+                PassEncoder* passEnc = m_passEnc[pass];
+                if (passEnc->m_ret && !ret)
+                    ret = passEnc->m_ret;
+                if (passEnc->m_encoder)
+                {
+                    passEnc->m_cliopt.api->encoder_close(passEnc->m_encoder);
+                    passEnc->m_encoder = NULL;
+                }
+            }
+            m_numActiveEncodes.set(0);
+            return;
+        }
+
         /* start passEncoder worker threads */
         for (uint8_t pass = 0; pass < m_numEncodes; pass++)
             m_passEnc[pass]->startThreads();
     }
 
+    /* The owner reads every frame the sharer encodes, and neither converts
+     * the pictures in place */
+    static bool isSameInput(const CLIOptions& owner, const CLIOptions& sharer)
+    {
+        const x265_param* op = owner.param;
+        const x265_param* sp = sharer.param;
+        return owner.inputName && sharer.inputName && !strcmp(owner.inputName, sharer.inputName) &&
+               owner.seek == sharer.seek && !owner.bDither && !sharer.bDither &&
+               (!owner.framesToBeEncoded || (sharer.framesToBeEncoded && sharer.framesToBeEncoded <= owner.framesToBeEncoded)) &&
+               op->sourceWidth == sp->sourceWidth && op->sourceHeight == sp->sourceHeight &&
+               op->internalCsp == sp->internalCsp && op->sourceBitDepth == sp->sourceBitDepth;
+    }
+
+    void AbrEncoder::buildInputGraph(CLIOptions cliopt[])
+    {
+        for (uint8_t i = 0; i < m_numEncodes; i++)
+        {
+            m_scaleSrc[i] = (cliopt[i].enableScaler && i) ? 0 : -1;
+            m_picSrc[i] = i;
+            m_picConsumers[i] = 0;
+        }
+
+        /* passes reading the same input share the pictures of the first of them */
+        for (uint8_t i = 1; i < m_numEncodes; i++)
+        {
+            for (uint8_t j = 0; j < i && m_scaleSrc[i] < 0; j++)
+            {
+                if (m_scaleSrc[j] < 0 && m_picSrc[j] == j && isSameInput(cliopt[j], cliopt[i]))
+                {
+                    m_picSrc[i] = j;
+                    break;
+                }
+            }
+        }
+
+        /* Scaled passes are ordered by decreasing area, ties by pass index, and
+         * may only be scaled from pass 0 (which reads the input) or from a pass
+         * earlier in that order. Among those, the smallest one covering the pass
+         * in both dimensions is used, pass 0 when none does */
+        for (uint8_t i = 1; i < m_numEncodes; i++)
+        {
+            if (m_scaleSrc[i] < 0)
+                continue;
+
+            int w = cliopt[i].param->sourceWidth;
+            int h = cliopt[i].param->sourceHeight;
+            int64_t area = (int64_t)w * h;
+            int64_t bestArea = 0;
+            for (uint8_t j = 0; j < m_numEncodes; j++)
+            {
+                if (j == i || (j && m_scaleSrc[j] < 0))
+                    continue;
+                int srcW = cliopt[j].param->sourceWidth;
+                int srcH = cliopt[j].param->sourceHeight;
+                int64_t srcArea = (int64_t)srcW * srcH;
+                bool before = !j || srcArea > area || (srcArea == area && j < i);
+                if (before && srcW >= w && srcH >= h && (!bestArea || srcArea < bestArea))
+                {
+                    bestArea = srcArea;
+                    m_scaleSrc[i] = j;
+                }
+            }
+
+            /* nothing to scale, encode the pictures of the source */
+            if (bestArea == area)
+                m_picSrc[i] = m_scaleSrc[i];
+        }
+
+        /* resolve chains of shared pictures to their owner, the graph is acyclic */
+        for (uint8_t i = 0; i < m_numEncodes; i++)
+        {
+            int owner = i;
+            while (m_picSrc[owner] != owner)
+                owner = m_picSrc[owner];
+            m_picSrc[i] = owner;
+        }
+        for (uint8_t i = 0; i < m_numEncodes; i++)
+        {
+            if (m_picSrc[i] != i)
+                m_scaleSrc[i] = -1;
+            else if (m_scaleSrc[i] >= 0)
+                m_scaleSrc[i] = m_picSrc[m_scaleSrc[i]];
+        }
+
+        /* every picture is read by each encoder sharing it and by each pass scaled from it */
+        for (uint8_t i = 0; i < m_numEncodes; i++)
+        {
+            m_picConsumers[m_picSrc[i]]++;
+            if (m_scaleSrc[i] >= 0)
+                m_picConsumers[m_scaleSrc[i]]++;
+        }
+    }
+
     bool AbrEncoder::allocBuffers()
     {
         m_inputPicBuffer = X265_MALLOC(x265_picture**, m_numEncodes);
@@ -114,9 +241,12 @@ namespace X265_NS {
         x265_cleanup(); /* Free library singletons */
         for (uint8_t pass = 0; pass < m_numEncodes; pass++)
         {
+            /* pictures of a mapped input point into the file mapping */
+            bool bOwnsPlanes = !(m_passEnc[pass]->m_reader && m_passEnc[pass]->m_reader->m_bMapped);
             for (uint32_t index = 0; index < m_queueSize; index++)
             {
-                X265_FREE(m_inputPicBuffer[pass][index]->planes[0]);
+                if (bOwnsPlanes)
+                    X265_FREE(m_inputPicBuffer[pass][index]->planes[0]);
                 x265_picture_free(m_inputPicBuffer[pass][index]);
             }
 
@@ -143,6 +273,9 @@ namespace X265_NS {
         X265_FREE(m_analysisRead);
 
         X265_FREE(m_passEnc);
+        X265_FREE(m_scaleSrc);
+        X265_FREE(m_picSrc);
+        X265_FREE(m_picConsumers);
     }
 
     PassEncoder::PassEncoder(uint32_t id, CLIOptions cliopt, AbrEncoder *parent)
@@ -153,6 +286,8 @@ namespace X265_NS {
         if(!(m_cliopt.enableScaler && m_id))
             m_input = m_cliopt.input;
         m_param = cliopt.param;
+        m_picWidth = m_param->sourceWidth;
+        m_picHeight = m_param->sourceHeight;
         m_inputOver = false;
         m_lastIdx = -1;
         m_encoder = NULL;
@@ -166,15 +301,19 @@ namespace X265_NS {
         if (m_parent->m_numEncodes > 1)
             setReuseLevel();
                 
-        if (!(m_cliopt.enableScaler && m_id))
+        if (m_parent->m_picSrc[m_id] != (int)m_id)
+        {
+            /* encodes the read-only pictures of another pass, nothing to read or scale */
+        }
+        else if (m_parent->m_scaleSrc[m_id] < 0)
             m_reader = new Reader(m_id, this);
         else
         {
+            /* the input pictures keep the depth of the source file */
             VideoDesc *src = NULL, *dst = NULL;
-            dst = new VideoDesc(m_param->sourceWidth, m_param->sourceHeight, m_param->internalCsp, m_param->internalBitDepth);
-            int dstW = m_parent->m_passEnc[m_id - 1]->m_param->sourceWidth;
-            int dstH = m_parent->m_passEnc[m_id - 1]->m_param->sourceHeight;
-            src = new VideoDesc(dstW, dstH, m_param->internalCsp, m_param->internalBitDepth);
+            dst = new VideoDesc(m_picWidth, m_picHeight, m_param->internalCsp, m_param->sourceBitDepth);
+            PassEncoder* srcEnc = m_parent->m_passEnc[m_parent->m_scaleSrc[m_id]];
+            src = new VideoDesc(srcEnc->m_picWidth, srcEnc->m_picHeight, m_param->internalCsp, m_param->sourceBitDepth);
             if (src != NULL && dst != NULL)
             {
                 m_scaler = new Scaler(0, 1, m_id, src, dst, this);
@@ -183,6 +322,9 @@ namespace X265_NS {
                     x265_log(m_param, X265_LOG_ERROR, "\n MALLOC failure in Scaler");
                     result = 4;
                 }
+                else
+                    x265_log(m_param, X265_LOG_INFO, "%s: scaled from %s, %dx%d to %dx%d\n", m_cliopt.encName, srcEnc->m_cliopt.encName,
+                             srcEnc->m_picWidth, srcEnc->m_picHeight, m_picWidth, m_picHeight);
             }
         }
 
@@ -395,13 +537,15 @@ ret:
     bool PassEncoder::readPicture(x265_picture *dstPic)
     {
         /*Check and wait if there any input frames to read*/
+        int picSrc = m_parent->m_picSrc[m_id];
+        PassEncoder* owner = m_parent->m_passEnc[picSrc];
         int ipread = m_parent->m_picReadCnt[m_id].get();
-        int ipwrite = m_parent->m_picWriteCnt[m_id].get();
+        int ipwrite = m_parent->m_picWriteCnt[picSrc].get();
 
         bool isAbrLoad = m_cliopt.loadLevel && (m_parent->m_numEncodes > 1);
-        while (!m_inputOver && (ipread == ipwrite))
+        while (!owner->m_inputOver && (ipread == ipwrite))
         {
-            ipwrite = m_parent->m_picWriteCnt[m_id].waitForChange(ipwrite);
+            ipwrite = m_parent->m_picWriteCnt[picSrc].waitForChange(ipwrite);
         }
 
         if (m_threadActive && ipread < ipwrite)
@@ -459,7 +603,7 @@ ret:
                         readPos = analysisData->poc % m_parent->m_queueSize;
                         while ((ipwrite < readPos) || ((ipwrite - 1) < (int)analysisData->poc))
                         {
-                            ipwrite = m_parent->m_picWriteCnt[m_id].waitForChange(ipwrite);
+                            ipwrite = m_parent->m_picWriteCnt[picSrc].waitForChange(ipwrite);
                         }
                     }
 
@@ -470,7 +614,7 @@ ret:
             }
 
 
-            x265_picture *srcPic = (x265_picture*)(m_parent->m_inputPicBuffer[m_id][readPos]);
+            x265_picture *srcPic = (x265_picture*)(m_parent->m_inputPicBuffer[picSrc][readPos]);
 
             x265_picture *pic = (x265_picture*)(dstPic);
             pic->colorSpace = srcPic->colorSpace;
@@ -717,9 +861,13 @@ ret:
 
                     int numEncoded = api->encoder_encode(m_encoder, &p_nal, &nal, picInput, pic_recon);
 
-                    int idx = (inFrameCount - 1) % m_parent->m_queueSize;
-                    m_parent->m_picIdxReadCnt[m_id][idx].incr();
-                    m_parent->m_picReadCnt[m_id].incr();
+                    /* release the input picture once, after its last field */
+                    if (pic_in && inputNum == inputPicNum - 1)
+                    {
+                        int idx = (inFrameCount - 1) % m_parent->m_queueSize;
+                        m_parent->m_picIdxReadCnt[m_parent->m_picSrc[m_id]][idx].incr();
+                        m_parent->m_picReadCnt[m_id].incr();
+                    }
                     if (m_cliopt.loadLevel && picInput)
                     {
                         m_parent->m_analysisReadCnt[m_cliopt.refId].incr();
@@ -858,7 +1006,7 @@ ret:
             m_reader->stop();
             delete m_reader;
         }
-        else
+        else if (m_scaler)
         {
             m_scaler->stop();
             m_scaler->destroy();
@@ -870,11 +1018,15 @@ ret:
     {
         m_parentEnc = parentEnc;
         m_id = id;
+        m_srcId = parentEnc->m_parent->m_scaleSrc[id];
         m_srcFormat = src;
         m_dstFormat = dst;
         m_threadActive = false;
         m_scaleFrameSize = 0;
-        m_filterManager = NULL;
+        m_numBands = 0;
+        m_jobSrc = m_jobDst = NULL;
+        memset(m_filterManager, 0, sizeof(m_filterManager));
+        memset(m_bandWorker, 0, sizeof(m_bandWorker));
         m_threadId = threadId;
         m_threadTotal = threadNum;
 
@@ -890,8 +1042,68 @@ ret:
 
         if (src->m_height != dst->m_height || src->m_width != dst->m_width)
         {
-            m_filterManager = new ScalerFilterManager;
-            m_filterManager->init(4, m_srcFormat, m_dstFormat);
+            /* split the destination picture into bands of at least MIN_BAND_HEIGHT
+             * rows, one per core, scaled concurrently by the band workers */
+            m_numBands = x265_clip3(1, (int)MAX_SCALER_BANDS, X265_MIN(ThreadPool::getCpuCount(), dst->m_height / MIN_BAND_HEIGHT));
+            for (int i = 0; i < m_numBands; i++)
+            {
+                m_filterManager[i] = new ScalerFilterManager;
+                m_filterManager[i]->init(4, m_srcFormat, m_dstFormat);
+            }
+            for (int i = 1; i < m_numBands; i++)
+                m_bandWorker[i] = new ScalerBand(this, i);
+        }
+    }
+
+    void Scaler::destroy()
+    {
+        for (int i = 1; i < m_numBands; i++)
+        {
+            if (m_bandWorker[i])
+            {
+                m_bandWorker[i]->m_threadActive = false;
+                m_bandWorker[i]->m_workAvailable.trigger();
+                m_bandWorker[i]->stop();
+                delete m_bandWorker[i];
+                m_bandWorker[i] = NULL;
+            }
+        }
+        for (int i = 0; i < m_numBands; i++)
+        {
+            delete m_filterManager[i];
+            m_filterManager[i] = NULL;
+        }
+        m_numBands = 0;
+    }
+
+    void Scaler::scaleBand(int bandId)
+    {
+        /* band boundaries stay on even rows so 4:2:0 chroma rows are not split */
+        int dstH = m_dstFormat->m_height;
+        int dstYStart = (dstH * bandId / m_numBands) & ~1;
+        int dstYEnd = bandId + 1 == m_numBands ? dstH : (dstH * (bandId + 1) / m_numBands) & ~1;
+        m_filterManager[bandId]->scale_pic(m_jobSrc, m_jobDst, m_jobSrcStride, m_jobDstStride, dstYStart, dstYEnd);
+    }
+
+    ScalerBand::ScalerBand(Scaler *parent, int bandId)
+    {
+        m_parent = parent;
+        m_bandId = bandId;
+        m_threadActive = true;
+        start();
+    }
+
+    void ScalerBand::threadMain()
+    {
+        THREAD_NAME("ScalerBand", m_bandId);
+
+        while (m_threadActive)
+        {
+            m_workAvailable.wait();
+            if (!m_threadActive)
+                break;
+            m_parent->scaleBand(m_bandId);
+            m_parent->m_bandsDone.incr();
         }
     }
 
@@ -928,7 +1140,19 @@ ret:
             }
             if (m_scaleFrameSize)
             {
-                m_filterManager->scale_pic(srcPlane, dstPlane, srcStride, dstStride);
+                m_jobSrc = srcPlane;
+                m_jobDst = dstPlane;
+                memcpy(m_jobSrcStride, srcStride, sizeof(srcStride));
+                memcpy(m_jobDstStride, dstStride, sizeof(dstStride));
+                m_bandsDone.set(0);
+                for (int i = 1; i < m_numBands; i++)
+                    m_bandWorker[i]->m_workAvailable.trigger();
+
+                scaleBand(0);
+
+                int done = m_bandsDone.get();
+                while (done < m_numBands - 1)
+                    done = m_bandsDone.waitForChange(done);
                 return true;
             }
             else
@@ -941,9 +1165,11 @@ ret:
     {
         THREAD_NAME("Scaler", m_id);
 
-        /* unscaled picture is stored in the last index */
-        uint32_t srcId = m_id - 1;
+        /* pictures are scaled from the source pass chosen by the scaling graph */
+        uint32_t srcId = m_srcId;
+        PassEncoder* srcEnc = m_parentEnc->m_parent->m_passEnc[srcId];
         int QDepth = m_parentEnc->m_parent->m_queueSize;
+        int consumers = m_parentEnc->m_parent->m_picConsumers[m_id];
         while (!m_parentEnc->m_inputOver)
         {
 
@@ -959,7 +1185,7 @@ ret:
             uint32_t written = m_parentEnc->m_parent->m_picWriteCnt[srcId].get();
 
             /*If all the input pictures are scaled by the current scale worker thread wait for input pictures*/
-            while (m_threadActive && (scaledWritten == written)) {
+            while (m_threadActive && (scaledWritten == written) && !srcEnc->m_inputOver) {
                 written = m_parentEnc->m_parent->m_picWriteCnt[srcId].waitForChange(written);
             }
 
@@ -970,39 +1196,29 @@ ret:
                 int overWritePicBuffer = scaledWritten / QDepth;
                 int read = m_parentEnc->m_parent->m_picIdxReadCnt[m_id][scaledWriteIdx].get();
 
-                while (overWritePicBuffer && read < overWritePicBuffer)
+                /* the slot is free once every consumer has read its previous picture */
+                while (overWritePicBuffer && read < overWritePicBuffer * consumers)
                 {
                     read = m_parentEnc->m_parent->m_picIdxReadCnt[m_id][scaledWriteIdx].waitForChange(read);
                 }
 
-                if (!m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWriteIdx])
+                x265_picture* destPic = m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWriteIdx];
+                if (!destPic->planes[0])
                 {
-                    int framesize = 0;
-                    int planesize[3];
+                    /* one allocation per picture, AbrEncoder::destroy() frees planes[0] */
                     int csp = m_dstFormat->m_csp;
-                    int stride[3];
-                    stride[0] = m_dstFormat->m_width;
-                    stride[1] = stride[0] >> x265_cli_csps[csp].width[1];
-                    stride[2] = stride[0] >> x265_cli_csps[csp].width[2];
-                    for (int i = 0; i < x265_cli_csps[csp].planes; i++)
-                    {
-                        uint32_t h = m_dstFormat->m_height >> x265_cli_csps[csp].height[i];
-                        planesize[i] = h * stride[i];
-                        framesize += planesize[i];
-                    }
-
-                    m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWriteIdx] = x265_picture_alloc();
-                    x265_picture_init(m_parentEnc->m_param, m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWriteIdx]);
-
-                    ((x265_picture*)m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWritten % QDepth])->framesize = framesize;
+                    char* buf = X265_MALLOC(char, m_scaleFrameSize);
                     for (int32_t j = 0; j < x265_cli_csps[csp].planes; j++)
                     {
-                        m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWritten % QDepth]->planes[j] = X265_MALLOC(char, planesize[j]);
+                        destPic->planes[j] = buf;
+                        buf += m_scalePlanes[j];
                     }
+                    destPic->framesize = m_scaleFrameSize;
+                    destPic->width = m_dstFormat->m_width;
+                    destPic->height = m_dstFormat->m_height;
                 }
 
                 x265_picture *srcPic = m_parentEnc->m_parent->m_inputPicBuffer[srcId][scaledWritten % QDepth];
-                x265_picture* destPic = m_parentEnc->m_parent->m_inputPicBuffer[m_id][scaledWriteIdx];
 
                 // Enqueue this picture up with the current encoder so that it will asynchronously encode
                 if (!scalePic(destPic, srcPic))
@@ -1025,20 +1241,20 @@ ret:
                     break;
                 }
             }
-            else
+            else if (srcEnc->m_inputOver)
             {
                 /* Once end of video is reached and all frames are scaled, release wait on picwritecount */
                 scaledWritten = m_parentEnc->m_parent->m_picWriteCnt[m_id].get();
                 written = m_parentEnc->m_parent->m_picWriteCnt[srcId].get();
                 if (written == scaledWritten)
-                {
-                    m_parentEnc->m_parent->m_picWriteCnt[srcId].poke();
-                    m_parentEnc->m_parent->m_picWriteCnt[m_id].poke();
                     break;
-                }
             }
 
         }
+        /* the end of this pass' input is the end of input for passes scaled from it */
+        m_parentEnc->m_inputOver = true;
+        m_parentEnc->m_parent->m_picWriteCnt[srcId].poke();
+        m_parentEnc->m_parent->m_picWriteCnt[m_id].poke();
         m_threadActive = false;
         destroy();
     }
@@ -1048,6 +1264,8 @@ ret:
         m_parentEnc = parentEnc;
         m_id = id;
         m_input = parentEnc->m_input;
+        /* dithering converts the pictures in place, so it needs a copy */
+        m_bMapped = m_input->isMapped() && !parentEnc->m_cliopt.bDither;
     }
 
     void Reader::threadMain()
@@ -1064,17 +1282,19 @@ ret:
             uint32_t writeIdx = written % QDepth;
             uint32_t read = m_parentEnc->m_parent->m_picIdxReadCnt[m_id][writeIdx].get();
             uint32_t overWritePicBuffer = written / QDepth;
+            uint32_t consumers = m_parentEnc->m_parent->m_picConsumers[m_id];
 
-            if (m_parentEnc->m_cliopt.framesToBeEncoded && written >= m_parentEnc->m_cliopt.framesToBeEncoded)
-                break;
-
-            while (overWritePicBuffer && read < overWritePicBuffer)
+            while (overWritePicBuffer && read < overWritePicBuffer * consumers)
             {
                 read = m_parentEnc->m_parent->m_picIdxReadCnt[m_id][writeIdx].waitForChange(read);
             }
 
             x265_picture* dest = m_parentEnc->m_parent->m_inputPicBuffer[m_id][writeIdx];
-            if (m_input->readPicture(*src))
+            /* every encoder has copied the picture this slot held */
+            if (m_bMapped && overWritePicBuffer)
+                m_input->releasePicture(*dest);
+            bool bFramesDone = m_parentEnc->m_cliopt.framesToBeEncoded && written >= m_parentEnc->m_cliopt.framesToBeEncoded;
+            if (!bFramesDone && m_input->readPicture(*src))
             {
                 dest->poc = src->poc;
                 dest->pts = src->pts;
@@ -1091,12 +1311,22 @@ ret:
                 dest->stride[1] = src->stride[1];
                 dest->stride[2] = src->stride[2];
 
-                if (!dest->planes[0])
-                    dest->planes[0] = X265_MALLOC(char, dest->framesize);
+                if (m_bMapped)
+                {
+                    /* the mapping outlives the encoders, so the encoder's own copy is the only one */
+                    dest->planes[0] = src->planes[0];
+                    dest->planes[1] = src->planes[1];
+                    dest->planes[2] = src->planes[2];
+                }
+                else
+                {
+                    if (!dest->planes[0])
+                        dest->planes[0] = X265_MALLOC(char, dest->framesize);
 
-                memcpy(dest->planes[0], src->planes[0], src->framesize * sizeof(char));
-                dest->planes[1] = (char*)dest->planes[0] + src->stride[0] * src->height;
-                dest->planes[2] = (char*)dest->planes[1] + src->stride[1] * (src->height >> x265_cli_csps[src->colorSpace].height[1]);
+                    memcpy(dest->planes[0], src->planes[0], src->framesize * sizeof(char));
+                    dest->planes[1] = (char*)dest->planes[0] + src->stride[0] * src->height;
+                    dest->planes[2] = (char*)dest->planes[1] + src->stride[1] * (src->height >> x265_cli_csps[src->colorSpace].height[1]);
+                }
                 m_parentEnc->m_parent->m_picWriteCnt[m_id].incr();
             }
             else
@@ -58,7 +58,17 @@ namespace X265_NS {
         ThreadSafeInteger  **m_analysisWrite; //[numEncodes][queueSize]
         ThreadSafeInteger  **m_analysisRead; //[numEncodes][queueSize]
 
+        /* Input graph: each scaled pass reads the pictures of the smallest
+         * pass which still covers its resolution, so a ladder is scaled as a
+         * cascade instead of filtering the full input once per rung. Passes
+         * with identical input pictures encode the read-only pictures of one
+         * owner pass instead of reading or scaling a private copy */
+        int                *m_scaleSrc;     //[numEncodes] source pass, -1 if not scaled
+        int                *m_picSrc;       //[numEncodes] pass owning the pictures each pass encodes
+        int                *m_picConsumers; //[numEncodes] readers of each input picture
+
         AbrEncoder(CLIOptions cliopt[], uint8_t numEncodes, int& ret);
+        void buildInputGraph(CLIOptions cliopt[]);
         bool allocBuffers();
         void destroy();
 
@@ -87,6 +97,8 @@ namespace X265_NS {
 
         CLIOptions m_cliopt;
         InputFile* m_input;
+        int      m_picWidth;      // size of the input pictures, opening the encoder pads m_param's
+        int      m_picHeight;
         const char* m_reconPlayCmd;
         FILE*    m_qpfile;
         FILE*    m_zoneFile;
@@ -109,11 +121,28 @@ namespace X265_NS {
         void threadMain();
     };
 
+    /* Scales one horizontal band of every picture handed to the parent Scaler */
+    class ScalerBand : public Thread
+    {
+    public:
+        Scaler *m_parent;
+        int m_bandId;
+        int m_threadActive;
+        Event m_workAvailable;
+
+        ScalerBand(Scaler *parent, int bandId);
+        void threadMain();
+    };
+
     class Scaler : public Thread
     {
     public:
+        enum { MAX_SCALER_BANDS = 8 };
+        enum { MIN_BAND_HEIGHT = 128 };
+
         PassEncoder *m_parentEnc;
         int m_id;
+        int m_srcId;
         int m_scalePlanes[3];
         int m_scaleFrameSize;
         uint32_t m_threadId;
@@ -122,19 +151,24 @@ namespace X265_NS {
         VideoDesc* m_srcFormat;
         VideoDesc* m_dstFormat;
         int m_threadActive;
-        ScalerFilterManager* m_filterManager;
+
+        /* each band owns its filter state, the ring buffers are not shareable */
+        int m_numBands;
+        ScalerFilterManager* m_filterManager[MAX_SCALER_BANDS];
+        ScalerBand* m_bandWorker[MAX_SCALER_BANDS];
+        ThreadSafeInteger m_bandsDone;
+
+        /* picture currently being scaled by the band workers */
+        void** m_jobSrc;
+        void** m_jobDst;
+        int m_jobSrcStride[3];
+        int m_jobDstStride[3];
 
         Scaler(int threadId, int threadNum, int id, VideoDesc *src, VideoDesc * dst, PassEncoder *parentEnc);
         bool scalePic(x265_picture *destination, x265_picture *source);
+        void scaleBand(int bandId);
         void threadMain();
-        void destroy()
-        {
-            if (m_filterManager)
-            {
-                delete m_filterManager;
-                m_filterManager = NULL;
-            }
-        }
+        void destroy();
     };
 
     class Reader : public Thread
@@ -144,6 +178,7 @@ namespace X265_NS {
         int m_id;
         InputFile* m_input;
         int m_threadActive;
+        bool m_bMapped;       // queued pictures point into the read-only input mapping
 
         Reader(int id, PassEncoder *parentEnc);
         void threadMain();
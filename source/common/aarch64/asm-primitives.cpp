@@ -297,6 +297,8 @@ extern "C" {
 #include "dct-prim.h"
 #include "loopfilter-prim.h"
 #include "intrapred-prim.h"
+#include "temporalfilter-prim.h"
+#include "scaler-prim.h"
 
 namespace X265_NS
 {
@@ -324,6 +326,8 @@ void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask)
         setupDCTPrimitives_neon(p);
         setupLoopFilterPrimitives_neon(p);
         setupIntraPrimitives_neon(p);
+        setupTemporalFilterPrimitives_neon(p);
+        setupScalerPrimitives_neon(p);
 
         ALL_CHROMA_420_PU(p2s[NONALIGNED], filterPixelToShort, neon);
         ALL_CHROMA_422_PU(p2s[ALIGNED], filterPixelToShort, neon);
@@ -0,0 +1,148 @@
+#if HAVE_NEON
+
+#include "scaler-prim.h"
+#include <arm_neon.h>
+
+namespace
+{
+
+using namespace X265_NS;
+
+/* Kernels for depth-bit samples, bytes for 8 and 16-bit words for 10,
+ * bit-exact with doScaling_c and yuv2PlaneX_c of the same depth */
+template<int depth>
+struct ScalerShifts
+{
+    enum
+    {
+        HFILTER_SHIFT = depth - 1,
+        VFILTER_SHIFT = 27 - depth,
+        VFILTER_ROUND = 1 << (VFILTER_SHIFT - 1),
+        VFILTER_MAX   = (1 << depth) - 1
+    };
+};
+
+template<int depth>
+static inline int16x8_t loadTaps8(const uint8_t *src, int pos)
+{
+    if (depth == 8)
+        return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src + pos)));
+    else
+        return vreinterpretq_s16_u16(vld1q_u16((const uint16_t *)src + pos));
+}
+
+template<int depth>
+static inline int16x4_t loadTaps4(const uint8_t *src, int pos)
+{
+    if (depth == 8)
+    {
+        uint8x8_t in = vreinterpret_u8_u32(vld1_dup_u32((const uint32_t *)(src + pos)));
+        return vreinterpret_s16_u16(vget_low_u16(vmovl_u8(in)));
+    }
+    else
+        return vreinterpret_s16_u16(vld1_u16((const uint16_t *)src + pos));
+}
+
+template<int depth>
+static inline int loadSample(const uint8_t *src, int pos)
+{
+    return depth == 8 ? (int)src[pos] : (int)((const uint16_t *)src)[pos];
+}
+
+template<int depth>
+static void scalerHFilter_neon(int16_t *dst, int dstW, const uint8_t *src, const int16_t *filter, const int32_t *filterPos, int filterSize)
+{
+    int i = 0;
+
+    /* padded filters (ScalerFilter::padCoeff) come in whole groups of four taps */
+    if (!(filterSize & 3))
+    {
+        for (; i < dstW; i++)
+        {
+            const int16_t *f = filter + filterSize * i;
+            const int pos = filterPos[i];
+            int32x4_t sum = vdupq_n_s32(0);
+            int j = 0;
+            for (; j + 8 <= filterSize; j += 8)
+            {
+                int16x8_t s = loadTaps8<depth>(src, pos + j);
+                int16x8_t c = vld1q_s16(f + j);
+                sum = vmlal_s16(sum, vget_low_s16(s), vget_low_s16(c));
+                sum = vmlal_s16(sum, vget_high_s16(s), vget_high_s16(c));
+            }
+            if (j < filterSize)
+                sum = vmlal_s16(sum, loadTaps4<depth>(src, pos + j), vld1_s16(f + j));
+
+            dst[i] = (int16_t)x265_clip3(-(1 << 15), (1 << 15) - 1, vaddvq_s32(sum) >> ScalerShifts<depth>::HFILTER_SHIFT);
+        }
+    }
+
+    for (; i < dstW; i++)
+    {
+        int val = 0;
+        const int sourcePos = filterPos[i];
+        for (int j = 0; j < filterSize; j++)
+            val += loadSample<depth>(src, sourcePos + j) * filter[filterSize * i + j];
+        dst[i] = (int16_t)x265_clip3(-(1 << 15), (1 << 15) - 1, val >> ScalerShifts<depth>::HFILTER_SHIFT);
+    }
+}
+
+template<int depth>
+static void scalerVFilter_neon(const int16_t *filter, int filterSize, const int16_t **src, uint8_t *dest, int dstW)
+{
+    const int shift = ScalerShifts<depth>::VFILTER_SHIFT;
+    const int maxVal = ScalerShifts<depth>::VFILTER_MAX;
+    int i = 0;
+
+    for (; i + 8 <= dstW; i += 8)
+    {
+        int32x4_t sumLo = vdupq_n_s32(ScalerShifts<depth>::VFILTER_ROUND);
+        int32x4_t sumHi = vdupq_n_s32(ScalerShifts<depth>::VFILTER_ROUND);
+        for (int j = 0; j < filterSize; j++)
+        {
+            int16x8_t s = vld1q_s16(src[j] + i);
+            sumLo = vmlal_n_s16(sumLo, vget_low_s16(s), filter[j]);
+            sumHi = vmlal_n_s16(sumHi, vget_high_s16(s), filter[j]);
+        }
+
+        int16x8_t out = vcombine_s16(vqmovn_s32(vshrq_n_s32(sumLo, ScalerShifts<depth>::VFILTER_SHIFT)),
+                                     vqmovn_s32(vshrq_n_s32(sumHi, ScalerShifts<depth>::VFILTER_SHIFT)));
+        if (depth == 8)
+            vst1_u8(dest + i, vqmovun_s16(out));
+        else
+        {
+            out = vmaxq_s16(vminq_s16(out, vdupq_n_s16(maxVal)), vdupq_n_s16(0));
+            vst1q_u16((uint16_t *)dest + i, vreinterpretq_u16_s16(out));
+        }
+    }
+
+    for (; i < dstW; i++)
+    {
+        int val = ScalerShifts<depth>::VFILTER_ROUND;
+        for (int j = 0; j < filterSize; j++)
+            val += src[j][i] * filter[j];
+        const int d = x265_clip3(0, maxVal, val >> shift);
+        if (depth == 8)
+            dest[i] = (uint8_t)d;
+        else
+            ((uint16_t *)dest)[i] = (uint16_t)d;
+    }
+}
+
+}
+
+namespace X265_NS
+{
+
+void setupScalerPrimitives_neon(EncoderPrimitives &p)
+{
+    p.scalerHFilter[SCALER_8BIT] = scalerHFilter_neon<8>;
+    p.scalerVFilter[SCALER_8BIT] = scalerVFilter_neon<8>;
+    p.scalerHFilter[SCALER_10BIT] = scalerHFilter_neon<10>;
+    p.scalerVFilter[SCALER_10BIT] = scalerVFilter_neon<10>;
+}
+
+};
+
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _SCALER_PRIM_ARM64_H__
+#define _SCALER_PRIM_ARM64_H__
+
+
+#include "common.h"
+#include "primitives.h"
+#include "x265.h"
+
+
+namespace X265_NS
+{
+
+
+void setupScalerPrimitives_neon(EncoderPrimitives &p);
+
+};
+
+
+#endif
@@ -0,0 +1,162 @@
+#if HAVE_NEON
+
+#include "temporalfilter-prim.h"
+#include "temporalfilter.h"
+#include <arm_neon.h>
+
+namespace
+{
+
+using namespace X265_NS;
+
+
+static inline int32x4_t load4_s32(const pixel *src)
+{
+#if HIGH_BIT_DEPTH
+    return vreinterpretq_s32_u32(vmovl_u16(vld1_u16(src)));
+#else
+    uint8x8_t in = vreinterpret_u8_u32(vld1_dup_u32((const uint32_t *)src));
+    return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vmovl_u8(in))));
+#endif
+}
+
+/* Separable 6-tap interpolation of a width x height block (width a multiple
+ * of 4) into 32-bit samples clipped to the pixel range, MAX_CU_SIZE stride */
+static void interpBlock_neon(const pixel *src, intptr_t srcStride, int32_t *dst, int width, int height, int fracX, int fracY)
+{
+    ALIGN_VAR_32(int32_t, tmp[(MAX_CU_SIZE + 5) * MAX_CU_SIZE]);
+    const int *xFilter = s_interpolationFilter[fracX];
+    const int *yFilter = s_interpolationFilter[fracY];
+
+    const pixel *srcRow = src - 2 * srcStride - 2;
+    for (int y = 0; y < height + 5; y++, srcRow += srcStride)
+    {
+        int32_t *t = tmp + y * MAX_CU_SIZE;
+        for (int x = 0; x < width; x += 4)
+        {
+            int32x4_t sum = vmulq_n_s32(load4_s32(srcRow + x), xFilter[1]);
+            sum = vmlaq_n_s32(sum, load4_s32(srcRow + x + 1), xFilter[2]);
+            sum = vmlaq_n_s32(sum, load4_s32(srcRow + x + 2), xFilter[3]);
+            sum = vmlaq_n_s32(sum, load4_s32(srcRow + x + 3), xFilter[4]);
+            sum = vmlaq_n_s32(sum, load4_s32(srcRow + x + 4), xFilter[5]);
+            sum = vmlaq_n_s32(sum, load4_s32(srcRow + x + 5), xFilter[6]);
+            vst1q_s32(t + x, sum);
+        }
+    }
+
+    const int32x4_t maxVal = vdupq_n_s32((1 << X265_DEPTH) - 1);
+    const int32x4_t zero = vdupq_n_s32(0);
+    for (int y = 0; y < height; y++)
+    {
+        const int32_t *t = tmp + y * MAX_CU_SIZE;
+        int32_t *d = dst + y * MAX_CU_SIZE;
+        for (int x = 0; x < width; x += 4)
+        {
+            int32x4_t sum = vmulq_n_s32(vld1q_s32(t + x), yFilter[1]);
+            sum = vmlaq_n_s32(sum, vld1q_s32(t + 1 * MAX_CU_SIZE + x), yFilter[2]);
+            sum = vmlaq_n_s32(sum, vld1q_s32(t + 2 * MAX_CU_SIZE + x), yFilter[3]);
+            sum = vmlaq_n_s32(sum, vld1q_s32(t + 3 * MAX_CU_SIZE + x), yFilter[4]);
+            sum = vmlaq_n_s32(sum, vld1q_s32(t + 4 * MAX_CU_SIZE + x), yFilter[5]);
+            sum = vmlaq_n_s32(sum, vld1q_s32(t + 5 * MAX_CU_SIZE + x), yFilter[6]);
+            sum = vrshrq_n_s32(sum, 12);
+            sum = vmaxq_s32(vminq_s32(sum, maxVal), zero);
+            vst1q_s32(d + x, sum);
+        }
+    }
+}
+
+static void mcstfApplyMotion_neon(const pixel *src, intptr_t srcStride, pixel *dst, intptr_t dstStride, int width, int height, int fracX, int fracY)
+{
+    X265_CHECK(!(width & 3) && width <= MAX_CU_SIZE && height <= MAX_CU_SIZE, "mcstf block size not supported\n");
+    ALIGN_VAR_32(int32_t, pred[MAX_CU_SIZE * MAX_CU_SIZE]);
+    interpBlock_neon(src, srcStride, pred, width, height, fracX, fracY);
+
+    for (int y = 0; y < height; y++, dst += dstStride)
+    {
+        const int32_t *p = pred + y * MAX_CU_SIZE;
+        for (int x = 0; x < width; x += 4)
+        {
+            uint16x4_t v = vmovn_u32(vreinterpretq_u32_s32(vld1q_s32(p + x)));
+#if HIGH_BIT_DEPTH
+            vst1_u16(dst + x, v);
+#else
+            uint8x8_t v8 = vmovn_u16(vcombine_u16(v, v));
+            vst1_lane_u32((uint32_t *)(dst + x), vreinterpret_u32_u8(v8), 0);
+#endif
+        }
+    }
+}
+
+template<bool bSSD>
+static int mcstfSubpelError_neon(const pixel *org, intptr_t orgStride, const pixel *ref, intptr_t refStride, int bs, int fracX, int fracY, int bestError)
+{
+    X265_CHECK(!(bs & 3) && bs <= MAX_CU_SIZE, "mcstf block size not supported\n");
+    ALIGN_VAR_32(int32_t, pred[MAX_CU_SIZE * MAX_CU_SIZE]);
+    interpBlock_neon(ref, refStride, pred, bs, bs, fracX, fracY);
+
+    int error = 0;
+    for (int y = 0; y < bs; y++, org += orgStride)
+    {
+        const int32_t *p = pred + y * MAX_CU_SIZE;
+        int32x4_t acc = vdupq_n_s32(0);
+        for (int x = 0; x < bs; x += 4)
+        {
+            int32x4_t d = vsubq_s32(vld1q_s32(p + x), load4_s32(org + x));
+            if (bSSD)
+                acc = vmlaq_s32(acc, d, d);
+            else
+                acc = vaddq_s32(acc, vabsq_s32(d));
+        }
+        error += vaddvq_s32(acc);
+        if (error > bestError)
+            return error;
+    }
+    return error;
+}
+
+static void mcstfWeightAcc_neon(const pixel *org, intptr_t orgStride, const pixel *ref, intptr_t refStride, int width, int height,
+                                const double *expTable, double scale, double *sumVal, double *sumWeight, intptr_t sumStride)
+{
+    for (int y = 0; y < height; y++)
+    {
+        int x = 0;
+        for (; x + 2 <= width; x += 2)
+        {
+            const int ref0 = ref[x], ref1 = ref[x + 1];
+            float64x2_t e = { expTable[abs(ref0 - org[x])], expTable[abs(ref1 - org[x + 1])] };
+            float64x2_t r = { (double)ref0, (double)ref1 };
+            float64x2_t w = vmulq_n_f64(e, scale);
+            vst1q_f64(sumVal + x, vaddq_f64(vld1q_f64(sumVal + x), vmulq_f64(w, r)));
+            vst1q_f64(sumWeight + x, vaddq_f64(vld1q_f64(sumWeight + x), w));
+        }
+        for (; x < width; x++)
+        {
+            const int refVal = ref[x];
+            const double weight = scale * expTable[abs(refVal - org[x])];
+            sumVal[x] += weight * refVal;
+            sumWeight[x] += weight;
+        }
+        org += orgStride;
+        ref += refStride;
+        sumVal += sumStride;
+        sumWeight += sumStride;
+    }
+}
+
+}
+
+namespace X265_NS
+{
+
+void setupTemporalFilterPrimitives_neon(EncoderPrimitives &p)
+{
+    p.mcstfSubpelSAD = mcstfSubpelError_neon<false>;
+    p.mcstfSubpelSSD = mcstfSubpelError_neon<true>;
+    p.mcstfApplyMotion = mcstfApplyMotion_neon;
+    p.mcstfWeightAcc = mcstfWeightAcc_neon;
+}
+
+};
+
+
+#endif
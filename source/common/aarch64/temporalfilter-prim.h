@@ -0,0 +1,19 @@
+#ifndef _TEMPORALFILTER_PRIM_ARM64_H__
+#define _TEMPORALFILTER_PRIM_ARM64_H__
+
+
+#include "common.h"
+#include "primitives.h"
+#include "x265.h"
+
+
+namespace X265_NS
+{
+
+
+void setupTemporalFilterPrimitives_neon(EncoderPrimitives &p);
+
+};
+
+
+#endif
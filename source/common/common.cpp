@@ -33,6 +33,10 @@
 #include <fcntl.h>
 #else
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace X265_NS {
@@ -306,4 +310,72 @@ error:
     return NULL;
 }
 
+/* Read-only view of a whole file, whose pages are read on first access.
+ * Windows falls back to reading the file into memory. Returns NULL if the
+ * file can't be opened or is empty */
+void* x265_map_file(const char *filename, size_t *size)
+{
+    if (!filename)
+        return NULL;
+
+#if _WIN32
+    FILE *fh = x265_fopen(filename, "rb");
+    if (!fh)
+    {
+        x265_log_file(NULL, X265_LOG_ERROR, "unable to open file %s\n", filename);
+        return NULL;
+    }
+
+    char *buf = NULL;
+    long fSize;
+    if (!fseek(fh, 0, SEEK_END) && (fSize = ftell(fh)) > 0 && !fseek(fh, 0, SEEK_SET))
+    {
+        buf = X265_MALLOC(char, fSize);
+        if (buf && fread(buf, 1, fSize, fh) != (size_t)fSize)
+        {
+            X265_FREE(buf);
+            buf = NULL;
+        }
+        *size = fSize;
+    }
+    fclose(fh);
+    if (!buf)
+        x265_log(NULL, X265_LOG_ERROR, "unable to read the file\n");
+    return buf;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        x265_log_file(NULL, X265_LOG_ERROR, "unable to open file %s\n", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    void *base = NULL;
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0 && (uint64_t)st.st_size <= (uint64_t)SIZE_MAX)
+    {
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED)
+            base = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    if (!base)
+        x265_log(NULL, X265_LOG_ERROR, "unable to map the file\n");
+    return base;
+#endif
+}
+
+void x265_unmap_file(void *base, size_t size)
+{
+    if (!base)
+        return;
+#if _WIN32
+    (void)size;
+    X265_FREE(base);
+#else
+    munmap(base, size);
+#endif
+}
+
 }
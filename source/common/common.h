@@ -455,6 +455,8 @@ uint32_t x265_picturePlaneSize(int csp, int width, int height, int plane);
 void*    x265_malloc(size_t size);
 void     x265_free(void *ptr);
 char*    x265_slurp_file(const char *filename);
+void*    x265_map_file(const char *filename, size_t *size);
+void     x265_unmap_file(void *base, size_t size);
 
 /* located in primitives.cpp */
 void     x265_setup_primitives(x265_param* param);
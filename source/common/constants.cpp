@@ -267,6 +267,8 @@ const int16_t g_chromaFilter[8][NTAPS_CHROMA] =
     { -2, 10, 58, -2 }
 };
 
+const uint16_t g_motionBlurTaps[5] = { 3571, 16004, 26386, 16004, 3571 };
+
 const int16_t g_t4[4][4] =
 {
     { 64, 64, 64, 64 },
@@ -72,6 +72,7 @@ extern const int16_t g_t32[32][32];
 
 extern const int16_t g_lumaFilter[4][NTAPS_LUMA];      // Luma filter taps
 extern const int16_t g_chromaFilter[8][NTAPS_CHROMA];  // Chroma filter taps
+extern const uint16_t g_motionBlurTaps[5];             // VMAF motion blur taps, 16 fraction bits, symmetric
 
 // Scanning order & context mapping table
 
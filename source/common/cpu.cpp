@@ -75,6 +75,7 @@ const cpu_name_t cpu_names[] =
     { "SSE2",        SSE2 },
     { "SSE2Fast",    SSE2 | X265_CPU_SSE2_IS_FAST },
     { "LZCNT", X265_CPU_LZCNT },
+    { "PCLMUL",      X265_CPU_PCLMUL },
     { "SSE3",        SSE2 | X265_CPU_SSE3 },
     { "SSSE3",       SSE2 | X265_CPU_SSE3 | X265_CPU_SSSE3 },
     { "SSE4.1",      SSE2 | X265_CPU_SSE3 | X265_CPU_SSSE3 | X265_CPU_SSE4 },
@@ -164,6 +165,8 @@ uint32_t cpu_detect(bool benableavx512 )
         cpu |= X265_CPU_SSE2;
     if (ecx & 0x00000001)
         cpu |= X265_CPU_SSE3;
+    if (ecx & 0x00000002)
+        cpu |= X265_CPU_PCLMUL;
     if (ecx & 0x00000200)
         cpu |= X265_CPU_SSSE3 | X265_CPU_SSE2_IS_FAST;
     if (ecx & 0x00080000)
@@ -314,11 +314,18 @@ void CUData::initCTU(const Frame& frame, uint32_t cuAddr, int qp, uint32_t first
 
     m_vbvAffected = false;
 
+    /* neighbor CTUs are only available within the same tile */
+    const PPS& pps = *m_slice->m_pps;
     uint32_t widthInCU = m_slice->m_sps->numCuInWidth;
-    m_cuLeft = (m_cuAddr % widthInCU) ? m_encData->getPicCTU(m_cuAddr - 1) : NULL;
-    m_cuAbove = (m_cuAddr >= widthInCU) && !m_bFirstRowInSlice ? m_encData->getPicCTU(m_cuAddr - widthInCU) : NULL;
+    uint32_t col = m_cuAddr % widthInCU;
+    uint32_t row = m_cuAddr / widthInCU;
+    uint32_t tileCol = pps.getTileColumn(col);
+    m_bFirstColInTile = col == pps.tileColBd[tileCol];
+    m_bFirstRowInTile = row == pps.tileRowBd[pps.getTileRow(row)];
+    m_cuLeft = !m_bFirstColInTile ? m_encData->getPicCTU(m_cuAddr - 1) : NULL;
+    m_cuAbove = !m_bFirstRowInTile && !m_bFirstRowInSlice ? m_encData->getPicCTU(m_cuAddr - widthInCU) : NULL;
     m_cuAboveLeft = (m_cuLeft && m_cuAbove) ? m_encData->getPicCTU(m_cuAddr - widthInCU - 1) : NULL;
-    m_cuAboveRight = (m_cuAbove && ((m_cuAddr % widthInCU) < (widthInCU - 1))) ? m_encData->getPicCTU(m_cuAddr - widthInCU + 1) : NULL;
+    m_cuAboveRight = (m_cuAbove && (col + 1 < pps.tileColBd[tileCol + 1])) ? m_encData->getPicCTU(m_cuAddr - widthInCU + 1) : NULL;
     memset(m_distortion, 0, m_numPartitions * sizeof(sse_t));
 }
 
@@ -338,6 +345,8 @@ void CUData::initSubCU(const CUData& ctu, const CUGeom& cuGeom, int qp)
     m_bFirstRowInSlice = ctu.m_bFirstRowInSlice;
     m_bLastRowInSlice = ctu.m_bLastRowInSlice;
     m_bLastCuInSlice = ctu.m_bLastCuInSlice;
+    m_bFirstColInTile = ctu.m_bFirstColInTile;
+    m_bFirstRowInTile = ctu.m_bFirstRowInTile;
     for (int i = 0; i < 3; i++)
     {
         m_fAc_den[i] = ctu.m_fAc_den[i];
@@ -440,6 +449,8 @@ void CUData::initLosslessCU(const CUData& cu, const CUGeom& cuGeom)
     m_cuAbove      = cu.m_cuAbove;
     m_cuAboveLeft  = cu.m_cuAboveLeft;
     m_cuAboveRight = cu.m_cuAboveRight;
+    m_bFirstColInTile = cu.m_bFirstColInTile;
+    m_bFirstRowInTile = cu.m_bFirstRowInTile;
     m_absIdxInCTU  = cuGeom.absPartIdx;
     m_numPartitions = cuGeom.numPartitions;
     memcpy(m_qp, cu.m_qp, BytesPerPartition * m_numPartitions);
@@ -878,6 +889,17 @@ int8_t CUData::getLastCodedQP(uint32_t absPartIdx) const
     {
         if (m_absIdxInCTU)
             return m_encData->getPicCTU(m_cuAddr)->getLastCodedQP(m_absIdxInCTU);
+        else if (m_slice->m_pps->bTilesEnabled && m_bFirstColInTile)
+        {
+            /* the previous CTU in tile scan is the last of the tile's row above */
+            if (m_bFirstRowInTile)
+                return (int8_t)m_slice->m_sliceQp;
+            const PPS& pps = *m_slice->m_pps;
+            uint32_t widthInCU = m_slice->m_sps->numCuInWidth;
+            uint32_t col = m_cuAddr % widthInCU;
+            uint32_t lastCol = pps.tileColBd[pps.getTileColumn(col) + 1] - 1;
+            return m_encData->getPicCTU(m_cuAddr - widthInCU + lastCol - col)->getLastCodedQP(m_encData->m_param->num4x4Partitions);
+        }
         else if (m_cuAddr > 0 && !(m_slice->m_pps->bEntropyCodingSyncEnabled && !(m_cuAddr % m_slice->m_sps->numCuInWidth)))
             return m_encData->getPicCTU(m_cuAddr - 1)->getLastCodedQP(m_encData->m_param->num4x4Partitions);
         else
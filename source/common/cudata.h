@@ -189,6 +189,10 @@ public:
     uint8_t      m_bLastRowInSlice;
     uint8_t      m_bLastCuInSlice;
 
+    /* tile informations, also set at the picture edges when tiles are disabled */
+    uint8_t      m_bFirstColInTile;
+    uint8_t      m_bFirstRowInTile;
+
     /* Per-part data, stored contiguously */
     int8_t*       m_qp;               // array of QP values
     int8_t*       m_qpAnalysis;       // array of QP values for analysis reuse
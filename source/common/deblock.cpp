@@ -43,6 +43,24 @@ void Deblock::deblockCTU(const CUData* ctu, const CUGeom& cuGeom, int32_t dir)
     deblockCU(ctu, cuGeom, dir, blockStrength);
 }
 
+/* CTU neighbors are unavailable across tile boundaries for prediction, but the
+ * loop filter is applied across them (loop_filter_across_tiles_enabled_flag) */
+static inline const CUData* getDeblockLeft(const CUData* cu, uint32_t& partP, uint32_t partQ)
+{
+    const CUData* cuP = cu->getPULeft(partP, partQ);
+    if (!cuP && cu->m_bFirstColInTile && cu->m_cuPelX)
+        cuP = cu->m_encData->getPicCTU(cu->m_cuAddr - 1);
+    return cuP;
+}
+
+static inline const CUData* getDeblockAbove(const CUData* cu, uint32_t& partP, uint32_t partQ)
+{
+    const CUData* cuP = cu->getPUAbove(partP, partQ);
+    if (!cuP && cu->m_bFirstRowInTile && cu->m_cuPelY && !cu->m_bFirstRowInSlice)
+        cuP = cu->m_encData->getPicCTU(cu->m_cuAddr - cu->m_slice->m_sps->numCuInWidth);
+    return cuP;
+}
+
 static inline uint8_t bsCuEdge(const CUData* cu, uint32_t absPartIdx, int32_t dir)
 {
     if (dir == Deblock::EDGE_VER)
@@ -50,7 +68,7 @@ static inline uint8_t bsCuEdge(const CUData* cu, uint32_t absPartIdx, int32_t di
         if (cu->m_cuPelX + g_zscanToPelX[absPartIdx] > 0)
         {
             uint32_t    tempPartIdx;
-            const CUData* tempCU = cu->getPULeft(tempPartIdx, absPartIdx);
+            const CUData* tempCU = getDeblockLeft(cu, tempPartIdx, absPartIdx);
             return tempCU ? 2 : 0;
         }
     }
@@ -59,7 +77,7 @@ static inline uint8_t bsCuEdge(const CUData* cu, uint32_t absPartIdx, int32_t di
         if (cu->m_cuPelY + g_zscanToPelY[absPartIdx] > 0)
         {
             uint32_t    tempPartIdx;
-            const CUData* tempCU = cu->getPUAbove(tempPartIdx, absPartIdx);
+            const CUData* tempCU = getDeblockAbove(cu, tempPartIdx, absPartIdx);
             return tempCU ? 2 : 0;
         }
     }
@@ -192,7 +210,7 @@ uint8_t Deblock::getBoundaryStrength(const CUData* cuQ, int32_t dir, uint32_t pa
 {
     // Calculate block index
     uint32_t partP;
-    const CUData* cuP = (dir == EDGE_VER ? cuQ->getPULeft(partP, partQ) : cuQ->getPUAbove(partP, partQ));
+    const CUData* cuP = (dir == EDGE_VER ? getDeblockLeft(cuQ, partP, partQ) : getDeblockAbove(cuQ, partP, partQ));
 
     // Set BS for Intra MB : BS = 2
     if (cuP->isIntra(partP) || cuQ->isIntra(partQ))
@@ -353,7 +371,7 @@ void Deblock::edgeFilterLuma(const CUData* cuQ, uint32_t absPartIdx, uint32_t de
 
         // Derive neighboring PU index
         uint32_t partP;
-        const CUData* cuP = (dir == EDGE_VER ? cuQ->getPULeft(partP, partQ) : cuQ->getPUAbove(partP, partQ));
+        const CUData* cuP = (dir == EDGE_VER ? getDeblockLeft(cuQ, partP, partQ) : getDeblockAbove(cuQ, partP, partQ));
 
         if (bCheckNoFilter)
         {
@@ -464,7 +482,7 @@ void Deblock::edgeFilterChroma(const CUData* cuQ, uint32_t absPartIdx, uint32_t
 
         // Derive neighboring PU index
         uint32_t partP;
-        const CUData* cuP = (dir == EDGE_VER ? cuQ->getPULeft(partP, partQ) : cuQ->getPUAbove(partP, partQ));
+        const CUData* cuP = (dir == EDGE_VER ? getDeblockLeft(cuQ, partP, partQ) : getDeblockAbove(cuQ, partP, partQ));
 
         if (bCheckNoFilter)
         {
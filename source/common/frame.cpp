@@ -64,6 +64,8 @@ Frame::Frame()
     m_edgeBitPlane = NULL;
     m_edgeBitPic = NULL;
     m_isInsideWindow = 0;
+    m_vmafMotion = 0;
+    m_motionFrameNum = -1;
 
     // mcstf
     m_isSubSampled = NULL;
@@ -155,6 +155,8 @@ public:
     pixel*                 m_edgeBitPic;
 
     int                    m_isInsideWindow;
+    double                 m_vmafMotion;    // --perceptual-metrics motion to the previous input frame
+    int                    m_motionFrameNum; // --perceptual-metrics place in the motion queue
 
     /*Frame's temporal layer info*/
     uint8_t                m_tempLayer;
@@ -71,6 +71,11 @@ bool FrameData::create(const x265_param& param, const SPS& sps, int csp)
         m_meBuffer[i] = NULL;
         m_meIntegral[i] = NULL;
     }
+    for (int i = 0; i < 3; i++)
+    {
+        m_hpelBuffer[i] = NULL;
+        m_hpelPlane[i] = NULL;
+    }
     return true;
 
 fail:
@@ -113,4 +118,9 @@ void FrameData::destroy()
             m_meBuffer[i] = NULL;
         }
     }
+    for (int i = 0; i < 3; i++)
+    {
+        X265_FREE(m_hpelBuffer[i]);
+        m_hpelBuffer[i] = NULL;
+    }
 }
@@ -37,6 +37,25 @@ class JobProvider;
 #define INTER_MODES 4 // 2Nx2N, 2NxN, Nx2N, AMP modes
 #define INTRA_MODES 3 // DC, Planar, Angular modes
 
+/* confidence in a PU's lowres motion vector, --me-confidence */
+enum LowresMVConfidence
+{
+    LOWRES_MV_LOW,    // full motion search
+    LOWRES_MV_NARROW, // short search window around the lowres MV
+    LOWRES_MV_REFINE, // square and sub-pel refinement of the lowres MV only
+    LOWRES_MV_CONFIDENCES
+};
+
+/* outcome of a CTU's analysis cache lookup, x265_param.analysisCache */
+enum AnalysisCacheLookup
+{
+    ANALYSIS_CACHE_MISS,  // no entry, full analysis
+    ANALYSIS_CACHE_STALE, // entry for another slice type or a distant QP, full analysis
+    ANALYSIS_CACHE_HIT,   // cached partitioning reused
+    ANALYSIS_CACHE_UNCACHED, // picture past the cache's frame window, full analysis
+    ANALYSIS_CACHE_LOOKUPS
+};
+
 /* Current frame stats for 2 pass */
 struct FrameStats
 {
@@ -88,6 +107,17 @@ struct FrameStats
     uint64_t    cntInterPu[NUM_CU_DEPTH][INTER_MODES - 1];
     uint64_t    cntMergePu[NUM_CU_DEPTH][INTER_MODES - 1];
 
+    /* CTUs searched with each motion search method, --adaptive-me */
+    uint32_t    cntSearchMethod[X265_FULL_SEARCH + 1];
+
+    /* PU motion searches per lowres MV confidence and confident searches
+     * ending near the lowres MV, --me-confidence */
+    uint32_t    cntLowresMVSearch[LOWRES_MV_CONFIDENCES];
+    uint32_t    cntLowresMVHit;
+
+    /* CTU analysis cache lookups per outcome */
+    uint32_t    cntAnalysisCache[ANALYSIS_CACHE_LOOKUPS];
+
     /* Feature values per row for dynamic refinement */
     uint64_t       rowRdDyn[MAX_NUM_DYN_REFINE];
     uint32_t       rowVarDyn[MAX_NUM_DYN_REFINE];
@@ -171,6 +201,9 @@ public:
     uint32_t*              m_meIntegral[INTEGRAL_PLANE_NUM];       // 12 integral planes for 32x32, 32x24, 32x8, 24x32, 16x16, 16x12, 16x4, 12x16, 8x32, 8x8, 4x16 and 4x4.
     uint32_t*              m_meBuffer[INTEGRAL_PLANE_NUM];
 
+    pixel*                 m_hpelPlane[3];  // --hpel-cache: half-pel luma planes (H, V, HV) of the recon picture
+    pixel*                 m_hpelBuffer[3];
+
     FrameData();
 
     bool create(const x265_param& param, const SPS& sps, int csp);
@@ -26,6 +26,10 @@
 
 using namespace X265_NS;
 
+namespace X265_NS {
+int satd_8x8_c(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2); // pixel.cpp
+}
+
 namespace {
 
 template<int tuSize>
@@ -232,6 +236,78 @@ void all_angs_pred_c(pixel *dest, pixel *refPix, pixel *filtPix, int bLuma)
         }
     }
 }
+
+/* Intra cost estimate of the lookahead for a run of horizontally adjacent 8x8
+ * lowres blocks: DC and planar, every fifth angular mode, then a refinement
+ * around the best angle. Neighbours are source pixels of the padded plane.
+ * Calls the C kernels directly so it stays a reference for the SIMD versions */
+void lowres_intra_cost_c(const pixel* src, intptr_t stride, int numBlocks, int32_t* costs, uint8_t* modes)
+{
+    const int cuSize = 8;
+    const int cuSize2 = cuSize << 1;
+    const int costMax = 1 << 28;
+
+    ALIGN_VAR_32(pixel, prediction[cuSize * cuSize]);
+    pixel neighbours[2][cuSize * 4 + 1];
+    pixel* samples = neighbours[0], *filtered = neighbours[1];
+
+    for (int blk = 0; blk < numBlocks; blk++)
+    {
+        const pixel* fenc = src + blk * cuSize;
+
+        /* collect reference sample pixels */
+        const pixel* pixCur = fenc - stride - 1;
+        memcpy(samples, pixCur, (cuSize2 + 1) * sizeof(pixel)); /* top */
+        for (int i = 1; i <= cuSize2; i++)
+            samples[cuSize2 + i] = pixCur[i * stride];          /* left */
+
+        intraFilter<cuSize>(samples, filtered);
+
+        int cost, icost = costMax;
+        uint32_t ilowmode = 0;
+
+        /* DC and planar */
+        intra_pred_dc_c<cuSize>(prediction, cuSize, samples, 0, 1);
+        cost = satd_8x8_c(fenc, stride, prediction, cuSize);
+        COPY2_IF_LT(icost, cost, ilowmode, DC_IDX);
+
+        planar_pred_c<3>(prediction, cuSize, filtered, 0, 0);
+        cost = satd_8x8_c(fenc, stride, prediction, cuSize);
+        COPY2_IF_LT(icost, cost, ilowmode, PLANAR_IDX);
+
+        /* scan angular predictions */
+        int filter, acost = costMax;
+        uint32_t mode, alowmode = 4;
+        for (mode = 5; mode < 35; mode += 5)
+        {
+            filter = !!(g_intraFilterFlags[mode] & cuSize);
+            intra_pred_ang_c<cuSize>(prediction, cuSize, neighbours[filter], mode, 1);
+            cost = satd_8x8_c(fenc, stride, prediction, cuSize);
+            COPY2_IF_LT(acost, cost, alowmode, mode);
+        }
+        for (uint32_t dist = 2; dist >= 1; dist--)
+        {
+            int minusmode = alowmode - dist;
+            int plusmode = alowmode + dist;
+
+            mode = minusmode;
+            filter = !!(g_intraFilterFlags[mode] & cuSize);
+            intra_pred_ang_c<cuSize>(prediction, cuSize, neighbours[filter], mode, 1);
+            cost = satd_8x8_c(fenc, stride, prediction, cuSize);
+            COPY2_IF_LT(acost, cost, alowmode, mode);
+
+            mode = plusmode;
+            filter = !!(g_intraFilterFlags[mode] & cuSize);
+            intra_pred_ang_c<cuSize>(prediction, cuSize, neighbours[filter], mode, 1);
+            cost = satd_8x8_c(fenc, stride, prediction, cuSize);
+            COPY2_IF_LT(acost, cost, alowmode, mode);
+        }
+        COPY2_IF_LT(icost, acost, ilowmode, alowmode);
+
+        costs[blk] = icost;
+        modes[blk] = (uint8_t)ilowmode;
+    }
+}
 }
 
 namespace X265_NS {
@@ -266,5 +342,7 @@ void setupIntraPrimitives_c(EncoderPrimitives& p)
     p.cu[BLOCK_8x8].intra_pred_allangs = all_angs_pred_c<3>;
     p.cu[BLOCK_16x16].intra_pred_allangs = all_angs_pred_c<4>;
     p.cu[BLOCK_32x32].intra_pred_allangs = all_angs_pred_c<5>;
+
+    p.lowresIntraCost = lowres_intra_cost_c;
 }
 }
@@ -36,6 +36,11 @@ namespace X265_NS {
 #define NUMBER_OF_SEGMENTS_IN_WIDTH      4
 #define NUMBER_OF_SEGMENTS_IN_HEIGHT     4
 
+/* --hpel-cache planes cover the padded luma plane less this border, where
+ * the 8-tap filters would read outside the picture buffer */
+#define HPEL_CACHE_BORDER_X              8
+#define HPEL_CACHE_BORDER_Y              4
+
 struct ReferencePlanes
 {
     ReferencePlanes() { memset(this, 0, sizeof(ReferencePlanes)); }
@@ -44,6 +49,10 @@ struct ReferencePlanes
     pixel*   lowresPlane[4];
     PicYuv*  reconPic;
 
+    /* cached half-pel luma planes (H, V, HV) laid out like fpelPlane[0], or
+     * NULL when not available (--no-hpel-cache, weighted or lowres) */
+    pixel*   hpelPlane[3];
+
     /* 1/16th resolution : Level-0 HME planes */
     pixel*   fpelLowerResPlane[3];
     pixel*   lowerResPlane[4];
@@ -397,6 +397,31 @@ void x265_param_default(x265_param* param)
     /* Film grain characteristics model filename */
     param->filmGrain = NULL;
     param->bEnableSBRC = 0;
+    param->bAnalysisSaveCompress = 0;
+    param->bWorkStealing = 0;
+    param->tileColumns = 1;
+    param->tileRows = 1;
+    memset(param->tileColumnWidths, 0, sizeof(param->tileColumnWidths));
+    memset(param->tileRowHeights, 0, sizeof(param->tileRowHeights));
+    param->bSubFrameOutput = 0;
+    param->bHpelCache = 0;
+    param->bAdaptiveSearch = 0;
+    param->bMEConfidence = 0;
+    param->mdModel = NULL;
+    param->mdStats = NULL;
+    param->analysisCache = NULL;
+    param->analysisCacheQpDelta = 4;
+    param->analysisCacheFrames = 1000;
+    param->numCrfProbes = 0;
+    memset(param->crfProbes, 0, sizeof(param->crfProbes));
+    param->crfProbeCsv = NULL;
+    param->bStatBinary = 0;
+    param->statSegmentStart = 0;
+    param->statSegmentEnd = 0;
+    param->bCtuMetrics = 0;
+    param->bPerceptualMetrics = 0;
+    param->nalOutputCallback = NULL;
+    param->nalOutputOpaque = NULL;
 }
 
 int x265_param_default_preset(x265_param* param, const char* preset, const char* tune)
@@ -1435,6 +1460,32 @@ int x265_param_parse(x265_param* p, const char* name, const char* value)
         OPT("film-grain") p->filmGrain = (char* )value;
         OPT("mcstf") p->bEnableTemporalFilter = atobool(value);
         OPT("sbrc") p->bEnableSBRC = atobool(value);
+        OPT("analysis-save-compress") p->bAnalysisSaveCompress = atobool(value);
+        OPT("work-stealing") p->bWorkStealing = atobool(value);
+        OPT("tiles")
+        {
+            int n = sscanf(value, "%dx%d", &p->tileColumns, &p->tileRows);
+            if (n == 1)
+                p->tileRows = 1;
+            else if (n != 2)
+                bError = true;
+        }
+        OPT("tile-column-widths") bError |= parseTileSizes(value, p->tileColumnWidths, X265_MAX_TILE_COLUMNS - 1, p->tileColumns);
+        OPT("tile-row-heights") bError |= parseTileSizes(value, p->tileRowHeights, X265_MAX_TILE_ROWS - 1, p->tileRows);
+        OPT("sub-frame-output") p->bSubFrameOutput = atobool(value);
+        OPT("hpel-cache") p->bHpelCache = atobool(value);
+        OPT("adaptive-me") p->bAdaptiveSearch = atobool(value);
+        OPT("me-confidence") p->bMEConfidence = atobool(value);
+        OPT("md-model") p->mdModel = strdup(value);
+        OPT("md-stats") p->mdStats = strdup(value);
+        OPT("analysis-cache-qp-delta") p->analysisCacheQpDelta = atoi(value);
+        OPT("analysis-cache-frames") p->analysisCacheFrames = atoi(value);
+        OPT("crf-probe") bError |= parseCRFProbes(value, p->crfProbes, p->numCrfProbes);
+        OPT("crf-probe-csv") p->crfProbeCsv = strdup(value);
+        OPT("stats-binary") p->bStatBinary = atobool(value);
+        OPT("stats-segment") bError |= sscanf(value, "%d,%d", &p->statSegmentStart, &p->statSegmentEnd) != 2;
+        OPT("ctu-metrics") p->bCtuMetrics = atobool(value);
+        OPT("perceptual-metrics") p->bPerceptualMetrics = atobool(value);
         else
             return X265_PARAM_BAD_NAME;
     }
@@ -1595,6 +1646,26 @@ int x265_check_params(x265_param* param)
 
     CHECK((param->maxSlices > 1) && !param->bEnableWavefront,
         "Multiple-Slices mode must be enable Wavefront Parallel Processing (--wpp)");
+    CHECK(param->tileColumns < 1 || param->tileColumns > X265_MAX_TILE_COLUMNS,
+        "Tile columns must be between 1 and 20");
+    CHECK(param->tileRows < 1 || param->tileRows > X265_MAX_TILE_ROWS,
+        "Tile rows must be between 1 and 22");
+    if (param->tileColumnWidths[0])
+    {
+        int listed = 0;
+        while (listed < X265_MAX_TILE_COLUMNS - 1 && param->tileColumnWidths[listed])
+            listed++;
+        CHECK(listed != param->tileColumns - 1,
+            "--tiles column count conflicts with --tile-column-widths");
+    }
+    if (param->tileRowHeights[0])
+    {
+        int listed = 0;
+        while (listed < X265_MAX_TILE_ROWS - 1 && param->tileRowHeights[listed])
+            listed++;
+        CHECK(listed != param->tileRows - 1,
+            "--tiles row count conflicts with --tile-row-heights");
+    }
     CHECK(param->internalBitDepth != X265_DEPTH,
           "internalBitDepth must match compiled bit depth");
     CHECK(param->minCUSize != 32 && param->minCUSize != 16 && param->minCUSize != 8,
@@ -1896,6 +1967,9 @@ int x265_check_params(x265_param* param)
     CHECK(param->confWinRightOffset < 0, "Conformance Window Right Offset must be 0 or greater");
     CHECK(param->confWinBottomOffset < 0, "Conformance Window Bottom Offset must be 0 or greater");
     CHECK(param->decoderVbvMaxRate < 0, "Invalid Decoder Vbv Maxrate. Value can not be less than zero");
+    CHECK(param->analysisCacheQpDelta < 0 || param->analysisCacheQpDelta > QP_MAX_SPEC,
+          "Analysis cache QP delta must be between 0 and 51");
+    CHECK(param->analysisCacheFrames < 0, "Analysis cache frames must be 0 or greater");
     if (param->bliveVBV2pass)
     {
         CHECK((param->rc.bStatRead == 0), "Live VBV in multi pass option requires rate control 2 pass to be enabled");
@@ -1905,6 +1979,8 @@ int x265_check_params(x265_param* param)
             x265_log(param, X265_LOG_WARNING, "Live VBV enabled without VBV settings.Disabling live VBV in 2 pass\n");
         }
     }
+    CHECK(param->statSegmentStart < 0 || param->statSegmentEnd < 0 || (param->statSegmentEnd && param->statSegmentEnd < param->statSegmentStart),
+          "Invalid stats segment, the last frame must follow the first\n");
     CHECK(param->rc.dataShareMode != X265_SHARE_MODE_FILE && param->rc.dataShareMode != X265_SHARE_MODE_SHAREDMEM, "Invalid data share mode. It must be one of the X265_DATA_SHARE_MODES enum values\n" );
     return check_failed;
 }
@@ -2053,6 +2129,22 @@ void x265_print_params(x265_param* param)
     TOOLOPT(param->bDynamicRefine, "dynamic-refine");
     if (param->maxSlices > 1)
         TOOLVAL(param->maxSlices, "slices=%d");
+    if (param->tileColumns * param->tileRows > 1)
+    {
+        sprintf(tmp, "tiles=%dx%d", param->tileColumns, param->tileRows);
+        appendtool(param, buf, sizeof(buf), tmp);
+    }
+    TOOLOPT(param->bSubFrameOutput, "sub-frame-output");
+    TOOLOPT(param->bHpelCache, "hpel-cache");
+    TOOLOPT(param->bAdaptiveSearch, "adaptive-me");
+    TOOLOPT(param->bMEConfidence, "me-confidence");
+    TOOLOPT(param->mdModel, "md-model");
+    TOOLOPT(param->analysisCache, "analysis-cache");
+    TOOLOPT(param->numCrfProbes, "crf-probe");
+    TOOLOPT(param->bStatBinary, "stats-binary");
+    TOOLOPT(param->statSegmentStart || param->statSegmentEnd, "stats-segment");
+    TOOLOPT(param->bCtuMetrics, "ctu-metrics");
+    TOOLOPT(param->bPerceptualMetrics, "perceptual-metrics");
     if (param->bEnableLoopFilter)
     {
         if (param->deblockingFilterBetaOffset || param->deblockingFilterTCOffset)
@@ -2099,6 +2191,7 @@ char *x265_param2string(x265_param* p, int padx, int pady)
     if (p->numaPools)
         s += sprintf(s, " numa-pools=%s", p->numaPools);
     BOOL(p->bEnableWavefront, "wpp");
+    BOOL(p->bWorkStealing, "work-stealing");
     BOOL(p->bDistributeModeAnalysis, "pmode");
     BOOL(p->bDistributeMotionEstimation, "pme");
     BOOL(p->bEnablePsnr, "psnr");
@@ -2291,6 +2384,44 @@ char *x265_param2string(x265_param* p, int padx, int pady)
     BOOL(p->bEmitVUITimingInfo, "vui-timing-info");
     BOOL(p->bEmitVUIHRDInfo, "vui-hrd-info");
     s += sprintf(s, " slices=%d", p->maxSlices);
+    s += sprintf(s, " tiles=%dx%d", p->tileColumns, p->tileRows);
+    if (p->tileColumnWidths[0])
+    {
+        s += sprintf(s, " tile-column-widths=%d", p->tileColumnWidths[0]);
+        for (int i = 1; i < p->tileColumns - 1; i++)
+            s += sprintf(s, ",%d", p->tileColumnWidths[i]);
+    }
+    if (p->tileRowHeights[0])
+    {
+        s += sprintf(s, " tile-row-heights=%d", p->tileRowHeights[0]);
+        for (int i = 1; i < p->tileRows - 1; i++)
+            s += sprintf(s, ",%d", p->tileRowHeights[i]);
+    }
+    BOOL(p->bSubFrameOutput, "sub-frame-output");
+    BOOL(p->bHpelCache, "hpel-cache");
+    BOOL(p->bAdaptiveSearch, "adaptive-me");
+    BOOL(p->bMEConfidence, "me-confidence");
+    if (p->mdModel)
+        s += sprintf(s, " md-model");
+    if (p->analysisCache)
+    {
+        s += sprintf(s, " analysis-cache-qp-delta=%d", p->analysisCacheQpDelta);
+        s += sprintf(s, " analysis-cache-frames=%d", p->analysisCacheFrames);
+    }
+    if (p->numCrfProbes)
+    {
+        s += sprintf(s, " crf-probe=%.1f", p->crfProbes[0]);
+        for (int i = 1; i < p->numCrfProbes; i++)
+            s += sprintf(s, ",%.1f", p->crfProbes[i]);
+    }
+    if (p->bStatBinary)
+        s += sprintf(s, " stats-binary");
+    if (p->statSegmentStart || p->statSegmentEnd)
+        s += sprintf(s, " stats-segment=%d,%d", p->statSegmentStart, p->statSegmentEnd);
+    if (p->bCtuMetrics)
+        s += sprintf(s, " ctu-metrics");
+    if (p->bPerceptualMetrics)
+        s += sprintf(s, " perceptual-metrics");
     BOOL(p->bOptQpPPS, "opt-qp-pps");
     BOOL(p->bOptRefListLengthPPS, "opt-ref-list-length-pps");
     BOOL(p->bMultiPassOptRPS, "multi-pass-opt-rps");
@@ -2307,6 +2438,7 @@ char *x265_param2string(x265_param* p, int padx, int pady)
         s += sprintf(s, " analysis-load");
     s += sprintf(s, " analysis-reuse-level=%d", p->analysisReuseLevel);
     s += sprintf(s, " analysis-save-reuse-level=%d", p->analysisSaveReuseLevel);
+    BOOL(p->bAnalysisSaveCompress, "analysis-save-compress");
     s += sprintf(s, " analysis-load-reuse-level=%d", p->analysisLoadReuseLevel);
     s += sprintf(s, " scale-factor=%d", p->scaleFactor);
     s += sprintf(s, " refine-intra=%d", p->intraRefine);
@@ -2409,6 +2541,55 @@ bool parseLambdaFile(x265_param* param)
     return false;
 }
 
+/* parse a comma separated list of tile column widths or row heights in CTUs,
+ * the last tile column (row) is implied and not listed */
+bool parseTileSizes(const char* value, int* sizes, int maxSizes, int& numTiles)
+{
+    memset(sizes, 0, maxSizes * sizeof(int));
+
+    int count = 0;
+    const char* s = value;
+    while (*s)
+    {
+        char* end;
+        long size = strtol(s, &end, 10);
+        if (end == s || size < 1 || count == maxSizes || (*end && *end != ','))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "invalid tile size list \"%s\"\n", value);
+            memset(sizes, 0, maxSizes * sizeof(int));
+            return true;
+        }
+        sizes[count++] = (int)size;
+        s = *end ? end + 1 : end;
+    }
+
+    if (count)
+        numTiles = count + 1;
+    return false;
+}
+
+bool parseCRFProbes(const char* value, double* crfs, int& numCrfs)
+{
+    int count = 0;
+    const char* s = value;
+    while (*s)
+    {
+        char* end;
+        double crf = strtod(s, &end);
+        if (end == s || crf < 0 || crf > 51 || count == X265_MAX_CRF_PROBES || (*end && *end != ','))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "invalid CRF probe list \"%s\"\n", value);
+            numCrfs = 0;
+            return true;
+        }
+        crfs[count++] = crf;
+        s = *end ? end + 1 : end;
+    }
+
+    numCrfs = count;
+    return false;
+}
+
 bool parseMaskingStrength(x265_param* p, const char* value)
 {
     bool bError = false;
@@ -2861,6 +3042,34 @@ void x265_copy_params(x265_param* dst, x265_param* src)
     if (src->filmGrain)
         dst->filmGrain = src->filmGrain;
     dst->bEnableSBRC = src->bEnableSBRC;
+    dst->bAnalysisSaveCompress = src->bAnalysisSaveCompress;
+    dst->bWorkStealing = src->bWorkStealing;
+    dst->tileColumns = src->tileColumns;
+    dst->tileRows = src->tileRows;
+    memcpy(dst->tileColumnWidths, src->tileColumnWidths, sizeof(dst->tileColumnWidths));
+    memcpy(dst->tileRowHeights, src->tileRowHeights, sizeof(dst->tileRowHeights));
+    dst->bSubFrameOutput = src->bSubFrameOutput;
+    dst->bHpelCache = src->bHpelCache;
+    dst->bAdaptiveSearch = src->bAdaptiveSearch;
+    dst->bMEConfidence = src->bMEConfidence;
+    if (src->mdModel) dst->mdModel = strdup(src->mdModel);
+    else dst->mdModel = NULL;
+    if (src->mdStats) dst->mdStats = strdup(src->mdStats);
+    else dst->mdStats = NULL;
+    dst->analysisCache = src->analysisCache;
+    dst->analysisCacheQpDelta = src->analysisCacheQpDelta;
+    dst->analysisCacheFrames = src->analysisCacheFrames;
+    dst->numCrfProbes = src->numCrfProbes;
+    memcpy(dst->crfProbes, src->crfProbes, sizeof(dst->crfProbes));
+    if (src->crfProbeCsv) dst->crfProbeCsv = strdup(src->crfProbeCsv);
+    else dst->crfProbeCsv = NULL;
+    dst->bStatBinary = src->bStatBinary;
+    dst->statSegmentStart = src->statSegmentStart;
+    dst->statSegmentEnd = src->statSegmentEnd;
+    dst->bCtuMetrics = src->bCtuMetrics;
+    dst->bPerceptualMetrics = src->bPerceptualMetrics;
+    dst->nalOutputCallback = src->nalOutputCallback;
+    dst->nalOutputOpaque = src->nalOutputOpaque;
 }
 
 #ifdef SVT_HEVC
@@ -39,6 +39,8 @@ void  getParamAspectRatio(x265_param *p, int& width, int& height);
 bool  parseLambdaFile(x265_param *param);
 void x265_copy_params(x265_param* dst, x265_param* src);
 bool parseMaskingStrength(x265_param* p, const char* value);
+bool parseTileSizes(const char* value, int* sizes, int maxSizes, int& numTiles);
+bool parseCRFProbes(const char* value, double* crfs, int& numCrfs);
 
 /* this table is kept internal to avoid confusion, since log level indices start at -1 */
 static const char * const logLevelNames[] = { "none", "error", "warning", "info", "debug", "full", 0 };
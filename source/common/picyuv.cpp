@@ -516,81 +516,52 @@ void PicYuv::copyFromPicture(const x265_picture& pic, const x265_param& param, i
 
 namespace X265_NS {
 
-template<uint32_t OUTPUT_BITDEPTH_DIV8>
-static void md5_block(MD5Context& md5, const pixel* plane, uint32_t n)
-{
-    /* create a 64 byte buffer for packing pixel's into */
-    uint8_t buf[64 / OUTPUT_BITDEPTH_DIV8][OUTPUT_BITDEPTH_DIV8];
-
-    for (uint32_t i = 0; i < n; i++)
-    {
-        pixel pel = plane[i];
-        /* perform bitdepth and endian conversion */
-        for (uint32_t d = 0; d < OUTPUT_BITDEPTH_DIV8; d++)
-            buf[i][d] = (uint8_t)(pel >> (d * 8));
-    }
-
-    MD5Update(&md5, (uint8_t*)buf, n * OUTPUT_BITDEPTH_DIV8);
-}
-
 /* Update md5 with all samples in plane in raster order, each sample
- * is adjusted to OUTBIT_BITDEPTH_DIV8 */
+ * is adjusted to OUTPUT_BITDEPTH_DIV8 bytes in little endian byte order.
+ * NB, for 8bit data, data is truncated to 8bits. */
 template<uint32_t OUTPUT_BITDEPTH_DIV8>
 static void md5_plane(MD5Context& md5, const pixel* plane, uint32_t width, uint32_t height, intptr_t stride)
 {
-    /* N is the number of samples to process per md5 update.
-     * All N samples must fit in buf */
-    uint32_t N = 32;
-    uint32_t width_modN = width % N;
-    uint32_t width_less_modN = width - width_modN;
-
-    for (uint32_t y = 0; y < height; y++)
+#if _MSC_VER
+#pragma warning(disable: 4127) // conditional expression is constant
+#endif
+    /* 8bit samples are already packed, hash the lines in place */
+    if (sizeof(pixel) == 1 && OUTPUT_BITDEPTH_DIV8 == 1)
     {
-        /* convert pel's into uint32_t chars in little endian byte order.
-         * NB, for 8bit data, data is truncated to 8bits. */
-        for (uint32_t x = 0; x < width_less_modN; x += N)
-            md5_block<OUTPUT_BITDEPTH_DIV8>(md5, &plane[y * stride + x], N);
-
-        /* mop up any of the remaining line */
-        md5_block<OUTPUT_BITDEPTH_DIV8>(md5, &plane[y * stride + width_less_modN], width_modN);
+        for (uint32_t y = 0; y < height; y++)
+            MD5Update(&md5, (uint8_t*)&plane[y * stride], width);
+        return;
     }
-}
 
-void updateCRC(const pixel* plane, uint32_t& crcVal, uint32_t height, uint32_t width, intptr_t stride)
-{
-    uint32_t crcMsb;
-    uint32_t bitVal;
-    uint32_t bitIdx;
+    /* N is the number of samples packed per md5 update, a whole line of most
+     * pictures, so MD5Update() transforms the packed blocks in place */
+    const uint32_t N = 1024;
+    uint8_t buf[N * OUTPUT_BITDEPTH_DIV8];
 
     for (uint32_t y = 0; y < height; y++)
     {
-        for (uint32_t x = 0; x < width; x++)
+        const pixel* line = &plane[y * stride];
+        for (uint32_t x = 0; x < width; x += N)
         {
-            // take CRC of first pictureData byte
-            for (bitIdx = 0; bitIdx < 8; bitIdx++)
+            uint32_t n = X265_MIN(N, width - x);
+            for (uint32_t i = 0; i < n; i++)
             {
-                crcMsb = (crcVal >> 15) & 1;
-                bitVal = (plane[y * stride + x] >> (7 - bitIdx)) & 1;
-                crcVal = (((crcVal << 1) + bitVal) & 0xffff) ^ (crcMsb * 0x1021);
+                pixel pel = line[x + i];
+                /* perform bitdepth and endian conversion */
+                for (uint32_t d = 0; d < OUTPUT_BITDEPTH_DIV8; d++)
+                    buf[i * OUTPUT_BITDEPTH_DIV8 + d] = (uint8_t)(pel >> (d * 8));
             }
 
-#if _MSC_VER
-#pragma warning(disable: 4127) // conditional expression is constant
-#endif
-            // take CRC of second pictureData byte if bit depth is greater than 8-bits
-            if (X265_DEPTH > 8)
-            {
-                for (bitIdx = 0; bitIdx < 8; bitIdx++)
-                {
-                    crcMsb = (crcVal >> 15) & 1;
-                    bitVal = (plane[y * stride + x] >> (15 - bitIdx)) & 1;
-                    crcVal = (((crcVal << 1) + bitVal) & 0xffff) ^ (crcMsb * 0x1021);
-                }
-            }
+            MD5Update(&md5, buf, n * OUTPUT_BITDEPTH_DIV8);
         }
     }
 }
 
+void updateCRC(const pixel* plane, uint32_t& crcVal, uint32_t height, uint32_t width, intptr_t stride)
+{
+    crcVal = primitives.pictureCRC(plane, stride, width, height, crcVal);
+}
+
 void crcFinish(uint32_t& crcVal, uint8_t digest[16])
 {
     uint32_t crcMsb;
@@ -607,19 +578,8 @@ void crcFinish(uint32_t& crcVal, uint8_t digest[16])
 
 void updateChecksum(const pixel* plane, uint32_t& checksumVal, uint32_t height, uint32_t width, intptr_t stride, int row, uint32_t cuHeight)
 {
-    uint8_t xor_mask;
-
-    for (uint32_t y = row * cuHeight; y < ((row * cuHeight) + height); y++)
-    {
-        for (uint32_t x = 0; x < width; x++)
-        {
-            xor_mask = (uint8_t)((x & 0xff) ^ (y & 0xff) ^ (x >> 8) ^ (y >> 8));
-            checksumVal = (checksumVal + ((plane[y * stride + x] & 0xff) ^ xor_mask)) & 0xffffffff;
-
-            if (X265_DEPTH > 8)
-                checksumVal = (checksumVal + ((plane[y * stride + x] >> 7 >> 1) ^ xor_mask)) & 0xffffffff;
-        }
-    }
+    int firstLine = row * cuHeight;
+    checksumVal = primitives.pictureChecksum(plane + firstLine * stride, stride, width, height, firstLine, checksumVal);
 }
 
 void checksumFinish(uint32_t checksum, uint8_t digest[16])
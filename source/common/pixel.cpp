@@ -28,6 +28,7 @@
 #include "common.h"
 #include "slicetype.h"      // LOWRES_COST_MASK
 #include "primitives.h"
+#include "constants.h"
 #include "x265.h"
 
 #include <cstdlib> // abs()
@@ -1010,6 +1011,106 @@ static void normFact_c(const pixel* src, uint32_t blockSize, int shift, uint64_t
     }
 }
 
+/* The picture CRC shifts the sample bytes MSB first into a 16bit register,
+ * xoring the polynomial 0x1021 whenever a set bit falls out of it. A byte
+ * shifted in moves the register's low byte up and the bits falling out of
+ * its high byte leave a remainder which only depends on that byte, so the
+ * update is done a byte at a time from a table of the 256 remainders */
+static const struct CRCTable
+{
+    uint16_t rem[256];
+
+    CRCTable()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crcVal = i << 8;
+            for (int bitIdx = 0; bitIdx < 8; bitIdx++)
+                crcVal = ((crcVal << 1) & 0xffff) ^ (((crcVal >> 15) & 1) * 0x1021);
+            rem[i] = (uint16_t)crcVal;
+        }
+    }
+} s_crcTable;
+
+static inline uint32_t crcByte(uint32_t crcVal, uint32_t byte)
+{
+    return (((crcVal << 8) & 0xffff) | byte) ^ s_crcTable.rem[crcVal >> 8];
+}
+
+static uint32_t picture_crc_c(const pixel* plane, intptr_t stride, int width, int height, uint32_t crc)
+{
+    for (int y = 0; y < height; y++)
+    {
+        const pixel* line = &plane[y * stride];
+        for (int x = 0; x < width; x++)
+        {
+            // take CRC of first pictureData byte
+            crc = crcByte(crc, line[x] & 0xff);
+
+            // take CRC of second pictureData byte if bit depth is greater than 8-bits
+            if (X265_DEPTH > 8)
+                crc = crcByte(crc, (line[x] >> 7 >> 1) & 0xff);
+        }
+    }
+
+    return crc;
+}
+
+static uint32_t picture_checksum_c(const pixel* plane, intptr_t stride, int width, int height, int firstLine, uint32_t checksum)
+{
+    for (int y = 0; y < height; y++)
+    {
+        /* the xor mask of a sample is the low byte of x ^ y ^ (x >> 8) ^ (y >> 8),
+         * the line part is hoisted out of the sample loop */
+        const pixel* line = &plane[y * stride];
+        const uint32_t picY = firstLine + y;
+        const uint32_t yMask = (picY ^ (picY >> 8)) & 0xff;
+
+        for (int x = 0; x < width; x++)
+        {
+            uint32_t xorMask = ((x ^ (x >> 8)) & 0xff) ^ yMask;
+            checksum += (line[x] & 0xff) ^ xorMask;
+
+            if (X265_DEPTH > 8)
+                checksum += (line[x] >> 7 >> 1) ^ xorMask;
+        }
+    }
+
+    return checksum;
+}
+
+/* the 5-tap vertical pass of the lines above and below, mirrored at the
+ * picture edges by the caller, then the horizontal pass mirrored at the line
+ * ends; 8 of the 32 fraction bits are kept */
+static void motion_blur_c(uint32_t* dst, uint32_t* rowSums, const pixel* const* lines, int width)
+{
+    const uint16_t* taps = g_motionBlurTaps;
+
+    for (int x = 0; x < width; x++)
+        rowSums[x] = (uint32_t)taps[0] * lines[0][x] + (uint32_t)taps[1] * lines[1][x] + (uint32_t)taps[2] * lines[2][x] +
+                     (uint32_t)taps[3] * lines[3][x] + (uint32_t)taps[4] * lines[4][x];
+
+    for (int x = 0; x < width; x++)
+    {
+        uint64_t sum = 0;
+        for (int k = 0; k < 5; k++)
+        {
+            int i = x + k - 2;
+            i = i < 0 ? -i : i >= width ? 2 * width - 2 - i : i;
+            sum += (uint64_t)taps[k] * rowSums[i];
+        }
+        dst[x] = (uint32_t)((sum + (1 << 23)) >> 24);
+    }
+}
+
+static uint64_t motion_sad_c(const uint32_t* cur, const uint32_t* prev, int count)
+{
+    uint64_t sad = 0;
+    for (int i = 0; i < count; i++)
+        sad += cur[i] > prev[i] ? cur[i] - prev[i] : prev[i] - cur[i];
+    return sad;
+}
+
 #if HIGH_BIT_DEPTH
 static pixel planeClipAndMax_c(pixel *src, intptr_t stride, int width, int height, uint64_t *outsum, 
                                const pixel minPix, const pixel maxPix)
@@ -1033,11 +1134,32 @@ static pixel planeClipAndMax_c(pixel *src, intptr_t stride, int width, int heigh
 }
 
 #endif
+
+/* scores four candidate blocks sharing one stride (sub-pel refinement batches)
+ * through the partition's single-block SATD; the fallback when no vector
+ * kernel scores the four at once */
+template<int part>
+void satd_x4(const pixel* fenc, const pixel* fref0, const pixel* fref1, const pixel* fref2, const pixel* fref3, intptr_t frefstride, int32_t* res)
+{
+    pixelcmp_t satd = primitives.pu[part].satd;
+
+    res[0] = satd(fenc, FENC_STRIDE, fref0, frefstride);
+    res[1] = satd(fenc, FENC_STRIDE, fref1, frefstride);
+    res[2] = satd(fenc, FENC_STRIDE, fref2, frefstride);
+    res[3] = satd(fenc, FENC_STRIDE, fref3, frefstride);
+}
+
 }  // end anonymous namespace
 
 namespace X265_NS {
 // x265 private namespace
 
+/* C 8x8 SATD for C references which must not go through the primitive table */
+int satd_8x8_c(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    return satd8<8, 8>(pix1, stride_pix1, pix2, stride_pix2);
+}
+
 /* Extend the edges of a picture so that it may safely be used for motion
  * compensation. This function assumes the picture is stored in a buffer with
  * sufficient padding for the X and Y margins */
@@ -1067,6 +1189,7 @@ void setupPixelPrimitives_c(EncoderPrimitives &p)
     p.pu[LUMA_ ## W ## x ## H].sad = sad<W, H>; \
     p.pu[LUMA_ ## W ## x ## H].sad_x3 = sad_x3<W, H>; \
     p.pu[LUMA_ ## W ## x ## H].sad_x4 = sad_x4<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].satd_x4 = satd_x4<LUMA_ ## W ## x ## H>; \
     p.pu[LUMA_ ## W ## x ## H].pixelavg_pp[NONALIGNED] = pixelavg_pp<W, H>; \
     p.pu[LUMA_ ## W ## x ## H].pixelavg_pp[ALIGNED] = pixelavg_pp<W, H>;
 #define LUMA_CU(W, H) \
@@ -1358,6 +1481,10 @@ void setupPixelPrimitives_c(EncoderPrimitives &p)
 #if HIGH_BIT_DEPTH
     p.planeClipAndMax = planeClipAndMax_c;
 #endif
+    p.pictureCRC = picture_crc_c;
+    p.pictureChecksum = picture_checksum_c;
+    p.motionBlur = motion_blur_c;
+    p.motionSad = motion_sad_c;
     p.propagateCost = estimateCUPropagateCost;
     p.fix8Unpack = cuTreeFix8Unpack;
     p.fix8Pack = cuTreeFix8Pack;
@@ -59,6 +59,8 @@ void setupLoopFilterPrimitives_c(EncoderPrimitives &p);
 void setupSaoPrimitives_c(EncoderPrimitives &p);
 void setupSeaIntegralPrimitives_c(EncoderPrimitives &p);
 void setupLowPassPrimitives_c(EncoderPrimitives& p);
+void setupTemporalFilterPrimitives_c(EncoderPrimitives &p);
+void setupScalerPrimitives_c(EncoderPrimitives &p);
 
 void setupCPrimitives(EncoderPrimitives &p)
 {
@@ -70,6 +72,8 @@ void setupCPrimitives(EncoderPrimitives &p)
     setupLoopFilterPrimitives_c(p); // loopfilter.cpp
     setupSaoPrimitives_c(p);        // sao.cpp
     setupSeaIntegralPrimitives_c(p);  // framefilter.cpp
+    setupTemporalFilterPrimitives_c(p); // temporalfilter.cpp
+    setupScalerPrimitives_c(p);         // scaler.cpp
 }
 
 void enableLowpassDCTPrimitives(EncoderPrimitives &p)
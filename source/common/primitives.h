@@ -208,6 +208,14 @@ typedef void (*planecopy_cp_t) (const uint8_t* src, intptr_t srcStride, pixel* d
 typedef void (*planecopy_sp_t) (const uint16_t* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int shift, uint16_t mask);
 typedef void (*planecopy_pp_t) (const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int shift);
 typedef pixel (*planeClipAndMax_t)(pixel *src, intptr_t stride, int width, int height, uint64_t *outsum, const pixel minPix, const pixel maxPix);
+/* Decoded picture hash SEI: continue the CRC register or the checksum of a plane over height
+ * lines of width samples; firstLine is the picture line of plane, it seeds the checksum mask */
+typedef uint32_t (*picture_crc_t)(const pixel* plane, intptr_t stride, int width, int height, uint32_t crc);
+typedef uint32_t (*picture_checksum_t)(const pixel* plane, intptr_t stride, int width, int height, int firstLine, uint32_t sum);
+/* VMAF motion feature (--perceptual-metrics): blur one line from the five lines around it,
+ * and sum the absolute differences of two blurred planes */
+typedef void (*motion_blur_t)(uint32_t* dst, uint32_t* rowSums, const pixel* const* lines, int width);
+typedef uint64_t (*motion_sad_t)(const uint32_t* cur, const uint32_t* prev, int count);
 
 typedef void (*cutree_propagate_cost) (int* dst, const uint16_t* propagateIn, const int32_t* intraCosts, const uint16_t* interCosts, const int32_t* invQscales, const double* fpsFactor, int len);
 
@@ -234,6 +242,26 @@ typedef void(*ssimDistortion_t)(const pixel *fenc, uint32_t fStride, const pixel
 typedef void(*normFactor_t)(const pixel *src, uint32_t blockSize, int shift, uint64_t *z_k);
 /* SubSampling Luma */
 typedef void (*downscaleluma_t)(const pixel* src0, pixel* dstf, intptr_t src_stride, intptr_t dst_stride, int width, int height);
+/* MCSTF temporal filter */
+typedef int  (*mcstf_motion_error_t)(const pixel* org, intptr_t orgStride, const pixel* ref, intptr_t refStride, int bs, int fracX, int fracY, int bestError);
+typedef void (*mcstf_apply_motion_t)(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int fracX, int fracY);
+typedef void (*mcstf_weight_acc_t)(const pixel* org, intptr_t orgStride, const pixel* ref, intptr_t refStride, int width, int height,
+                                   const double* expTable, double scale, double* sumVal, double* sumWeight, intptr_t sumStride);
+/* ABR ladder scaler: horizontal filter of one source line into 16-bit intermediates,
+ * vertical filter of filterSize intermediate lines into one output line. There is a
+ * kernel pair per sample depth of the scaled pictures, whatever X265_DEPTH is */
+enum ScalerDepth
+{
+    SCALER_8BIT,     // 8-bit samples, one byte each
+    SCALER_10BIT,    // 10-bit samples in 16-bit words
+    NUM_SCALER_DEPTHS
+};
+
+typedef void (*scaler_hfilter_t)(int16_t* dst, int dstW, const uint8_t* src, const int16_t* filter, const int32_t* filterPos, int filterSize);
+typedef void (*scaler_vfilter_t)(const int16_t* filter, int filterSize, const int16_t** src, uint8_t* dest, int dstW);
+/* Lookahead intra estimate of numBlocks horizontally adjacent 8x8 lowres blocks. src is the
+ * first block of a padded lowres plane; writes the best SATD cost and intra mode per block */
+typedef void (*lowres_intra_cost_t)(const pixel* src, intptr_t stride, int numBlocks, int32_t* costs, uint8_t* modes);
 /* Function pointers to optimized encoder primitives. Each pointer can reference
  * either an assembly routine, a SIMD intrinsic primitive, or a C function */
 struct EncoderPrimitives
@@ -251,6 +279,7 @@ struct EncoderPrimitives
         pixelcmp_x4_t  sad_x4;      // Sum of Absolute Differences, 4 mv offsets at once
         pixelcmp_ads_t ads;         // Absolute Differences sum
         pixelcmp_t     satd;        // Sum of Absolute Transformed Differences (4x4 Hadamard)
+        pixelcmp_x4_t  satd_x4;     // Sum of Absolute Transformed Differences, 4 candidate blocks at once
 
         filter_pp_t    luma_hpp;    // 8-tap luma motion compensation interpolation filters
         filter_hps_t   luma_hps;
@@ -357,6 +386,16 @@ struct EncoderPrimitives
     downscale_t           frameInitLowerRes;
     /* Sub Sample Luma */
     downscaleluma_t        frameSubSampleLuma;
+    lowres_intra_cost_t   lowresIntraCost;
+    /* MCSTF: sub-pel block error (SAD and SSD variants), motion compensated
+     * block copy and bilateral weight accumulation */
+    mcstf_motion_error_t  mcstfSubpelSAD;
+    mcstf_motion_error_t  mcstfSubpelSSD;
+    mcstf_apply_motion_t  mcstfApplyMotion;
+    mcstf_weight_acc_t    mcstfWeightAcc;
+    /* Picture scaler kernels, indexed by ScalerDepth */
+    scaler_hfilter_t      scalerHFilter[NUM_SCALER_DEPTHS];
+    scaler_vfilter_t      scalerVFilter[NUM_SCALER_DEPTHS];
     cutree_propagate_cost propagateCost;
     cutree_fix8_unpack    fix8Unpack;
     cutree_fix8_pack      fix8Pack;
@@ -367,6 +406,10 @@ struct EncoderPrimitives
     planecopy_sp_t        planecopy_sp_shl;
     planecopy_pp_t        planecopy_pp_shr;
     planeClipAndMax_t     planeClipAndMax;
+    picture_crc_t         pictureCRC;
+    picture_checksum_t    pictureChecksum;
+    motion_blur_t         motionBlur;
+    motion_sad_t          motionSad;
 
     weightp_sp_t          weight_sp;
     weightp_pp_t          weight_pp;
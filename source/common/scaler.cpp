@@ -22,6 +22,7 @@
 *****************************************************************************/
 
 #include "scaler.h"
+#include "primitives.h"
 
 #if _MSC_VER
 #pragma warning(disable: 4706) // assignment within conditional
@@ -30,7 +31,6 @@
 
 #define SHORT_MIN (-(1 << 15))
 #define SHORT_MAX ((1 << 15) - 1)
-#define SHORT_MAX_10 ((1 << 10) - 1)
 
 namespace X265_NS{
 
@@ -62,65 +62,48 @@ inline static void filter_copy_c(int64_t* filter, int64_t* filter2, int size)
         filter2[i] = filter[i];
 }
 
-#if X265_DEPTH == 8
+/* Horizontal filter of depth-bit samples (bytes for 8, 16-bit words above)
+ * into 16-bit intermediates of depth + 6 bits */
+template<int depth>
 static void doScaling_c(int16_t *dst, int dstW, const uint8_t *src, const int16_t *filter, const int32_t *filterPos, int filterSize)
 {
+    const uint16_t *src16 = (const uint16_t *)src;
     for (int i = 0; i < dstW; i++)
     {
         int val = 0;
         int sourcePos = filterPos[i];
         for (int j = 0; j < filterSize; j++)
-            val += ((int)src[sourcePos + j]) * filter[filterSize * i + j];
+            val += (depth == 8 ? (int)src[sourcePos + j] : (int)src16[sourcePos + j]) * filter[filterSize * i + j];
         // the cubic equation does overflow ...
-        dst[i] = x265_clip3(SHORT_MIN, SHORT_MAX, val >> 7);
+        dst[i] = x265_clip3(SHORT_MIN, SHORT_MAX, val >> (depth - 1));
     }
 }
-static uint8_t clipUint8(int a)
-{
-    if (a&(~0xFF))
-        return (-a) >> 31;
-    else
-        return a;
-}
 
+/* Vertical filter of 16-bit intermediates into depth-bit samples */
+template<int depth>
 static void yuv2PlaneX_c(const int16_t *filter, int filterSize, const int16_t **src, uint8_t *dest, int dstW)
 {
+    const int shift = 27 - depth;
     for (int i = 0; i < dstW; i++)
     {
-        int val = 64 << 12;
+        int val = 1 << (shift - 1);
         for (int j = 0; j < filterSize; j++)
             val += src[j][i] * filter[j];
-        dest[i] = clipUint8(val >> 19);
+        int d = x265_clip3(0, (1 << depth) - 1, val >> shift);
+        if (depth == 8)
+            dest[i] = (uint8_t)d;
+        else
+            ((uint16_t *)dest)[i] = (uint16_t)d;
     }
 }
-#else
-static void yuv2PlaneX_c_h(const int16_t *filter, int filterSize, const int16_t **src, uint8_t *dest, int dstW)
+
+void setupScalerPrimitives_c(EncoderPrimitives &p)
 {
-    for (int i = 0; i < dstW; i++)
-    {
-        int val = 1 << 16;
-        uint16_t* dst16bit = (uint16_t *)dest;
-        for (int j = 0; j < filterSize; j++)
-            val += src[j][i] * filter[j];
-        uint16_t d = x265_clip3(0, SHORT_MAX_10, val >> 17);
-        ((uint8_t*)(&dst16bit[i]))[0] = (d);
-        ((uint8_t*)(&dst16bit[i]))[1] = (d) >> 8;
-    }
+    p.scalerHFilter[SCALER_8BIT] = doScaling_c<8>;
+    p.scalerVFilter[SCALER_8BIT] = yuv2PlaneX_c<8>;
+    p.scalerHFilter[SCALER_10BIT] = doScaling_c<10>;
+    p.scalerVFilter[SCALER_10BIT] = yuv2PlaneX_c<10>;
 }
-static void doScaling_c_h(int16_t *dst, int dstW, const uint8_t *src, const int16_t *filter, const int32_t *filterPos, int filterSize)
-{
-    const uint16_t *srcLocal = (const uint16_t *)src;
-    for (int i = 0; i < dstW; i++)
-    {
-        int val = 0;
-        int sourcePos = filterPos[i];
-        for (int j = 0; j < filterSize; j++)
-            val += ((int)srcLocal[sourcePos + j]) * filter[filterSize * i + j];
-        // the cubic equation does overflow
-        dst[i] = x265_clip3(SHORT_MIN, SHORT_MAX, val >> 9);
-    }
-}
-#endif
 
 ScalerFilter::ScalerFilter() :
     m_filtLen(0),
@@ -180,32 +163,12 @@ void ScalerHCrFilter::process(int sliceVer, int sliceHor)
 
 void VFilterScaler8Bit::yuv2PlaneX(const int16_t *filter, int filterSize, const int16_t **src, uint8_t *dest, int dstW)
 {
-    int IdxW = FACTOR_4;
-    int IdxF = FIL_DEF;
-
-    (dstW % 4 == 0) && (filterSize == 6) && (IdxF = FIL_6) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 8) && (IdxF = FIL_8) && (IdxW = FACTOR_4);
-
-#if X265_DEPTH == 8
-    yuv2PlaneX_c(filter, filterSize, src, dest, dstW);
-#else
-    yuv2PlaneX_c_h(filter, filterSize, src, dest, dstW);
-#endif
+    primitives.scalerVFilter[SCALER_8BIT](filter, filterSize, src, dest, dstW);
 }
 
 void VFilterScaler10Bit::yuv2PlaneX(const int16_t *filter, int filterSize, const int16_t **src, uint8_t *dest, int dstW)
 {
-    int IdxW = FACTOR_4;
-    int IdxF = FIL_DEF;
-
-    (dstW % 4 == 0) && (filterSize == 6) && (IdxF = FIL_6) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 8) && (IdxF = FIL_8) && (IdxW = FACTOR_4);
-
-#if X265_DEPTH == 8
-    yuv2PlaneX_c(filter, filterSize, src, dest, dstW);
-#else
-    yuv2PlaneX_c_h(filter, filterSize, src, dest, dstW);
-#endif
+    primitives.scalerVFilter[SCALER_10BIT](filter, filterSize, src, dest, dstW);
 }
 
 void ScalerVLumFilter::process(int sliceVer, int sliceHor)
@@ -499,6 +462,32 @@ int ScalerFilter::initCoeff(int flag, int inc, int srcW, int dstW, int filtAlign
     return 0;
 }
 
+/* Pad every filter to a multiple of filtAlign taps with zero coefficients so
+ * the vector kernels can consume whole groups of taps. Filters whose padded
+ * taps would run past the end of the source line are moved left and their
+ * coefficients shifted right, so the sums are unchanged */
+void ScalerFilter::padCoeff(int filtAlign, int srcW, int dstW)
+{
+    const int filtLen = SCALER_ALIGN(m_filtLen, filtAlign);
+    if (filtLen == m_filtLen || filtLen > srcW)
+        return;
+
+    int16_t* filt = new int16_t[(dstW + 3) * filtLen];
+    memset(filt, 0, sizeof(int16_t) * (dstW + 3) * filtLen);
+
+    for (int i = 0; i < dstW + 3; i++)
+    {
+        const int shift = X265_MAX(m_filtPos[i] + filtLen - srcW, 0);
+        for (int j = 0; j < m_filtLen; j++)
+            filt[i * filtLen + j + shift] = m_filt[i * m_filtLen + j];
+        m_filtPos[i] -= shift;
+    }
+
+    delete[] m_filt;
+    m_filt = filt;
+    m_filtLen = filtLen;
+}
+
 int ScalerFilterManager::init(int algorithmFlags, VideoDesc *srcVideoDesc, VideoDesc *dstVideoDesc)
 {
     int srcW = m_srcW = srcVideoDesc->m_width;
@@ -515,6 +504,12 @@ int ScalerFilterManager::init(int algorithmFlags, VideoDesc *srcVideoDesc, Video
     m_bitDepth = dstVideoDesc->m_inputDepth;
     if (m_bitDepth == 16)
         dst_stride <<= 1;
+    // there are kernels for 8 and 10-bit samples, whatever the build depth
+    if (m_bitDepth != 8 && m_bitDepth != 10)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "scaler supports 8 and 10-bit pictures, not %d-bit\n", m_bitDepth);
+        return -1;
+    }
 
     m_algorithmFlags = algorithmFlags;
     lumXInc = (((int64_t)srcW << 16) + (dstW >> 1)) / dstW;
@@ -582,6 +577,10 @@ int ScalerFilterManager::init(int algorithmFlags, VideoDesc *srcVideoDesc, Video
     m_ScalerFilters[1]->initCoeff(m_algorithmFlags, crXInc, m_crSrcW, m_crDstW, filterAlign, 1 << 14,
         getLocalPos(m_crSrcHSubSample, srcHCrPos), getLocalPos(m_crDstHSubSample, dstHCrPos));
 
+    // horizontal kernels consume taps in groups of four
+    m_ScalerFilters[0]->padCoeff(4, srcW, dstW);
+    m_ScalerFilters[1]->padCoeff(4, m_crSrcW, m_crDstW);
+
     // init vertical Luma scaler filter
     m_ScalerFilters[2] = new ScalerVLumFilter(m_bitDepth);
     m_ScalerFilters[2]->initCoeff(m_algorithmFlags, lumYInc, srcH, dstH, filterAlign, 1 << 12, getLocalPos(0, 0), getLocalPos(0, 0));
@@ -606,69 +605,15 @@ int ScalerFilterManager::init(int algorithmFlags, VideoDesc *srcVideoDesc, Video
 
 void HFilterScaler8Bit::doScaling(int16_t *dst, int dstW, const uint8_t *src, const int16_t *filter, const int32_t *filterPos, int filterSize)
 {
-    int IdxW = FACTOR_4;
-    int IdxF = FIL_DEF;
-
-    /* This is hard to read code, but much faster. Speed is crucial here */
-    (dstW % 8 == 0) && (filterSize == 6) && (IdxF = FIL_6) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 8) && (IdxF = FIL_8) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 16) && (IdxF = FIL_16) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 11) && (IdxF = FIL_11) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 10) && (IdxF = FIL_10) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 9) && (IdxF = FIL_9) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 15) && (IdxF = FIL_15) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 13) && (IdxF = FIL_13) && (IdxW = FACTOR_8);
-
-    /* Do not check multiple of width 4, if width is already multiple of 8 */
-    !(dstW % 8 == 0) && (dstW % 4 == 0) && (filterSize == 6) && (IdxF = FIL_6) && (IdxW = FACTOR_4);
-    !(dstW % 8 == 0) && (dstW % 4 == 0) && (filterSize == 8) && (IdxF = FIL_8) && (IdxW = FACTOR_4);
-    !(dstW % 8 == 0) && (dstW % 4 == 0) && (filterSize == 16) && (IdxF = FIL_16) && (IdxW = FACTOR_4);
-
-    (dstW % 4 == 0) && (filterSize == 24) && (IdxF = FIL_24) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 22) && (IdxF = FIL_22) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 19) && (IdxF = FIL_19) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 17) && (IdxF = FIL_17) && (IdxW = FACTOR_4);
-
-#if X265_DEPTH == 8
-    doScaling_c(dst, dstW, src, filter, filterPos, filterSize);
-#else
-    doScaling_c_h(dst, dstW, src, filter, filterPos, filterSize);
-#endif
+    primitives.scalerHFilter[SCALER_8BIT](dst, dstW, src, filter, filterPos, filterSize);
 }
 
 void HFilterScaler10Bit::doScaling(int16_t *dst, int dstW, const uint8_t *src, const int16_t *filter, const int32_t *filterPos, int filterSize)
 {
-    int IdxW = FACTOR_4;
-    int IdxF = FIL_DEF;
-
-    /* This is hard to read code, but much faster. Speed is crucial here */
-    (dstW % 8 == 0) && (filterSize == 6) && (IdxF = FIL_6) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 8) && (IdxF = FIL_8) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 16) && (IdxF = FIL_16) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 11) && (IdxF = FIL_11) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 10) && (IdxF = FIL_10) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 9) && (IdxF = FIL_9) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 15) && (IdxF = FIL_15) && (IdxW = FACTOR_8);
-    (dstW % 8 == 0) && (filterSize == 13) && (IdxF = FIL_13) && (IdxW = FACTOR_8);
-
-    /* Do not check multiple of width 4, if width is already multiple of 8 */
-    !(dstW % 8 == 0) && (dstW % 4 == 0) && (filterSize == 6) && (IdxF = FIL_6) && (IdxW = FACTOR_4);
-    !(dstW % 8 == 0) && (dstW % 4 == 0) && (filterSize == 8) && (IdxF = FIL_8) && (IdxW = FACTOR_4);
-    !(dstW % 8 == 0) && (dstW % 4 == 0) && (filterSize == 16) && (IdxF = FIL_16) && (IdxW = FACTOR_4);
-
-    (dstW % 4 == 0) && (filterSize == 24) && (IdxF = FIL_24) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 22) && (IdxF = FIL_22) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 19) && (IdxF = FIL_19) && (IdxW = FACTOR_4);
-    (dstW % 4 == 0) && (filterSize == 17) && (IdxF = FIL_17) && (IdxW = FACTOR_4);
-
-#if X265_DEPTH == 8
-    doScaling_c(dst, dstW, src, filter, filterPos, filterSize);
-#else
-    doScaling_c_h(dst, dstW, src, filter, filterPos, filterSize);
-#endif
+    primitives.scalerHFilter[SCALER_10BIT](dst, dstW, src, filter, filterPos, filterSize);
 }
 
-int ScalerFilterManager::scale_pic(void ** src, void ** dst, int * srcStride, int * dstStride)
+int ScalerFilterManager::scale_pic(void ** src, void ** dst, int * srcStride, int * dstStride, int dstYStart, int dstYEnd)
 {
     uint8_t** src_8bit, **dst_8bit;
     src_8bit = (uint8_t**)src;
@@ -679,6 +624,10 @@ int ScalerFilterManager::scale_pic(void ** src, void ** dst, int * srcStride, in
     const int srcsliceHor = m_srcH;
     const int dstW = m_dstW;
     const int dstH = m_dstH;
+    if (dstYEnd < 0)
+        dstYEnd = dstH;
+    X265_CHECK(!(dstYStart & ((1 << m_crDstVSubSample) - 1)), "scaler band must start on a chroma row\n");
+    X265_CHECK(primitives.scalerHFilter[SCALER_8BIT] && primitives.scalerHFilter[SCALER_10BIT], "scaler primitives not initialized\n");
     int32_t *vLumFilterPos = m_ScalerFilters[2]->m_filtPos;
     int32_t *vCrFilterPos = m_ScalerFilters[3]->m_filtPos;
     const int vLumFilterSize = m_ScalerFilters[2]->m_filtLen;
@@ -710,7 +659,7 @@ int ScalerFilterManager::scale_pic(void ** src, void ** dst, int * srcStride, in
     hout_slice->m_plane[3].sliceHor = 0;
     hout_slice->m_width = dstW;
 
-    for (int dstY = 0; dstY < dstH; dstY++)
+    for (int dstY = dstYStart; dstY < dstYEnd; dstY++)
     {
         const int crDstY = dstY >> m_crDstVSubSample;
         const int firstLumSrcY = x265_max(1 - vLumFilterSize, vLumFilterPos[dstY]);
@@ -923,7 +872,10 @@ void ScalerSlice::destroy()
     for (int i = 0; i < m_numSlicePlane; i++)
     {
         if (m_plane[i].lineBuf)
+        {
             X265_FREE(m_plane[i].lineBuf);
+            m_plane[i].lineBuf = NULL;
+        }
     }
 }
 
@@ -75,6 +75,7 @@ public:
     virtual ~ScalerFilter();
     virtual void process(int sliceVer, int sliceHor) = 0;
     int initCoeff(int flag, int inc, int srcW, int dstW, int filtAlign, int one, int sourcePos, int destPos);
+    void padCoeff(int filtAlign, int srcW, int dstW);
     void setSlice(ScalerSlice* source, ScalerSlice* dest) { m_sourceSlice = source; m_destSlice = dest; }
 };
 
@@ -156,7 +157,7 @@ private:
     HFilterScaler* m_hFilterScaler;
 public:
     ScalerHLumFilter(int bitDepth) { bitDepth == 8 ? m_hFilterScaler = new HFilterScaler8Bit : bitDepth == 10 ? m_hFilterScaler = new HFilterScaler10Bit : NULL;}
-    ~ScalerHLumFilter() { if (m_hFilterScaler) X265_FREE(m_hFilterScaler); }
+    ~ScalerHLumFilter() { if (m_hFilterScaler) delete m_hFilterScaler; }
     virtual void process(int sliceVer, int sliceHor);
 };
 
@@ -166,7 +167,7 @@ private:
     HFilterScaler* m_hFilterScaler;
 public:
     ScalerHCrFilter(int bitDepth) { bitDepth == 8 ? m_hFilterScaler = new HFilterScaler8Bit : bitDepth == 10 ? m_hFilterScaler = new HFilterScaler10Bit : NULL;}
-    ~ScalerHCrFilter() { if (m_hFilterScaler) X265_FREE(m_hFilterScaler); }
+    ~ScalerHCrFilter() { if (m_hFilterScaler) delete m_hFilterScaler; }
     virtual void process(int sliceVer, int sliceHor);
 };
 
@@ -176,7 +177,7 @@ private:
     VFilterScaler* m_vFilterScaler;
 public:
     ScalerVLumFilter(int bitDepth) { bitDepth == 8 ? m_vFilterScaler = new VFilterScaler8Bit : bitDepth == 10 ? m_vFilterScaler = new VFilterScaler10Bit : NULL;}
-    ~ScalerVLumFilter() { if (m_vFilterScaler) X265_FREE(m_vFilterScaler); }
+    ~ScalerVLumFilter() { if (m_vFilterScaler) delete m_vFilterScaler; }
     virtual void process(int sliceVer, int sliceHor);
 };
 
@@ -186,7 +187,7 @@ private:
     VFilterScaler*    m_vFilterScaler;
 public:
     ScalerVCrFilter(int bitDepth) { bitDepth == 8 ? m_vFilterScaler = new VFilterScaler8Bit : bitDepth == 10 ? m_vFilterScaler = new VFilterScaler10Bit : NULL;}
-    ~ScalerVCrFilter() { if (m_vFilterScaler) X265_FREE(m_vFilterScaler); }
+    ~ScalerVCrFilter() { if (m_vFilterScaler) delete m_vFilterScaler; }
     virtual void process(int sliceVer, int sliceHor);
 };
 
@@ -247,7 +248,11 @@ public:
             if (m_ScalerFilters[i]) { delete m_ScalerFilters[i]; m_ScalerFilters[i] = NULL; }
     }
     int init(int algorithmFlags, VideoDesc* srcVideoDesc, VideoDesc* dstVideoDesc);
-    int scale_pic(void** src, void** dst, int* srcStride, int* dstStride);
+    /* Scale destination rows [dstYStart, dstYEnd) of the picture, the whole
+     * picture by default. Each band only depends on the source, so separate
+     * managers may scale the bands of one picture in parallel. dstYStart must
+     * be a multiple of the chroma vertical subsampling */
+    int scale_pic(void** src, void** dst, int* srcStride, int* dstStride, int dstYStart = 0, int dstYEnd = -1);
 };
 }
 
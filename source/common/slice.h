@@ -283,6 +283,7 @@ struct PPS
     bool     bTransquantBypassEnabled;  // Indicates presence of cu_transquant_bypass_flag in CUs.
     bool     bTransformSkipEnabled;     // use param
     bool     bEntropyCodingSyncEnabled; // use param
+    bool     bDependentSliceSegmentsEnabled; // sub-frame output, one segment per CTU row
     bool     bSignHideEnabled;          // use param
 
     bool     bDeblockingFilterControlPresent;
@@ -290,6 +291,32 @@ struct PPS
 
     int      numRefIdxDefault[2];
     bool     pps_slice_chroma_qp_offsets_present_flag;
+
+    /* tile grid, in CTUs. Always describes at least one tile covering the
+     * whole picture so the tile helpers may be used without checking
+     * bTilesEnabled */
+    bool     bTilesEnabled;
+    bool     bUniformTileSpacing;
+    uint32_t numTileColumns;
+    uint32_t numTileRows;
+    uint32_t tileColBd[X265_MAX_TILE_COLUMNS + 1];
+    uint32_t tileRowBd[X265_MAX_TILE_ROWS + 1];
+
+    uint32_t getTileColumn(uint32_t ctuCol) const
+    {
+        uint32_t i = 0;
+        while (ctuCol >= tileColBd[i + 1])
+            i++;
+        return i;
+    }
+
+    uint32_t getTileRow(uint32_t ctuRow) const
+    {
+        uint32_t i = 0;
+        while (ctuRow >= tileRowBd[i + 1])
+            i++;
+        return i;
+    }
 };
 
 struct WeightParam
@@ -31,6 +31,109 @@
 
 using namespace X265_NS;
 
+namespace X265_NS
+{
+/* Motion compensated copy of a width x height block. src points at the
+ * integer-pel position, fracX/fracY select the 1/16-pel filter phase. Taps 0
+ * and 7 of s_interpolationFilter are always zero so only six are applied */
+static void mcstfApplyMotion_c(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int fracX, int fracY)
+{
+    const int *xFilter = s_interpolationFilter[fracX];
+    const int *yFilter = s_interpolationFilter[fracY];
+    const int maxValue = (1 << X265_DEPTH) - 1;
+    int tempArray[MAX_CU_SIZE + 5][MAX_CU_SIZE];
+
+    const pixel *sourceRow = src - 2 * srcStride;
+    for (int y = 0; y < height + 5; y++, sourceRow += srcStride)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const pixel *rowStart = sourceRow + x - 3;
+
+            int iSum = 0;
+            iSum += xFilter[1] * rowStart[1];
+            iSum += xFilter[2] * rowStart[2];
+            iSum += xFilter[3] * rowStart[3];
+            iSum += xFilter[4] * rowStart[4];
+            iSum += xFilter[5] * rowStart[5];
+            iSum += xFilter[6] * rowStart[6];
+
+            tempArray[y][x] = iSum;
+        }
+    }
+
+    for (int y = 0; y < height; y++, dst += dstStride)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int iSum = 0;
+            iSum += yFilter[1] * tempArray[y + 0][x];
+            iSum += yFilter[2] * tempArray[y + 1][x];
+            iSum += yFilter[3] * tempArray[y + 2][x];
+            iSum += yFilter[4] * tempArray[y + 3][x];
+            iSum += yFilter[5] * tempArray[y + 4][x];
+            iSum += yFilter[6] * tempArray[y + 5][x];
+
+            iSum = (iSum + (1 << 11)) >> 12;
+            iSum = iSum < 0 ? 0 : (iSum > maxValue ? maxValue : iSum);
+            dst[x] = (pixel)iSum;
+        }
+    }
+}
+
+/* Sub-pel block matching error. Returns as soon as the running error of the
+ * completed rows exceeds bestError */
+template<bool bSSD>
+static int mcstfSubpelError_c(const pixel* org, intptr_t orgStride, const pixel* ref, intptr_t refStride, int bs, int fracX, int fracY, int bestError)
+{
+    pixel pred[MAX_CU_SIZE * MAX_CU_SIZE];
+    mcstfApplyMotion_c(ref, refStride, pred, MAX_CU_SIZE, bs, bs, fracX, fracY);
+
+    int error = 0;
+    for (int y = 0; y < bs; y++, org += orgStride)
+    {
+        const pixel *predRow = pred + y * MAX_CU_SIZE;
+        for (int x = 0; x < bs; x++)
+        {
+            int diff = predRow[x] - org[x];
+            error += bSSD ? diff * diff : abs(diff);
+        }
+        if (error > bestError)
+            return error;
+    }
+    return error;
+}
+
+/* Accumulate the bilateral weights of one motion compensated reference block.
+ * expTable is indexed by the absolute sample difference */
+static void mcstfWeightAcc_c(const pixel* org, intptr_t orgStride, const pixel* ref, intptr_t refStride, int width, int height,
+                             const double* expTable, double scale, double* sumVal, double* sumWeight, intptr_t sumStride)
+{
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const int refVal = ref[x];
+            const double weight = scale * expTable[abs(refVal - org[x])];
+            sumVal[x] += weight * refVal;
+            sumWeight[x] += weight;
+        }
+        org += orgStride;
+        ref += refStride;
+        sumVal += sumStride;
+        sumWeight += sumStride;
+    }
+}
+
+void setupTemporalFilterPrimitives_c(EncoderPrimitives &p)
+{
+    p.mcstfSubpelSAD = mcstfSubpelError_c<false>;
+    p.mcstfSubpelSSD = mcstfSubpelError_c<true>;
+    p.mcstfApplyMotion = mcstfApplyMotion_c;
+    p.mcstfWeightAcc = mcstfWeightAcc_c;
+}
+}
+
 void OrigPicBuffer::addPicture(Frame* inFrame)
 {
     m_mcstfPicList.pushFrontMCSTF(*inFrame);
@@ -151,6 +254,16 @@ TemporalFilter::TemporalFilter()
     m_sigmaMultiplier = 9.0;
     m_sigmaZeroPoint = 10.0;
     m_motionVectorFactor = 16;
+    m_expTable = NULL;
+    m_pool = NULL;
+    m_metld = NULL;
+    m_rowProgress = NULL;
+    m_maxRows = 0;
+    m_jobFrame = NULL;
+    m_jobRefList = NULL;
+    m_jobNumRefs = m_jobRows = m_jobLevel = 0;
+    m_refStrengthRow = 2;
+    m_overallStrength = 1.0;
 }
 
 void TemporalFilter::init(const x265_param* param)
@@ -161,10 +274,133 @@ void TemporalFilter::init(const x265_param* param)
     m_sourceHeight = param->sourceHeight;
     m_internalCsp = param->internalCsp;
     m_numComponents = (m_internalCsp != X265_CSP_I400) ? MAX_NUM_COMPONENT : 1;
+}
 
-    m_metld = new MotionEstimatorTLD;
+bool TemporalFilter::create(ThreadPool* pool)
+{
+    m_pool = pool;
+    int numTLD = 1 + (m_pool ? m_pool->m_numWorkers : 0);
+    m_metld = new MotionEstimatorTLD[numTLD];
 
-    predPUYuv.create(FENC_STRIDE, X265_CSP_I400);
+    /* the 8x8 ME level has the most block rows */
+    m_maxRows = m_sourceHeight / 8 + 1;
+    m_rowProgress = new ThreadSafeInteger[(m_range << 1) * m_maxRows];
+
+    m_expTable = X265_MALLOC(double, 2 * 4 * (1 << m_bitDepth));
+    return m_metld && m_rowProgress && m_expTable;
+}
+
+TemporalFilter::~TemporalFilter()
+{
+    waitForExit();
+    delete [] m_metld;
+    delete [] m_rowProgress;
+    X265_FREE(m_expTable);
+}
+
+void TemporalFilter::runJobs(int numJobs)
+{
+    m_jobTotal = numJobs;
+    m_jobAcquired = 0;
+    if (m_pool)
+        tryBondPeers(*m_pool, numJobs - 1);
+    processTasks(-1);
+    waitForExit();
+    m_jobTotal = m_jobAcquired = 0;
+}
+
+void TemporalFilter::processTasks(int workerThreadId)
+{
+    int id = workerThreadId;
+    if (workerThreadId < 0)
+        id = m_pool ? m_pool->m_numWorkers : 0;
+    MotionEstimatorTLD& tld = m_metld[id];
+
+    m_lock.acquire();
+    while (m_jobAcquired < m_jobTotal)
+    {
+        int i = m_jobAcquired++;
+        m_lock.release();
+
+        if (m_jobLevel < 0)
+        {
+            /* luma block row i of the filter, with the co-located chroma rows */
+            for (int r = 0; r < m_jobNumRefs; r++)
+            {
+                TemporalFilterRefPicInfo* ref = &m_jobRefList[r];
+                applyMotion(ref->mvs, ref->mvsStride, ref->picBuffer, ref->compensatedPic, i);
+            }
+
+            for (int c = 0; c < m_numComponents; c++)
+            {
+                const int csy = c ? CHROMA_V_SHIFT(m_internalCsp) : 0;
+                const int blkSize = c ? 4 : 8;
+                const int height = m_jobFrame->m_fencPic->m_picHeight >> csy;
+                const int lastY = X265_MIN(height, ((i + 1) * 8) >> csy);
+                for (int y = (i * 8) >> csy; y < lastY; y += blkSize)
+                    bilateralFilterRow(c, y);
+            }
+        }
+        else
+        {
+            /* jobs are ordered by reference then block row, so the row above
+             * is always acquired before the rows that wait on it */
+            const int r = i / m_jobRows;
+            const int row = i % m_jobRows;
+            TemporalFilterRefPicInfo* ref = &m_jobRefList[r];
+            ThreadSafeInteger* rowProgress = m_rowProgress + r * m_maxRows + row;
+            Frame* frame = m_jobFrame;
+
+            switch (m_jobLevel)
+            {
+            case 0:
+                motionEstimationLuma(tld, ref->mvs0, ref->mvsStride0, frame->m_fencPicSubsampled4, ref->picBufferSubSampled4, 16, row * 16, rowProgress);
+                break;
+            case 1:
+                motionEstimationLuma(tld, ref->mvs1, ref->mvsStride1, frame->m_fencPicSubsampled2, ref->picBufferSubSampled2, 16, row * 16, rowProgress, ref->mvs0, ref->mvsStride0, 2);
+                break;
+            case 2:
+                motionEstimationLuma(tld, ref->mvs2, ref->mvsStride2, frame->m_fencPic, ref->picBuffer, 16, row * 16, rowProgress, ref->mvs1, ref->mvsStride1, 2);
+                break;
+            default:
+                motionEstimationLumaDoubleRes(tld, ref->mvs, ref->mvsStride, frame->m_fencPic, ref->picBuffer, 8, row * 8, rowProgress, ref->mvs2, ref->mvsStride2, 1, ref->error);
+                break;
+            }
+        }
+
+        m_lock.acquire();
+    }
+    m_lock.release();
+}
+
+void TemporalFilter::motionEstimation(Frame* frame, TemporalFilterRefPicInfo* mctfRefList, int numRefs)
+{
+    if (!numRefs)
+        return;
+
+    m_jobFrame = frame;
+    m_jobRefList = mctfRefList;
+    m_jobNumRefs = numRefs;
+
+    /* each level reads the MVs of the previous one, so the levels are run
+     * one after the other with every reference of a level in flight */
+    for (int level = 0; level < 4; level++)
+    {
+        PicYuv* orig = !level ? frame->m_fencPicSubsampled4 : level == 1 ? frame->m_fencPicSubsampled2 : frame->m_fencPic;
+        const int blockSize = level < 3 ? 16 : 8;
+
+        m_jobLevel = level;
+        m_jobRows = orig->m_picHeight / blockSize;
+        if (!m_jobRows)
+            continue;
+        X265_CHECK(m_jobRows <= m_maxRows, "too many mcstf block rows\n");
+
+        for (int r = 0; r < numRefs; r++)
+            for (int row = 0; row < m_jobRows; row++)
+                m_rowProgress[r * m_maxRows + row].set(0);
+
+        runJobs(numRefs * m_jobRows);
+    }
 }
 
 int TemporalFilter::createRefPicInfo(TemporalFilterRefPicInfo* refFrame, x265_param* param)
@@ -178,7 +414,6 @@ int TemporalFilter::createRefPicInfo(TemporalFilterRefPicInfo* refFrame, x265_pa
     CHECKED_MALLOC_ZERO(refFrame->mvs2, MV, sizeof(MV)* ((m_sourceWidth ) / 16)*((m_sourceHeight ) / 16));
     refFrame->mvsStride2 = m_sourceWidth / 16;
 
-    CHECKED_MALLOC_ZERO(refFrame->noise, int, sizeof(int) * ((m_sourceWidth) / 4) * ((m_sourceHeight) / 4));
     CHECKED_MALLOC_ZERO(refFrame->error, int, sizeof(int) * ((m_sourceWidth) / 4) * ((m_sourceHeight) / 4));
 
     refFrame->slicetype = X265_TYPE_AUTO;
@@ -192,6 +427,7 @@ fail:
 }
 
 int TemporalFilter::motionErrorLumaSAD(
+    MotionEstimatorTLD& tld,
     PicYuv *orig,
     PicYuv *buffer,
     int x,
@@ -230,9 +466,9 @@ int TemporalFilter::motionErrorLumaSAD(
 #else
         int partEnum = partitionFromSizes(bs, bs);
         /* copy PU block into cache */
-        primitives.pu[partEnum].copy_pp(predPUYuv.m_buf[0], FENC_STRIDE, bufferRowStart, buffStride);
+        primitives.pu[partEnum].copy_pp(tld.predPUYuv.m_buf[0], FENC_STRIDE, bufferRowStart, buffStride);
 
-        error = m_metld->me.bufSAD(predPUYuv.m_buf[0], FENC_STRIDE);
+        error = tld.me.bufSAD(tld.predPUYuv.m_buf[0], FENC_STRIDE);
 #endif
         if (error > besterror)
         {
@@ -241,61 +477,16 @@ int TemporalFilter::motionErrorLumaSAD(
     }
     else
     {
-        const int *xFilter = s_interpolationFilter[dx & 0xF];
-        const int *yFilter = s_interpolationFilter[dy & 0xF];
-        int tempArray[64 + 8][64];
-
-        int iSum, iBase;
-        for (int y1 = 1; y1 < bs + 7; y1++)
-        {
-            const int yOffset = y + y1 + (dy >> 4) - 3;
-            const pixel *sourceRow = buffOrigin + (yOffset)*buffStride + 0;
-            for (int x1 = 0; x1 < bs; x1++)
-            {
-                iSum = 0;
-                iBase = x + x1 + (dx >> 4) - 3;
-                const pixel *rowStart = sourceRow + iBase;
-
-                iSum += xFilter[1] * rowStart[1];
-                iSum += xFilter[2] * rowStart[2];
-                iSum += xFilter[3] * rowStart[3];
-                iSum += xFilter[4] * rowStart[4];
-                iSum += xFilter[5] * rowStart[5];
-                iSum += xFilter[6] * rowStart[6];
-
-                tempArray[y1][x1] = iSum;
-            }
-        }
+        const pixel* bufferRowStart = buffOrigin + (y + (dy >> 4)) * buffStride + (x + (dx >> 4));
+        const pixel* origRowStart = origOrigin + y * origStride + x;
 
-        const pixel maxSampleValue = (1 << m_bitDepth) - 1;
-        for (int y1 = 0; y1 < bs; y1++)
-        {
-            const pixel *origRow = origOrigin + (y + y1)*origStride + 0;
-            for (int x1 = 0; x1 < bs; x1++)
-            {
-                iSum = 0;
-                iSum += yFilter[1] * tempArray[y1 + 1][x1];
-                iSum += yFilter[2] * tempArray[y1 + 2][x1];
-                iSum += yFilter[3] * tempArray[y1 + 3][x1];
-                iSum += yFilter[4] * tempArray[y1 + 4][x1];
-                iSum += yFilter[5] * tempArray[y1 + 5][x1];
-                iSum += yFilter[6] * tempArray[y1 + 6][x1];
-
-                iSum = (iSum + (1 << 11)) >> 12;
-                iSum = iSum < 0 ? 0 : (iSum > maxSampleValue ? maxSampleValue : iSum);
-
-                error += abs(iSum - origRow[x + x1]);
-            }
-            if (error > besterror)
-            {
-                return error;
-            }
-        }
+        error = primitives.mcstfSubpelSAD(origRowStart, origStride, bufferRowStart, buffStride, bs, dx & 0xF, dy & 0xF, besterror);
     }
     return error;
 }
 
 int TemporalFilter::motionErrorLumaSSD(
+    MotionEstimatorTLD& tld,
     PicYuv *orig,
     PicYuv *buffer,
     int x,
@@ -334,9 +525,9 @@ int TemporalFilter::motionErrorLumaSSD(
 #else
         int partEnum = partitionFromSizes(bs, bs);
         /* copy PU block into cache */
-        primitives.pu[partEnum].copy_pp(predPUYuv.m_buf[0], FENC_STRIDE, bufferRowStart, buffStride);
+        primitives.pu[partEnum].copy_pp(tld.predPUYuv.m_buf[0], FENC_STRIDE, bufferRowStart, buffStride);
 
-        error = (int)primitives.cu[partEnum].sse_pp(m_metld->me.fencPUYuv.m_buf[0], FENC_STRIDE, predPUYuv.m_buf[0], FENC_STRIDE);
+        error = (int)primitives.cu[partEnum].sse_pp(tld.me.fencPUYuv.m_buf[0], FENC_STRIDE, tld.predPUYuv.m_buf[0], FENC_STRIDE);
 
 #endif
         if (error > besterror)
@@ -346,61 +537,15 @@ int TemporalFilter::motionErrorLumaSSD(
     }
     else
     {
-        const int *xFilter = s_interpolationFilter[dx & 0xF];
-        const int *yFilter = s_interpolationFilter[dy & 0xF];
-        int tempArray[64 + 8][64];
-
-        int iSum, iBase;
-        for (int y1 = 1; y1 < bs + 7; y1++)
-        {
-            const int yOffset = y + y1 + (dy >> 4) - 3;
-            const pixel *sourceRow = buffOrigin + (yOffset)*buffStride + 0;
-            for (int x1 = 0; x1 < bs; x1++)
-            {
-                iSum = 0;
-                iBase = x + x1 + (dx >> 4) - 3;
-                const pixel *rowStart = sourceRow + iBase;
-
-                iSum += xFilter[1] * rowStart[1];
-                iSum += xFilter[2] * rowStart[2];
-                iSum += xFilter[3] * rowStart[3];
-                iSum += xFilter[4] * rowStart[4];
-                iSum += xFilter[5] * rowStart[5];
-                iSum += xFilter[6] * rowStart[6];
-
-                tempArray[y1][x1] = iSum;
-            }
-        }
+        const pixel* bufferRowStart = buffOrigin + (y + (dy >> 4)) * buffStride + (x + (dx >> 4));
+        const pixel* origRowStart = origOrigin + y * origStride + x;
 
-        const pixel maxSampleValue = (1 << m_bitDepth) - 1;
-        for (int y1 = 0; y1 < bs; y1++)
-        {
-            const pixel *origRow = origOrigin + (y + y1)*origStride + 0;
-            for (int x1 = 0; x1 < bs; x1++)
-            {
-                iSum = 0;
-                iSum += yFilter[1] * tempArray[y1 + 1][x1];
-                iSum += yFilter[2] * tempArray[y1 + 2][x1];
-                iSum += yFilter[3] * tempArray[y1 + 3][x1];
-                iSum += yFilter[4] * tempArray[y1 + 4][x1];
-                iSum += yFilter[5] * tempArray[y1 + 5][x1];
-                iSum += yFilter[6] * tempArray[y1 + 6][x1];
-
-                iSum = (iSum + (1 << 11)) >> 12;
-                iSum = iSum < 0 ? 0 : (iSum > maxSampleValue ? maxSampleValue : iSum);
-
-                error += (iSum - origRow[x + x1]) * (iSum - origRow[x + x1]);
-            }
-            if (error > besterror)
-            {
-                return error;
-            }
-        }
+        error = primitives.mcstfSubpelSSD(origRowStart, origStride, bufferRowStart, buffStride, bs, dx & 0xF, dy & 0xF, besterror);
     }
     return error;
 }
 
-void TemporalFilter::applyMotion(MV *mvs, uint32_t mvsStride, PicYuv *input, PicYuv *output)
+void TemporalFilter::applyMotion(MV *mvs, uint32_t mvsStride, PicYuv *input, PicYuv *output, int blockNumY)
 {
     static const int lumaBlockSize = 8;
     int srcStride = 0;
@@ -408,8 +553,6 @@ void TemporalFilter::applyMotion(MV *mvs, uint32_t mvsStride, PicYuv *input, Pic
     int csx = 0, csy = 0;
     for (int c = 0; c < m_numComponents; c++)
     {
-        const pixel maxValue = (1 << X265_DEPTH) - 1;
-
         const pixel *pSrcImage = input->m_picOrg[c];
         pixel *pDstImage = output->m_picOrg[c];
 
@@ -430,66 +573,22 @@ void TemporalFilter::applyMotion(MV *mvs, uint32_t mvsStride, PicYuv *input, Pic
         const int height = input->m_picHeight >> csy;
         const int width = input->m_picWidth >> csx;
 
-        for (int y = 0, blockNumY = 0; y + blockSizeY <= height; y += blockSizeY, blockNumY++)
-        {
-            for (int x = 0, blockNumX = 0; x + blockSizeX <= width; x += blockSizeX, blockNumX++)
-            {
-                int mvIdx = blockNumY * mvsStride + blockNumX;
-                const MV &mv = mvs[mvIdx];
-                const int dx = mv.x >> csx;
-                const int dy = mv.y >> csy;
-                const int xInt = mv.x >> (4 + csx);
-                const int yInt = mv.y >> (4 + csy);
-
-                const int *xFilter = s_interpolationFilter[dx & 0xf];
-                const int *yFilter = s_interpolationFilter[dy & 0xf]; // will add 6 bit.
-                const int numFilterTaps = 7;
-                const int centreTapOffset = 3;
-
-                int tempArray[lumaBlockSize + numFilterTaps][lumaBlockSize];
-
-                for (int by = 1; by < blockSizeY + numFilterTaps; by++)
-                {
-                    const int yOffset = y + by + yInt - centreTapOffset;
-                    const pixel *sourceRow = pSrcImage + yOffset * srcStride;
-                    for (int bx = 0; bx < blockSizeX; bx++)
-                    {
-                        int iBase = x + bx + xInt - centreTapOffset;
-                        const pixel *rowStart = sourceRow + iBase;
-
-                        int iSum = 0;
-                        iSum += xFilter[1] * rowStart[1];
-                        iSum += xFilter[2] * rowStart[2];
-                        iSum += xFilter[3] * rowStart[3];
-                        iSum += xFilter[4] * rowStart[4];
-                        iSum += xFilter[5] * rowStart[5];
-                        iSum += xFilter[6] * rowStart[6];
-
-                        tempArray[by][bx] = iSum;
-                    }
-                }
+        const int y = blockNumY * blockSizeY;
+        if (y + blockSizeY > height)
+            continue;
 
-                pixel *pDstRow = pDstImage + y * dstStride;
-                for (int by = 0; by < blockSizeY; by++, pDstRow += dstStride)
-                {
-                    pixel *pDstPel = pDstRow + x;
-                    for (int bx = 0; bx < blockSizeX; bx++, pDstPel++)
-                    {
-                        int iSum = 0;
-
-                        iSum += yFilter[1] * tempArray[by + 1][bx];
-                        iSum += yFilter[2] * tempArray[by + 2][bx];
-                        iSum += yFilter[3] * tempArray[by + 3][bx];
-                        iSum += yFilter[4] * tempArray[by + 4][bx];
-                        iSum += yFilter[5] * tempArray[by + 5][bx];
-                        iSum += yFilter[6] * tempArray[by + 6][bx];
-
-                        iSum = (iSum + (1 << 11)) >> 12;
-                        iSum = iSum < 0 ? 0 : (iSum > maxValue ? maxValue : iSum);
-                        *pDstPel = (pixel)iSum;
-                    }
-                }
-            }
+        for (int x = 0, blockNumX = 0; x + blockSizeX <= width; x += blockSizeX, blockNumX++)
+        {
+            int mvIdx = blockNumY * mvsStride + blockNumX;
+            const MV &mv = mvs[mvIdx];
+            const int dx = mv.x >> csx;
+            const int dy = mv.y >> csy;
+            const int xInt = mv.x >> (4 + csx);
+            const int yInt = mv.y >> (4 + csy);
+
+            primitives.mcstfApplyMotion(pSrcImage + (y + yInt) * srcStride + x + xInt, srcStride,
+                                        pDstImage + y * dstStride + x, dstStride,
+                                        blockSizeX, blockSizeY, dx & 0xf, dy & 0xf);
         }
     }
 }
@@ -501,12 +600,6 @@ void TemporalFilter::bilateralFilter(Frame* frame,
 
     const int numRefs = frame->m_mcstf->m_numRef;
 
-    for (int i = 0; i < numRefs; i++)
-    {
-        TemporalFilterRefPicInfo *ref = &m_mcstfRefList[i];
-        applyMotion(m_mcstfRefList[i].mvs, m_mcstfRefList[i].mvsStride, m_mcstfRefList[i].picBuffer, ref->compensatedPic);
-    }
-
     int refStrengthRow = 2;
     if (numRefs == m_range * 2)
     {
@@ -520,131 +613,180 @@ void TemporalFilter::bilateralFilter(Frame* frame,
     const double lumaSigmaSq = (m_QP - m_sigmaZeroPoint) * (m_QP - m_sigmaZeroPoint) * m_sigmaMultiplier;
     const double chromaSigmaSq = 30 * 30;
 
-    PicYuv* orgPic = frame->m_fencPic;
+    const double maxSampleValue = (1 << m_bitDepth) - 1;
+    const double bitDepthDiffWeighting = 1024.0 / (maxSampleValue + 1);
+    const int numSampleValues = 1 << m_bitDepth;
 
-    for (int c = 0; c < m_numComponents; c++)
+    /* The exponential term of the weight only depends on the absolute sample
+     * difference and on the noise/error class of the block, so it is tabulated
+     * once per frame. Table index is (chroma * 4 + class) */
+    for (int c = 0; c < 2; c++)
     {
-        int height, width;
-        pixel *srcPelRow = NULL;
-        intptr_t srcStride, correctedPicsStride = 0;
-
-        if (!c)
+        const double sigmaSq = (!c) ? lumaSigmaSq : chromaSigmaSq;
+        for (int cls = 0; cls < 4; cls++)
         {
-            height = orgPic->m_picHeight;
-            width = orgPic->m_picWidth;
-            srcPelRow = orgPic->m_picOrg[c];
-            srcStride = orgPic->m_stride;
-        }
-        else
-        {
-            int csx = CHROMA_H_SHIFT(m_internalCsp);
-            int csy = CHROMA_V_SHIFT(m_internalCsp);
+            double sw = 1;
+            sw *= (cls & 2) ? 1.3 : 0.8;
+            sw *= (cls & 1) ? 1.3 : 1;
 
-            height = orgPic->m_picHeight >> csy;
-            width = orgPic->m_picWidth >> csx;
-            srcPelRow = orgPic->m_picOrg[c];
-            srcStride = (int)orgPic->m_strideC;
+            double* expTable = m_expTable + (c * 4 + cls) * numSampleValues;
+            for (int d = 0; d < numSampleValues; d++)
+            {
+                double diff = (double)d * bitDepthDiffWeighting;
+                double diffSq = diff * diff;
+                expTable[d] = exp(-diffSq / (2 * sw * sigmaSq));
+            }
         }
+    }
+
+    m_jobFrame = frame;
+    m_jobRefList = m_mcstfRefList;
+    m_jobNumRefs = numRefs;
+    m_jobLevel = -1;
+    m_refStrengthRow = refStrengthRow;
+    m_overallStrength = overallStrength;
+
+    /* Each 8x8 luma block row (and its chroma) is motion compensated and
+     * filtered as one job; blocks only read their own samples */
+    runJobs((frame->m_fencPic->m_picHeight + 7) / 8);
+}
 
-        const double sigmaSq = (!c)  ? lumaSigmaSq : chromaSigmaSq;
-        const double weightScaling = overallStrength * ( (!c) ? 0.4 : m_chromaFactor);
+void TemporalFilter::bilateralFilterRow(int c, int y)
+{
+    const int numRefs = m_jobNumRefs;
+    const double maxSampleValue = (1 << m_bitDepth) - 1;
+    const int numSampleValues = 1 << m_bitDepth;
+
+    PicYuv* orgPic = m_jobFrame->m_fencPic;
+
+    int height, width;
+    pixel *srcPelRow = NULL;
+    intptr_t srcStride, correctedPicsStride = 0;
+
+    if (!c)
+    {
+        height = orgPic->m_picHeight;
+        width = orgPic->m_picWidth;
+        srcPelRow = orgPic->m_picOrg[c];
+        srcStride = orgPic->m_stride;
+    }
+    else
+    {
+        int csx = CHROMA_H_SHIFT(m_internalCsp);
+        int csy = CHROMA_V_SHIFT(m_internalCsp);
+
+        height = orgPic->m_picHeight >> csy;
+        width = orgPic->m_picWidth >> csx;
+        srcPelRow = orgPic->m_picOrg[c];
+        srcStride = (int)orgPic->m_strideC;
+    }
+    srcPelRow += y * srcStride;
 
-        const double maxSampleValue = (1 << m_bitDepth) - 1;
-        const double bitDepthDiffWeighting = 1024.0 / (maxSampleValue + 1);
+    const double weightScaling = m_overallStrength * ( (!c) ? 0.4 : m_chromaFactor);
+    const double* expTables = m_expTable + (!c ? 0 : 4) * numSampleValues;
 
-        const int blkSize = (!c) ? 8 : 4;
+    const int blkSize = (!c) ? 8 : 4;
+    const int blkHeight = X265_MIN(blkSize, height - y);
 
-        for (int y = 0; y < height; y++, srcPelRow += srcStride)
+    ALIGN_VAR_32(double, sumVal[8 * 8]);
+    ALIGN_VAR_32(double, sumWeight[8 * 8]);
+    int noise[MAX_MCSTF_TEMPORAL_WINDOW_LENGTH];
+
+    for (int x = 0; x < width; x += blkSize)
+    {
+        const int blkWidth = X265_MIN(blkSize, width - x);
+        pixel *srcPel = srcPelRow + x;
+
+        for (int i = 0; i < numRefs; i++)
         {
-            pixel *srcPel = srcPelRow;
+            TemporalFilterRefPicInfo *refPicInfo = &m_jobRefList[i];
 
-            for (int x = 0; x < width; x++, srcPel++)
-            {
-                const int orgVal = (int)*srcPel;
-                double temporalWeightSum = 1.0;
-                double newVal = (double)orgVal;
+            if (!c)
+                correctedPicsStride = refPicInfo->compensatedPic->m_stride;
+            else
+                correctedPicsStride = refPicInfo->compensatedPic->m_strideC;
 
-                if ((y % blkSize == 0) && (x % blkSize == 0))
+            double variance = 0, diffsum = 0;
+            for (int y1 = 0; y1 < blkSize - 1; y1++)
+            {
+                for (int x1 = 0; x1 < blkSize - 1; x1++)
                 {
-                    for (int i = 0; i < numRefs; i++)
-                    {
-                        TemporalFilterRefPicInfo *refPicInfo = &m_mcstfRefList[i];
+                    int pix = *(srcPel + x1);
+                    int pixR = *(srcPel + x1 + 1);
+                    int pixD = *(srcPel + x1 + srcStride);
 
-                        if (!c)
-                            correctedPicsStride = refPicInfo->compensatedPic->m_stride;
-                        else
-                            correctedPicsStride = refPicInfo->compensatedPic->m_strideC;
+                    int ref = *(refPicInfo->compensatedPic->m_picOrg[c] + ((y + y1) * correctedPicsStride + x + x1));
+                    int refR = *(refPicInfo->compensatedPic->m_picOrg[c] + ((y + y1) * correctedPicsStride + x + x1 + 1));
+                    int refD = *(refPicInfo->compensatedPic->m_picOrg[c] + ((y + y1 + 1) * correctedPicsStride + x + x1));
 
-                        double variance = 0, diffsum = 0;
-                        for (int y1 = 0; y1 < blkSize - 1; y1++)
-                        {
-                            for (int x1 = 0; x1 < blkSize - 1; x1++)
-                            {
-                                int pix = *(srcPel + x1);
-                                int pixR = *(srcPel + x1 + 1);
-                                int pixD = *(srcPel + x1 + srcStride);
-
-                                int ref = *(refPicInfo->compensatedPic->m_picOrg[c] + ((y + y1) * correctedPicsStride + x + x1));
-                                int refR = *(refPicInfo->compensatedPic->m_picOrg[c] + ((y + y1) * correctedPicsStride + x + x1 + 1));
-                                int refD = *(refPicInfo->compensatedPic->m_picOrg[c] + ((y + y1 + 1) * correctedPicsStride + x + x1));
-
-                                int diff = pix - ref;
-                                int diffR = pixR - refR;
-                                int diffD = pixD - refD;
-
-                                variance += diff * diff;
-                                diffsum += (diffR - diff) * (diffR - diff);
-                                diffsum += (diffD - diff) * (diffD - diff);
-                            }
-                        }
+                    int diff = pix - ref;
+                    int diffR = pixR - refR;
+                    int diffD = pixD - refD;
 
-                        refPicInfo->noise[(y / blkSize) * refPicInfo->mvsStride + (x / blkSize)] = (int)round((300 * variance + 50) / (10 * diffsum + 50));
-                    }
+                    variance += diff * diff;
+                    diffsum += (diffR - diff) * (diffR - diff);
+                    diffsum += (diffD - diff) * (diffD - diff);
                 }
+            }
 
-                double minError = 9999999;
-                for (int i = 0; i < numRefs; i++)
-                {
-                    TemporalFilterRefPicInfo *refPicInfo = &m_mcstfRefList[i];
-                    minError = X265_MIN(minError, (double)refPicInfo->error[(y / blkSize) * refPicInfo->mvsStride + (x / blkSize)]);
-                }
+            noise[i] = (int)round((300 * variance + 50) / (10 * diffsum + 50));
+        }
 
-                for (int i = 0; i < numRefs; i++)
-                {
-                    TemporalFilterRefPicInfo *refPicInfo = &m_mcstfRefList[i];
-
-                    const int error = refPicInfo->error[(y / blkSize) * refPicInfo->mvsStride + (x / blkSize)];
-                    const int noise = refPicInfo->noise[(y / blkSize) * refPicInfo->mvsStride + (x / blkSize)];
-
-                    const pixel *pCorrectedPelPtr = refPicInfo->compensatedPic->m_picOrg[c] + (y * correctedPicsStride + x);
-                    const int refVal = (int)*pCorrectedPelPtr;
-                    double diff = (double)(refVal - orgVal);
-                    diff *= bitDepthDiffWeighting;
-                    double diffSq = diff * diff;
-
-                    const int index = X265_MIN(3, std::abs(refPicInfo->origOffset) - 1);
-                    double ww = 1, sw = 1;
-                    ww *= (noise < 25) ? 1 : 1.2;
-                    sw *= (noise < 25) ? 1.3 : 0.8;
-                    ww *= (error < 50) ? 1.2 : ((error > 100) ? 0.8 : 1);
-                    sw *= (error < 50) ? 1.3 : 1;
-                    ww *= ((minError + 1) / (error + 1));
-                    const double weight = weightScaling * s_refStrengths[refStrengthRow][index] * ww * exp(-diffSq / (2 * sw * sigmaSq));
-
-                    newVal += weight * refVal;
-                    temporalWeightSum += weight;
-                }
-                newVal /= temporalWeightSum;
+        double minError = 9999999;
+        for (int i = 0; i < numRefs; i++)
+        {
+            TemporalFilterRefPicInfo *refPicInfo = &m_jobRefList[i];
+            minError = X265_MIN(minError, (double)refPicInfo->error[(y / blkSize) * refPicInfo->mvsStride + (x / blkSize)]);
+        }
+
+        for (int y1 = 0; y1 < blkHeight; y1++)
+        {
+            for (int x1 = 0; x1 < blkWidth; x1++)
+            {
+                sumVal[y1 * blkSize + x1] = (double)srcPel[y1 * srcStride + x1];
+                sumWeight[y1 * blkSize + x1] = 1.0;
+            }
+        }
+
+        for (int i = 0; i < numRefs; i++)
+        {
+            TemporalFilterRefPicInfo *refPicInfo = &m_jobRefList[i];
+
+            const int error = refPicInfo->error[(y / blkSize) * refPicInfo->mvsStride + (x / blkSize)];
+
+            if (!c)
+                correctedPicsStride = refPicInfo->compensatedPic->m_stride;
+            else
+                correctedPicsStride = refPicInfo->compensatedPic->m_strideC;
+            const pixel *pCorrectedPelPtr = refPicInfo->compensatedPic->m_picOrg[c] + (y * correctedPicsStride + x);
+
+            const int index = X265_MIN(3, std::abs(refPicInfo->origOffset) - 1);
+            double ww = 1;
+            ww *= (noise[i] < 25) ? 1 : 1.2;
+            ww *= (error < 50) ? 1.2 : ((error > 100) ? 0.8 : 1);
+            ww *= ((minError + 1) / (error + 1));
+            const double scale = weightScaling * s_refStrengths[m_refStrengthRow][index] * ww;
+            const int cls = ((noise[i] < 25) << 1) | (error < 50);
+
+            primitives.mcstfWeightAcc(srcPel, srcStride, pCorrectedPelPtr, correctedPicsStride, blkWidth, blkHeight,
+                                      expTables + cls * numSampleValues, scale, sumVal, sumWeight, blkSize);
+        }
+
+        for (int y1 = 0; y1 < blkHeight; y1++)
+        {
+            for (int x1 = 0; x1 < blkWidth; x1++)
+            {
+                double newVal = sumVal[y1 * blkSize + x1] / sumWeight[y1 * blkSize + x1];
                 double sampleVal = round(newVal);
                 sampleVal = (sampleVal < 0 ? 0 : (sampleVal > maxSampleValue ? maxSampleValue : sampleVal));
-                *srcPel = (pixel)sampleVal;
+                srcPel[y1 * srcStride + x1] = (pixel)sampleVal;
             }
         }
     }
 }
 
-void TemporalFilter::motionEstimationLuma(MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int blockSize,
-    MV *previous, uint32_t prevMvStride, int factor)
+void TemporalFilter::motionEstimationLuma(MotionEstimatorTLD& tld, MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int blockSize,
+    int blockY, ThreadSafeInteger* rowProgress, MV *previous, uint32_t prevMvStride, int factor)
 {
 
     int range = 5;
@@ -657,148 +799,152 @@ void TemporalFilter::motionEstimationLuma(MV *mvs, uint32_t mvStride, PicYuv *or
 
     int error;
 
-    for (int blockY = 0; blockY + blockSize <= origHeight; blockY += stepSize)
+    /* MVs of the row above are produced concurrently by another job */
+    int aboveDone = blockY > 0 ? rowProgress[-1].get() : 0;
+
+    for (int blockX = 0; blockX + blockSize <= origWidth; blockX += stepSize)
     {
-        for (int blockX = 0; blockX + blockSize <= origWidth; blockX += stepSize)
-        {
-            const intptr_t pelOffset = blockY * orig->m_stride + blockX;
-            m_metld->me.setSourcePU(orig->m_picOrg[0], orig->m_stride, pelOffset, blockSize, blockSize, X265_HEX_SEARCH, 1);
+        const intptr_t pelOffset = blockY * orig->m_stride + blockX;
+        tld.me.setSourcePU(orig->m_picOrg[0], orig->m_stride, pelOffset, blockSize, blockSize, X265_HEX_SEARCH, 1);
 
 
-            MV best(0, 0);
-            int leastError = INT_MAX;
+        MV best(0, 0);
+        int leastError = INT_MAX;
 
-            if (previous == NULL)
-            {
-                range = 8;
-            }
-            else
+        if (previous == NULL)
+        {
+            range = 8;
+        }
+        else
+        {
+
+            for (int py = -1; py <= 1; py++)
             {
+                int testy = blockY / (2 * blockSize) + py;
 
-                for (int py = -1; py <= 1; py++)
+                for (int px = -1; px <= 1; px++)
                 {
-                    int testy = blockY / (2 * blockSize) + py;
 
-                    for (int px = -1; px <= 1; px++)
+                    int testx = blockX / (2 * blockSize) + px;
+                    if ((testx >= 0) && (testx < origWidth / (2 * blockSize)) && (testy >= 0) && (testy < origHeight / (2 * blockSize)))
                     {
+                        int mvIdx = testy * prevMvStride + testx;
+                        MV old = previous[mvIdx];
 
-                        int testx = blockX / (2 * blockSize) + px;
-                        if ((testx >= 0) && (testx < origWidth / (2 * blockSize)) && (testy >= 0) && (testy < origHeight / (2 * blockSize)))
+                        if (m_useSADinME)
+                            error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
+                        else
+                            error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
+
+                        if (error < leastError)
                         {
-                            int mvIdx = testy * prevMvStride + testx;
-                            MV old = previous[mvIdx];
-
-                            if (m_useSADinME)
-                                error = motionErrorLumaSAD(orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
-                            else
-                                error = motionErrorLumaSSD(orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
-
-                            if (error < leastError)
-                            {
-                                best.set(old.x * factor, old.y * factor);
-                                leastError = error;
-                            }
+                            best.set(old.x * factor, old.y * factor);
+                            leastError = error;
                         }
                     }
                 }
-
-                if (m_useSADinME)
-                    error = motionErrorLumaSAD(orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
-                else
-                    error = motionErrorLumaSSD(orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
-
-                if (error < leastError)
-                {
-                    best.set(0, 0);
-                    leastError = error;
-                }
-
             }
 
-            MV prevBest = best;
-            for (int y2 = prevBest.y / m_motionVectorFactor - range; y2 <= prevBest.y / m_motionVectorFactor + range; y2++)
+            if (m_useSADinME)
+                error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
+            else
+                error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
+
+            if (error < leastError)
             {
-                for (int x2 = prevBest.x / m_motionVectorFactor - range; x2 <= prevBest.x / m_motionVectorFactor + range; x2++)
-                {
-                    if (m_useSADinME)
-                        error = motionErrorLumaSAD(orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
-                    else
-                        error = motionErrorLumaSSD(orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
-                    if (error < leastError)
-                    {
-                        best.set(x2 * m_motionVectorFactor, y2 * m_motionVectorFactor);
-                        leastError = error;
-                    }
-                }
+                best.set(0, 0);
+                leastError = error;
             }
 
-            if (blockY > 0)
-            {
-                int idx = ((blockY - stepSize) / stepSize) * mvStride + (blockX / stepSize);
-                MV aboveMV = mvs[idx];
+        }
 
+        MV prevBest = best;
+        for (int y2 = prevBest.y / m_motionVectorFactor - range; y2 <= prevBest.y / m_motionVectorFactor + range; y2++)
+        {
+            for (int x2 = prevBest.x / m_motionVectorFactor - range; x2 <= prevBest.x / m_motionVectorFactor + range; x2++)
+            {
                 if (m_useSADinME)
-                    error = motionErrorLumaSAD(orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
+                    error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
                 else
-                    error = motionErrorLumaSSD(orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
-
+                    error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
                 if (error < leastError)
                 {
-                    best.set(aboveMV.x, aboveMV.y);
+                    best.set(x2 * m_motionVectorFactor, y2 * m_motionVectorFactor);
                     leastError = error;
                 }
             }
+        }
+
+        if (blockY > 0)
+        {
+            while (aboveDone <= blockX / stepSize)
+                aboveDone = rowProgress[-1].waitForChange(aboveDone);
+
+            int idx = ((blockY - stepSize) / stepSize) * mvStride + (blockX / stepSize);
+            MV aboveMV = mvs[idx];
+
+            if (m_useSADinME)
+                error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
+            else
+                error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
 
-            if (blockX > 0)
+            if (error < leastError)
             {
-                int idx = ((blockY / stepSize) * mvStride + (blockX - stepSize) / stepSize);
-                MV leftMV = mvs[idx];
+                best.set(aboveMV.x, aboveMV.y);
+                leastError = error;
+            }
+        }
 
-                if (m_useSADinME)
-                    error = motionErrorLumaSAD(orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
-                else
-                    error = motionErrorLumaSSD(orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
+        if (blockX > 0)
+        {
+            int idx = ((blockY / stepSize) * mvStride + (blockX - stepSize) / stepSize);
+            MV leftMV = mvs[idx];
 
-                if (error < leastError)
-                {
-                    best.set(leftMV.x, leftMV.y);
-                    leastError = error;
-                }
+            if (m_useSADinME)
+                error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
+            else
+                error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
+
+            if (error < leastError)
+            {
+                best.set(leftMV.x, leftMV.y);
+                leastError = error;
             }
+        }
 
-            // calculate average
-            double avg = 0.0;
-            for (int x1 = 0; x1 < blockSize; x1++)
+        // calculate average
+        double avg = 0.0;
+        for (int x1 = 0; x1 < blockSize; x1++)
+        {
+            for (int y1 = 0; y1 < blockSize; y1++)
             {
-                for (int y1 = 0; y1 < blockSize; y1++)
-                {
-                    avg = avg + *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
-                }
+                avg = avg + *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
             }
-            avg = avg / (blockSize * blockSize);
+        }
+        avg = avg / (blockSize * blockSize);
 
-            // calculate variance
-            double variance = 0;
-            for (int x1 = 0; x1 < blockSize; x1++)
+        // calculate variance
+        double variance = 0;
+        for (int x1 = 0; x1 < blockSize; x1++)
+        {
+            for (int y1 = 0; y1 < blockSize; y1++)
             {
-                for (int y1 = 0; y1 < blockSize; y1++)
-                {
-                    int pix = *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
-                    variance = variance + (pix - avg) * (pix - avg);
-                }
+                int pix = *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
+                variance = variance + (pix - avg) * (pix - avg);
             }
+        }
 
-            leastError = (int)(20 * ((leastError + 5.0) / (variance + 5.0)) + (leastError / (blockSize * blockSize)) / 50);
+        leastError = (int)(20 * ((leastError + 5.0) / (variance + 5.0)) + (leastError / (blockSize * blockSize)) / 50);
 
-            int mvIdx = (blockY / stepSize) * mvStride + (blockX / stepSize);
-            mvs[mvIdx] = best;
-        }
+        int mvIdx = (blockY / stepSize) * mvStride + (blockX / stepSize);
+        mvs[mvIdx] = best;
+        rowProgress->incr();
     }
 }
 
 
-void TemporalFilter::motionEstimationLumaDoubleRes(MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int blockSize,
-    MV *previous, uint32_t prevMvStride, int factor, int* minError)
+void TemporalFilter::motionEstimationLumaDoubleRes(MotionEstimatorTLD& tld, MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int blockSize,
+    int blockY, ThreadSafeInteger* rowProgress, MV *previous, uint32_t prevMvStride, int factor, int* minError)
 {
 
     int range = 0;
@@ -811,183 +957,187 @@ void TemporalFilter::motionEstimationLumaDoubleRes(MV *mvs, uint32_t mvStride, P
 
     int error;
 
-    for (int blockY = 0; blockY + blockSize <= origHeight; blockY += stepSize)
+    /* MVs of the row above are produced concurrently by another job */
+    int aboveDone = blockY > 0 ? rowProgress[-1].get() : 0;
+
+    for (int blockX = 0; blockX + blockSize <= origWidth; blockX += stepSize)
     {
-        for (int blockX = 0; blockX + blockSize <= origWidth; blockX += stepSize)
-        {
 
-            const intptr_t pelOffset = blockY * orig->m_stride + blockX;
-            m_metld->me.setSourcePU(orig->m_picOrg[0], orig->m_stride, pelOffset, blockSize, blockSize, X265_HEX_SEARCH, 1);
+        const intptr_t pelOffset = blockY * orig->m_stride + blockX;
+        tld.me.setSourcePU(orig->m_picOrg[0], orig->m_stride, pelOffset, blockSize, blockSize, X265_HEX_SEARCH, 1);
 
-            MV best(0, 0);
-            int leastError = INT_MAX;
+        MV best(0, 0);
+        int leastError = INT_MAX;
 
-            if (previous == NULL)
-            {
-                range = 8;
-            }
-            else
+        if (previous == NULL)
+        {
+            range = 8;
+        }
+        else
+        {
+
+            for (int py = -1; py <= 1; py++)
             {
+                int testy = blockY / (2 * blockSize) + py;
 
-                for (int py = -1; py <= 1; py++)
+                for (int px = -1; px <= 1; px++)
                 {
-                    int testy = blockY / (2 * blockSize) + py;
 
-                    for (int px = -1; px <= 1; px++)
+                    int testx = blockX / (2 * blockSize) + px;
+                    if ((testx >= 0) && (testx < origWidth / (2 * blockSize)) && (testy >= 0) && (testy < origHeight / (2 * blockSize)))
                     {
+                        int mvIdx = testy * prevMvStride + testx;
+                        MV old = previous[mvIdx];
 
-                        int testx = blockX / (2 * blockSize) + px;
-                        if ((testx >= 0) && (testx < origWidth / (2 * blockSize)) && (testy >= 0) && (testy < origHeight / (2 * blockSize)))
+                        if (m_useSADinME)
+                            error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
+                        else
+                            error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
+
+                        if (error < leastError)
                         {
-                            int mvIdx = testy * prevMvStride + testx;
-                            MV old = previous[mvIdx];
-
-                            if (m_useSADinME)
-                                error = motionErrorLumaSAD(orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
-                            else
-                                error = motionErrorLumaSSD(orig, buffer, blockX, blockY, old.x * factor, old.y * factor, blockSize, leastError);
-
-                            if (error < leastError)
-                            {
-                                best.set(old.x * factor, old.y * factor);
-                                leastError = error;
-                            }
+                            best.set(old.x * factor, old.y * factor);
+                            leastError = error;
                         }
                     }
                 }
-
-                if (m_useSADinME)
-                    error = motionErrorLumaSAD(orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
-                else
-                    error = motionErrorLumaSSD(orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
-
-                if (error < leastError)
-                {
-                    best.set(0, 0);
-                    leastError = error;
-                }
-
             }
 
-            MV prevBest = best;
-            for (int y2 = prevBest.y / m_motionVectorFactor - range; y2 <= prevBest.y / m_motionVectorFactor + range; y2++)
-            {
-                for (int x2 = prevBest.x / m_motionVectorFactor - range; x2 <= prevBest.x / m_motionVectorFactor + range; x2++)
-                {
-                    if (m_useSADinME)
-                        error = motionErrorLumaSAD(orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
-                    else
-                        error = motionErrorLumaSSD(orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
-
-                    if (error < leastError)
-                    {
-                        best.set(x2 * m_motionVectorFactor, y2 * m_motionVectorFactor);
-                        leastError = error;
-                    }
-                }
-            }
+            if (m_useSADinME)
+                error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
+            else
+                error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, 0, 0, blockSize, leastError);
 
-            prevBest = best;
-            int doubleRange = 3 * 4;
-            for (int y2 = prevBest.y - doubleRange; y2 <= prevBest.y + doubleRange; y2 += 4)
+            if (error < leastError)
             {
-                for (int x2 = prevBest.x - doubleRange; x2 <= prevBest.x + doubleRange; x2 += 4)
-                {
-                    if (m_useSADinME)
-                        error = motionErrorLumaSAD(orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
-                    else
-                        error = motionErrorLumaSSD(orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
-
-                    if (error < leastError)
-                    {
-                        best.set(x2, y2);
-                        leastError = error;
-                    }
-                }
+                best.set(0, 0);
+                leastError = error;
             }
 
-            prevBest = best;
-            doubleRange = 3;
-            for (int y2 = prevBest.y - doubleRange; y2 <= prevBest.y + doubleRange; y2++)
+        }
+
+        MV prevBest = best;
+        for (int y2 = prevBest.y / m_motionVectorFactor - range; y2 <= prevBest.y / m_motionVectorFactor + range; y2++)
+        {
+            for (int x2 = prevBest.x / m_motionVectorFactor - range; x2 <= prevBest.x / m_motionVectorFactor + range; x2++)
             {
-                for (int x2 = prevBest.x - doubleRange; x2 <= prevBest.x + doubleRange; x2++)
-                {
-                    if (m_useSADinME)
-                        error = motionErrorLumaSAD(orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
-                    else
-                        error = motionErrorLumaSSD(orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
+                if (m_useSADinME)
+                    error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
+                else
+                    error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, x2 * m_motionVectorFactor, y2 * m_motionVectorFactor, blockSize, leastError);
 
-                    if (error < leastError)
-                    {
-                        best.set(x2, y2);
-                        leastError = error;
-                    }
+                if (error < leastError)
+                {
+                    best.set(x2 * m_motionVectorFactor, y2 * m_motionVectorFactor);
+                    leastError = error;
                 }
             }
+        }
 
-
-            if (blockY > 0)
+        prevBest = best;
+        int doubleRange = 3 * 4;
+        for (int y2 = prevBest.y - doubleRange; y2 <= prevBest.y + doubleRange; y2 += 4)
+        {
+            for (int x2 = prevBest.x - doubleRange; x2 <= prevBest.x + doubleRange; x2 += 4)
             {
-                int idx = ((blockY - stepSize) / stepSize) * mvStride + (blockX / stepSize);
-                MV aboveMV = mvs[idx];
-
                 if (m_useSADinME)
-                    error = motionErrorLumaSAD(orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
+                    error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
                 else
-                    error = motionErrorLumaSSD(orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
+                    error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
 
                 if (error < leastError)
                 {
-                    best.set(aboveMV.x, aboveMV.y);
+                    best.set(x2, y2);
                     leastError = error;
                 }
             }
+        }
 
-            if (blockX > 0)
+        prevBest = best;
+        doubleRange = 3;
+        for (int y2 = prevBest.y - doubleRange; y2 <= prevBest.y + doubleRange; y2++)
+        {
+            for (int x2 = prevBest.x - doubleRange; x2 <= prevBest.x + doubleRange; x2++)
             {
-                int idx = ((blockY / stepSize) * mvStride + (blockX - stepSize) / stepSize);
-                MV leftMV = mvs[idx];
-
                 if (m_useSADinME)
-                    error = motionErrorLumaSAD(orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
+                    error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
                 else
-                    error = motionErrorLumaSSD(orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
+                    error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, x2, y2, blockSize, leastError);
 
                 if (error < leastError)
                 {
-                    best.set(leftMV.x, leftMV.y);
+                    best.set(x2, y2);
                     leastError = error;
                 }
             }
+        }
+
+
+        if (blockY > 0)
+        {
+            while (aboveDone <= blockX / stepSize)
+                aboveDone = rowProgress[-1].waitForChange(aboveDone);
+
+            int idx = ((blockY - stepSize) / stepSize) * mvStride + (blockX / stepSize);
+            MV aboveMV = mvs[idx];
+
+            if (m_useSADinME)
+                error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
+            else
+                error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, aboveMV.x, aboveMV.y, blockSize, leastError);
 
-            // calculate average
-            double avg = 0.0;
-            for (int x1 = 0; x1 < blockSize; x1++)
+            if (error < leastError)
             {
-                for (int y1 = 0; y1 < blockSize; y1++)
-                {
-                    avg = avg + *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
-                }
+                best.set(aboveMV.x, aboveMV.y);
+                leastError = error;
             }
-            avg = avg / (blockSize * blockSize);
+        }
+
+        if (blockX > 0)
+        {
+            int idx = ((blockY / stepSize) * mvStride + (blockX - stepSize) / stepSize);
+            MV leftMV = mvs[idx];
+
+            if (m_useSADinME)
+                error = motionErrorLumaSAD(tld, orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
+            else
+                error = motionErrorLumaSSD(tld, orig, buffer, blockX, blockY, leftMV.x, leftMV.y, blockSize, leastError);
 
-            // calculate variance
-            double variance = 0;
-            for (int x1 = 0; x1 < blockSize; x1++)
+            if (error < leastError)
             {
-                for (int y1 = 0; y1 < blockSize; y1++)
-                {
-                    int pix = *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
-                    variance = variance + (pix - avg) * (pix - avg);
-                }
+                best.set(leftMV.x, leftMV.y);
+                leastError = error;
             }
+        }
 
-            leastError = (int)(20 * ((leastError + 5.0) / (variance + 5.0)) + (leastError / (blockSize * blockSize)) / 50);
+        // calculate average
+        double avg = 0.0;
+        for (int x1 = 0; x1 < blockSize; x1++)
+        {
+            for (int y1 = 0; y1 < blockSize; y1++)
+            {
+                avg = avg + *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
+            }
+        }
+        avg = avg / (blockSize * blockSize);
 
-            int mvIdx = (blockY / stepSize) * mvStride + (blockX / stepSize);
-            mvs[mvIdx] = best;
-            minError[mvIdx] = leastError;
+        // calculate variance
+        double variance = 0;
+        for (int x1 = 0; x1 < blockSize; x1++)
+        {
+            for (int y1 = 0; y1 < blockSize; y1++)
+            {
+                int pix = *(orig->m_picOrg[0] + (blockX + x1 + orig->m_stride * (blockY + y1)));
+                variance = variance + (pix - avg) * (pix - avg);
+            }
         }
+
+        leastError = (int)(20 * ((leastError + 5.0) / (variance + 5.0)) + (leastError / (blockSize * blockSize)) / 50);
+
+        int mvIdx = (blockY / stepSize) * mvStride + (blockX / stepSize);
+        mvs[mvIdx] = best;
+        minError[mvIdx] = leastError;
+        rowProgress->incr();
     }
 }
 
@@ -1009,8 +1159,6 @@ void TemporalFilter::destroyRefPicInfo(TemporalFilterRefPicInfo* curFrame)
             X265_FREE(curFrame->mvs1);
         if (curFrame->mvs2)
             X265_FREE(curFrame->mvs2);
-        if (curFrame->noise)
-            X265_FREE(curFrame->noise);
         if (curFrame->error)
             X265_FREE(curFrame->error);
     }
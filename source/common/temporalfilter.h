@@ -30,6 +30,7 @@
 #include "piclist.h"
 #include "yuv.h"
 #include "motion.h"
+#include "threadpool.h"
 
 const int s_interpolationFilter[16][8] =
 {
@@ -76,17 +77,20 @@ namespace X265_NS {
         void addEncPictureToPicList(Frame*);
     };
 
+    /* Per-worker motion search state, indexed by worker thread ID */
     struct MotionEstimatorTLD
     {
         MotionEstimate  me;
+        Yuv             predPUYuv;
 
         MotionEstimatorTLD()
         {
             me.init(X265_CSP_I400);
             me.setQP(X265_LOOKAHEAD_QP);
+            predPUYuv.create(FENC_STRIDE, X265_CSP_I400);
         }
 
-        ~MotionEstimatorTLD() {}
+        ~MotionEstimatorTLD() { predPUYuv.destroy(); }
     };
 
     struct TemporalFilterRefPicInfo
@@ -103,7 +107,6 @@ namespace X265_NS {
         uint32_t   mvsStride1;
         uint32_t   mvsStride2;
         int*       error;
-        int*       noise;
 
         int16_t    origOffset;
         bool       isFilteredFrame;
@@ -114,14 +117,19 @@ namespace X265_NS {
         int        slicetype;
     };
 
-    class TemporalFilter
+    /* Motion estimation levels and the filtering are split into block-row
+     * jobs which bonded worker threads of the pool pick up in order */
+    class TemporalFilter : public BondedTaskGroup
     {
     public:
         TemporalFilter();
-        ~TemporalFilter() {}
+        virtual ~TemporalFilter();
 
         void init(const x265_param* param);
 
+        /* allocate the filtering state, only needed by the frame encoders */
+        bool create(ThreadPool* pool);
+
         //private:
             // Private static member variables
         const x265_param *m_param;
@@ -144,21 +152,42 @@ namespace X265_NS {
         int m_numComponents;
         uint8_t m_sliceTypeConfig;
 
-        MotionEstimatorTLD* m_metld;
-        Yuv  predPUYuv;
+        ThreadPool* m_pool;
+        MotionEstimatorTLD* m_metld;  /* one per pool worker, plus the calling thread */
         int m_useSADinME;
 
+        /* number of MVs completed in each block row of the current ME level,
+         * [ref][row]; a row waits on the row above for its above MV candidate */
+        ThreadSafeInteger* m_rowProgress;
+        int m_maxRows;
+
+        /* state of the current batch of block-row jobs */
+        Frame* m_jobFrame;
+        TemporalFilterRefPicInfo* m_jobRefList;
+        int m_jobNumRefs;
+        int m_jobRows;
+        int m_jobLevel;
+        int m_refStrengthRow;
+        double m_overallStrength;
+
+        /* bilateral weight exp() lookup, [luma/chroma][noise/error class][abs diff] */
+        double* m_expTable;
+
         int createRefPicInfo(TemporalFilterRefPicInfo* refFrame, x265_param* param);
 
         void bilateralFilter(Frame* frame, TemporalFilterRefPicInfo* mctfRefList, double overallStrength);
 
-        void motionEstimationLuma(MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int bs,
-            MV *previous = 0, uint32_t prevmvStride = 0, int factor = 1);
+        /* hierarchical motion estimation of the frame against each of its references */
+        void motionEstimation(Frame* frame, TemporalFilterRefPicInfo* mctfRefList, int numRefs);
 
-        void motionEstimationLumaDoubleRes(MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int blockSize,
-            MV *previous, uint32_t prevMvStride, int factor, int* minError);
+        void motionEstimationLuma(MotionEstimatorTLD& tld, MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int bs,
+            int blockY, ThreadSafeInteger* rowProgress, MV *previous = 0, uint32_t prevmvStride = 0, int factor = 1);
 
-        int motionErrorLumaSSD(PicYuv *orig,
+        void motionEstimationLumaDoubleRes(MotionEstimatorTLD& tld, MV *mvs, uint32_t mvStride, PicYuv *orig, PicYuv *buffer, int blockSize,
+            int blockY, ThreadSafeInteger* rowProgress, MV *previous, uint32_t prevMvStride, int factor, int* minError);
+
+        int motionErrorLumaSSD(MotionEstimatorTLD& tld,
+            PicYuv *orig,
             PicYuv *buffer,
             int x,
             int y,
@@ -167,7 +196,8 @@ namespace X265_NS {
             int bs,
             int besterror = 8 * 8 * 1024 * 1024);
 
-        int motionErrorLumaSAD(PicYuv *orig,
+        int motionErrorLumaSAD(MotionEstimatorTLD& tld,
+            PicYuv *orig,
             PicYuv *buffer,
             int x,
             int y,
@@ -178,8 +208,16 @@ namespace X265_NS {
 
         void destroyRefPicInfo(TemporalFilterRefPicInfo* curFrame);
 
-        void applyMotion(MV *mvs, uint32_t mvsStride, PicYuv *input, PicYuv *output);
+        void applyMotion(MV *mvs, uint32_t mvsStride, PicYuv *input, PicYuv *output, int blockNumY);
+
+        void bilateralFilterRow(int c, int y);
+
+    protected:
+
+        void runJobs(int numJobs);
+        void processTasks(int workerThreadId);
 
+        TemporalFilter& operator=(const TemporalFilter&);
     };
 }
 #endif
@@ -82,6 +82,22 @@ int no_atomic_add(int* ptr, int val)
     pthread_mutex_unlock(&g_mutex);
     return ret;
 }
+
+int no_atomic_cas(int* ptr, int oldval, int newval)
+{
+    pthread_mutex_lock(&g_mutex);
+    int ret = *ptr == oldval;
+    if (ret)
+        *ptr = newval;
+    pthread_mutex_unlock(&g_mutex);
+    return ret;
+}
+
+void no_atomic_barrier()
+{
+    pthread_mutex_lock(&g_mutex);
+    pthread_mutex_unlock(&g_mutex);
+}
 #endif
 
 /* C shim for forced stack alignment */
@@ -56,6 +56,8 @@ int no_atomic_and(int* ptr, int mask);
 int no_atomic_inc(int* ptr);
 int no_atomic_dec(int* ptr);
 int no_atomic_add(int* ptr, int val);
+int no_atomic_cas(int* ptr, int oldval, int newval);
+void no_atomic_barrier();
 }
 
 #define CLZ(id, x)            id = (unsigned long)__builtin_clz(x) ^ 31
@@ -65,6 +67,8 @@ int no_atomic_add(int* ptr, int val);
 #define ATOMIC_INC(ptr)       no_atomic_inc((int*)ptr)
 #define ATOMIC_DEC(ptr)       no_atomic_dec((int*)ptr)
 #define ATOMIC_ADD(ptr, val)  no_atomic_add((int*)ptr, val)
+#define ATOMIC_CAS(ptr, oldval, newval) no_atomic_cas((int*)ptr, oldval, newval)
+#define MEMORY_BARRIER()      no_atomic_barrier()
 #define GIVE_UP_TIME()        usleep(0)
 
 #elif __GNUC__               /* GCCs builtin atomics */
@@ -79,6 +83,8 @@ int no_atomic_add(int* ptr, int val);
 #define ATOMIC_INC(ptr)       __sync_add_and_fetch((volatile int32_t*)ptr, 1)
 #define ATOMIC_DEC(ptr)       __sync_add_and_fetch((volatile int32_t*)ptr, -1)
 #define ATOMIC_ADD(ptr, val)  __sync_fetch_and_add((volatile int32_t*)ptr, val)
+#define ATOMIC_CAS(ptr, oldval, newval) __sync_bool_compare_and_swap((volatile int32_t*)ptr, oldval, newval)
+#define MEMORY_BARRIER()      __sync_synchronize()
 #define GIVE_UP_TIME()        usleep(0)
 
 #elif defined(_MSC_VER)       /* Windows atomic intrinsics */
@@ -92,6 +98,8 @@ int no_atomic_add(int* ptr, int val);
 #define ATOMIC_ADD(ptr, val)  InterlockedExchangeAdd((volatile LONG*)ptr, val)
 #define ATOMIC_OR(ptr, mask)  _InterlockedOr((volatile LONG*)ptr, (LONG)mask)
 #define ATOMIC_AND(ptr, mask) _InterlockedAnd((volatile LONG*)ptr, (LONG)mask)
+#define ATOMIC_CAS(ptr, oldval, newval) (InterlockedCompareExchange((volatile LONG*)ptr, (LONG)newval, (LONG)oldval) == (LONG)oldval)
+#define MEMORY_BARRIER()      MemoryBarrier()
 #define GIVE_UP_TIME()        Sleep(0)
 
 #endif // ifdef __GNUC__
@@ -32,6 +32,12 @@
 #include <winnt.h>
 #endif
 
+#if defined(_MSC_VER)
+#define X265_THREAD_LOCAL __declspec(thread)
+#else
+#define X265_THREAD_LOCAL __thread
+#endif
+
 #if X86_64
 
 #ifdef __GNUC__
@@ -43,8 +49,8 @@
 #elif defined(_MSC_VER)
 
 #define SLEEPBITMAP_CTZ(id, x)     _BitScanForward64(&id, x)
-#define SLEEPBITMAP_OR(ptr, mask)  InterlockedOr64((volatile LONG64*)ptr, (LONG)mask)
-#define SLEEPBITMAP_AND(ptr, mask) InterlockedAnd64((volatile LONG64*)ptr, (LONG)mask)
+#define SLEEPBITMAP_OR(ptr, mask)  InterlockedOr64((volatile LONG64*)ptr, (LONG64)mask)
+#define SLEEPBITMAP_AND(ptr, mask) InterlockedAnd64((volatile LONG64*)ptr, (LONG64)mask)
 
 #endif // ifdef __GNUC__
 
@@ -89,28 +95,155 @@ static int popCount(uint64_t x)
 namespace X265_NS {
 // x265 private namespace
 
+const PoolBitmap ALL_POOL_THREADS = { { (sleepbitmap_t)-1, (sleepbitmap_t)-1, (sleepbitmap_t)-1, (sleepbitmap_t)-1 } };
+const PoolBitmap NO_POOL_THREADS = { { 0 } };
+
+void PoolBitmap::set(int id)
+{
+    SLEEPBITMAP_OR(&m_words[id / BITMAP_WORD_BITS], (sleepbitmap_t)1 << (id % BITMAP_WORD_BITS));
+}
+
+void PoolBitmap::clear(int id)
+{
+    SLEEPBITMAP_AND(&m_words[id / BITMAP_WORD_BITS], ~((sleepbitmap_t)1 << (id % BITMAP_WORD_BITS)));
+}
+
+bool PoolBitmap::isSet(int id) const
+{
+    return !!(m_words[id / BITMAP_WORD_BITS] & ((sleepbitmap_t)1 << (id % BITMAP_WORD_BITS)));
+}
+
+bool PoolBitmap::testAndClear(int id)
+{
+    sleepbitmap_t bit = (sleepbitmap_t)1 << (id % BITMAP_WORD_BITS);
+    return !!(SLEEPBITMAP_AND(&m_words[id / BITMAP_WORD_BITS], ~bit) & bit);
+}
+
+/* A unit of work queued in work-stealing mode, either a hint that a job
+ * provider has work available or an offer to join a bonded task group */
+struct PoolTask
+{
+    JobProvider*     provider;
+    BondedTaskGroup* group;
+};
+
+/* Bounded Chase-Lev deque. Only the owning worker pushes and pops (at the
+ * bottom), any other worker may steal (from the top) */
+class WorkDeque
+{
+public:
+
+    enum { DEQUE_SIZE = 256 }; /* must be a power of two */
+
+    PoolTask     m_tasks[DEQUE_SIZE];
+    int volatile m_top;
+    int volatile m_bottom;
+
+    WorkDeque() : m_top(0), m_bottom(0) {}
+
+    bool isEmpty() const { return m_bottom - m_top <= 0; }
+
+    bool push(const PoolTask& task)
+    {
+        int b = m_bottom;
+        if (b - m_top >= DEQUE_SIZE)
+            return false;
+        m_tasks[b & (DEQUE_SIZE - 1)] = task;
+        MEMORY_BARRIER();
+        m_bottom = b + 1;
+        MEMORY_BARRIER();
+        return true;
+    }
+
+    bool pop(PoolTask& task)
+    {
+        int b = m_bottom - 1;
+        m_bottom = b;
+        MEMORY_BARRIER();
+        int t = m_top;
+        if (b - t < 0)
+        {
+            m_bottom = t;
+            return false;
+        }
+
+        task = m_tasks[b & (DEQUE_SIZE - 1)];
+        if (b != t)
+            return true;
+
+        /* last task, race against thieves for it */
+        bool won = ATOMIC_CAS(&m_top, t, t + 1);
+        m_bottom = t + 1;
+        return won;
+    }
+
+    bool steal(PoolTask& task)
+    {
+        int t = m_top;
+        MEMORY_BARRIER();
+        int b = m_bottom;
+        if (b - t <= 0)
+            return false;
+
+        task = m_tasks[t & (DEQUE_SIZE - 1)];
+        return ATOMIC_CAS(&m_top, t, t + 1);
+    }
+};
+
 class WorkerThread : public Thread
 {
 private:
 
     ThreadPool&  m_pool;
-    int          m_id;
     Event        m_wakeEvent;
 
     WorkerThread& operator =(const WorkerThread&);
 
 public:
 
+    int              m_id;
     JobProvider*     m_curJobProvider;
     BondedTaskGroup* m_bondMaster;
 
-    WorkerThread(ThreadPool& pool, int id) : m_pool(pool), m_id(id) {}
+    /* work-stealing mode state, only the counters are read by other threads
+     * and only once the pool has stopped */
+    WorkDeque        m_deque;
+    uint32_t         m_randState;
+    uint64_t         m_localTasks;
+    uint64_t         m_stolenTasks;
+    uint64_t         m_failedSteals;
+    uint64_t         m_idleCount;
+
+    WorkerThread(ThreadPool& pool, int id)
+        : m_pool(pool)
+        , m_id(id)
+        , m_randState(id * 2654435761u + 1)
+        , m_localTasks(0)
+        , m_stolenTasks(0)
+        , m_failedSteals(0)
+        , m_idleCount(0)
+    {}
     virtual ~WorkerThread() {}
 
     void threadMain();
     void awaken()           { m_wakeEvent.trigger(); }
+    bool isMember(const ThreadPool& pool) const { return &m_pool == &pool; }
+    bool findTask(PoolTask& task);
+    bool stealTask(PoolTask& task);
+    void runTask(const PoolTask& task);
+
+    uint32_t nextRandom()
+    {
+        m_randState ^= m_randState << 13;
+        m_randState ^= m_randState >> 17;
+        m_randState ^= m_randState << 5;
+        return m_randState;
+    }
 };
 
+/* the worker running on the current thread, NULL for non-pool threads */
+static X265_THREAD_LOCAL WorkerThread* s_curWorker;
+
 void WorkerThread::threadMain()
 {
     THREAD_NAME("Worker", m_id);
@@ -122,13 +255,13 @@ void WorkerThread::threadMain()
 #endif
 
     m_pool.setCurrentThreadAffinity();
+    s_curWorker = this;
 
-    sleepbitmap_t idBit = (sleepbitmap_t)1 << m_id;
     m_curJobProvider = m_pool.m_jpTable[0];
     m_bondMaster = NULL;
 
-    SLEEPBITMAP_OR(&m_curJobProvider->m_ownerBitmap, idBit);
-    SLEEPBITMAP_OR(&m_pool.m_sleepBitmap, idBit);
+    m_curJobProvider->m_ownerBitmap.set(m_id);
+    m_pool.m_sleepBitmap.set(m_id);
     m_wakeEvent.wait();
 
     while (m_pool.m_isActive)
@@ -162,25 +295,125 @@ void WorkerThread::threadMain()
             }
             if (nextProvider != -1 && m_curJobProvider != m_pool.m_jpTable[nextProvider])
             {
-                SLEEPBITMAP_AND(&m_curJobProvider->m_ownerBitmap, ~idBit);
+                m_curJobProvider->m_ownerBitmap.clear(m_id);
                 m_curJobProvider = m_pool.m_jpTable[nextProvider];
-                SLEEPBITMAP_OR(&m_curJobProvider->m_ownerBitmap, idBit);
+                m_curJobProvider->m_ownerBitmap.set(m_id);
             }
         }
         while (m_curJobProvider->m_helpWanted);
 
+        if (m_pool.m_bWorkStealing)
+        {
+            PoolTask task;
+            if (findTask(task))
+            {
+                runTask(task);
+                continue;
+            }
+        }
+
         /* While the worker sleeps, a job-provider or bond-group may acquire this
          * worker's sleep bitmap bit. Once acquired, that thread may modify 
          * m_bondMaster or m_curJobProvider, then waken the thread */
-        SLEEPBITMAP_OR(&m_pool.m_sleepBitmap, idBit);
+        m_pool.m_sleepBitmap.set(m_id);
+
+        /* a task queued after our last steal attempt saw no searching thread
+         * and may not have woken anyone, take our bit back unless it has
+         * already been acquired */
+        if (m_pool.m_bWorkStealing && m_pool.hasQueuedTasks() &&
+            m_pool.m_sleepBitmap.testAndClear(m_id))
+            continue;
+
+        m_idleCount++;
         m_wakeEvent.wait();
     }
 
-    SLEEPBITMAP_OR(&m_pool.m_sleepBitmap, idBit);
+    m_pool.m_sleepBitmap.set(m_id);
+}
+
+bool WorkerThread::findTask(PoolTask& task)
+{
+    enum { STEAL_ROUNDS = 2 };
+
+    if (m_deque.pop(task))
+    {
+        m_localTasks++;
+        return true;
+    }
+
+    /* while any worker is searching, producers skip waking sleepers */
+    ATOMIC_INC(&m_pool.m_numSearching);
+    bool found = false;
+    for (int round = 0; round < STEAL_ROUNDS && !found; round++)
+        found = stealTask(task);
+    ATOMIC_DEC(&m_pool.m_numSearching);
+
+    if (found)
+        m_stolenTasks++;
+    else
+        m_failedSteals++;
+    return found;
+}
+
+bool WorkerThread::stealTask(PoolTask& task)
+{
+    /* hints posted by threads outside of the pool */
+    sleepbitmap_t injected = m_pool.m_injectBitmap;
+    while (injected)
+    {
+        unsigned long id;
+        SLEEPBITMAP_CTZ(id, injected);
+
+        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
+        if (SLEEPBITMAP_AND(&m_pool.m_injectBitmap, ~bit) & bit)
+        {
+            task.provider = m_pool.m_jpTable[id];
+            task.group = NULL;
+            return true;
+        }
+
+        injected = m_pool.m_injectBitmap;
+    }
+
+    /* visit every other worker once, starting from a random victim */
+    int numWorkers = m_pool.m_numWorkers;
+    int victim = (int)(nextRandom() % (uint32_t)numWorkers);
+    for (int i = 0; i < numWorkers; i++, victim = (victim + 1 == numWorkers) ? 0 : victim + 1)
+    {
+        if (victim == m_id)
+            continue;
+
+        if (m_pool.m_workers[victim].m_deque.steal(task))
+        {
+            /* the master keeps the group alive until every offer is
+             * accounted for as either taken or revoked */
+            if (task.group)
+                ATOMIC_INC(&task.group->m_offersTaken);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerThread::runTask(const PoolTask& task)
+{
+    if (task.group)
+    {
+        task.group->processTasks(m_id);
+        task.group->m_exitedPeerCount.incr();
+    }
+    else
+        task.provider->findJob(m_id);
 }
 
 void JobProvider::tryWakeOne()
 {
+    /* in work-stealing mode a searching worker will find the hint, so only
+     * wake a sleeping thread when nobody is looking for work */
+    if (m_pool->m_bWorkStealing && m_pool->postHint(*this) && m_pool->m_numSearching)
+        return;
+
     int id = m_pool->tryAcquireSleepingThread(m_ownerBitmap, ALL_POOL_THREADS);
     if (id < 0)
     {
@@ -191,51 +424,59 @@ void JobProvider::tryWakeOne()
     WorkerThread& worker = m_pool->m_workers[id];
     if (worker.m_curJobProvider != this) /* poaching */
     {
-        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
-        SLEEPBITMAP_AND(&worker.m_curJobProvider->m_ownerBitmap, ~bit);
+        worker.m_curJobProvider->m_ownerBitmap.clear(id);
         worker.m_curJobProvider = this;
-        SLEEPBITMAP_OR(&worker.m_curJobProvider->m_ownerBitmap, bit);
+        worker.m_curJobProvider->m_ownerBitmap.set(id);
     }
     worker.awaken();
 }
 
-int ThreadPool::tryAcquireSleepingThread(sleepbitmap_t firstTryBitmap, sleepbitmap_t secondTryBitmap)
+int ThreadPool::tryAcquireSleepingThread(const PoolBitmap& firstTryBitmap, const PoolBitmap& secondTryBitmap)
 {
     unsigned long id;
 
-    sleepbitmap_t masked = m_sleepBitmap & firstTryBitmap;
-    while (masked)
+    for (int w = 0; w < m_numBitmapWords; w++)
     {
-        SLEEPBITMAP_CTZ(id, masked);
+        sleepbitmap_t masked = m_sleepBitmap.m_words[w] & firstTryBitmap.m_words[w];
+        while (masked)
+        {
+            SLEEPBITMAP_CTZ(id, masked);
 
-        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
-        if (SLEEPBITMAP_AND(&m_sleepBitmap, ~bit) & bit)
-            return (int)id;
+            sleepbitmap_t bit = (sleepbitmap_t)1 << id;
+            if (SLEEPBITMAP_AND(&m_sleepBitmap.m_words[w], ~bit) & bit)
+                return w * BITMAP_WORD_BITS + (int)id;
 
-        masked = m_sleepBitmap & firstTryBitmap;
+            masked = m_sleepBitmap.m_words[w] & firstTryBitmap.m_words[w];
+        }
     }
 
-    masked = m_sleepBitmap & secondTryBitmap;
-    while (masked)
+    for (int w = 0; w < m_numBitmapWords; w++)
     {
-        SLEEPBITMAP_CTZ(id, masked);
+        sleepbitmap_t masked = m_sleepBitmap.m_words[w] & secondTryBitmap.m_words[w];
+        while (masked)
+        {
+            SLEEPBITMAP_CTZ(id, masked);
 
-        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
-        if (SLEEPBITMAP_AND(&m_sleepBitmap, ~bit) & bit)
-            return (int)id;
+            sleepbitmap_t bit = (sleepbitmap_t)1 << id;
+            if (SLEEPBITMAP_AND(&m_sleepBitmap.m_words[w], ~bit) & bit)
+                return w * BITMAP_WORD_BITS + (int)id;
 
-        masked = m_sleepBitmap & secondTryBitmap;
+            masked = m_sleepBitmap.m_words[w] & secondTryBitmap.m_words[w];
+        }
     }
 
     return -1;
 }
 
-int ThreadPool::tryBondPeers(int maxPeers, sleepbitmap_t peerBitmap, BondedTaskGroup& master)
+int ThreadPool::tryBondPeers(int maxPeers, const PoolBitmap& peerBitmap, BondedTaskGroup& master)
 {
+    if (m_bWorkStealing && s_curWorker && s_curWorker->isMember(*this))
+        return offerTasks(maxPeers, peerBitmap, master);
+
     int bondCount = 0;
     do
     {
-        int id = tryAcquireSleepingThread(peerBitmap, 0);
+        int id = tryAcquireSleepingThread(peerBitmap, NO_POOL_THREADS);
         if (id < 0)
             return bondCount;
 
@@ -247,6 +488,131 @@ int ThreadPool::tryBondPeers(int maxPeers, sleepbitmap_t peerBitmap, BondedTaskG
 
     return bondCount;
 }
+
+bool ThreadPool::postHint(JobProvider& jp)
+{
+    PoolTask task = { &jp, NULL };
+    if (s_curWorker && s_curWorker->isMember(*this) && s_curWorker->m_deque.push(task))
+        return true;
+
+    if (jp.m_jpId < 0 || jp.m_jpId >= BITMAP_WORD_BITS)
+        return false;
+
+    SLEEPBITMAP_OR(&m_injectBitmap, (sleepbitmap_t)1 << jp.m_jpId);
+    return true;
+}
+
+/* Work-stealing replacement of tryBondPeers(). The offers are pushed on the
+ * master's deque, so they can only be taken by idle (searching) workers.
+ * Each offer counts as a bonded peer until revokeOffers() reclaims it */
+int ThreadPool::offerTasks(int maxPeers, const PoolBitmap& peerBitmap, BondedTaskGroup& master)
+{
+    WorkerThread& worker = *s_curWorker;
+    PoolTask task = { NULL, &master };
+
+    int offers = 0;
+    while (offers < maxPeers && worker.m_deque.push(task))
+        offers++;
+    if (!offers)
+        return 0;
+
+    master.m_offerPool = this;
+    master.m_offerCount += offers;
+
+    /* searching workers will pick up offers without being woken */
+    for (int wake = offers - m_numSearching; wake > 0; wake--)
+    {
+        int id = tryAcquireSleepingThread(peerBitmap, ALL_POOL_THREADS);
+        if (id < 0)
+            break;
+        m_workers[id].awaken();
+    }
+
+    return offers;
+}
+
+/* Called by the master before waiting on its peers. Pops every offer which
+ * was not stolen off the master's deque and removes them from the bonded peer
+ * count. Offers are popped LIFO, so any hints queued above them are put back
+ * afterwards */
+void ThreadPool::revokeOffers(BondedTaskGroup& master)
+{
+    enum { MAX_STASHED = 32 };
+
+    WorkerThread& worker = *s_curWorker;
+    PoolTask stash[MAX_STASHED];
+    int numStashed = 0;
+    int revoked = 0;
+
+    while (revoked + master.m_offersTaken < master.m_offerCount)
+    {
+        PoolTask task;
+        if (!worker.m_deque.pop(task))
+        {
+            /* a thief won the race for an offer, wait for it to be counted */
+            GIVE_UP_TIME();
+            continue;
+        }
+
+        /* offers of nested groups were revoked before ours, so anything
+         * else above our offers is a job provider hint */
+        X265_CHECK(!task.group || task.group == &master, "unexpected offer above bonded group offers\n");
+        if (task.group == &master)
+            revoked++;
+        else if (numStashed < MAX_STASHED)
+            stash[numStashed++] = task;
+        else
+            task.provider->m_helpWanted = true; /* drop the hint, fall back to the provider scan */
+    }
+
+    while (numStashed)
+        worker.m_deque.push(stash[--numStashed]);
+
+    master.m_bondedPeerCount -= revoked;
+    master.m_offerCount = master.m_offersTaken = 0;
+
+    /* if no thief joined, the master takes the place of the revoked peer.
+     * Groups without a job counter expect exactly one processTasks() call per
+     * peer (weight analysis) */
+    if (revoked)
+    {
+        master.m_lock.acquire();
+        bool pending = !master.m_jobTotal || master.m_jobAcquired < master.m_jobTotal;
+        master.m_lock.release();
+        if (pending)
+            master.processTasks(worker.m_id);
+    }
+}
+
+bool ThreadPool::hasQueuedTasks() const
+{
+    MEMORY_BARRIER();
+    if (m_injectBitmap)
+        return true;
+    for (int i = 0; i < m_numWorkers; i++)
+        if (!m_workers[i].m_deque.isEmpty())
+            return true;
+    return false;
+}
+
+void ThreadPool::logStats(const x265_param* p, int poolId) const
+{
+    if (!m_bWorkStealing || !m_workers)
+        return;
+
+    uint64_t local = 0, stolen = 0, failed = 0, idle = 0;
+    for (int i = 0; i < m_numWorkers; i++)
+    {
+        local += m_workers[i].m_localTasks;
+        stolen += m_workers[i].m_stolenTasks;
+        failed += m_workers[i].m_failedSteals;
+        idle += m_workers[i].m_idleCount;
+    }
+
+    x265_log(p, X265_LOG_INFO, "pool %d work-stealing: " X265_LL " local, " X265_LL " stolen, " X265_LL " failed steals, " X265_LL " idle waits\n",
+             poolId, local, stolen, failed, idle);
+}
+
 ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isThreadsReserved)
 {
     enum { MAX_NODE_NUM = 127 };
@@ -446,6 +812,7 @@ ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isTh
                 numPools = 0;
                 return NULL;
             }
+            pools[i].m_bWorkStealing = !!p->bWorkStealing;
             if (numNumaNodes > 1)
             {
                 char *nodesstr = new char[64 * strlen(",63") + 1];
@@ -502,6 +869,7 @@ bool ThreadPool::create(int numThreads, int maxProviders, uint64_t nodeMask)
 #endif
 
     m_numWorkers = numThreads;
+    m_numBitmapWords = (numThreads + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
 
     m_workers = X265_MALLOC(WorkerThread, numThreads);
     /* placement new initialization */
@@ -536,7 +904,7 @@ void ThreadPool::stopWorkers()
         m_isActive = false;
         for (int i = 0; i < m_numWorkers; i++)
         {
-            while (!(m_sleepBitmap & ((sleepbitmap_t)1 << i)))
+            while (!m_sleepBitmap.isSet(i))
                 GIVE_UP_TIME();
             m_workers[i].awaken();
             m_workers[i].stop();
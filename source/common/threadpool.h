@@ -40,8 +40,29 @@ typedef uint64_t sleepbitmap_t;
 typedef uint32_t sleepbitmap_t;
 #endif
 
-static const sleepbitmap_t ALL_POOL_THREADS = (sleepbitmap_t)-1;
-enum { MAX_POOL_THREADS = sizeof(sleepbitmap_t) * 8 };
+enum { BITMAP_WORD_BITS = sizeof(sleepbitmap_t) * 8 };
+enum { BITMAP_WORDS = 4 };
+enum { MAX_POOL_THREADS = BITMAP_WORD_BITS * BITMAP_WORDS };
+
+/* One bit per worker thread of a pool, split over several machine words so a
+ * single pool may span more hardware threads than an atomic word has bits.
+ * Each word is updated atomically on its own; bitmap operations only visit
+ * the words covering the pool's workers, so pools of up to BITMAP_WORD_BITS
+ * threads behave exactly as a single word bitmap */
+struct PoolBitmap
+{
+    sleepbitmap_t m_words[BITMAP_WORDS];
+
+    void set(int id);
+    void clear(int id);
+    bool isSet(int id) const;
+
+    /* atomically clear the bit, returns true if this call cleared it */
+    bool testAndClear(int id);
+};
+
+extern const PoolBitmap ALL_POOL_THREADS;
+extern const PoolBitmap NO_POOL_THREADS;
 enum { INVALID_SLICE_PRIORITY = 10 }; // a value larger than any X265_TYPE_* macro
 
 // Frame level job providers. FrameEncoder and Lookahead derive from
@@ -51,7 +72,7 @@ class JobProvider
 public:
 
     ThreadPool*   m_pool;
-    sleepbitmap_t m_ownerBitmap;
+    PoolBitmap    m_ownerBitmap;
     int           m_jpId;
     int           m_sliceType;
     bool          m_helpWanted;
@@ -59,7 +80,7 @@ public:
 
     JobProvider()
         : m_pool(NULL)
-        , m_ownerBitmap(0)
+        , m_ownerBitmap()
         , m_jpId(-1)
         , m_sliceType(INVALID_SLICE_PRIORITY)
         , m_helpWanted(false)
@@ -80,15 +101,23 @@ class ThreadPool
 {
 public:
 
-    sleepbitmap_t m_sleepBitmap;
+    PoolBitmap    m_sleepBitmap;
     int           m_numProviders;
     int           m_numWorkers;
+    int           m_numBitmapWords; // words of a PoolBitmap covering m_numWorkers
     void*         m_numaMask; // node mask in linux, cpu mask in windows
 #if defined(_WIN32_WINNT) && _WIN32_WINNT >= _WIN32_WINNT_WIN7 
     GROUP_AFFINITY m_groupAffinity;
 #endif
     bool          m_isActive;
 
+    /* work-stealing mode: each worker owns a deque of job provider hints and
+     * bonded task offers which idle workers steal from. Threads outside of
+     * the pool post their hints in m_injectBitmap (one bit per provider) */
+    bool          m_bWorkStealing;
+    sleepbitmap_t m_injectBitmap;
+    int volatile  m_numSearching;
+
     JobProvider** m_jpTable;
     WorkerThread* m_workers;
 
@@ -100,8 +129,13 @@ public:
     void stopWorkers();
     void setCurrentThreadAffinity();
     void setThreadNodeAffinity(void *numaMask);
-    int  tryAcquireSleepingThread(sleepbitmap_t firstTryBitmap, sleepbitmap_t secondTryBitmap);
-    int  tryBondPeers(int maxPeers, sleepbitmap_t peerBitmap, BondedTaskGroup& master);
+    int  tryAcquireSleepingThread(const PoolBitmap& firstTryBitmap, const PoolBitmap& secondTryBitmap);
+    int  tryBondPeers(int maxPeers, const PoolBitmap& peerBitmap, BondedTaskGroup& master);
+    bool postHint(JobProvider& jp);
+    int  offerTasks(int maxPeers, const PoolBitmap& peerBitmap, BondedTaskGroup& master);
+    void revokeOffers(BondedTaskGroup& master);
+    bool hasQueuedTasks() const;
+    void logStats(const x265_param* p, int poolId) const;
     static ThreadPool* allocThreadPools(x265_param* p, int& numPools, bool isThreadsReserved);
     static int  getCpuCount();
     static int  getNumaNodeCount();
@@ -128,7 +162,18 @@ public:
     int               m_jobTotal;
     int               m_jobAcquired;
 
-    BondedTaskGroup()  { m_bondedPeerCount = m_jobTotal = m_jobAcquired = 0; }
+    /* work-stealing mode: peers are not bonded directly, the master pushes
+     * offers on its own deque and revokes the ones nobody stole */
+    ThreadPool*       m_offerPool;
+    int               m_offerCount;
+    int volatile      m_offersTaken;
+
+    BondedTaskGroup()
+    {
+        m_bondedPeerCount = m_jobTotal = m_jobAcquired = 0;
+        m_offerPool = NULL;
+        m_offerCount = m_offersTaken = 0;
+    }
 
     /* Do not allow the instance to be destroyed before all bonded peers have
      * exited processTasks() */
@@ -158,6 +203,9 @@ public:
      * ensure all tasks are completed (but this is generally implied). */
     void waitForExit()
     {
+        if (m_offerCount)
+            m_offerPool->revokeOffers(*this);
+
         int exited = m_exitedPeerCount.get();
         while (m_bondedPeerCount != exited)
             exited = m_exitedPeerCount.waitForChange(exited);
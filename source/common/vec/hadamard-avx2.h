@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_HADAMARD_AVX2_H
+#define X265_HADAMARD_AVX2_H
+
+/* AVX2 helpers shared by the SATD based intrinsics. Include after common.h
+ * and immintrin.h, in files built with AVX2 enabled */
+
+namespace X265_NS {
+// private x265 namespace
+
+static inline __m256i pack2(__m128i lo, __m128i hi)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+static inline __m128i loadRow(const pixel* src)
+{
+#if X265_DEPTH == 8
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)src));
+#else
+    return _mm_loadu_si128((const __m128i*)src);
+#endif
+}
+
+/* half the absolute Hadamard sum of the two 4x4 blocks in four rows, the
+ * value satd_8x4 returns, spread over eight 16-bit elements per lane.
+ * |a + b| + |a - b| == 2 * max(|a|, |b|) replaces the last butterfly */
+static inline __m256i satd8x4(__m256i r0, __m256i r1, __m256i r2, __m256i r3)
+{
+    __m256i s01 = _mm256_add_epi16(r0, r1), d01 = _mm256_sub_epi16(r0, r1);
+    __m256i s23 = _mm256_add_epi16(r2, r3), d23 = _mm256_sub_epi16(r2, r3);
+    __m256i h0 = _mm256_add_epi16(s01, s23), h1 = _mm256_add_epi16(d01, d23);
+    __m256i h2 = _mm256_sub_epi16(s01, s23), h3 = _mm256_sub_epi16(d01, d23);
+
+    /* columns of both 4x4 blocks */
+    __m256i t0 = _mm256_unpacklo_epi16(h0, h1), t1 = _mm256_unpackhi_epi16(h0, h1);
+    __m256i t2 = _mm256_unpacklo_epi16(h2, h3), t3 = _mm256_unpackhi_epi16(h2, h3);
+    __m256i c01 = _mm256_unpacklo_epi32(t0, t2), c23 = _mm256_unpackhi_epi32(t0, t2);
+    __m256i c45 = _mm256_unpacklo_epi32(t1, t3), c67 = _mm256_unpackhi_epi32(t1, t3);
+
+    __m256i sa = _mm256_add_epi16(c01, c23), da = _mm256_sub_epi16(c01, c23);
+    __m256i sb = _mm256_add_epi16(c45, c67), db = _mm256_sub_epi16(c45, c67);
+
+    __m256i ma = _mm256_max_epi16(_mm256_abs_epi16(_mm256_unpacklo_epi64(sa, da)), _mm256_abs_epi16(_mm256_unpackhi_epi64(sa, da)));
+    __m256i mb = _mm256_max_epi16(_mm256_abs_epi16(_mm256_unpacklo_epi64(sb, db)), _mm256_abs_epi16(_mm256_unpackhi_epi64(sb, db)));
+    return _mm256_add_epi16(ma, mb);
+}
+
+}
+
+#endif // ifndef X265_HADAMARD_AVX2_H
@@ -0,0 +1,348 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+#include "hadamard-avx2.h"
+
+using namespace X265_NS;
+
+namespace {
+
+#if X265_DEPTH <= 10
+
+/* The lowres intra estimate runs two 8x8 blocks side by side, one per 128-bit
+ * lane, each row held as eight 16-bit samples. Horizontal modes are predicted
+ * in their vertical form and scored against the transposed source block; the
+ * 4x4 Hadamard sums of SATD do not change under transposition. */
+
+const int8_t  angleTable[17] = { -32, -26, -21, -17, -13, -9, -5, -2, 0, 2, 5, 9, 13, 17, 21, 26, 32 };
+const int16_t invAngleTable[8] = { 4096, 1638, 910, 630, 482, 390, 315, 256 };
+
+struct LowresBlock
+{
+    /* [filtered][horizontal]: top-left, 16 above and 16 left samples, above
+     * and left swapped for horizontal modes */
+    int16_t nb[2][2][33];
+};
+
+/* reference row of one angular mode in the layout of intra_pred_ang_c */
+struct AngularRef
+{
+    int16_t        buf[32];
+    const int16_t* ref;
+    int            angle;
+    int            hor;
+    int16_t        edge[8]; /* filtered first column when angle is 0 */
+};
+
+static void loadNeighbours(const pixel* fenc, intptr_t stride, LowresBlock& blk)
+{
+    const pixel* pixCur = fenc - stride - 1;
+    int16_t* s = blk.nb[0][0];
+    int16_t* f = blk.nb[1][0];
+
+    for (int i = 0; i <= 16; i++)
+        s[i] = pixCur[i];
+    for (int i = 1; i <= 16; i++)
+        s[16 + i] = pixCur[i * stride];
+
+    /* 1:2:1 filter of intraFilter<8> */
+    for (int i = 1; i < 16; i++)
+        f[i] = (int16_t)(((s[i] << 1) + s[i - 1] + s[i + 1] + 2) >> 2);
+    f[16] = s[16];
+    f[0] = (int16_t)(((s[0] << 1) + s[1] + s[17] + 2) >> 2);
+    f[17] = (int16_t)(((s[17] << 1) + s[0] + s[18] + 2) >> 2);
+    for (int i = 18; i < 32; i++)
+        f[i] = (int16_t)(((s[i] << 1) + s[i - 1] + s[i + 1] + 2) >> 2);
+    f[32] = s[32];
+
+    for (int k = 0; k < 2; k++)
+    {
+        const int16_t* v = blk.nb[k][0];
+        int16_t* h = blk.nb[k][1];
+        h[0] = v[0];
+        for (int i = 0; i < 16; i++)
+        {
+            h[1 + i] = v[17 + i];
+            h[17 + i] = v[1 + i];
+        }
+    }
+}
+
+static void setupAngular(const LowresBlock& blk, int mode, AngularRef& ar)
+{
+    ar.hor = mode < 18;
+    const int16_t* srcPix = blk.nb[!!(g_intraFilterFlags[mode] & 8)][ar.hor];
+    int angleOffset = ar.hor ? 10 - mode : mode - 26;
+    ar.angle = angleTable[8 + angleOffset];
+
+    if (ar.angle < 0)
+    {
+        int nbProjected = -((8 * ar.angle) >> 5) - 1;
+        int16_t* refPix = ar.buf + 16;
+
+        int invAngle = invAngleTable[-angleOffset - 1];
+        int invAngleSum = 128;
+        for (int i = 0; i < nbProjected; i++)
+        {
+            invAngleSum += invAngle;
+            refPix[-2 - i] = srcPix[16 + (invAngleSum >> 8)];
+        }
+        for (int i = 0; i < 9; i++)
+            refPix[-1 + i] = srcPix[i];
+        ar.ref = refPix;
+    }
+    else
+        ar.ref = srcPix + 1;
+
+    if (!ar.angle)
+    {
+        int topLeft = srcPix[0], top = srcPix[1];
+        for (int y = 0; y < 8; y++)
+            ar.edge[y] = (int16_t)x265_clip((int16_t)(top + ((srcPix[17 + y] - topLeft) >> 1)));
+    }
+}
+
+static void predAngular(const AngularRef& a0, const AngularRef& a1, __m256i pred[8])
+{
+    const __m256i c32 = _mm256_set1_epi16(32);
+    const __m256i c16 = _mm256_set1_epi16(16);
+
+    for (int y = 0; y < 8; y++)
+    {
+        int sum0 = (y + 1) * a0.angle, sum1 = (y + 1) * a1.angle;
+        const int16_t* r0 = a0.ref + (sum0 >> 5);
+        const int16_t* r1 = a1.ref + (sum1 >> 5);
+
+        __m256i p = pack2(_mm_loadu_si128((const __m128i*)r0), _mm_loadu_si128((const __m128i*)r1));
+        __m256i n = pack2(_mm_loadu_si128((const __m128i*)(r0 + 1)), _mm_loadu_si128((const __m128i*)(r1 + 1)));
+        __m256i frac = pack2(_mm_set1_epi16((int16_t)(sum0 & 31)), _mm_set1_epi16((int16_t)(sum1 & 31)));
+
+        /* a zero fraction degenerates to a copy of the reference */
+        __m256i v = _mm256_add_epi16(_mm256_mullo_epi16(p, _mm256_sub_epi16(c32, frac)), _mm256_mullo_epi16(n, frac));
+        pred[y] = _mm256_srli_epi16(_mm256_add_epi16(v, c16), 5);
+
+        if (!a0.angle)
+            pred[y] = _mm256_insert_epi16(pred[y], a0.edge[y], 0);
+        if (!a1.angle)
+            pred[y] = _mm256_insert_epi16(pred[y], a1.edge[y], 8);
+    }
+}
+
+static void predDC(const LowresBlock& b0, const LowresBlock& b1, __m256i pred[8])
+{
+    __m128i rows[2][8];
+    const LowresBlock* blk[2] = { &b0, &b1 };
+
+    for (int l = 0; l < 2; l++)
+    {
+        const int16_t* above = blk[l]->nb[0][0] + 1;
+        const int16_t* left = blk[l]->nb[0][0] + 17;
+
+        int dcVal = 8;
+        for (int i = 0; i < 8; i++)
+            dcVal += above[i] + left[i];
+        dcVal >>= 4;
+
+        __m128i dc = _mm_set1_epi16((int16_t)dcVal);
+        __m128i dc3 = _mm_set1_epi16((int16_t)(3 * dcVal + 2));
+        __m128i top = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)above), dc3), 2);
+        rows[l][0] = _mm_insert_epi16(top, (above[0] + left[0] + 2 * dcVal + 2) >> 2, 0);
+        for (int y = 1; y < 8; y++)
+            rows[l][y] = _mm_insert_epi16(dc, (left[y] + 3 * dcVal + 2) >> 2, 0);
+    }
+
+    for (int y = 0; y < 8; y++)
+        pred[y] = pack2(rows[0][y], rows[1][y]);
+}
+
+static void predPlanar(const LowresBlock& b0, const LowresBlock& b1, __m256i pred[8])
+{
+    const int16_t* f0 = b0.nb[1][0];
+    const int16_t* f1 = b1.nb[1][0];
+
+    const __m256i xInv = _mm256_setr_epi16(7, 6, 5, 4, 3, 2, 1, 0, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i xInc = _mm256_setr_epi16(1, 2, 3, 4, 5, 6, 7, 8, 1, 2, 3, 4, 5, 6, 7, 8);
+
+    __m256i above = pack2(_mm_loadu_si128((const __m128i*)(f0 + 1)), _mm_loadu_si128((const __m128i*)(f1 + 1)));
+    __m256i topRight = pack2(_mm_set1_epi16(f0[9]), _mm_set1_epi16(f1[9]));
+    __m256i bottomLeft = pack2(_mm_set1_epi16(f0[25]), _mm_set1_epi16(f1[25]));
+    __m256i base = _mm256_add_epi16(_mm256_mullo_epi16(xInc, topRight), _mm256_set1_epi16(8));
+
+    for (int y = 0; y < 8; y++)
+    {
+        __m256i left = pack2(_mm_set1_epi16(f0[17 + y]), _mm_set1_epi16(f1[17 + y]));
+        __m256i v = _mm256_add_epi16(base, _mm256_mullo_epi16(xInv, left));
+        v = _mm256_add_epi16(v, _mm256_mullo_epi16(above, _mm256_set1_epi16((int16_t)(7 - y))));
+        v = _mm256_add_epi16(v, _mm256_mullo_epi16(bottomLeft, _mm256_set1_epi16((int16_t)(y + 1))));
+        pred[y] = _mm256_srli_epi16(v, 4);
+    }
+}
+
+static void transpose8x8(const __m256i r[8], __m256i t[8])
+{
+    __m256i a0 = _mm256_unpacklo_epi16(r[0], r[1]);
+    __m256i a1 = _mm256_unpackhi_epi16(r[0], r[1]);
+    __m256i a2 = _mm256_unpacklo_epi16(r[2], r[3]);
+    __m256i a3 = _mm256_unpackhi_epi16(r[2], r[3]);
+    __m256i a4 = _mm256_unpacklo_epi16(r[4], r[5]);
+    __m256i a5 = _mm256_unpackhi_epi16(r[4], r[5]);
+    __m256i a6 = _mm256_unpacklo_epi16(r[6], r[7]);
+    __m256i a7 = _mm256_unpackhi_epi16(r[6], r[7]);
+
+    __m256i b0 = _mm256_unpacklo_epi32(a0, a2);
+    __m256i b1 = _mm256_unpackhi_epi32(a0, a2);
+    __m256i b2 = _mm256_unpacklo_epi32(a1, a3);
+    __m256i b3 = _mm256_unpackhi_epi32(a1, a3);
+    __m256i b4 = _mm256_unpacklo_epi32(a4, a6);
+    __m256i b5 = _mm256_unpackhi_epi32(a4, a6);
+    __m256i b6 = _mm256_unpacklo_epi32(a5, a7);
+    __m256i b7 = _mm256_unpackhi_epi32(a5, a7);
+
+    t[0] = _mm256_unpacklo_epi64(b0, b4);
+    t[1] = _mm256_unpackhi_epi64(b0, b4);
+    t[2] = _mm256_unpacklo_epi64(b1, b5);
+    t[3] = _mm256_unpackhi_epi64(b1, b5);
+    t[4] = _mm256_unpacklo_epi64(b2, b6);
+    t[5] = _mm256_unpackhi_epi64(b2, b6);
+    t[6] = _mm256_unpacklo_epi64(b3, b7);
+    t[7] = _mm256_unpackhi_epi64(b3, b7);
+}
+
+static inline void satdPair(const __m256i fenc[8], const __m256i pred[8], int cost[2])
+{
+    __m256i d[8];
+    for (int y = 0; y < 8; y++)
+        d[y] = _mm256_sub_epi16(fenc[y], pred[y]);
+
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(satd8x4(d[0], d[1], d[2], d[3]), ones),
+                                   _mm256_madd_epi16(satd8x4(d[4], d[5], d[6], d[7]), ones));
+    sum = _mm256_add_epi32(sum, _mm256_shuffle_epi32(sum, 0x4E));
+    sum = _mm256_add_epi32(sum, _mm256_shuffle_epi32(sum, 0xB1));
+    cost[0] = _mm256_cvtsi256_si32(sum);
+    cost[1] = _mm256_extract_epi32(sum, 4);
+}
+
+static void estimatePair(const pixel* fenc0, const pixel* fenc1, intptr_t stride, int32_t* costs, uint8_t* modes)
+{
+    LowresBlock blk[2];
+    loadNeighbours(fenc0, stride, blk[0]);
+    loadNeighbours(fenc1, stride, blk[1]);
+
+    __m256i fencV[8], fencH[8], pred[8];
+    for (int y = 0; y < 8; y++)
+        fencV[y] = pack2(loadRow(fenc0 + y * stride), loadRow(fenc1 + y * stride));
+    transpose8x8(fencV, fencH);
+
+    const int costMax = 1 << 28;
+    int cost[2];
+    int icost[2] = { costMax, costMax }, acost[2] = { costMax, costMax };
+    uint32_t ilowmode[2] = { 0, 0 }, alowmode[2] = { 4, 4 };
+
+    /* DC and planar */
+    predDC(blk[0], blk[1], pred);
+    satdPair(fencV, pred, cost);
+    for (int l = 0; l < 2; l++)
+        COPY2_IF_LT(icost[l], cost[l], ilowmode[l], DC_IDX);
+
+    predPlanar(blk[0], blk[1], pred);
+    satdPair(fencV, pred, cost);
+    for (int l = 0; l < 2; l++)
+        COPY2_IF_LT(icost[l], cost[l], ilowmode[l], PLANAR_IDX);
+
+    /* scan angular predictions, the same mode in both lanes */
+    AngularRef ar[2];
+    for (uint32_t mode = 5; mode < 35; mode += 5)
+    {
+        setupAngular(blk[0], mode, ar[0]);
+        setupAngular(blk[1], mode, ar[1]);
+        predAngular(ar[0], ar[1], pred);
+        satdPair(ar[0].hor ? fencH : fencV, pred, cost);
+        for (int l = 0; l < 2; l++)
+            COPY2_IF_LT(acost[l], cost[l], alowmode[l], mode);
+    }
+
+    /* refinement, each lane around its own best angle */
+    __m256i fencMix[8];
+    for (uint32_t dist = 2; dist >= 1; dist--)
+    {
+        uint32_t steps[2][2] = { { alowmode[0] - dist, alowmode[0] + dist },
+                                 { alowmode[1] - dist, alowmode[1] + dist } };
+        for (int s = 0; s < 2; s++)
+        {
+            setupAngular(blk[0], steps[0][s], ar[0]);
+            setupAngular(blk[1], steps[1][s], ar[1]);
+            predAngular(ar[0], ar[1], pred);
+
+            const __m256i* src = ar[0].hor ? fencH : fencV;
+            if (ar[0].hor != ar[1].hor)
+            {
+                for (int y = 0; y < 8; y++)
+                    fencMix[y] = _mm256_blend_epi32(src[y], ar[1].hor ? fencH[y] : fencV[y], 0xF0);
+                src = fencMix;
+            }
+            satdPair(src, pred, cost);
+            for (int l = 0; l < 2; l++)
+                COPY2_IF_LT(acost[l], cost[l], alowmode[l], steps[l][s]);
+        }
+    }
+
+    for (int l = 0; l < 2; l++)
+    {
+        COPY2_IF_LT(icost[l], acost[l], ilowmode[l], alowmode[l]);
+        costs[l] = icost[l];
+        modes[l] = (uint8_t)ilowmode[l];
+    }
+}
+
+void lowres_intra_cost_avx2(const pixel* src, intptr_t stride, int numBlocks, int32_t* costs, uint8_t* modes)
+{
+    int blk = 0;
+    for (; blk + 2 <= numBlocks; blk += 2)
+        estimatePair(src + blk * 8, src + (blk + 1) * 8, stride, costs + blk, modes + blk);
+
+    if (blk < numBlocks)
+    {
+        /* an odd last block is estimated in both lanes */
+        int32_t lastCost[2];
+        uint8_t lastMode[2];
+        estimatePair(src + blk * 8, src + blk * 8, stride, lastCost, lastMode);
+        costs[blk] = lastCost[0];
+        modes[blk] = lastMode[0];
+    }
+}
+
+#endif // X265_DEPTH <= 10
+}
+
+namespace X265_NS {
+void setupIntrinsicIntra_avx2(EncoderPrimitives &p)
+{
+#if X265_DEPTH <= 10
+    p.lowresIntraCost = lowres_intra_cost_avx2;
+#else
+    (void)p;
+#endif
+}
+}
@@ -0,0 +1,133 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+
+#include "common.h"
+#include "primitives.h"
+#include "constants.h"
+#include <immintrin.h> // AVX2
+
+using namespace X265_NS;
+
+namespace {
+
+/* eight samples widened to 32 bits */
+static inline __m256i loadSamples(const pixel* src)
+{
+#if HIGH_BIT_DEPTH
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+#else
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src));
+#endif
+}
+
+static inline uint32_t blurSample(const uint32_t* rowSums, int x, int width)
+{
+    uint64_t sum = 0;
+    for (int k = 0; k < 5; k++)
+    {
+        int i = x + k - 2;
+        i = i < 0 ? -i : i >= width ? 2 * width - 2 - i : i;
+        sum += (uint64_t)g_motionBlurTaps[k] * rowSums[i];
+    }
+    return (uint32_t)((sum + (1 << 23)) >> 24);
+}
+
+/* The taps are symmetric, the outer pairs are added before the products.
+ * A vertical sum is below 2^16 * PIXEL_MAX, so pairs of them still fit 32
+ * bits; the horizontal products are taken in 64 bits by mul_epu32, the even
+ * and the odd samples apart */
+void motion_blur_avx2(uint32_t* dst, uint32_t* rowSums, const pixel* const* lines, int width)
+{
+    const uint16_t* taps = g_motionBlurTaps;
+    const __m256i t0 = _mm256_set1_epi32(taps[0]);
+    const __m256i t1 = _mm256_set1_epi32(taps[1]);
+    const __m256i t2 = _mm256_set1_epi32(taps[2]);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m256i outer = _mm256_add_epi32(loadSamples(lines[0] + x), loadSamples(lines[4] + x));
+        __m256i inner = _mm256_add_epi32(loadSamples(lines[1] + x), loadSamples(lines[3] + x));
+        __m256i sum = _mm256_mullo_epi32(loadSamples(lines[2] + x), t2);
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(outer, t0));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(inner, t1));
+        _mm256_storeu_si256((__m256i*)(rowSums + x), sum);
+    }
+    for (; x < width; x++)
+        rowSums[x] = (uint32_t)taps[0] * lines[0][x] + (uint32_t)taps[1] * lines[1][x] + (uint32_t)taps[2] * lines[2][x] +
+                     (uint32_t)taps[3] * lines[3][x] + (uint32_t)taps[4] * lines[4][x];
+
+    const __m256i round = _mm256_set1_epi64x(1 << 23);
+    for (x = 0; x < X265_MIN(2, width); x++)
+        dst[x] = blurSample(rowSums, x, width);
+    for (; x + 10 <= width; x += 8)
+    {
+        const uint32_t* s = rowSums + x;
+        __m256i outer = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(s - 2)), _mm256_loadu_si256((const __m256i*)(s + 2)));
+        __m256i inner = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(s - 1)), _mm256_loadu_si256((const __m256i*)(s + 1)));
+        __m256i centre = _mm256_loadu_si256((const __m256i*)s);
+
+        __m256i even = _mm256_add_epi64(_mm256_mul_epu32(outer, t0), _mm256_mul_epu32(inner, t1));
+        even = _mm256_add_epi64(even, _mm256_mul_epu32(centre, t2));
+        __m256i odd = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(outer, 32), t0), _mm256_mul_epu32(_mm256_srli_epi64(inner, 32), t1));
+        odd = _mm256_add_epi64(odd, _mm256_mul_epu32(_mm256_srli_epi64(centre, 32), t2));
+
+        even = _mm256_srli_epi64(_mm256_add_epi64(even, round), 24);
+        odd = _mm256_srli_epi64(_mm256_add_epi64(odd, round), 24);
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_or_si256(even, _mm256_slli_epi64(odd, 32)));
+    }
+    for (; x < width; x++)
+        dst[x] = blurSample(rowSums, x, width);
+}
+
+uint64_t motion_sad_avx2(const uint32_t* cur, const uint32_t* prev, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(cur + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(prev + i));
+        __m256i diff = _mm256_sub_epi32(_mm256_max_epu32(a, b), _mm256_min_epu32(a, b));
+        sum = _mm256_add_epi64(sum, _mm256_add_epi64(_mm256_unpacklo_epi32(diff, zero), _mm256_unpackhi_epi32(diff, zero)));
+    }
+
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+    uint64_t sad;
+    _mm_storel_epi64((__m128i*)&sad, s);
+
+    for (; i < count; i++)
+        sad += cur[i] > prev[i] ? cur[i] - prev[i] : prev[i] - cur[i];
+    return sad;
+}
+}
+
+namespace X265_NS {
+void setupIntrinsicMotion_avx2(EncoderPrimitives &p)
+{
+    p.motionBlur = motion_blur_avx2;
+    p.motionSad = motion_sad_avx2;
+}
+}
@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+#include <wmmintrin.h> // PCLMULQDQ
+
+using namespace X265_NS;
+
+namespace {
+
+/* The picture CRC register after a message M is (crc * x^len(M) + M) mod P,
+ * P = x^16 + 0x1021, the message bits taken MSB first. Each line is folded
+ * 16 bytes at a time into a 128-bit polynomial congruent to that sum,
+ * multiplying its halves by x^128 and x^192 mod P with carry-less products,
+ * and reduced to the 16-bit register at the end of the line. The first
+ * len % 16 bytes of a line are folded with the register, so every load
+ * after them is a whole block */
+static uint64_t xPowMod(int n)
+{
+    uint64_t r = 1;
+    while (n--)
+    {
+        r <<= 1;
+        if (r & 0x10000)
+            r ^= 0x11021;
+    }
+    return r;
+}
+
+static const struct CRCFoldConstants
+{
+    uint64_t head[16];  // x^(8 * bytes) mod P
+    uint64_t k64;       // x^64 mod P
+    uint64_t k128;      // x^128 mod P
+    uint64_t k192;      // x^192 mod P
+    uint64_t mu;        // x^64 / P, the Barrett quotient
+
+    CRCFoldConstants()
+    {
+        for (int i = 0; i < 16; i++)
+            head[i] = xPowMod(8 * i);
+        k64 = xPowMod(64);
+        k128 = xPowMod(128);
+        k192 = xPowMod(192);
+
+        /* long division of x^64, the quotient has degree 48 */
+        uint64_t rem = 0;
+        mu = 0;
+        for (int i = 64; i >= 0; i--)
+        {
+            rem = (rem << 1) | (i == 64);
+            if (rem & 0x10000)
+            {
+                mu |= (uint64_t)1 << i;
+                rem ^= 0x11021;
+            }
+        }
+    }
+} s_fold;
+
+static inline __m128i loadBlock(const uint8_t* src, __m128i swap)
+{
+    /* the first byte holds the highest powers of x */
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), swap);
+}
+
+uint32_t picture_crc_avx2(const pixel* plane, intptr_t stride, int width, int height, uint32_t crc)
+{
+    const __m128i swap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i fold = _mm_set_epi64x((int64_t)s_fold.k192, (int64_t)s_fold.k128);
+    const __m128i k64 = _mm_set_epi64x(0, (int64_t)s_fold.k64);
+    const __m128i mu = _mm_set_epi64x(0, (int64_t)s_fold.mu);
+    const __m128i poly = _mm_cvtsi32_si128(0x11021);
+    const int bytes = width * (int)sizeof(pixel);
+    const int headBytes = bytes & 15;
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* line = (const uint8_t*)(plane + y * stride);
+
+        ALIGN_VAR_16(uint8_t, head[16]);
+        memset(head, 0, sizeof(head));
+        memcpy(head + 16 - headBytes, line, headBytes);
+        __m128i acc = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc), _mm_set_epi64x(0, (int64_t)s_fold.head[headBytes]), 0x00);
+        acc = _mm_xor_si128(acc, loadBlock(head, swap));
+
+        for (int i = headBytes; i < bytes; i += 16)
+        {
+            __m128i lo = _mm_clmulepi64_si128(acc, fold, 0x00);
+            __m128i hi = _mm_clmulepi64_si128(acc, fold, 0x11);
+            acc = _mm_xor_si128(_mm_xor_si128(lo, hi), loadBlock(line + i, swap));
+        }
+
+        /* fold the high half down twice, below x^64, then Barrett reduce */
+        acc = _mm_xor_si128(_mm_clmulepi64_si128(acc, k64, 0x01), _mm_move_epi64(acc));
+        acc = _mm_xor_si128(_mm_clmulepi64_si128(acc, k64, 0x01), _mm_move_epi64(acc));
+        __m128i q = _mm_srli_si128(_mm_clmulepi64_si128(_mm_srli_epi64(acc, 16), mu, 0x00), 6);
+        acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(q, poly, 0x00));
+        crc = (uint32_t)_mm_cvtsi128_si32(acc) & 0xffff;
+    }
+
+    return crc;
+}
+
+/* The checksum mask of a sample is the low byte of x ^ y ^ (x >> 8) ^ (y >> 8).
+ * Within an aligned run of 32 bytes x >> 8 is constant and the low bits of x
+ * count up, so the mask is a fixed ramp xored with one byte per run. Each
+ * byte of a 16-bit sample takes the mask of the sample */
+uint32_t picture_checksum_avx2(const pixel* plane, intptr_t stride, int width, int height, int firstLine, uint32_t checksum)
+{
+#if X265_DEPTH == 8
+    const int step = 32;
+    const __m256i ramp = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                          16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+#else
+    const int step = 16;
+    const __m256i ramp = _mm256_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                          8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15);
+#endif
+    const int vecWidth = width & ~(step - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+
+    for (int y = 0; y < height; y++)
+    {
+        const pixel* line = &plane[y * stride];
+        const uint32_t picY = firstLine + y;
+        const uint32_t yMask = (picY ^ (picY >> 8)) & 0xff;
+
+        for (int x = 0; x < vecWidth; x += step)
+        {
+            __m256i mask = _mm256_xor_si256(ramp, _mm256_set1_epi8((char)(((x ^ (x >> 8)) & 0xff) ^ yMask)));
+            __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(line + x)), mask);
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(v, zero));
+        }
+
+        for (int x = vecWidth; x < width; x++)
+        {
+            uint32_t xorMask = ((x ^ (x >> 8)) & 0xff) ^ yMask;
+            checksum += (line[x] & 0xff) ^ xorMask;
+
+            if (X265_DEPTH > 8)
+                checksum += (line[x] >> 7 >> 1) ^ xorMask;
+        }
+    }
+
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+    return checksum + (uint32_t)_mm_cvtsi128_si32(s);
+}
+}
+
+namespace X265_NS {
+/* the CRC kernel also needs PCLMULQDQ, which CPUID reports on its own */
+void setupIntrinsicPictureHash_avx2(EncoderPrimitives &p, int cpuMask)
+{
+    if (cpuMask & X265_CPU_PCLMUL)
+        p.pictureCRC = picture_crc_avx2;
+    p.pictureChecksum = picture_checksum_avx2;
+}
+}
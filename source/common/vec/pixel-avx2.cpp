@@ -0,0 +1,142 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+#include "hadamard-avx2.h"
+
+using namespace X265_NS;
+
+namespace {
+
+#if X265_DEPTH <= 10
+
+/* four samples of a row in the low half, zeros above */
+static inline __m128i loadHalfRow(const pixel* src)
+{
+#if X265_DEPTH == 8
+    int32_t row;
+    memcpy(&row, src, sizeof(row));
+    return _mm_cvtepu8_epi16(_mm_cvtsi32_si128(row));
+#else
+    return _mm_loadl_epi64((const __m128i*)src);
+#endif
+}
+
+/* The source block is broadcast to both 128-bit lanes and scored against two
+ * candidates at a time, fref0 and fref1 in one register and fref2 and fref3
+ * in the other. 4-wide columns leave the upper 4x4 block of each lane zero,
+ * so the same 8x4 transform serves all partitions */
+template<int lx, int ly>
+void satd_x4_avx2(const pixel* fenc, const pixel* fref0, const pixel* fref1, const pixel* fref2, const pixel* fref3, intptr_t frefstride, int32_t* res)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum01 = _mm256_setzero_si256();
+    __m256i sum23 = _mm256_setzero_si256();
+
+    for (int y = 0; y < ly; y += 4)
+    {
+        for (int x = 0; x < lx; x += 8)
+        {
+            __m256i d01[4], d23[4];
+            for (int i = 0; i < 4; i++)
+            {
+                const pixel* f = fenc + (y + i) * FENC_STRIDE + x;
+                intptr_t offset = (y + i) * frefstride + x;
+                __m128i fe, r0, r1, r2, r3;
+                if (lx - x >= 8)
+                {
+                    fe = loadRow(f);
+                    r0 = loadRow(fref0 + offset);
+                    r1 = loadRow(fref1 + offset);
+                    r2 = loadRow(fref2 + offset);
+                    r3 = loadRow(fref3 + offset);
+                }
+                else
+                {
+                    fe = loadHalfRow(f);
+                    r0 = loadHalfRow(fref0 + offset);
+                    r1 = loadHalfRow(fref1 + offset);
+                    r2 = loadHalfRow(fref2 + offset);
+                    r3 = loadHalfRow(fref3 + offset);
+                }
+                __m256i ff = pack2(fe, fe);
+                d01[i] = _mm256_sub_epi16(ff, pack2(r0, r1));
+                d23[i] = _mm256_sub_epi16(ff, pack2(r2, r3));
+            }
+
+            sum01 = _mm256_add_epi32(sum01, _mm256_madd_epi16(satd8x4(d01[0], d01[1], d01[2], d01[3]), ones));
+            sum23 = _mm256_add_epi32(sum23, _mm256_madd_epi16(satd8x4(d23[0], d23[1], d23[2], d23[3]), ones));
+        }
+    }
+
+    /* low lanes hold fref0 and fref2, high lanes fref1 and fref3 */
+    __m256i s = _mm256_hadd_epi32(sum01, sum23);
+    s = _mm256_hadd_epi32(s, s);
+    res[0] = _mm256_extract_epi32(s, 0);
+    res[1] = _mm256_extract_epi32(s, 4);
+    res[2] = _mm256_extract_epi32(s, 1);
+    res[3] = _mm256_extract_epi32(s, 5);
+}
+
+#endif // X265_DEPTH <= 10
+}
+
+namespace X265_NS {
+void setupIntrinsicPixel_avx2(EncoderPrimitives &p)
+{
+#if X265_DEPTH <= 10
+#define LUMA_PU(W, H) \
+    p.pu[LUMA_ ## W ## x ## H].satd_x4 = satd_x4_avx2<W, H>;
+
+    LUMA_PU(4, 4);
+    LUMA_PU(8, 8);
+    LUMA_PU(16, 16);
+    LUMA_PU(32, 32);
+    LUMA_PU(64, 64);
+    LUMA_PU(4, 8);
+    LUMA_PU(8, 4);
+    LUMA_PU(16,  8);
+    LUMA_PU(8, 16);
+    LUMA_PU(16, 12);
+    LUMA_PU(12, 16);
+    LUMA_PU(16,  4);
+    LUMA_PU(4, 16);
+    LUMA_PU(32, 16);
+    LUMA_PU(16, 32);
+    LUMA_PU(32, 24);
+    LUMA_PU(24, 32);
+    LUMA_PU(32,  8);
+    LUMA_PU(8, 32);
+    LUMA_PU(64, 32);
+    LUMA_PU(32, 64);
+    LUMA_PU(64, 48);
+    LUMA_PU(48, 64);
+    LUMA_PU(64, 16);
+    LUMA_PU(16, 64);
+
+#undef LUMA_PU
+#else
+    (void)p;
+#endif
+}
+}
@@ -0,0 +1,199 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include <immintrin.h> // AVX2
+
+using namespace X265_NS;
+
+namespace {
+
+/* Kernels for depth-bit samples, bytes for 8 and 16-bit words for 10,
+ * bit-exact with doScaling_c and yuv2PlaneX_c of the same depth */
+template<int depth>
+struct ScalerShifts
+{
+    enum
+    {
+        HFILTER_SHIFT = depth - 1,
+        VFILTER_SHIFT = 27 - depth,
+        VFILTER_ROUND = 1 << (VFILTER_SHIFT - 1),
+        VFILTER_MAX   = (1 << depth) - 1
+    };
+};
+
+/* eight taps of one output, widened to 16 bits */
+template<int depth>
+static inline __m128i loadTaps8(const uint8_t* src, int pos)
+{
+    if (depth == 8)
+        return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(src + pos)));
+    else
+        return _mm_loadu_si128((const __m128i*)((const uint16_t*)src + pos));
+}
+
+template<int depth>
+static inline __m128i loadTaps4(const uint8_t* src, int pos)
+{
+    if (depth == 8)
+        return _mm_cvtepu8_epi16(_mm_cvtsi32_si128(*(const int32_t*)(src + pos)));
+    else
+        return _mm_loadl_epi64((const __m128i*)((const uint16_t*)src + pos));
+}
+
+template<int depth>
+static inline int loadSample(const uint8_t* src, int pos)
+{
+    return depth == 8 ? (int)src[pos] : (int)((const uint16_t*)src)[pos];
+}
+
+/* partial sums of the outputs i and i + 4 in the low and high lanes */
+template<int depth>
+static inline __m256i hfilterPair(const uint8_t* src, const int16_t* filter, const int32_t* filterPos, int filterSize, int i)
+{
+    const int16_t* f0 = filter + filterSize * i;
+    const int16_t* f1 = filter + filterSize * (i + 4);
+    const int pos0 = filterPos[i];
+    const int pos1 = filterPos[i + 4];
+
+    __m256i sum = _mm256_setzero_si256();
+    int j = 0;
+    for (; j + 8 <= filterSize; j += 8)
+    {
+        __m256i s = _mm256_inserti128_si256(_mm256_castsi128_si256(loadTaps8<depth>(src, pos0 + j)), loadTaps8<depth>(src, pos1 + j), 1);
+        __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(f0 + j))),
+                                            _mm_loadu_si128((const __m128i*)(f1 + j)), 1);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(s, c));
+    }
+    if (j < filterSize)
+    {
+        __m256i s = _mm256_inserti128_si256(_mm256_castsi128_si256(loadTaps4<depth>(src, pos0 + j)), loadTaps4<depth>(src, pos1 + j), 1);
+        __m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(f0 + j))),
+                                            _mm_loadl_epi64((const __m128i*)(f1 + j)), 1);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(s, c));
+    }
+    return sum;
+}
+
+template<int depth>
+static void scalerHFilter_avx2(int16_t* dst, int dstW, const uint8_t* src, const int16_t* filter, const int32_t* filterPos, int filterSize)
+{
+    int i = 0;
+
+    /* padded filters (ScalerFilter::padCoeff) come in whole groups of four taps */
+    if (!(filterSize & 3))
+    {
+        for (; i + 8 <= dstW; i += 8)
+        {
+            __m256i s0 = hfilterPair<depth>(src, filter, filterPos, filterSize, i + 0);
+            __m256i s1 = hfilterPair<depth>(src, filter, filterPos, filterSize, i + 1);
+            __m256i s2 = hfilterPair<depth>(src, filter, filterPos, filterSize, i + 2);
+            __m256i s3 = hfilterPair<depth>(src, filter, filterPos, filterSize, i + 3);
+
+            /* lane 0 holds outputs i..i+3, lane 1 outputs i+4..i+7 */
+            __m256i sum = _mm256_hadd_epi32(_mm256_hadd_epi32(s0, s1), _mm256_hadd_epi32(s2, s3));
+            sum = _mm256_srai_epi32(sum, ScalerShifts<depth>::HFILTER_SHIFT);
+            sum = _mm256_packs_epi32(sum, sum);
+            sum = _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(sum));
+        }
+    }
+
+    for (; i < dstW; i++)
+    {
+        int val = 0;
+        const int sourcePos = filterPos[i];
+        for (int j = 0; j < filterSize; j++)
+            val += loadSample<depth>(src, sourcePos + j) * filter[filterSize * i + j];
+        dst[i] = (int16_t)x265_clip3(-(1 << 15), (1 << 15) - 1, val >> ScalerShifts<depth>::HFILTER_SHIFT);
+    }
+}
+
+template<int depth>
+static void scalerVFilter_avx2(const int16_t* filter, int filterSize, const int16_t** src, uint8_t* dest, int dstW)
+{
+    const int shift = ScalerShifts<depth>::VFILTER_SHIFT;
+    const int maxVal = ScalerShifts<depth>::VFILTER_MAX;
+    const __m256i round = _mm256_set1_epi32(ScalerShifts<depth>::VFILTER_ROUND);
+    int i = 0;
+
+    for (; i + 16 <= dstW; i += 16)
+    {
+        __m256i sumLo = round;
+        __m256i sumHi = round;
+        int j = 0;
+        for (; j + 2 <= filterSize; j += 2)
+        {
+            const __m256i c = _mm256_set1_epi32((uint16_t)filter[j] | ((uint32_t)(uint16_t)filter[j + 1] << 16));
+            const __m256i a = _mm256_loadu_si256((const __m256i*)(src[j] + i));
+            const __m256i b = _mm256_loadu_si256((const __m256i*)(src[j + 1] + i));
+            sumLo = _mm256_add_epi32(sumLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), c));
+            sumHi = _mm256_add_epi32(sumHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), c));
+        }
+        if (j < filterSize)
+        {
+            const __m256i c = _mm256_set1_epi32((uint16_t)filter[j]);
+            const __m256i a = _mm256_loadu_si256((const __m256i*)(src[j] + i));
+            const __m256i zero = _mm256_setzero_si256();
+            sumLo = _mm256_add_epi32(sumLo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, zero), c));
+            sumHi = _mm256_add_epi32(sumHi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, zero), c));
+        }
+
+        /* the in-lane unpacks are undone by the in-lane pack */
+        __m256i out = _mm256_packs_epi32(_mm256_srai_epi32(sumLo, shift), _mm256_srai_epi32(sumHi, shift));
+        if (depth == 8)
+        {
+            out = _mm256_packus_epi16(out, out);
+            out = _mm256_permute4x64_epi64(out, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i*)(dest + i), _mm256_castsi256_si128(out));
+        }
+        else
+        {
+            out = _mm256_max_epi16(_mm256_min_epi16(out, _mm256_set1_epi16(maxVal)), _mm256_setzero_si256());
+            _mm256_storeu_si256((__m256i*)((uint16_t*)dest + i), out);
+        }
+    }
+
+    for (; i < dstW; i++)
+    {
+        int val = ScalerShifts<depth>::VFILTER_ROUND;
+        for (int j = 0; j < filterSize; j++)
+            val += src[j][i] * filter[j];
+        const int d = x265_clip3(0, maxVal, val >> shift);
+        if (depth == 8)
+            dest[i] = (uint8_t)d;
+        else
+            ((uint16_t*)dest)[i] = (uint16_t)d;
+    }
+}
+
+}
+
+namespace X265_NS {
+void setupIntrinsicScaler_avx2(EncoderPrimitives &p)
+{
+    p.scalerHFilter[SCALER_8BIT] = scalerHFilter_avx2<8>;
+    p.scalerVFilter[SCALER_8BIT] = scalerVFilter_avx2<8>;
+    p.scalerHFilter[SCALER_10BIT] = scalerHFilter_avx2<10>;
+    p.scalerVFilter[SCALER_10BIT] = scalerVFilter_avx2<10>;
+}
+}
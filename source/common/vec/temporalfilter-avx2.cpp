@@ -0,0 +1,226 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2021 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "temporalfilter.h"
+#include <immintrin.h> // AVX2
+
+using namespace X265_NS;
+
+namespace {
+
+static inline __m256i load8_epi32(const pixel* src)
+{
+#if HIGH_BIT_DEPTH
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+#else
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src));
+#endif
+}
+
+static inline __m128i load4_epi32(const pixel* src)
+{
+#if HIGH_BIT_DEPTH
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)src));
+#else
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t*)src));
+#endif
+}
+
+/* Separable 6-tap interpolation of a width x height block (width a multiple
+ * of 4) into 32-bit samples clipped to the pixel range, MAX_CU_SIZE stride */
+static void interpBlock(const pixel* src, intptr_t srcStride, int32_t* dst, int width, int height, int fracX, int fracY)
+{
+    ALIGN_VAR_32(int32_t, tmp[(MAX_CU_SIZE + 5) * MAX_CU_SIZE]);
+    const int* xFilter = s_interpolationFilter[fracX];
+    const int* yFilter = s_interpolationFilter[fracY];
+
+    __m256i xc[6], yc[6];
+    for (int k = 0; k < 6; k++)
+    {
+        xc[k] = _mm256_set1_epi32(xFilter[k + 1]);
+        yc[k] = _mm256_set1_epi32(yFilter[k + 1]);
+    }
+
+    const pixel* srcRow = src - 2 * srcStride - 2;
+    for (int y = 0; y < height + 5; y++, srcRow += srcStride)
+    {
+        int32_t* t = tmp + y * MAX_CU_SIZE;
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i sum = _mm256_mullo_epi32(load8_epi32(srcRow + x), xc[0]);
+            for (int k = 1; k < 6; k++)
+                sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(load8_epi32(srcRow + x + k), xc[k]));
+            _mm256_store_si256((__m256i*)(t + x), sum);
+        }
+        if (x < width)
+        {
+            __m128i sum = _mm_mullo_epi32(load4_epi32(srcRow + x), _mm256_castsi256_si128(xc[0]));
+            for (int k = 1; k < 6; k++)
+                sum = _mm_add_epi32(sum, _mm_mullo_epi32(load4_epi32(srcRow + x + k), _mm256_castsi256_si128(xc[k])));
+            _mm_store_si128((__m128i*)(t + x), sum);
+        }
+    }
+
+    const __m256i offset = _mm256_set1_epi32(1 << 11);
+    const __m256i maxVal = _mm256_set1_epi32((1 << X265_DEPTH) - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    for (int y = 0; y < height; y++)
+    {
+        const int32_t* t = tmp + y * MAX_CU_SIZE;
+        int32_t* d = dst + y * MAX_CU_SIZE;
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i sum = _mm256_mullo_epi32(_mm256_load_si256((const __m256i*)(t + x)), yc[0]);
+            for (int k = 1; k < 6; k++)
+                sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_load_si256((const __m256i*)(t + k * MAX_CU_SIZE + x)), yc[k]));
+            sum = _mm256_srai_epi32(_mm256_add_epi32(sum, offset), 12);
+            sum = _mm256_max_epi32(_mm256_min_epi32(sum, maxVal), zero);
+            _mm256_store_si256((__m256i*)(d + x), sum);
+        }
+        if (x < width)
+        {
+            __m128i sum = _mm_mullo_epi32(_mm_load_si128((const __m128i*)(t + x)), _mm256_castsi256_si128(yc[0]));
+            for (int k = 1; k < 6; k++)
+                sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_load_si128((const __m128i*)(t + k * MAX_CU_SIZE + x)), _mm256_castsi256_si128(yc[k])));
+            sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm256_castsi256_si128(offset)), 12);
+            sum = _mm_max_epi32(_mm_min_epi32(sum, _mm256_castsi256_si128(maxVal)), _mm256_castsi256_si128(zero));
+            _mm_store_si128((__m128i*)(d + x), sum);
+        }
+    }
+}
+
+static void mcstfApplyMotion_avx2(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int fracX, int fracY)
+{
+    X265_CHECK(!(width & 3) && width <= MAX_CU_SIZE && height <= MAX_CU_SIZE, "mcstf block size not supported\n");
+    ALIGN_VAR_32(int32_t, pred[MAX_CU_SIZE * MAX_CU_SIZE]);
+    interpBlock(src, srcStride, pred, width, height, fracX, fracY);
+
+    for (int y = 0; y < height; y++, dst += dstStride)
+    {
+        const int32_t* p = pred + y * MAX_CU_SIZE;
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i v = _mm256_load_si256((const __m256i*)(p + x));
+            __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+#if HIGH_BIT_DEPTH
+            _mm_storeu_si128((__m128i*)(dst + x), w);
+#else
+            _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(w, w));
+#endif
+        }
+        if (x < width)
+        {
+            __m128i v = _mm_load_si128((const __m128i*)(p + x));
+            __m128i w = _mm_packus_epi32(v, v);
+#if HIGH_BIT_DEPTH
+            _mm_storel_epi64((__m128i*)(dst + x), w);
+#else
+            *(int32_t*)(dst + x) = _mm_cvtsi128_si32(_mm_packus_epi16(w, w));
+#endif
+        }
+    }
+}
+
+static inline int hsum_epi32(__m128i s)
+{
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+template<bool bSSD>
+static int mcstfSubpelError_avx2(const pixel* org, intptr_t orgStride, const pixel* ref, intptr_t refStride, int bs, int fracX, int fracY, int bestError)
+{
+    X265_CHECK(!(bs & 3) && bs <= MAX_CU_SIZE, "mcstf block size not supported\n");
+    ALIGN_VAR_32(int32_t, pred[MAX_CU_SIZE * MAX_CU_SIZE]);
+    interpBlock(ref, refStride, pred, bs, bs, fracX, fracY);
+
+    int error = 0;
+    for (int y = 0; y < bs; y++, org += orgStride)
+    {
+        const int32_t* p = pred + y * MAX_CU_SIZE;
+        __m256i acc = _mm256_setzero_si256();
+        int x = 0;
+        for (; x + 8 <= bs; x += 8)
+        {
+            __m256i d = _mm256_sub_epi32(_mm256_load_si256((const __m256i*)(p + x)), load8_epi32(org + x));
+            acc = _mm256_add_epi32(acc, bSSD ? _mm256_mullo_epi32(d, d) : _mm256_abs_epi32(d));
+        }
+        __m128i acc4 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        if (x < bs)
+        {
+            __m128i d = _mm_sub_epi32(_mm_load_si128((const __m128i*)(p + x)), load4_epi32(org + x));
+            acc4 = _mm_add_epi32(acc4, bSSD ? _mm_mullo_epi32(d, d) : _mm_abs_epi32(d));
+        }
+        error += hsum_epi32(acc4);
+        if (error > bestError)
+            return error;
+    }
+    return error;
+}
+
+static void mcstfWeightAcc_avx2(const pixel* org, intptr_t orgStride, const pixel* ref, intptr_t refStride, int width, int height,
+                                const double* expTable, double scale, double* sumVal, double* sumWeight, intptr_t sumStride)
+{
+    const __m256d vscale = _mm256_set1_pd(scale);
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for (int y = 0; y < height; y++)
+    {
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i r = load4_epi32(ref + x);
+            __m128i d = _mm_abs_epi32(_mm_sub_epi32(r, load4_epi32(org + x)));
+            __m256d w = _mm256_mul_pd(vscale, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), expTable, d, mask, 8));
+            __m256d v = _mm256_mul_pd(w, _mm256_cvtepi32_pd(r));
+            _mm256_storeu_pd(sumVal + x, _mm256_add_pd(_mm256_loadu_pd(sumVal + x), v));
+            _mm256_storeu_pd(sumWeight + x, _mm256_add_pd(_mm256_loadu_pd(sumWeight + x), w));
+        }
+        for (; x < width; x++)
+        {
+            const int refVal = ref[x];
+            const double weight = scale * expTable[abs(refVal - org[x])];
+            sumVal[x] += weight * refVal;
+            sumWeight[x] += weight;
+        }
+        org += orgStride;
+        ref += refStride;
+        sumVal += sumStride;
+        sumWeight += sumStride;
+    }
+}
+
+}
+
+namespace X265_NS {
+void setupIntrinsicMCSTF_avx2(EncoderPrimitives &p)
+{
+    p.mcstfSubpelSAD = mcstfSubpelError_avx2<false>;
+    p.mcstfSubpelSSD = mcstfSubpelError_avx2<true>;
+    p.mcstfApplyMotion = mcstfApplyMotion_avx2;
+    p.mcstfWeightAcc = mcstfWeightAcc_avx2;
+}
+}
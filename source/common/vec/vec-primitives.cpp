@@ -57,6 +57,12 @@ namespace X265_NS {
 void setupIntrinsicDCT_sse3(EncoderPrimitives&);
 void setupIntrinsicDCT_ssse3(EncoderPrimitives&);
 void setupIntrinsicDCT_sse41(EncoderPrimitives&);
+void setupIntrinsicMCSTF_avx2(EncoderPrimitives&);
+void setupIntrinsicScaler_avx2(EncoderPrimitives&);
+void setupIntrinsicIntra_avx2(EncoderPrimitives&);
+void setupIntrinsicPixel_avx2(EncoderPrimitives&);
+void setupIntrinsicPictureHash_avx2(EncoderPrimitives&, int cpuMask);
+void setupIntrinsicMotion_avx2(EncoderPrimitives&);
 
 /* Use primitives for the best available vector architecture */
 void setupInstrinsicPrimitives(EncoderPrimitives &p, int cpuMask)
@@ -78,6 +84,17 @@ void setupInstrinsicPrimitives(EncoderPrimitives &p, int cpuMask)
     {
         setupIntrinsicDCT_sse41(p);
     }
+#endif
+#ifdef HAVE_AVX2
+    if (cpuMask & X265_CPU_AVX2)
+    {
+        setupIntrinsicMCSTF_avx2(p);
+        setupIntrinsicScaler_avx2(p);
+        setupIntrinsicIntra_avx2(p);
+        setupIntrinsicPixel_avx2(p);
+        setupIntrinsicPictureHash_avx2(p, cpuMask);
+        setupIntrinsicMotion_avx2(p);
+    }
 #endif
     (void)p;
     (void)cpuMask;
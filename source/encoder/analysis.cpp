@@ -80,6 +80,13 @@ Analysis::Analysis()
     m_checkMergeAndSkipOnly[0] = false;
     m_checkMergeAndSkipOnly[1] = false;
     m_evaluateInter = 0;
+    m_mdModel = NULL;
+    m_analysisCacheLookup = ANALYSIS_CACHE_MISS;
+    m_cachedCTU = NULL;
+    m_cacheEntry = NULL;
+    m_cachedCUs = NULL;
+    m_cacheEntryCUs = NULL;
+    m_bCachedQpRaised = false;
 }
 
 bool Analysis::create(ThreadLocalData *tld)
@@ -148,6 +155,7 @@ Mode& Analysis::compressCTU(CUData& ctu, Frame& frame, const CUGeom& cuGeom, con
 
     int qp = setLambdaFromQP(ctu, m_slice->m_pps->bUseDQP ? calculateQpforCuSize(ctu, cuGeom) : m_slice->m_sliceQp);
     ctu.setQPSubParts((int8_t)qp, 0, 0);
+    setCTUSearch(ctu);
 
     m_rqt[0].cur.load(initialContext);
     ctu.m_meanQP = initialContext.m_meanQP;
@@ -156,6 +164,11 @@ Mode& Analysis::compressCTU(CUData& ctu, Frame& frame, const CUGeom& cuGeom, con
     if (m_param->bSsimRd)
         calculateNormFactor(ctu, qp);
 
+    m_cachedCTU = m_cacheEntry = NULL;
+    m_cachedCUs = m_cacheEntryCUs = NULL;
+    if (m_param->analysisCache)
+        lookupAnalysisCache(ctu, qp);
+
     uint32_t numPartition = ctu.m_numPartitions;
     if (m_param->bCTUInfo && (*m_frame->m_ctuInfo + ctu.m_cuAddr))
     {
@@ -313,9 +326,57 @@ Mode& Analysis::compressCTU(CUData& ctu, Frame& frame, const CUGeom& cuGeom, con
     if (m_param->csvLogLevel >= 2)
         collectPUStatistics(ctu, cuGeom);
 
+    if (m_cacheEntry)
+    {
+        static_cast<AnalysisCache*>(m_param->analysisCache)->pack(m_cacheEntryCUs, ctu);
+        m_cacheEntry->qp = (int8_t)qp;
+        m_cacheEntry->sliceType = (uint8_t)m_slice->m_sliceType;
+        m_cacheEntry->bValid = true;
+    }
+
     return *m_modeDepth[0].bestMode;
 }
 
+void Analysis::lookupAnalysisCache(const CUData& ctu, int qp)
+{
+    /* pictures past the frame window are neither reused nor cached */
+    if (m_param->analysisCacheFrames && m_slice->m_poc >= m_param->analysisCacheFrames)
+    {
+        m_analysisCacheLookup = ANALYSIS_CACHE_UNCACHED;
+        return;
+    }
+
+    AnalysisCache* cache = static_cast<AnalysisCache*>(m_param->analysisCache);
+    uint8_t* frameCUs;
+    AnalysisCache::CTUDecisions* frameCTUs = cache->getFrame(m_slice->m_poc, frameCUs);
+    m_analysisCacheLookup = ANALYSIS_CACHE_MISS;
+    if (!frameCTUs)
+        return;
+
+    AnalysisCache::CTUDecisions& entry = frameCTUs[ctu.m_cuAddr];
+    uint8_t* ctuCUs = cache->getCTUCUs(frameCUs, ctu.m_cuAddr);
+    if (!entry.bValid)
+    {
+        m_cacheEntry = &entry;
+        m_cacheEntryCUs = ctuCUs;
+    }
+    else if (entry.sliceType != m_slice->m_sliceType || abs(qp - entry.qp) > m_param->analysisCacheQpDelta)
+    {
+        /* decisions made at a distant QP are not trusted; the full analysis
+         * of this encode replaces them */
+        m_analysisCacheLookup = ANALYSIS_CACHE_STALE;
+        m_cacheEntry = &entry;
+        m_cacheEntryCUs = ctuCUs;
+    }
+    else
+    {
+        m_analysisCacheLookup = ANALYSIS_CACHE_HIT;
+        m_cachedCTU = &entry;
+        m_cachedCUs = ctuCUs;
+        m_bCachedQpRaised = qp >= entry.qp;
+    }
+}
+
 void Analysis::collectPUStatistics(const CUData& ctu, const CUGeom& cuGeom)
 {
     uint8_t depth = 0;
@@ -520,6 +581,13 @@ uint64_t Analysis::compressIntraCU(const CUData& parentCTU, const CUGeom& cuGeom
     bool mightSplit = !(cuGeom.flags & CUGeom::LEAF);
     bool mightNotSplit = !(cuGeom.flags & CUGeom::SPLIT_MANDATORY);
 
+    if (m_cachedCTU)
+    {
+        uint32_t cachedDepth = cachedCU(cuGeom.absPartIdx) & AnalysisCache::CU_DEPTH_MASK;
+        mightSplit &= cachedDepth > depth;
+        mightNotSplit &= cachedDepth == depth;
+    }
+
     bool bAlreadyDecided = m_param->intraRefine != 4 && parentCTU.m_lumaIntraDir[cuGeom.absPartIdx] != (uint8_t)ALL_IDX && !(m_param->bAnalysisType == HEVC_INFO);
     bool bDecidedDepth = m_param->intraRefine != 4 && parentCTU.m_cuDepth[cuGeom.absPartIdx] == depth;
     int split = 0;
@@ -704,6 +772,8 @@ void Analysis::processPmode(PMODE& pmode, Analysis& slave)
         slave.m_slice = m_slice;
         slave.m_frame = m_frame;
         slave.m_param = m_param;
+        slave.m_searchMethod = m_searchMethod;
+        slave.m_searchRange = m_searchRange;
         slave.m_bChromaSa8d = m_param->rdLevel >= 3;
         slave.setLambdaFromQP(md.pred[PRED_2Nx2N].cu, m_rdCost.m_qp);
         slave.invalidateContexts(0);
@@ -856,6 +926,13 @@ void Analysis::processPmode(PMODE& pmode, Analysis& slave)
         pmode.m_lock.release();
     }
     while (task >= 0);
+
+    /* the master collects its own counters with the CTU */
+    if (&slave != this && m_param->bMEConfidence)
+    {
+        ScopedLock _lock(pmode.m_lock);
+        slave.moveLowresMVStats(pmode.lowresMVSearches, pmode.lowresMVHits);
+    }
 }
 
 uint32_t Analysis::compressInterCU_dist(const CUData& parentCTU, const CUGeom& cuGeom, int32_t qp)
@@ -990,6 +1067,8 @@ uint32_t Analysis::compressInterCU_dist(const CUData& parentCTU, const CUGeom& c
                 ProfileCUScope(parentCTU, pmodeBlockTime, countPModeMasters);
                 pmode.waitForExit();
             }
+            if (m_param->bMEConfidence)
+                addLowresMVStats(pmode.lowresMVSearches, pmode.lowresMVHits);
 
             /* select best inter mode based on sa8d cost */
             Mode *bestInter = &md.pred[PRED_2Nx2N];
@@ -1072,6 +1151,8 @@ uint32_t Analysis::compressInterCU_dist(const CUData& parentCTU, const CUGeom& c
                 ProfileCUScope(parentCTU, pmodeBlockTime, countPModeMasters);
                 pmode.waitForExit();
             }
+            if (m_param->bMEConfidence)
+                addLowresMVStats(pmode.lowresMVSearches, pmode.lowresMVHits);
 
             checkBestMode(md.pred[PRED_2Nx2N], depth);
             if (m_slice->m_sliceType == B_SLICE && md.pred[PRED_BIDIR].sa8dCost < MAX_INT64)
@@ -1198,6 +1279,15 @@ SplitData Analysis::compressInterCU_rd0_4(const CUData& parentCTU, const CUGeom&
             minDepth = depth;
         }
 
+        /* keep the partitioning of the cached decisions */
+        if (m_cachedCTU)
+        {
+            uint32_t cachedDepth = cachedCU(cuGeom.absPartIdx) & AnalysisCache::CU_DEPTH_MASK;
+            mightSplit &= cachedDepth > depth;
+            mightNotSplit &= cachedDepth == depth;
+            minDepth = depth;
+        }
+
         if ((m_limitTU & X265_TU_LIMIT_NEIGH) && cuGeom.log2CUSize >= 4)
             m_maxTUDepth = loadTUDepth(cuGeom, parentCTU);
 
@@ -1335,6 +1425,26 @@ SplitData Analysis::compressInterCU_rd0_4(const CUData& parentCTU, const CUGeom&
         }
         if (m_param->bAnalysisType == AVC_INFO && md.bestMode && cuGeom.numPartitions <= 16 && m_param->analysisLoadReuseLevel == 7)
             skipRecursion = true;
+        /* a QP no lower than the cached one only makes skip and 2Nx2N more
+         * likely, so those cached choices end the mode search early */
+        if (m_cachedCTU && m_bCachedQpRaised && mightNotSplit && md.bestMode)
+        {
+            uint8_t cu = cachedCU(cuGeom.absPartIdx);
+            skipModes |= !!(cu & AnalysisCache::CU_SKIP);
+            skipRectAmp |= !!(cu & AnalysisCache::CU_INTER_2Nx2N);
+        }
+        /* early-termination model, scored on the merge/skip result */
+        double mdFeatures[ModeDecisionModel::MDF_FEATURES];
+        bool bMDFeatures = m_mdModel && mightNotSplit && md.bestMode;
+        if (bMDFeatures)
+        {
+            getModeDecisionFeatures(parentCTU, cuGeom, qp, md.bestMode->sa8dCost, md.bestMode->cu.isSkipped(0), mdFeatures);
+            if (m_mdModel->hasModel())
+            {
+                skipRecursion |= mightSplit && m_mdModel->skip(ModeDecisionModel::MD_SPLIT, depth, mdFeatures);
+                skipRectAmp |= m_mdModel->skip(ModeDecisionModel::MD_RECT, depth, mdFeatures);
+            }
+        }
         /* Step 2. Evaluate each of the 4 split sub-blocks in series */
         if (mightSplit && !skipRecursion)
         {
@@ -1755,6 +1865,9 @@ SplitData Analysis::compressInterCU_rd0_4(const CUData& parentCTU, const CUGeom&
             checkDQPForSplitPred(*md.bestMode, cuGeom);
         }
 
+        if (bMDFeatures && m_mdModel->hasStats() && !skipModes && !skipRectAmp && !(mightSplit && skipRecursion))
+            writeModeDecisionStats(cuGeom, mightSplit, mdFeatures);
+
         /* determine which motion references the parent CU should search */
         splitCUData.initSplitCUData();
 
@@ -1896,6 +2009,14 @@ SplitData Analysis::compressInterCU_rd5_6(const CUData& parentCTU, const CUGeom&
             mightSplit &= false;
         }
 
+        /* keep the partitioning of the cached decisions */
+        if (m_cachedCTU)
+        {
+            uint32_t cachedDepth = cachedCU(cuGeom.absPartIdx) & AnalysisCache::CU_DEPTH_MASK;
+            mightSplit &= cachedDepth > depth;
+            mightNotSplit &= cachedDepth == depth;
+        }
+
         // avoid uninitialize value in below reference
         if (m_param->limitModes)
         {
@@ -2030,6 +2151,26 @@ SplitData Analysis::compressInterCU_rd5_6(const CUData& parentCTU, const CUGeom&
         }
         if (m_param->bAnalysisType == AVC_INFO && md.bestMode && cuGeom.numPartitions <= 16 && m_param->analysisLoadReuseLevel == 7)
             skipRecursion = true;
+        /* a QP no lower than the cached one only makes skip and 2Nx2N more
+         * likely, so those cached choices end the mode search early */
+        if (m_cachedCTU && m_bCachedQpRaised && mightNotSplit && md.bestMode)
+        {
+            uint8_t cu = cachedCU(cuGeom.absPartIdx);
+            skipModes |= !!(cu & AnalysisCache::CU_SKIP);
+            skipRectAmp |= !!(cu & AnalysisCache::CU_INTER_2Nx2N);
+        }
+        /* early-termination model, scored on the merge/skip and 2Nx2N results */
+        double mdFeatures[ModeDecisionModel::MDF_FEATURES];
+        bool bMDFeatures = m_mdModel && mightNotSplit && md.bestMode;
+        if (bMDFeatures)
+        {
+            getModeDecisionFeatures(parentCTU, cuGeom, qp, md.bestMode->rdCost, md.bestMode->cu.isSkipped(0), mdFeatures);
+            if (m_mdModel->hasModel())
+            {
+                skipRecursion |= mightSplit && m_mdModel->skip(ModeDecisionModel::MD_SPLIT, depth, mdFeatures);
+                skipRectAmp |= m_mdModel->skip(ModeDecisionModel::MD_RECT, depth, mdFeatures);
+            }
+        }
         // estimate split cost
         /* Step 2. Evaluate each of the 4 split sub-blocks in series */
         if (mightSplit && !skipRecursion)
@@ -2342,6 +2483,9 @@ SplitData Analysis::compressInterCU_rd5_6(const CUData& parentCTU, const CUGeom&
         if (mightSplit && !skipRecursion)
             checkBestMode(md.pred[PRED_SPLIT], depth);
 
+        if (bMDFeatures && m_mdModel->hasStats() && !skipModes && !skipRectAmp && !(mightSplit && skipRecursion))
+            writeModeDecisionStats(cuGeom, mightSplit, mdFeatures);
+
         if (m_param->bEnableRdRefine && depth <= m_slice->m_pps->maxCuDQPDepth)
         {
             int cuIdx = (cuGeom.childOffset - 1) / 3;
@@ -2490,7 +2634,7 @@ void Analysis::recodeCU(const CUData& parentCTU, const CUGeom& cuGeom, int32_t q
                     if (!mode.cu.m_mergeFlag[pu.puAbsPartIdx])
                     {
                         if (m_param->interRefine == 1)
-                            m_me.setSourcePU(*mode.fencYuv, pu.ctuAddr, pu.cuAbsPartIdx, pu.puAbsPartIdx, pu.width, pu.height, m_param->searchMethod, m_param->subpelRefine, false);
+                            m_me.setSourcePU(*mode.fencYuv, pu.ctuAddr, pu.cuAbsPartIdx, pu.puAbsPartIdx, pu.width, pu.height, m_searchMethod, m_param->subpelRefine, false);
                         //AMVP
                         MV mvc[(MD_ABOVE_LEFT + 1) * 2 + 2];
                         mode.cu.getNeighbourMV(part, pu.puAbsPartIdx, mode.interNeighbours);
@@ -3603,6 +3747,78 @@ uint32_t Analysis::calculateCUVariance(const CUData& ctu, const CUGeom& cuGeom)
     return cuVariance / cnt;
 }
 
+/* CU features of the early-termination model, see ModeDecisionModel::Feature */
+void Analysis::getModeDecisionFeatures(const CUData& parentCTU, const CUGeom& cuGeom, int32_t qp, uint64_t bestCost, bool bSkip, double* features)
+{
+    uint32_t depth = cuGeom.depth;
+    double numPixels = (double)(1 << (cuGeom.log2CUSize * 2));
+
+    const Yuv& fencYuv = m_modeDepth[depth].fencYuv;
+    uint64_t sumSsd = primitives.cu[cuGeom.log2CUSize - 2].var(fencYuv.m_buf[0], fencYuv.m_size);
+    double sum = (double)(uint32_t)sumSsd;
+    double variance = ((double)(uint32_t)(sumSsd >> 32) - sum * sum / numPixels) / numPixels;
+    features[ModeDecisionModel::MDF_VARIANCE] = log2(1.0 + X265_MAX(variance, 0.0));
+
+    /* depths the neighbouring and colocated CTUs chose over the same area */
+    const CUData* neighbours[3] = { parentCTU.m_cuLeft, parentCTU.m_cuAbove, NULL };
+    if (m_slice->m_numRefIdx[0])
+        neighbours[2] = m_slice->m_refFrameList[0][0]->m_encData->getPicCTU(parentCTU.m_cuAddr);
+    uint32_t depthSum = 0, depthCount = 0;
+    for (int n = 0; n < 3; n++)
+    {
+        if (!neighbours[n])
+            continue;
+        for (uint32_t i = 0; i < cuGeom.numPartitions; i += 4)
+        {
+            depthSum += neighbours[n]->m_cuDepth[cuGeom.absPartIdx + i];
+            depthCount++;
+        }
+    }
+    features[ModeDecisionModel::MDF_NEIGHBOUR] = depthCount ? (double)depthSum / depthCount - depth : 0.0;
+
+    double lowresCost = 0.0;
+    if (!m_param->bDisableLookahead)
+    {
+        const Lowres& lowres = m_frame->m_lowres;
+        int diffPoc = abs(m_slice->m_poc - m_slice->m_refPOCList[0][0]);
+        const int32_t* interCosts = NULL;
+        if (diffPoc <= m_param->bframes + 1 && lowres.lowresMvs[0][diffPoc][0].x != 0x7FFF)
+            interCosts = lowres.lowresMvCosts[0][diffPoc];
+
+        uint32_t blockX = (parentCTU.m_cuPelX + g_zscanToPelX[cuGeom.absPartIdx]) >> 4;
+        uint32_t blockY = (parentCTU.m_cuPelY + g_zscanToPelY[cuGeom.absPartIdx]) >> 4;
+        uint32_t blocks = X265_MAX(1u, (1u << cuGeom.log2CUSize) >> 4);
+        uint32_t count = 0;
+        for (uint32_t y = blockY; y < blockY + blocks && y < lowres.maxBlocksInCol; y++)
+        {
+            for (uint32_t x = blockX; x < blockX + blocks && x < lowres.maxBlocksInRow; x++)
+            {
+                uint32_t idx = y * lowres.maxBlocksInRow + x;
+                int32_t cost = lowres.intraCost[idx];
+                if (interCosts)
+                    cost = X265_MIN(cost, interCosts[idx]);
+                lowresCost += cost;
+                count++;
+            }
+        }
+        if (count)
+            lowresCost /= count;
+    }
+    features[ModeDecisionModel::MDF_LOWRES_COST] = log2(1.0 + lowresCost);
+
+    features[ModeDecisionModel::MDF_QP] = qp;
+    features[ModeDecisionModel::MDF_BEST_COST] = log2(1.0 + bestCost / numPixels);
+    features[ModeDecisionModel::MDF_SKIP] = bSkip;
+}
+
+void Analysis::writeModeDecisionStats(const CUGeom& cuGeom, bool bCanSplit, const double* features)
+{
+    const Mode& bestMode = *m_modeDepth[cuGeom.depth].bestMode;
+    bool bSplit = &bestMode == &m_modeDepth[cuGeom.depth].pred[PRED_SPLIT];
+    bool bRect = !bSplit && bestMode.cu.isInter(0) && bestMode.cu.m_partSize[0] != SIZE_2Nx2N;
+    m_mdModel->writeStats(m_slice->m_poc, m_slice->m_sliceType, cuGeom.depth, bCanSplit, features, bSplit, bRect);
+}
+
 double Analysis::aqQPOffset(const CUData& ctu, const CUGeom& cuGeom)
 {
     uint32_t aqDepth = X265_MIN(cuGeom.depth, m_frame->m_lowres.maxAQDepth - 1);
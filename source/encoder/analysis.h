@@ -35,6 +35,8 @@
 
 #include "entropy.h"
 #include "search.h"
+#include "modedecision.h"
+#include "analysiscache.h"
 
 namespace X265_NS {
 // private namespace
@@ -94,7 +96,15 @@ public:
         const CUGeom& cuGeom;
         int           modes[MAX_PRED_TYPES];
 
-        PMODE(Analysis& m, const CUGeom& g) : master(m), cuGeom(g) {}
+        /* --me-confidence counters of the slaves, moved to the master after
+         * waitForExit() */
+        uint32_t      lowresMVSearches[LOWRES_MV_CONFIDENCES];
+        uint32_t      lowresMVHits;
+
+        PMODE(Analysis& m, const CUGeom& g) : master(m), cuGeom(g), lowresMVHits(0)
+        {
+            memset(lowresMVSearches, 0, sizeof(lowresMVSearches));
+        }
 
         void processTasks(int workerThreadId);
 
@@ -113,6 +123,13 @@ public:
     bool      m_modeFlag[2];
     bool      m_checkMergeAndSkipOnly[2];
 
+    /* early-termination model and training data output, NULL unless
+     * --md-model or --md-stats */
+    ModeDecisionModel* m_mdModel;
+
+    /* outcome of the last CTU's analysis cache lookup, ANALYSIS_CACHE_* */
+    int       m_analysisCacheLookup;
+
     Analysis();
 
     bool create(ThreadLocalData* tld);
@@ -140,6 +157,13 @@ protected:
     uint8_t*                m_additionalCtuInfo;
     int*                    m_prevCtuInfoChange;
 
+    /* decisions an earlier encode made for this CTU, NULL unless reused */
+    AnalysisCache::CTUDecisions* m_cachedCTU;
+    AnalysisCache::CTUDecisions* m_cacheEntry; // entry to fill after a full analysis
+    uint8_t*                m_cachedCUs;      // packed CU decisions of m_cachedCTU
+    uint8_t*                m_cacheEntryCUs;  // packed CU decisions of m_cacheEntry
+    bool                    m_bCachedQpRaised;  // CTU QP not below the cached QP
+
     struct TrainingData
     {
         uint32_t cuVariance;
@@ -197,6 +221,10 @@ protected:
 
     int calculateQpforCuSize(const CUData& ctu, const CUGeom& cuGeom, int32_t complexCheck = 0, double baseQP = -1);
     uint32_t calculateCUVariance(const CUData& ctu, const CUGeom& cuGeom);
+    void getModeDecisionFeatures(const CUData& parentCTU, const CUGeom& cuGeom, int32_t qp, uint64_t bestCost, bool bSkip, double* features);
+    void writeModeDecisionStats(const CUGeom& cuGeom, bool bCanSplit, const double* features);
+    void lookupAnalysisCache(const CUData& ctu, int qp);
+    uint8_t cachedCU(uint32_t absPartIdx) const { return static_cast<AnalysisCache*>(m_param->analysisCache)->getCU(m_cachedCUs, absPartIdx); }
 
     void classifyCU(const CUData& ctu, const CUGeom& cuGeom, const Mode& bestMode, TrainingData& trainData);
     void trainCU(const CUData& ctu, const CUGeom& cuGeom, const Mode& bestMode, TrainingData& trainData);
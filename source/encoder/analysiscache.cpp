@@ -0,0 +1,133 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "analysiscache.h"
+
+using namespace X265_NS;
+
+AnalysisCache::AnalysisCache()
+{
+    m_frames = NULL;
+    m_frameCUs = NULL;
+    m_numFrames = 0;
+    m_numCUsInFrame = 0;
+    m_minCUsPerCTU = m_bytesPerCTU = m_partShift = 0;
+    m_width = m_height = 0;
+    m_maxCUSize = m_minCUSize = 0;
+}
+
+void AnalysisCache::destroy()
+{
+    for (int i = 0; i < m_numFrames; i++)
+    {
+        X265_FREE(m_frames[i]);
+        X265_FREE(m_frameCUs[i]);
+    }
+    X265_FREE(m_frames);
+    X265_FREE(m_frameCUs);
+    m_frames = NULL;
+    m_frameCUs = NULL;
+    m_numFrames = 0;
+    m_numCUsInFrame = 0;
+}
+
+bool AnalysisCache::bind(const x265_param* param)
+{
+    ScopedLock _lock(m_lock);
+
+    if (m_numCUsInFrame)
+        return m_width == param->sourceWidth && m_height == param->sourceHeight &&
+               m_maxCUSize == param->maxCUSize && m_minCUSize == param->minCUSize;
+
+    m_width = param->sourceWidth;
+    m_height = param->sourceHeight;
+    m_maxCUSize = param->maxCUSize;
+    m_minCUSize = param->minCUSize;
+    m_numCUsInFrame = ((m_width + m_maxCUSize - 1) / m_maxCUSize) * ((m_height + m_maxCUSize - 1) / m_maxCUSize);
+    m_minCUsPerCTU = (m_maxCUSize / m_minCUSize) * (m_maxCUSize / m_minCUSize);
+    m_bytesPerCTU = (m_minCUsPerCTU + 1) >> 1;
+    m_partShift = (g_log2Size[m_minCUSize] - LOG2_UNIT_SIZE) * 2;
+    return true;
+}
+
+AnalysisCache::CTUDecisions* AnalysisCache::getFrame(int poc, uint8_t*& frameCUs)
+{
+    ScopedLock _lock(m_lock);
+
+    if (poc >= m_numFrames)
+    {
+        int numFrames = X265_MAX(X265_MAX(m_numFrames * 2, 64), poc + 1);
+        CTUDecisions** frames = X265_MALLOC(CTUDecisions*, numFrames);
+        uint8_t** cus = X265_MALLOC(uint8_t*, numFrames);
+        if (!frames || !cus)
+        {
+            X265_FREE(frames);
+            X265_FREE(cus);
+            return NULL;
+        }
+        memset(frames, 0, sizeof(CTUDecisions*) * numFrames);
+        memset(cus, 0, sizeof(uint8_t*) * numFrames);
+        if (m_frames)
+        {
+            memcpy(frames, m_frames, sizeof(CTUDecisions*) * m_numFrames);
+            memcpy(cus, m_frameCUs, sizeof(uint8_t*) * m_numFrames);
+        }
+        X265_FREE(m_frames);
+        X265_FREE(m_frameCUs);
+        m_frames = frames;
+        m_frameCUs = cus;
+        m_numFrames = numFrames;
+    }
+
+    if (!m_frames[poc])
+    {
+        CTUDecisions* ctus = X265_MALLOC(CTUDecisions, m_numCUsInFrame);
+        uint8_t* ctuCUs = X265_MALLOC(uint8_t, m_numCUsInFrame * m_bytesPerCTU);
+        if (!ctus || !ctuCUs)
+        {
+            X265_FREE(ctus);
+            X265_FREE(ctuCUs);
+            return NULL;
+        }
+        memset(ctus, 0, sizeof(CTUDecisions) * m_numCUsInFrame);
+        m_frames[poc] = ctus;
+        m_frameCUs[poc] = ctuCUs;
+    }
+    frameCUs = m_frameCUs[poc];
+    return m_frames[poc];
+}
+
+void AnalysisCache::pack(uint8_t* ctuCUs, const CUData& ctu) const
+{
+    memset(ctuCUs, 0, m_bytesPerCTU);
+    for (uint32_t i = 0; i < m_minCUsPerCTU; i++)
+    {
+        uint32_t absPartIdx = i << m_partShift;
+        uint8_t predMode = ctu.m_predMode[absPartIdx];
+        uint8_t cu = ctu.m_cuDepth[absPartIdx] & CU_DEPTH_MASK;
+        if (predMode == MODE_SKIP)
+            cu |= CU_SKIP;
+        if (ctu.m_partSize[absPartIdx] == SIZE_2Nx2N && predMode != MODE_INTRA)
+            cu |= CU_INTER_2Nx2N;
+        ctuCUs[i >> 1] |= cu << ((i & 1) << 2);
+    }
+}
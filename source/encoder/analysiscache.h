@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ANALYSISCACHE_H
+#define X265_ANALYSISCACHE_H
+
+#include "common.h"
+#include "threading.h"
+#include "cudata.h"
+
+struct x265_analysis_cache {};
+
+namespace X265_NS {
+// private x265 namespace
+
+/* In-memory cache of CTU mode decisions keyed by (POC, CTU address), shared
+ * through x265_param.analysisCache by sequential encodes of the same content
+ * in one process, such as CRF probes. An encode that finds a valid entry for
+ * a CTU, decided at a QP close enough to its own, restricts its analysis to
+ * the cached partitioning; otherwise it analyses the CTU fully and replaces
+ * the entry. Decisions are packed as one nibble per minimum size CU, so a
+ * frame costs numCUsInFrame * (3 + (maxCUSize / minCUSize)^2 / 2) bytes. Only
+ * the pictures below the encoder's analysisCacheFrames are cached; frames are
+ * allocated on first use and kept until the cache is freed. Encoders sharing
+ * a cache must not run concurrently. */
+class AnalysisCache : public x265_analysis_cache
+{
+public:
+
+    struct CTUDecisions
+    {
+        int8_t  qp;        // CTU QP the decisions were made at
+        uint8_t sliceType;
+        uint8_t bValid;
+    };
+
+    /* flags of a minimum size CU beside its depth in the low two bits */
+    enum { CU_DEPTH_MASK = 3, CU_SKIP = 4, CU_INTER_2Nx2N = 8 };
+
+    AnalysisCache();
+    ~AnalysisCache() { destroy(); }
+
+    /* attach an encoder; returns false if the cache was filled by an encode
+     * with a different picture or CTU geometry */
+    bool bind(const x265_param* param);
+
+    /* the CTU headers of a picture and its packed CU decisions, allocated on
+     * first use. Returns NULL on allocation failure */
+    CTUDecisions* getFrame(int poc, uint8_t*& frameCUs);
+
+    /* packed CU decisions of one CTU within its frame */
+    uint8_t* getCTUCUs(uint8_t* frameCUs, uint32_t cuAddr) const { return frameCUs + cuAddr * m_bytesPerCTU; }
+
+    /* decisions of the minimum size CU at absPartIdx */
+    uint8_t getCU(const uint8_t* ctuCUs, uint32_t absPartIdx) const
+    {
+        uint32_t idx = absPartIdx >> m_partShift;
+        return (ctuCUs[idx >> 1] >> ((idx & 1) << 2)) & 15;
+    }
+
+    /* pack the decisions of an analysed CTU */
+    void pack(uint8_t* ctuCUs, const CUData& ctu) const;
+
+    void destroy();
+
+protected:
+
+    CTUDecisions** m_frames;
+    uint8_t**      m_frameCUs;
+    int            m_numFrames;
+    uint32_t       m_numCUsInFrame;
+    uint32_t       m_minCUsPerCTU;
+    uint32_t       m_bytesPerCTU;
+    uint32_t       m_partShift;   // log2 of the 4x4 partitions in a minimum size CU
+    int            m_width;
+    int            m_height;
+    uint32_t       m_maxCUSize;
+    uint32_t       m_minCUSize;
+    Lock           m_lock;
+};
+}
+
+#endif // ifndef X265_ANALYSISCACHE_H
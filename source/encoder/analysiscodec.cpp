@@ -0,0 +1,255 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "analysiscodec.h"
+
+/* Body layout, repeated for each appended array:
+ *   kind (1 byte), raw length (varint), coded array
+ * SEG_BYTES arrays are a sequence of varint tokens (len << 1 | isRun), a run
+ * followed by its single value, a literal by its len bytes.
+ * SEG_MV arrays hold the zigzag varint delta of each component from the
+ * previous MV of the array. */
+
+using namespace X265_NS;
+
+namespace {
+const uint32_t MIN_RUN = 3;
+
+inline uint32_t zigzag(int32_t v)   { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+bool getVarint(const uint8_t*& src, const uint8_t* end, uint32_t& val)
+{
+    val = 0;
+    for (int shift = 0; shift < 35 && src < end; shift += 7)
+    {
+        uint8_t b = *src++;
+        val |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+}
+
+AnalysisCodec::AnalysisCodec()
+{
+    m_packed = NULL;
+    m_packedSize = m_packedAlloc = 0;
+    m_raw = NULL;
+    m_rawSize = m_rawPos = m_rawAlloc = 0;
+    m_bPacking = false;
+    m_bUnpacked = false;
+}
+
+AnalysisCodec::~AnalysisCodec()
+{
+    X265_FREE(m_packed);
+    X265_FREE(m_raw);
+}
+
+bool AnalysisCodec::reserve(uint32_t bytes)
+{
+    if (m_packedSize + bytes <= m_packedAlloc)
+        return true;
+
+    uint32_t newAlloc = X265_MAX(m_packedAlloc * 2, m_packedSize + bytes + (64 << 10));
+    uint8_t* temp = X265_MALLOC(uint8_t, newAlloc);
+    if (!temp)
+        return false;
+    if (m_packedSize)
+        memcpy(temp, m_packed, m_packedSize);
+    X265_FREE(m_packed);
+    m_packed = temp;
+    m_packedAlloc = newAlloc;
+    return true;
+}
+
+void AnalysisCodec::putVarint(uint32_t val)
+{
+    while (val >= 0x80)
+    {
+        m_packed[m_packedSize++] = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    m_packed[m_packedSize++] = (uint8_t)val;
+}
+
+void AnalysisCodec::packBytes(const uint8_t* src, uint32_t bytes)
+{
+    uint32_t litStart = 0;
+    uint32_t i = 0;
+    while (i < bytes)
+    {
+        uint32_t run = 1;
+        while (i + run < bytes && src[i + run] == src[i])
+            run++;
+        if (run < MIN_RUN)
+        {
+            i += run;
+            continue;
+        }
+
+        if (litStart < i)
+        {
+            putVarint((i - litStart) << 1);
+            memcpy(m_packed + m_packedSize, src + litStart, i - litStart);
+            m_packedSize += i - litStart;
+        }
+        putVarint((run << 1) | 1);
+        m_packed[m_packedSize++] = src[i];
+        i += run;
+        litStart = i;
+    }
+    if (litStart < bytes)
+    {
+        putVarint((bytes - litStart) << 1);
+        memcpy(m_packed + m_packedSize, src + litStart, bytes - litStart);
+        m_packedSize += bytes - litStart;
+    }
+}
+
+void AnalysisCodec::packMVs(const uint8_t* src, uint32_t bytes)
+{
+    int16_t prev[2] = { 0, 0 };
+    for (uint32_t i = 0; i + 4 <= bytes; i += 4)
+    {
+        int16_t mv[2];
+        memcpy(mv, src + i, sizeof(mv));
+        putVarint(zigzag((int32_t)mv[0] - prev[0]));
+        putVarint(zigzag((int32_t)mv[1] - prev[1]));
+        prev[0] = mv[0];
+        prev[1] = mv[1];
+    }
+}
+
+bool AnalysisCodec::append(const void* src, size_t bytes, SegmentKind kind)
+{
+    X265_CHECK(m_bPacking, "analysis codec is not packing\n");
+    if (kind == SEG_MV && (bytes & 3))
+        kind = SEG_BYTES;
+
+    /* worst cases: one token per literal byte pair, three varint bytes per MV component */
+    uint32_t bound = kind == SEG_MV ? (uint32_t)bytes / 4 * 6 : (uint32_t)bytes + (uint32_t)bytes / 2;
+    if (bytes > (1u << 30) || !reserve(bound + 16))
+        return false;
+
+    m_packed[m_packedSize++] = (uint8_t)kind;
+    putVarint((uint32_t)bytes);
+    if (kind == SEG_MV)
+        packMVs((const uint8_t*)src, (uint32_t)bytes);
+    else
+        packBytes((const uint8_t*)src, (uint32_t)bytes);
+    m_rawSize += (uint32_t)bytes;
+    return true;
+}
+
+bool AnalysisCodec::unpack(FILE* fp, uint32_t rawSize, uint32_t packedSize)
+{
+    clear();
+    if (rawSize > m_rawAlloc)
+    {
+        X265_FREE(m_raw);
+        m_raw = X265_MALLOC(uint8_t, rawSize);
+        m_rawAlloc = m_raw ? rawSize : 0;
+        if (!m_raw)
+            return false;
+    }
+    m_packedSize = 0;
+    if (!reserve(packedSize) || fread(m_packed, 1, packedSize, fp) != packedSize)
+        return false;
+
+    const uint8_t* src = m_packed;
+    const uint8_t* end = m_packed + packedSize;
+    uint32_t out = 0;
+    while (src < end)
+    {
+        uint8_t kind = *src++;
+        uint32_t bytes;
+        if (!getVarint(src, end, bytes) || bytes > rawSize - out)
+            return false;
+
+        uint8_t* dst = m_raw + out;
+        if (kind == SEG_MV)
+        {
+            if (bytes & 3)
+                return false;
+            int16_t prev[2] = { 0, 0 };
+            for (uint32_t i = 0; i < bytes; i += 4)
+            {
+                uint32_t dx, dy;
+                if (!getVarint(src, end, dx) || !getVarint(src, end, dy))
+                    return false;
+                prev[0] = (int16_t)(prev[0] + unzigzag(dx));
+                prev[1] = (int16_t)(prev[1] + unzigzag(dy));
+                memcpy(dst + i, prev, sizeof(prev));
+            }
+        }
+        else if (kind == SEG_BYTES)
+        {
+            uint32_t i = 0;
+            while (i < bytes)
+            {
+                uint32_t ctrl;
+                if (!getVarint(src, end, ctrl))
+                    return false;
+                uint32_t len = ctrl >> 1;
+                if (!len || len > bytes - i)
+                    return false;
+                if (ctrl & 1)
+                {
+                    if (src >= end)
+                        return false;
+                    memset(dst + i, *src++, len);
+                }
+                else
+                {
+                    if ((uint32_t)(end - src) < len)
+                        return false;
+                    memcpy(dst + i, src, len);
+                    src += len;
+                }
+                i += len;
+            }
+        }
+        else
+            return false;
+        out += bytes;
+    }
+    if (out != rawSize)
+        return false;
+
+    m_rawSize = rawSize;
+    m_rawPos = 0;
+    m_bUnpacked = true;
+    return true;
+}
+
+size_t AnalysisCodec::read(void* dst, size_t size, size_t count)
+{
+    size_t avail = (m_rawSize - m_rawPos) / size;
+    if (count > avail)
+        count = avail;
+    memcpy(dst, m_raw + m_rawPos, size * count);
+    m_rawPos += (uint32_t)(size * count);
+    return count;
+}
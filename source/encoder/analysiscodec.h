@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ANALYSISCODEC_H
+#define X265_ANALYSISCODEC_H
+
+#include "common.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Set in the depthBytes field of a frame record whose body is packed */
+#define ANALYSIS_RECORD_PACKED 0x80000000u
+
+/* Lossless packing of analysis-save frame records. The per-CU arrays are
+ * dominated by long runs (depth, modes, part sizes repeat across every
+ * partition of a CU) and by MVs close to their predecessor, so each array
+ * is coded as byte runs or as zigzag varint MV deltas. All codes are byte
+ * aligned and decode at memory speed. */
+class AnalysisCodec
+{
+public:
+
+    enum SegmentKind
+    {
+        SEG_BYTES,
+        SEG_MV,
+    };
+
+    AnalysisCodec();
+
+    ~AnalysisCodec();
+
+    /* packing: arrays appended between begin() and end() form one record body */
+    void begin()                    { m_packedSize = 0; m_rawSize = 0; m_bPacking = true; }
+
+    void end()                      { m_bPacking = false; }
+
+    bool isPacking() const          { return m_bPacking; }
+
+    bool append(const void* src, size_t bytes, SegmentKind kind);
+
+    const uint8_t* packed() const   { return m_packed; }
+
+    uint32_t packedSize() const     { return m_packedSize; }
+
+    uint32_t rawSize() const        { return m_rawSize; }
+
+    /* unpacking: decodes a whole record body, read() then hands it out in order */
+    bool unpack(FILE* fp, uint32_t rawSize, uint32_t packedSize);
+
+    bool isUnpacked() const         { return m_bUnpacked; }
+
+    size_t read(void* dst, size_t size, size_t count);
+
+    void clear()                    { m_bUnpacked = false; m_rawPos = m_rawSize = 0; }
+
+protected:
+
+    uint8_t* m_packed;
+    uint32_t m_packedSize;
+    uint32_t m_packedAlloc;
+
+    uint8_t* m_raw;
+    uint32_t m_rawSize;
+    uint32_t m_rawPos;
+    uint32_t m_rawAlloc;
+
+    bool     m_bPacking;
+    bool     m_bUnpacked;
+
+    bool reserve(uint32_t bytes);
+    void putVarint(uint32_t val);
+    void packBytes(const uint8_t* src, uint32_t bytes);
+    void packMVs(const uint8_t* src, uint32_t bytes);
+};
+}
+
+#endif // ifndef X265_ANALYSISCODEC_H
@@ -31,6 +31,7 @@
 #include "nal.h"
 #include "bitcost.h"
 #include "svt.h"
+#include "analysiscache.h"
 
 #if ENABLE_LIBVMAF
 #include "libvmaf/libvmaf.h"
@@ -627,6 +628,19 @@ void x265_encoder_get_stats(x265_encoder *enc, x265_stats *outputStats, uint32_t
         encoder->fetchStats(outputStats, statsSizeBytes);
     }
 }
+
+int x265_encoder_crf_probe(x265_encoder *enc, const x265_crf_probe_scene **scenes)
+{
+    if (!enc || !scenes)
+        return 0;
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    if (!encoder->m_param->numCrfProbes)
+    {
+        *scenes = NULL;
+        return 0;
+    }
+    return encoder->m_crfProbe.getScenes(encoder->m_param, scenes);
+}
 #if ENABLE_LIBVMAF
 void x265_vmaf_encoder_log(x265_encoder* enc, int argc, char **argv, x265_param *param, x265_vmaf_data *vmafdata)
 {
@@ -972,6 +986,16 @@ void x265_free_analysis_data(x265_param *param, x265_analysis_data* analysis)
     }
 }
 
+x265_analysis_cache* x265_analysis_cache_alloc(void)
+{
+    return new AnalysisCache;
+}
+
+void x265_analysis_cache_free(x265_analysis_cache* cache)
+{
+    delete static_cast<AnalysisCache*>(cache);
+}
+
 void x265_cleanup(void)
 {
     BitCost::destroy();
@@ -1082,7 +1106,10 @@ static const x265_api libapi =
     &x265_calculate_vmaf_framelevelscore,
     &x265_vmaf_encoder_log,
 #endif
-    &PARAM_NS::x265_zone_param_parse
+    &PARAM_NS::x265_zone_param_parse,
+    &x265_analysis_cache_alloc,
+    &x265_analysis_cache_free,
+    &x265_encoder_crf_probe
 };
 
 typedef const x265_api* (*api_get_func)(int bitDepth);
@@ -1309,8 +1336,14 @@ FILE* x265_csvlog_open(const x265_param* param)
                     fprintf(csvfp, "UnclippedBufferFillFinal, ");
                 if (param->bEnablePsnr)
                     fprintf(csvfp, "Y PSNR, U PSNR, V PSNR, YUV PSNR, ");
+                if (param->bEnablePsnr && param->bCtuMetrics)
+                    fprintf(csvfp, "Min CTU PSNR, ");
                 if (param->bEnableSsim)
                     fprintf(csvfp, "SSIM, SSIM(dB), ");
+                if (param->bEnableSsim && param->bCtuMetrics)
+                    fprintf(csvfp, "Min CTU SSIM, ");
+                if (param->bPerceptualMetrics)
+                    fprintf(csvfp, "MS-SSIM, VMAF Motion, ");
                 fprintf(csvfp, "Latency, ");
                 fprintf(csvfp, "List 0, List 1");
                 uint32_t size = param->maxCUSize;
@@ -1403,6 +1436,15 @@ FILE* x265_csvlog_open(const x265_param* param)
     }
 }
 
+/* lowest value of a --ctu-metrics map */
+static double minCTUMetric(const double* map, int numCTUs)
+{
+    double minVal = map && numCTUs ? map[0] : 0;
+    for (int i = 1; map && i < numCTUs; i++)
+        minVal = X265_MIN(minVal, map[i]);
+    return minVal;
+}
+
 // per frame CSV logging
 void x265_csvlog_frame(const x265_param* param, const x265_picture* pic)
 {
@@ -1424,8 +1466,14 @@ void x265_csvlog_frame(const x265_param* param, const x265_picture* pic)
         fprintf(param->csvfpt, "%.3lf,", frameStats->unclippedBufferFillFinal);
     if (param->bEnablePsnr)
         fprintf(param->csvfpt, "%.3lf, %.3lf, %.3lf, %.3lf,", frameStats->psnrY, frameStats->psnrU, frameStats->psnrV, frameStats->psnr);
+    if (param->bEnablePsnr && param->bCtuMetrics)
+        fprintf(param->csvfpt, " %.3lf,", minCTUMetric(frameStats->ctuPsnr, frameStats->ctuMapWidth * frameStats->ctuMapHeight));
     if (param->bEnableSsim)
         fprintf(param->csvfpt, " %.6f, %6.3f,", frameStats->ssim, x265_ssim2dB(frameStats->ssim));
+    if (param->bEnableSsim && param->bCtuMetrics)
+        fprintf(param->csvfpt, " %.6f,", minCTUMetric(frameStats->ctuSsim, frameStats->ctuMapWidth * frameStats->ctuMapHeight));
+    if (param->bPerceptualMetrics)
+        fprintf(param->csvfpt, " %.6f, %.3f,", frameStats->msSsim, frameStats->vmafMotion);
     fprintf(param->csvfpt, "%d, ", frameStats->frameLatency);
     if (frameStats->sliceType == 'I' || frameStats->sliceType == 'i')
         fputs(" -, -,", param->csvfpt);
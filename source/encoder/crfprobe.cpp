@@ -0,0 +1,166 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "crfprobe.h"
+
+using namespace X265_NS;
+
+/* Exponents of the qscale ratio for texture bits, motion bits and MSE,
+ * fitted to CRF 16..40 encodes of test sequences re-costed from their CRF 28
+ * encode. On clean sources the whole-sequence bitrate came within 10% and
+ * the PSNR within 0.4dB at +-4 CRF, 16% and 1.2dB at +-12. Grainy sources
+ * are much steeper: the noise quantized away at the encode's QP is coded at
+ * lower ones, and bits were under-predicted by 40% at -4 CRF and by 80% at
+ * -12, over-predicted by 30-40% at higher CRFs */
+#define CRF_PROBE_TEX_EXPONENT 1.2
+#define CRF_PROBE_MV_EXPONENT  1.0
+#define CRF_PROBE_MSE_EXPONENT 1.0
+
+CRFProbe::CRFProbe()
+{
+    m_frames = NULL;
+    m_numFrames = 0;
+    m_maxFrames = 0;
+    m_scenes = NULL;
+    m_numScenes = 0;
+}
+
+void CRFProbe::destroy()
+{
+    X265_FREE(m_frames);
+    X265_FREE(m_scenes);
+    m_frames = NULL;
+    m_scenes = NULL;
+    m_numFrames = m_maxFrames = m_numScenes = 0;
+}
+
+void CRFProbe::addFrame(int poc, bool bSceneStart, double qpRc, uint64_t bits, int coeffBits, int mvBits,
+                        double psnrY, double psnrU, double psnrV)
+{
+    if (m_numFrames == m_maxFrames)
+    {
+        int maxFrames = X265_MAX(m_maxFrames * 2, 256);
+        FrameRecord* frames = X265_MALLOC(FrameRecord, maxFrames);
+        if (!frames)
+            return;
+        if (m_frames)
+            memcpy(frames, m_frames, sizeof(FrameRecord) * m_numFrames);
+        X265_FREE(m_frames);
+        m_frames = frames;
+        m_maxFrames = maxFrames;
+    }
+
+    FrameRecord& f = m_frames[m_numFrames++];
+    f.poc = poc;
+    f.bSceneStart = bSceneStart;
+    f.qpRc = qpRc;
+    f.bits = bits;
+    f.coeffBits = coeffBits;
+    f.mvBits = mvBits;
+    f.psnr = (6 * psnrY + psnrU + psnrV) / 8;
+}
+
+int CRFProbe::compareFrames(const void* a, const void* b)
+{
+    return ((const FrameRecord*)a)->poc - ((const FrameRecord*)b)->poc;
+}
+
+int CRFProbe::getScenes(const x265_param* param, const x265_crf_probe_scene** scenes)
+{
+    /* frames were recorded in encode order */
+    qsort(m_frames, m_numFrames, sizeof(FrameRecord), compareFrames);
+
+    int numScenes = 0;
+    for (int i = 0; i < m_numFrames; i++)
+        numScenes += !i || m_frames[i].bSceneStart;
+
+    X265_FREE(m_scenes);
+    m_scenes = X265_MALLOC(x265_crf_probe_scene, X265_MAX(numScenes, 1));
+    m_numScenes = 0;
+    if (!m_scenes)
+    {
+        *scenes = NULL;
+        return 0;
+    }
+
+    double fps = (double)param->fpsNum / param->fpsDenom;
+    x265_crf_probe_scene* scene = NULL;
+    for (int i = 0; i < m_numFrames; i++)
+    {
+        const FrameRecord& f = m_frames[i];
+        if (!i || f.bSceneStart)
+        {
+            scene = &m_scenes[m_numScenes++];
+            memset(scene, 0, sizeof(*scene));
+            scene->firstPoc = f.poc;
+            scene->numProbes = param->numCrfProbes;
+            for (int c = 0; c < param->numCrfProbes; c++)
+                scene->crf[c] = param->crfProbes[c];
+        }
+        scene->numFrames++;
+
+        double qScale = x265_qp2qScale(f.qpRc);
+        double otherBits = (double)f.bits - f.coeffBits - f.mvBits;
+        for (int c = 0; c < param->numCrfProbes; c++)
+        {
+            double qp = x265_clip3((double)param->rc.qpMin, (double)param->rc.qpMax, f.qpRc + param->crfProbes[c] - param->rc.rfConstant);
+            double newQScale = x265_qp2qScale(qp);
+            scene->bitrate[c] += (f.coeffBits + .1) * pow(qScale / newQScale, CRF_PROBE_TEX_EXPONENT)
+                                 + f.mvBits * pow(X265_MAX(qScale, 1) / X265_MAX(newQScale, 1), CRF_PROBE_MV_EXPONENT)
+                                 + X265_MAX(otherBits, 0);
+            scene->psnr[c] += X265_MIN(f.psnr - 10 * CRF_PROBE_MSE_EXPONENT * log10(newQScale / qScale), 99.99);
+        }
+    }
+
+    for (int s = 0; s < m_numScenes; s++)
+    {
+        x265_crf_probe_scene& sc = m_scenes[s];
+        for (int c = 0; c < sc.numProbes; c++)
+        {
+            sc.bitrate[c] = sc.bitrate[c] * fps / (1000 * sc.numFrames);
+            sc.psnr[c] /= sc.numFrames;
+        }
+    }
+
+    *scenes = m_scenes;
+    return m_numScenes;
+}
+
+bool CRFProbe::writeCSV(const char* filename, const x265_param* param)
+{
+    const x265_crf_probe_scene* scenes;
+    int numScenes = getScenes(param, &scenes);
+
+    FILE* fp = x265_fopen(filename, "w");
+    if (!fp)
+    {
+        x265_log_file(param, X265_LOG_ERROR, "crf-probe: unable to open %s\n", filename);
+        return false;
+    }
+    fprintf(fp, "Scene, First POC, Frames, CRF, Predicted kbps, Predicted PSNR\n");
+    for (int s = 0; s < numScenes; s++)
+        for (int c = 0; c < scenes[s].numProbes; c++)
+            fprintf(fp, "%d, %d, %d, %.2f, %.2f, %.3f\n", s, scenes[s].firstPoc, scenes[s].numFrames,
+                    scenes[s].crf[c], scenes[s].bitrate[c], scenes[s].psnr[c]);
+    fclose(fp);
+    return true;
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_CRFPROBE_H
+#define X265_CRFPROBE_H
+
+#include "common.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Rate/quality prediction for other CRFs from a single CRF encode
+ * (--crf-probe). A CRF change moves the rate-control QP of every frame by
+ * the same amount, so each encoded frame is re-costed at its shifted QP: its
+ * texture and motion bits with power laws of the qscale ratio as in the
+ * two-pass qscale-to-bits model, its MSE growing with the qscale. Frames are
+ * grouped into scenes starting at scenecuts. The exponents are fixed, not
+ * measured per encode, so the error grows with the CRF distance and is
+ * largest on grainy sources, see crfprobe.cpp */
+class CRFProbe
+{
+public:
+
+    CRFProbe();
+    ~CRFProbe() { destroy(); }
+
+    void destroy();
+
+    /* record an encoded frame; bits is the access unit size of which the
+     * coeffBits and mvBits are rescaled, the rest is kept as is */
+    void addFrame(int poc, bool bSceneStart, double qpRc, uint64_t bits, int coeffBits, int mvBits,
+                  double psnrY, double psnrU, double psnrV);
+
+    /* predicted table per scene for the param's probe CRFs, in display order.
+     * The table stays valid until the next call */
+    int getScenes(const x265_param* param, const x265_crf_probe_scene** scenes);
+
+    /* write the table as CSV, one line per scene and CRF */
+    bool writeCSV(const char* filename, const x265_param* param);
+
+protected:
+
+    struct FrameRecord
+    {
+        int      poc;
+        bool     bSceneStart;
+        double   qpRc;
+        uint64_t bits;
+        int      coeffBits;
+        int      mvBits;
+        double   psnr;    // (6 * Y + U + V) / 8, as the global PSNR
+    };
+
+    FrameRecord*          m_frames;
+    int                   m_numFrames;
+    int                   m_maxFrames;
+    x265_crf_probe_scene* m_scenes;
+    int                   m_numScenes;
+
+    static int compareFrames(const void* a, const void* b);
+};
+}
+
+#endif // ifndef X265_CRFPROBE_H
@@ -108,6 +108,12 @@ void DPB::recycleUnreferenced()
                     curFrame->m_encData->m_meBuffer[i] = NULL;
                 }
             }
+            for (int i = 0; i < 3; i++)
+            {
+                X265_FREE(curFrame->m_encData->m_hpelBuffer[i]);
+                curFrame->m_encData->m_hpelBuffer[i] = NULL;
+                curFrame->m_encData->m_hpelPlane[i] = NULL;
+            }
             if (curFrame->m_ctuInfo != NULL)
             {
                 uint32_t widthInCU = (curFrame->m_param->sourceWidth + curFrame->m_param->maxCUSize - 1) >> curFrame->m_param->maxLog2CUSize;
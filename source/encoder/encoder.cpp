@@ -131,6 +131,10 @@ Encoder::Encoder()
     m_numChromaWPFrames = 0;
     m_numLumaWPBiFrames = 0;
     m_numChromaWPBiFrames = 0;
+    memset(m_numSearchMethodCTUs, 0, sizeof(m_numSearchMethodCTUs));
+    memset(m_numLowresMVSearches, 0, sizeof(m_numLowresMVSearches));
+    m_numLowresMVHits = 0;
+    memset(m_numAnalysisCacheLookups, 0, sizeof(m_numAnalysisCacheLookups));
     m_lookahead = NULL;
     m_rateControl = NULL;
     m_dpb = NULL;
@@ -142,8 +146,15 @@ Encoder::Encoder()
     m_threadPool = NULL;
     m_analysisFileIn = NULL;
     m_analysisFileOut = NULL;
+    m_analysisIndex = NULL;
+    m_analysisIndexCount = 0;
+    m_analysisIndexSize = 0;
+    m_analysisRecordOffset = NULL;
+    m_analysisRecordCount = 0;
     m_filmGrainIn = NULL;
     m_naluFile = NULL;
+    m_ctuPsnrMap = NULL;
+    m_ctuSsimMap = NULL;
     m_offsetEmergency = NULL;
     m_iFrameNum = 0;
     m_iPPSQpMinus26 = 0;
@@ -256,7 +267,8 @@ void Encoder::create()
     bool allowPools = !p->numaPools || strcmp(p->numaPools, "none");
 
     // Trim the thread pool if --wpp, --pme, and --pmode are disabled
-    if (!p->bEnableWavefront && !p->bDistributeModeAnalysis && !p->bDistributeMotionEstimation && !p->lookaheadSlices)
+    if (!p->bEnableWavefront && !p->bDistributeModeAnalysis && !p->bDistributeMotionEstimation && !p->lookaheadSlices &&
+        p->tileColumns == 1)
         allowPools = false;
 
     m_numPools = 0;
@@ -288,12 +300,22 @@ void Encoder::create()
         p->bEnableWavefront = p->bDistributeModeAnalysis = p->bDistributeMotionEstimation = p->lookaheadSlices = 0;
     }
 
+    /* each CTU row is emitted as it completes, which relies on the row
+     * substreams and CABAC synchronization of WPP */
+    if (p->bSubFrameOutput && !p->bEnableWavefront)
+    {
+        x265_log(p, X265_LOG_WARNING, "--sub-frame-output requires --wpp, disabled\n");
+        p->bSubFrameOutput = 0;
+    }
+
     x265_log(p, X265_LOG_INFO, "Slices                              : %d\n", p->maxSlices);
 
     char buf[128];
     int len = 0;
     if (p->bEnableWavefront)
         len += sprintf(buf + len, "wpp(%d rows)", rows);
+    if (p->tileColumns * p->tileRows > 1)
+        len += sprintf(buf + len, "%stiles(%dx%d)", len ? "+" : "", p->tileColumns, p->tileRows);
     if (p->bDistributeModeAnalysis)
         len += sprintf(buf + len, "%spmode", len ? "+" : "");
     if (p->bDistributeMotionEstimation)
@@ -340,6 +362,17 @@ void Encoder::create()
         m_scalingList.setDefaultScalingList();
     else if (m_scalingList.parseScalingList(m_param->scalingLists))
         m_aborted = true;
+
+    /* must be ready before the frame encoders create their analysis instances */
+    if (m_param->mdModel && !m_mdModel.load(m_param->mdModel, m_param))
+        m_aborted = true;
+    if (m_param->mdStats && !m_mdModel.openStats(m_param->mdStats, m_param))
+        m_aborted = true;
+    if (m_param->analysisCache && !static_cast<AnalysisCache*>(m_param->analysisCache)->bind(m_param))
+    {
+        x265_log(m_param, X265_LOG_WARNING, "analysis cache holds decisions for another resolution or CTU size, not used\n");
+        m_param->analysisCache = NULL;
+    }
     int pools = m_numPools;
     ThreadPool* lookAheadThreadPool = 0;
     if (m_param->lookaheadThreads > 0)
@@ -460,6 +493,24 @@ void Encoder::create()
             m_aborted = true;
         }
     }
+    if (m_param->bCtuMetrics)
+    {
+        if (m_param->bEnablePsnr)
+            m_ctuPsnrMap = X265_MALLOC(double, numRows * numCols);
+        if (m_param->bEnableSsim)
+            m_ctuSsimMap = X265_MALLOC(double, numRows * numCols);
+        if ((m_param->bEnablePsnr && !m_ctuPsnrMap) || (m_param->bEnableSsim && !m_ctuSsimMap))
+        {
+            x265_log(m_param, X265_LOG_ERROR, "Unable to allocate CTU metric maps, aborting\n");
+            m_aborted = true;
+        }
+    }
+    if (m_param->bPerceptualMetrics &&
+        !m_motionFeature.create(m_param->sourceWidth - m_sps.conformanceWindow.rightOffset, m_param->sourceHeight - m_sps.conformanceWindow.bottomOffset))
+    {
+        x265_log(m_param, X265_LOG_ERROR, "Unable to allocate perceptual metric buffers, aborting\n");
+        m_aborted = true;
+    }
 
     for (int i = 0; i < m_param->frameNumThreads; i++)
     {
@@ -593,7 +644,10 @@ void Encoder::stopJobs()
     if (m_threadPool)
     {
         for (int i = 0; i < m_numPools; i++)
+        {
             m_threadPool[i].stopWorkers();
+            m_threadPool[i].logStats(m_param, i);
+        }
     }
 }
 
@@ -902,6 +956,13 @@ void Encoder::destroy()
             delete m_frameEncoder[i];
         }
     }
+    m_mdModel.destroy();
+    if (m_param->crfProbeCsv)
+        m_crfProbe.writeCSV(m_param->crfProbeCsv, m_param);
+    m_crfProbe.destroy();
+    X265_FREE(m_ctuPsnrMap);
+    X265_FREE(m_ctuSsimMap);
+    m_motionFeature.destroy();
 
     // thread pools can be cleaned up now that all the JobProviders are
     // known to be shutdown
@@ -940,10 +1001,14 @@ void Encoder::destroy()
     }
     if (m_analysisFileIn)
         fclose(m_analysisFileIn);
+    X265_FREE(m_analysisRecordOffset);
 
     if (m_analysisFileOut)
     {
         int bError = 1;
+        if (m_param->analysisSave && m_param->bUseAnalysisFile && !writeAnalysisIndex())
+            x265_log(m_param, X265_LOG_WARNING, "failed to write analysis index, loading will scan the file\n");
+        X265_FREE(m_analysisIndex);
         fclose(m_analysisFileOut);
         const char* name = m_param->analysisSave ? m_param->analysisSave : m_param->analysisReuseFileName;
         if (!name)
@@ -1422,7 +1487,6 @@ bool Encoder::generateMcstfRef(Frame* frameEnc, FrameEncoder* currEncoder)
                             memset(currEncoder->m_mcstfRefList[mcstf->m_numRef].mvs1,  0, sizeof(MV) * ((mcstf->m_sourceWidth / 16) * (mcstf->m_sourceHeight / 16)));
                             memset(currEncoder->m_mcstfRefList[mcstf->m_numRef].mvs2,  0, sizeof(MV) * ((mcstf->m_sourceWidth / 16) * (mcstf->m_sourceHeight / 16)));
                             memset(currEncoder->m_mcstfRefList[mcstf->m_numRef].mvs,   0, sizeof(MV) * ((mcstf->m_sourceWidth /  4) * (mcstf->m_sourceHeight /  4)));
-                            memset(currEncoder->m_mcstfRefList[mcstf->m_numRef].noise, 0, sizeof(int) * ((mcstf->m_sourceWidth / 4) * (mcstf->m_sourceHeight / 4)));
                             memset(currEncoder->m_mcstfRefList[mcstf->m_numRef].error, 0, sizeof(int) * ((mcstf->m_sourceWidth / 4) * (mcstf->m_sourceHeight / 4)));
 
                             mcstf->m_numRef--;
@@ -1643,6 +1707,8 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
 
         /* Copy input picture into a Frame and PicYuv, send to lookahead */
         inFrame->m_fencPic->copyFromPicture(*inputPic, *m_param, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset);
+        if (m_param->bPerceptualMetrics)
+            m_motionFeature.addFrame(*inFrame, m_threadPool);
 
         inFrame->m_poc       = ++m_pocLast;
         inFrame->m_userData  = inputPic->userData;
@@ -1987,6 +2053,22 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
             }
             if (m_param->analysisMultiPassRefine || m_param->analysisMultiPassDistortion)
                 x265_free_analysis_data(m_param, &outFrame->m_analysisData);
+            if (m_param->bAdaptiveSearch)
+            {
+                for (int m = 0; m <= X265_FULL_SEARCH; m++)
+                    m_numSearchMethodCTUs[m] += outFrame->m_encData->m_frameStats.cntSearchMethod[m];
+            }
+            if (m_param->bMEConfidence)
+            {
+                for (int c = 0; c < LOWRES_MV_CONFIDENCES; c++)
+                    m_numLowresMVSearches[c] += outFrame->m_encData->m_frameStats.cntLowresMVSearch[c];
+                m_numLowresMVHits += outFrame->m_encData->m_frameStats.cntLowresMVHit;
+            }
+            if (m_param->analysisCache)
+            {
+                for (int l = 0; l < ANALYSIS_CACHE_LOOKUPS; l++)
+                    m_numAnalysisCacheLookups[l] += outFrame->m_encData->m_frameStats.cntAnalysisCache[l];
+            }
             if (m_param->internalCsp == X265_CSP_I400)
             {
                 if (slice->m_sliceType == P_SLICE)
@@ -2245,6 +2327,25 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
                         x265_log(m_param, X265_LOG_ERROR, "SEA motion search: POC %d Integral buffer[%d] unallocated\n", frameEnc->m_poc, i);
                 }
             }
+            if (m_param->bHpelCache && IS_REFERENCED(frameEnc))
+            {
+                PicYuv* reconPic = frameEnc->m_reconPic;
+                uint32_t numCuInHeight = (reconPic->m_picHeight + m_param->maxCUSize - 1) / m_param->maxCUSize;
+                size_t planeSize = reconPic->m_stride * (numCuInHeight * m_param->maxCUSize + 2 * reconPic->m_lumaMarginY);
+                intptr_t originOffset = reconPic->m_picOrg[0] - reconPic->m_picBuf[0];
+                for (int i = 0; i < 3; i++)
+                {
+                    frameEnc->m_encData->m_hpelBuffer[i] = X265_MALLOC(pixel, planeSize);
+                    if (!frameEnc->m_encData->m_hpelBuffer[i])
+                    {
+                        x265_log(m_param, X265_LOG_ERROR, "hpel cache: POC %d plane[%d] unallocated\n", frameEnc->m_poc, i);
+                        break;
+                    }
+                    frameEnc->m_encData->m_hpelPlane[i] = frameEnc->m_encData->m_hpelBuffer[i] + originOffset;
+                }
+                if (!frameEnc->m_encData->m_hpelBuffer[0] || !frameEnc->m_encData->m_hpelBuffer[1] || !frameEnc->m_encData->m_hpelBuffer[2])
+                    frameEnc->m_encData->m_hpelPlane[0] = NULL; /* references fall back to interpolation */
+            }
 
             if (m_param->bOptQpPPS && frameEnc->m_lowres.bKeyframe && m_param->bRepeatHeaders)
             {
@@ -2403,15 +2504,7 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
                     }
                 }
 
-                for (uint8_t i = 1; i <= frameEnc->m_mcstf->m_numRef; i++)
-                {
-                    TemporalFilterRefPicInfo *ref = &curEncoder->m_mcstfRefList[i - 1];
-
-                    curEncoder->m_frameEncTF->motionEstimationLuma(ref->mvs0, ref->mvsStride0, frameEnc->m_fencPicSubsampled4, ref->picBufferSubSampled4, 16);
-                    curEncoder->m_frameEncTF->motionEstimationLuma(ref->mvs1, ref->mvsStride1, frameEnc->m_fencPicSubsampled2, ref->picBufferSubSampled2, 16, ref->mvs0, ref->mvsStride0, 2);
-                    curEncoder->m_frameEncTF->motionEstimationLuma(ref->mvs2, ref->mvsStride2, frameEnc->m_fencPic, ref->picBuffer, 16, ref->mvs1, ref->mvsStride1, 2);
-                    curEncoder->m_frameEncTF->motionEstimationLumaDoubleRes(ref->mvs,  ref->mvsStride, frameEnc->m_fencPic, ref->picBuffer, 8, ref->mvs2, ref->mvsStride2, 1, ref->error);
-                }
+                curEncoder->m_frameEncTF->motionEstimation(frameEnc, curEncoder->m_mcstfRefList, frameEnc->m_mcstf->m_numRef);
 
                 for (int i = 0; i < frameEnc->m_mcstf->m_numRef; i++)
                 {
@@ -2711,6 +2804,79 @@ void Encoder::printSummary()
             (float)100.0 * m_numLumaWPBiFrames / m_analyzeB.m_numPics,
             (float)100.0 * m_numChromaWPBiFrames / m_analyzeB.m_numPics);
     }
+    if (m_param->bAdaptiveSearch)
+    {
+        uint64_t totalCTUs = 0;
+        for (int m = 0; m <= X265_FULL_SEARCH; m++)
+            totalCTUs += m_numSearchMethodCTUs[m];
+        if (totalCTUs)
+        {
+            int len = 0;
+            for (int m = 0; m <= X265_FULL_SEARCH; m++)
+            {
+                if (m_numSearchMethodCTUs[m])
+                    len += snprintf(buffer + len, sizeof(buffer) - len, " %s:%.1f%%",
+                                    x265_motion_est_names[m], (float)100.0 * m_numSearchMethodCTUs[m] / totalCTUs);
+            }
+            x265_log(m_param, X265_LOG_INFO, "Adaptive ME CTUs:%s\n", buffer);
+        }
+    }
+    if (m_param->bMEConfidence)
+    {
+        uint64_t total = m_numLowresMVSearches[LOWRES_MV_LOW] + m_numLowresMVSearches[LOWRES_MV_NARROW] + m_numLowresMVSearches[LOWRES_MV_REFINE];
+        uint64_t confident = total - m_numLowresMVSearches[LOWRES_MV_LOW];
+        if (total)
+            x265_log(m_param, X265_LOG_INFO, "ME confidence: refine-only %.1f%% narrow %.1f%% full %.1f%%, lowres MV hit rate %.1f%%\n",
+                     (float)100.0 * m_numLowresMVSearches[LOWRES_MV_REFINE] / total,
+                     (float)100.0 * m_numLowresMVSearches[LOWRES_MV_NARROW] / total,
+                     (float)100.0 * m_numLowresMVSearches[LOWRES_MV_LOW] / total,
+                     confident ? (float)100.0 * m_numLowresMVHits / confident : 0.0f);
+    }
+    if (m_param->analysisCache)
+    {
+        uint64_t total = 0;
+        for (int l = 0; l < ANALYSIS_CACHE_LOOKUPS; l++)
+            total += m_numAnalysisCacheLookups[l];
+        if (total)
+            x265_log(m_param, X265_LOG_INFO, "Analysis cache CTUs: reused %.1f%% stale %.1f%% new %.1f%% uncached %.1f%%\n",
+                     (float)100.0 * m_numAnalysisCacheLookups[ANALYSIS_CACHE_HIT] / total,
+                     (float)100.0 * m_numAnalysisCacheLookups[ANALYSIS_CACHE_STALE] / total,
+                     (float)100.0 * m_numAnalysisCacheLookups[ANALYSIS_CACHE_MISS] / total,
+                     (float)100.0 * m_numAnalysisCacheLookups[ANALYSIS_CACHE_UNCACHED] / total);
+    }
+    if (m_param->numCrfProbes)
+    {
+        const x265_crf_probe_scene* scenes;
+        int numScenes = m_crfProbe.getScenes(m_param, &scenes);
+        int numFrames = 0;
+        for (int s = 0; s < numScenes; s++)
+            numFrames += scenes[s].numFrames;
+        if (numFrames)
+        {
+            char probes[X265_MAX_CRF_PROBES * 32];
+            int len = 0;
+            for (int c = 0; c < m_param->numCrfProbes; c++)
+            {
+                double kbps = 0, psnr = 0;
+                for (int s = 0; s < numScenes; s++)
+                {
+                    kbps += scenes[s].bitrate[c] * scenes[s].numFrames / numFrames;
+                    psnr += scenes[s].psnr[c] * scenes[s].numFrames / numFrames;
+                }
+                len += snprintf(probes + len, sizeof(probes) - len, " %.1f:%.0fkb/s,%.2fdB", m_param->crfProbes[c], kbps, psnr);
+            }
+            x265_log(m_param, X265_LOG_INFO, "CRF probe (%d scenes):%s\n", numScenes, probes);
+
+            /* measured bounds of the fixed-exponent model, see crfprobe.cpp */
+            double maxDelta = 0;
+            for (int c = 0; c < m_param->numCrfProbes; c++)
+                maxDelta = X265_MAX(maxDelta, fabs(m_param->crfProbes[c] - m_param->rc.rfConstant));
+            if (maxDelta <= 4)
+                x265_log(m_param, X265_LOG_INFO, "CRF probe error: ~10%% bitrate, 0.4dB on clean sources, up to 40%% on grainy ones\n");
+            else
+                x265_log(m_param, X265_LOG_INFO, "CRF probe error: ~16%% bitrate, 1.2dB on clean sources at 12 CRF away, up to 80%% on grainy ones\n");
+        }
+    }
 
     if (m_param->bLossless)
     {
@@ -3031,6 +3197,9 @@ void Encoder::finishFrameStats(Frame* curFrame, FrameEncoder *curEncoder, x265_f
         if (m_param->bEnableSsim)
             m_analyzeB.addSsim(ssim);
     }
+    if (m_param->numCrfProbes)
+        m_crfProbe.addFrame(slice->m_poc, slice->isIntra() && curFrame->m_lowres.bScenecut, curEncData.m_avgQpRc, bits,
+                            curEncData.m_frameStats.coeffBits, curEncData.m_frameStats.mvBits, psnrY, psnrU, psnrV);
     if (m_param->csvLogLevel >= 2 || m_param->maxCLL || m_param->maxFALL)
     {
         m_analyzeAll.m_maxFALL += curFrame->m_fencPic->m_avgLumaLevel;
@@ -3066,6 +3235,23 @@ void Encoder::finishFrameStats(Frame* curFrame, FrameEncoder *curEncoder, x265_f
         double psnr = (psnrY * 6 + psnrU + psnrV) / 8;
         frameStats->psnr = psnr;
         frameStats->ssim = ssim;
+        if (m_param->bCtuMetrics)
+        {
+            int numCTUs = m_sps.numCuInWidth * m_sps.numCuInHeight;
+            if (m_ctuPsnrMap)
+                memcpy(m_ctuPsnrMap, curEncoder->m_ctuPsnr, sizeof(double) * numCTUs);
+            if (m_ctuSsimMap)
+                memcpy(m_ctuSsimMap, curEncoder->m_ctuSsim, sizeof(double) * numCTUs);
+            frameStats->ctuPsnr = m_ctuPsnrMap;
+            frameStats->ctuSsim = m_ctuSsimMap;
+            frameStats->ctuMapWidth = m_sps.numCuInWidth;
+            frameStats->ctuMapHeight = m_sps.numCuInHeight;
+        }
+        if (m_param->bPerceptualMetrics)
+        {
+            frameStats->msSsim = curEncoder->m_msSsim;
+            frameStats->vmafMotion = curFrame->m_vmafMotion;
+        }
         if (!slice->isIntra())
         {
             for (int ref = 0; ref < MAX_NUM_REF; ref++)
@@ -3456,9 +3642,39 @@ void Encoder::initPPS(PPS *pps)
     pps->deblockingFilterTcOffsetDiv2 = m_param->deblockingFilterTCOffset;
 
     pps->bEntropyCodingSyncEnabled = m_param->bEnableWavefront;
+    pps->bDependentSliceSegmentsEnabled = !!m_param->bSubFrameOutput;
 
     pps->numRefIdxDefault[0] = 1;
     pps->numRefIdxDefault[1] = 1;
+
+    /* configure() has already validated the tile grid against the picture size */
+    pps->numTileColumns = m_param->tileColumns;
+    pps->numTileRows = m_param->tileRows;
+    pps->bTilesEnabled = pps->numTileColumns * pps->numTileRows > 1;
+    pps->bUniformTileSpacing = !m_param->tileColumnWidths[0] && !m_param->tileRowHeights[0];
+
+    uint32_t widthInCU = m_sps.numCuInWidth;
+    uint32_t heightInCU = m_sps.numCuInHeight;
+    pps->tileColBd[0] = 0;
+    for (uint32_t i = 0; i < pps->numTileColumns; i++)
+    {
+        if (i == pps->numTileColumns - 1)
+            pps->tileColBd[i + 1] = widthInCU;
+        else if (m_param->tileColumnWidths[0])
+            pps->tileColBd[i + 1] = pps->tileColBd[i] + m_param->tileColumnWidths[i];
+        else
+            pps->tileColBd[i + 1] = ((i + 1) * widthInCU) / pps->numTileColumns;
+    }
+    pps->tileRowBd[0] = 0;
+    for (uint32_t i = 0; i < pps->numTileRows; i++)
+    {
+        if (i == pps->numTileRows - 1)
+            pps->tileRowBd[i + 1] = heightInCU;
+        else if (m_param->tileRowHeights[0])
+            pps->tileRowBd[i + 1] = pps->tileRowBd[i] + m_param->tileRowHeights[i];
+        else
+            pps->tileRowBd[i + 1] = ((i + 1) * heightInCU) / pps->numTileRows;
+    }
 }
 
 void Encoder::configureZone(x265_param *p, x265_param *zone)
@@ -3935,6 +4151,7 @@ void Encoder::configure(x265_param *p)
         /* don't measure these metrics if they will not be reported */
         p->bEnablePsnr = 0;
         p->bEnableSsim = 0;
+        p->bPerceptualMetrics = 0;
     }
     /* Warn users trying to measure PSNR/SSIM with psy opts on. */
     if (p->bEnablePsnr || p->bEnableSsim)
@@ -3982,6 +4199,27 @@ void Encoder::configure(x265_param *p)
     {
         p->rc.dataShareMode = X265_SHARE_MODE_FILE;
     }
+    if (p->bStatBinary && p->rc.bStatWrite && p->rc.dataShareMode == X265_SHARE_MODE_SHAREDMEM)
+    {
+        x265_log(p, X265_LOG_WARNING, "--stats-binary is not supported with shared memory stats, disabling\n");
+        p->bStatBinary = 0;
+    }
+    if ((p->statSegmentStart || p->statSegmentEnd) &&
+        (!p->rc.bStatRead || p->rc.bStatWrite || p->rc.dataShareMode != X265_SHARE_MODE_FILE || p->analysisMultiPassRefine || p->analysisMultiPassDistortion))
+    {
+        x265_log(p, X265_LOG_WARNING, "--stats-segment requires reading file stats without writing them or multi-pass analysis, disabling\n");
+        p->statSegmentStart = p->statSegmentEnd = 0;
+    }
+    if (p->bCtuMetrics && !p->bEnablePsnr && !p->bEnableSsim)
+    {
+        x265_log(p, X265_LOG_WARNING, "--ctu-metrics requires --psnr or --ssim, disabling\n");
+        p->bCtuMetrics = 0;
+    }
+    if (p->bPerceptualMetrics && (p->sourceWidth < 128 || p->sourceHeight < 128))
+    {
+        x265_log(p, X265_LOG_WARNING, "--perceptual-metrics requires pictures of at least 128x128, disabling\n");
+        p->bPerceptualMetrics = 0;
+    }
 
     if (!p->rc.bStatRead || p->rc.rateControlMode != X265_RC_CRF)
     {
@@ -4042,6 +4280,10 @@ void Encoder::configure(x265_param *p)
                 m_conformanceWindow.bEnabled = true;
                 m_conformanceWindow.bottomOffset = padsize;
             }
+
+            /* files without an index footer are still read by scanning the records */
+            if (!m_aborted && !loadAnalysisIndex())
+                x265_log(m_param, X265_LOG_DEBUG, "Analysis load: no index in %s, records will be scanned\n", m_param->analysisLoad);
         }
     }
 
@@ -4310,6 +4552,98 @@ void Encoder::configure(x265_param *p)
         x265_log(p, X265_LOG_WARNING, "maxSlices can not be more than min(rows, MAX_NAL_UNITS-1), force set to %d\n", slicesLimit);
         p->maxSlices = slicesLimit;
     }
+    if (p->tileColumns * p->tileRows > 1)
+    {
+        const int widthInCU = (p->sourceWidth + p->maxCUSize - 1) / p->maxCUSize;
+        const int heightInCU = (p->sourceHeight + p->maxCUSize - 1) / p->maxCUSize;
+        const int minColCUs = X265_MAX(256 / (int)p->maxCUSize, 1);
+        const int minRowCUs = X265_MAX(64 / (int)p->maxCUSize, 1);
+
+        if (p->tileColumnWidths[0])
+        {
+            int sum = 0;
+            bool bTooSmall = false;
+            for (int i = 0; i < p->tileColumns - 1; i++)
+            {
+                sum += p->tileColumnWidths[i];
+                bTooSmall |= p->tileColumnWidths[i] < minColCUs;
+            }
+            if (bTooSmall || widthInCU - sum < minColCUs)
+            {
+                x265_log(p, X265_LOG_WARNING, "invalid tile column widths, using uniform spacing\n");
+                memset(p->tileColumnWidths, 0, sizeof(p->tileColumnWidths));
+            }
+        }
+        if (p->tileRowHeights[0])
+        {
+            int sum = 0;
+            bool bTooSmall = false;
+            for (int i = 0; i < p->tileRows - 1; i++)
+            {
+                sum += p->tileRowHeights[i];
+                bTooSmall |= p->tileRowHeights[i] < minRowCUs;
+            }
+            if (bTooSmall || heightInCU - sum < minRowCUs)
+            {
+                x265_log(p, X265_LOG_WARNING, "invalid tile row heights, using uniform spacing\n");
+                memset(p->tileRowHeights, 0, sizeof(p->tileRowHeights));
+            }
+        }
+
+        /* HEVC requires tile columns of at least 256 and tile rows of at least
+         * 64 luma samples; uniform grids are reduced to fit */
+        if (!p->tileColumnWidths[0] && p->tileColumns > X265_MAX(widthInCU / minColCUs, 1))
+        {
+            p->tileColumns = X265_MAX(widthInCU / minColCUs, 1);
+            x265_log(p, X265_LOG_WARNING, "tile columns must be at least 256 pixels wide, force set to %d\n", p->tileColumns);
+        }
+        if (!p->tileRowHeights[0] && p->tileRows > X265_MAX(heightInCU / minRowCUs, 1))
+        {
+            p->tileRows = X265_MAX(heightInCU / minRowCUs, 1);
+            x265_log(p, X265_LOG_WARNING, "tile rows must be at least 64 pixels high, force set to %d\n", p->tileRows);
+        }
+    }
+    if (p->tileColumns * p->tileRows > 1)
+    {
+        /* tiles replace wavefront parallel processing */
+        p->bEnableWavefront = 0;
+        if (p->maxSlices > 1)
+        {
+            x265_log(p, X265_LOG_WARNING, "--slices disabled, tiles are not supported with multiple slices\n");
+            p->maxSlices = 1;
+        }
+        if (p->rc.vbvBufferSize && p->rc.vbvMaxBitrate)
+            x265_log(p, X265_LOG_WARNING, "row level VBV rate control is disabled with tiles\n");
+    }
+    /* the half-pel planes are filled CTU row by CTU row in picture order,
+     * slices filter their rows out of order */
+    if (p->bHpelCache && p->maxSlices > 1)
+    {
+        x265_log(p, X265_LOG_WARNING, "--hpel-cache is not supported with multiple slices, disabled\n");
+        p->bHpelCache = 0;
+    }
+    /* lowres MVs are ignored when saving or loading analysis so the two
+     * passes agree */
+    if (p->bMEConfidence && (p->analysisSave || p->analysisLoad))
+    {
+        x265_log(p, X265_LOG_WARNING, "--me-confidence is not supported with analysis save/load, disabled\n");
+        p->bMEConfidence = 0;
+    }
+    if ((p->mdModel || p->mdStats) && p->bDistributeModeAnalysis && p->rdLevel >= 2)
+        x265_log(p, X265_LOG_WARNING, "--md-model and --md-stats are not used with --pmode\n");
+    if (p->numCrfProbes && p->rc.rateControlMode != X265_RC_CRF)
+    {
+        x265_log(p, X265_LOG_WARNING, "--crf-probe requires CRF rate control, disabled\n");
+        p->numCrfProbes = 0;
+    }
+    if (p->numCrfProbes)
+        p->bEnablePsnr = 1;
+    if (p->analysisCache && (p->analysisSave || p->analysisLoad || p->analysisMultiPassRefine || p->bCTUInfo ||
+                             (p->bDistributeModeAnalysis && p->rdLevel >= 2)))
+    {
+        x265_log(p, X265_LOG_WARNING, "analysis cache is not supported with analysis save/load, ctu-info or --pmode, disabled\n");
+        p->analysisCache = NULL;
+    }
     if (p->bHDR10Opt)
     {
         if (p->internalCsp != X265_CSP_I420 || p->internalBitDepth != 10 || p->vui.colorPrimaries != 9 ||
@@ -4417,7 +4751,7 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
         {\
         memcpy(val, src, (size * readSize));\
         }\
-        else if (fread(val, size, readSize, fileOffset) != readSize)\
+        else if ((m_analysisUnpacker.isUnpacked() ? m_analysisUnpacker.read(val, size, readSize) : fread(val, size, readSize, fileOffset)) != readSize)\
     {\
         x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");\
         x265_free_analysis_data(m_param, analysis);\
@@ -4428,8 +4762,22 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
     static uint64_t consumedBytes = 0;
     static uint64_t totalConsumedBytes = 0;
     uint32_t depthBytes = 0;
+    m_analysisUnpacker.clear();
     if (m_param->bUseAnalysisFile)
-        fseeko(m_analysisFileIn, totalConsumedBytes + paramBytes, SEEK_SET);
+    {
+        int64_t recordOffset = (int64_t)totalConsumedBytes + paramBytes;
+        if (m_analysisRecordOffset)
+        {
+            recordOffset = curPoc >= 0 && curPoc < m_analysisRecordCount ? m_analysisRecordOffset[curPoc] : -1;
+            if (recordOffset < 0)
+            {
+                x265_log(NULL, X265_LOG_WARNING, "Error reading analysis data: Cannot find POC %d\n", curPoc);
+                x265_free_analysis_data(m_param, analysis);
+                return;
+            }
+        }
+        fseeko(m_analysisFileIn, recordOffset, SEEK_SET);
+    }
     const x265_analysis_data *picData = &(picIn->analysisData);
     x265_analysis_intra_data *intraPic = picData->intraData;
     x265_analysis_inter_data *interPic = picData->interData;
@@ -4459,6 +4807,20 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
             x265_free_analysis_data(m_param, analysis);
             return;
         }
+        if (depthBytes & ANALYSIS_RECORD_PACKED)
+        {
+            /* the rest of the record is read from the unpacked body */
+            uint32_t bodySize[2];
+            depthBytes &= ~ANALYSIS_RECORD_PACKED;
+            if (fread(bodySize, sizeof(uint32_t), 2, m_analysisFileIn) != 2 ||
+                !m_analysisUnpacker.unpack(m_analysisFileIn, bodySize[0], bodySize[1]))
+            {
+                x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data: corrupt packed record for POC %d\n", curPoc);
+                x265_free_analysis_data(m_param, analysis);
+                m_aborted = true;
+                return;
+            }
+        }
     }
 
     uint32_t numCUsLoad, numCUsInHeightLoad;
@@ -4740,7 +5102,7 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
     {\
         memcpy(val, src, (size * readSize));\
     }\
-    else if (fread(val, size, readSize, fileOffset) != readSize)\
+    else if ((m_analysisUnpacker.isUnpacked() ? m_analysisUnpacker.read(val, size, readSize) : fread(val, size, readSize, fileOffset)) != readSize)\
     {\
         x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");\
         x265_free_analysis_data(m_param, analysis);\
@@ -4751,8 +5113,22 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
     static uint64_t consumedBytes = 0;
     static uint64_t totalConsumedBytes = 0;
     uint32_t depthBytes = 0;
+    m_analysisUnpacker.clear();
     if (m_param->bUseAnalysisFile)
-        fseeko(m_analysisFileIn, totalConsumedBytes + paramBytes, SEEK_SET);
+    {
+        int64_t recordOffset = (int64_t)totalConsumedBytes + paramBytes;
+        if (m_analysisRecordOffset)
+        {
+            recordOffset = curPoc >= 0 && curPoc < m_analysisRecordCount ? m_analysisRecordOffset[curPoc] : -1;
+            if (recordOffset < 0)
+            {
+                x265_log(NULL, X265_LOG_WARNING, "Error reading analysis data: Cannot find POC %d\n", curPoc);
+                x265_free_analysis_data(m_param, analysis);
+                return;
+            }
+        }
+        fseeko(m_analysisFileIn, recordOffset, SEEK_SET);
+    }
 
     const x265_analysis_data *picData = &(picIn->analysisData);
     x265_analysis_intra_data *intraPic = picData->intraData;
@@ -4783,6 +5159,20 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
             x265_free_analysis_data(m_param, analysis);
             return;
         }
+        if (depthBytes & ANALYSIS_RECORD_PACKED)
+        {
+            /* the rest of the record is read from the unpacked body */
+            uint32_t bodySize[2];
+            depthBytes &= ~ANALYSIS_RECORD_PACKED;
+            if (fread(bodySize, sizeof(uint32_t), 2, m_analysisFileIn) != 2 ||
+                !m_analysisUnpacker.unpack(m_analysisFileIn, bodySize[0], bodySize[1]))
+            {
+                x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data: corrupt packed record for POC %d\n", curPoc);
+                x265_free_analysis_data(m_param, analysis);
+                m_aborted = true;
+                return;
+            }
+        }
     }
 
     /* Now arrived at the right frame, read the record */
@@ -5393,6 +5783,96 @@ int Encoder::getPuShape(puOrientation* puOrient, int partSize, int numCTU)
     }
     return SIZE_2Nx2N;
 }
+bool Encoder::writeAnalysisIndex()
+{
+    /* entries are 8-byte aligned so the footer can be read in place */
+    int64_t pos = ftello(m_analysisFileOut);
+    if (pos < 0)
+        return false;
+    static const uint8_t zero[8] = { 0 };
+    uint32_t pad = (uint32_t)((8 - (pos & 7)) & 7);
+    if (pad && fwrite(zero, 1, pad, m_analysisFileOut) != pad)
+        return false;
+
+    AnalysisIndexTrailer trailer;
+    trailer.indexOffset = pos + pad;
+    trailer.numEntries = m_analysisIndexCount;
+    trailer.version = ANALYSIS_INDEX_VERSION;
+    trailer.magic = ANALYSIS_INDEX_MAGIC;
+    trailer.reserved = 0;
+
+    if (m_analysisIndexCount && fwrite(m_analysisIndex, sizeof(AnalysisIndexEntry), m_analysisIndexCount, m_analysisFileOut) != m_analysisIndexCount)
+        return false;
+    return fwrite(&trailer, sizeof(trailer), 1, m_analysisFileOut) == 1;
+}
+
+bool Encoder::packAnalysisRecord(int64_t recordStart)
+{
+    m_analysisPacker.end();
+    uint32_t bodySize[2] = { m_analysisPacker.rawSize(), m_analysisPacker.packedSize() };
+    if (fwrite(bodySize, sizeof(uint32_t), 2, m_analysisFileOut) != 2 ||
+        fwrite(m_analysisPacker.packed(), 1, bodySize[1], m_analysisFileOut) != bodySize[1])
+        return false;
+
+    /* the record shrank, patch its size so readers without the index can still walk the file */
+    int64_t recordEnd = ftello(m_analysisFileOut);
+    uint32_t recordSize = (uint32_t)(recordEnd - recordStart);
+    return recordEnd >= 0 && !fseeko(m_analysisFileOut, recordStart, SEEK_SET) &&
+           fwrite(&recordSize, sizeof(uint32_t), 1, m_analysisFileOut) == 1 &&
+           !fseeko(m_analysisFileOut, recordEnd, SEEK_SET);
+}
+
+bool Encoder::loadAnalysisIndex()
+{
+    int64_t resume = ftello(m_analysisFileIn);
+    AnalysisIndexEntry* entries = NULL;
+    AnalysisIndexTrailer trailer;
+    int64_t fileSize;
+    int maxPoc = -1;
+    bool bOk = false;
+
+    if (resume < 0 || fseeko(m_analysisFileIn, 0, SEEK_END))
+        goto done;
+    fileSize = ftello(m_analysisFileIn);
+    if (fileSize < (int64_t)sizeof(trailer) || fseeko(m_analysisFileIn, fileSize - (int64_t)sizeof(trailer), SEEK_SET) ||
+        fread(&trailer, sizeof(trailer), 1, m_analysisFileIn) != 1)
+        goto done;
+    if (trailer.magic != ANALYSIS_INDEX_MAGIC || trailer.version != ANALYSIS_INDEX_VERSION || !trailer.numEntries ||
+        trailer.indexOffset + (int64_t)trailer.numEntries * (int64_t)sizeof(AnalysisIndexEntry) + (int64_t)sizeof(trailer) != fileSize)
+        goto done;
+
+    entries = X265_MALLOC(AnalysisIndexEntry, trailer.numEntries);
+    if (!entries || fseeko(m_analysisFileIn, trailer.indexOffset, SEEK_SET) ||
+        fread(entries, sizeof(AnalysisIndexEntry), trailer.numEntries, m_analysisFileIn) != trailer.numEntries)
+        goto done;
+
+    for (uint32_t i = 0; i < trailer.numEntries; i++)
+    {
+        if (entries[i].poc < 0 || entries[i].offset < 0 || entries[i].offset >= trailer.indexOffset)
+            goto done;
+        maxPoc = X265_MAX(maxPoc, entries[i].poc);
+    }
+    /* POCs are frame numbers, so a direct table stays small on sane files */
+    if ((int64_t)maxPoc >= 4 * (int64_t)trailer.numEntries + 1024)
+        goto done;
+
+    m_analysisRecordOffset = X265_MALLOC(int64_t, maxPoc + 1);
+    if (!m_analysisRecordOffset)
+        goto done;
+    for (int poc = 0; poc <= maxPoc; poc++)
+        m_analysisRecordOffset[poc] = -1;
+    for (uint32_t i = 0; i < trailer.numEntries; i++)
+        m_analysisRecordOffset[entries[i].poc] = entries[i].offset;
+    m_analysisRecordCount = maxPoc + 1;
+    bOk = true;
+
+done:
+    X265_FREE(entries);
+    if (resume >= 0)
+        fseeko(m_analysisFileIn, resume, SEEK_SET);
+    return bOk;
+}
+
 void Encoder::computeDistortionOffset(x265_analysis_data* analysis)
 {
     x265_analysis_distortion_data *distortionData = analysis->distortionData;
@@ -5543,8 +6023,19 @@ void Encoder::copyDistortionData(x265_analysis_data* analysis, FrameData &curEnc
 void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncData)
 {
 
-#define X265_FWRITE(val, size, writeSize, fileOffset)\
-    if (fwrite(val, size, writeSize, fileOffset) < writeSize)\
+#define X265_FWRITE_KIND(val, size, writeSize, fileOffset, kind)\
+    if (m_analysisPacker.isPacking() ? !m_analysisPacker.append(val, (size) * (writeSize), kind) : fwrite(val, size, writeSize, fileOffset) < writeSize)\
+    {\
+        x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");\
+        x265_free_analysis_data(m_param, analysis);\
+        m_aborted = true;\
+        return;\
+    }\
+
+#define X265_FWRITE(val, size, writeSize, fileOffset) X265_FWRITE_KIND(val, size, writeSize, fileOffset, AnalysisCodec::SEG_BYTES)
+
+#define X265_FPACK_END(recordStart)\
+    if (m_analysisPacker.isPacking() && !packAnalysisRecord(recordStart))\
     {\
         x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");\
         x265_free_analysis_data(m_param, analysis);\
@@ -5707,9 +6198,34 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
     if (!m_param->bUseAnalysisFile)
         return;
 
+    if (m_analysisIndexCount == m_analysisIndexSize)
+    {
+        uint32_t newSize = m_analysisIndexSize ? m_analysisIndexSize * 2 : 256;
+        AnalysisIndexEntry* temp = X265_MALLOC(AnalysisIndexEntry, newSize);
+        if (!temp)
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");
+            x265_free_analysis_data(m_param, analysis);
+            m_aborted = true;
+            return;
+        }
+        if (m_analysisIndex)
+            memcpy(temp, m_analysisIndex, sizeof(AnalysisIndexEntry) * m_analysisIndexCount);
+        X265_FREE(m_analysisIndex);
+        m_analysisIndex = temp;
+        m_analysisIndexSize = newSize;
+    }
+    AnalysisIndexEntry& entry = m_analysisIndex[m_analysisIndexCount++];
+    entry.poc = analysis->poc;
+    entry.reserved = 0;
+    entry.offset = ftello(m_analysisFileOut);
+
+    uint32_t depthField = depthBytes | (m_param->bAnalysisSaveCompress ? ANALYSIS_RECORD_PACKED : 0);
     X265_FWRITE(&analysis->frameRecordSize, sizeof(uint32_t), 1, m_analysisFileOut);
-    X265_FWRITE(&depthBytes, sizeof(uint32_t), 1, m_analysisFileOut);
+    X265_FWRITE(&depthField, sizeof(uint32_t), 1, m_analysisFileOut);
     X265_FWRITE(&analysis->poc, sizeof(int), 1, m_analysisFileOut);
+    if (m_param->bAnalysisSaveCompress)
+        m_analysisPacker.begin();
     X265_FWRITE(&analysis->sliceType, sizeof(int), 1, m_analysisFileOut);
     X265_FWRITE(&analysis->bScenecut, sizeof(int), 1, m_analysisFileOut);
     X265_FWRITE(&analysis->satdCost, sizeof(int64_t), 1, m_analysisFileOut);
@@ -5721,7 +6237,10 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
         X265_FWRITE((WeightParam*)analysis->wt, sizeof(WeightParam), numPlanes * numDir, m_analysisFileOut);
 
     if (m_param->analysisSaveReuseLevel < 2)
+    {
+        X265_FPACK_END(entry.offset);
         return;
+    }
 
     if (analysis->sliceType == X265_TYPE_IDR || analysis->sliceType == X265_TYPE_I)
     {
@@ -5750,7 +6269,7 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
                 {
                     X265_FWRITE((analysis->interData)->mvpIdx[dir], sizeof(uint8_t), depthBytes, m_analysisFileOut);
                     X265_FWRITE((analysis->interData)->refIdx[dir], sizeof(int8_t), depthBytes, m_analysisFileOut);
-                    X265_FWRITE((analysis->interData)->mv[dir], sizeof(MV), depthBytes, m_analysisFileOut);
+                    X265_FWRITE_KIND((analysis->interData)->mv[dir], sizeof(MV), depthBytes, m_analysisFileOut, AnalysisCodec::SEG_MV);
                 }
                 if (bIntraInInter)
                     X265_FWRITE((analysis->intraData)->modes, sizeof(uint8_t), analysis->numCUsInFrame * analysis->numPartitions, m_analysisFileOut);
@@ -5760,7 +6279,10 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
             X265_FWRITE((analysis->interData)->ref, sizeof(int32_t), analysis->numCUsInFrame * X265_MAX_PRED_MODE_PER_CTU * numDir, m_analysisFileOut);
 
     }
+    X265_FPACK_END(entry.offset);
+#undef X265_FPACK_END
 #undef X265_FWRITE
+#undef X265_FWRITE_KIND
 }
 
 void Encoder::writeAnalysisFileRefine(x265_analysis_data* analysis, FrameData &curEncData)
@@ -33,6 +33,10 @@
 #include "framedata.h"
 #include "svt.h"
 #include "temporalfilter.h"
+#include "analysiscodec.h"
+#include "modedecision.h"
+#include "crfprobe.h"
+#include "perceptual.h"
 #ifdef ENABLE_HDR10_PLUS
     #include "dynamicHDR10/hdr10plus.h"
 #endif
@@ -157,6 +161,28 @@ struct AdaptiveFrameDuplication
     bool bDup;
 };
 
+/* Footer of an analysis save file: one entry per frame record, followed by a
+ * trailer at the very end of the file so --analysis-load can seek straight to
+ * any POC instead of walking the records */
+#define ANALYSIS_INDEX_MAGIC   0x58444958 /* "XIDX" */
+#define ANALYSIS_INDEX_VERSION 1
+
+struct AnalysisIndexEntry
+{
+    int32_t  poc;
+    uint32_t reserved;
+    int64_t  offset;   // absolute file offset of the frame record
+};
+
+struct AnalysisIndexTrailer
+{
+    int64_t  indexOffset;
+    uint32_t numEntries;
+    uint32_t version;
+    uint32_t magic;
+    uint32_t reserved;
+};
+
 class FrameEncoder;
 class DPB;
 class Lookahead;
@@ -195,6 +221,10 @@ public:
     int                m_numChromaWPFrames;  // number of P frames with weighted chroma reference
     int                m_numLumaWPBiFrames;  // number of B frames with weighted luma reference
     int                m_numChromaWPBiFrames; // number of B frames with weighted chroma reference
+    uint64_t           m_numSearchMethodCTUs[X265_FULL_SEARCH + 1]; // inter CTUs per motion search method, --adaptive-me
+    uint64_t           m_numLowresMVSearches[LOWRES_MV_CONFIDENCES]; // PU motion searches per lowres MV confidence, --me-confidence
+    uint64_t           m_numLowresMVHits;    // confident searches ending within a pixel of the lowres MV
+    uint64_t           m_numAnalysisCacheLookups[ANALYSIS_CACHE_LOOKUPS]; // CTUs per analysis cache outcome
     int                m_conformanceMode;
     int                m_lastBPSEI;
     uint32_t           m_numDelayedPic;
@@ -205,6 +235,18 @@ public:
     Frame*             m_exportedPic;
     FILE*              m_analysisFileIn;
     FILE*              m_analysisFileOut;
+    AnalysisIndexEntry* m_analysisIndex;        // records written to m_analysisFileOut
+    uint32_t           m_analysisIndexCount;
+    uint32_t           m_analysisIndexSize;
+    int64_t*           m_analysisRecordOffset;  // [poc] offset of each record in m_analysisFileIn, -1 if absent
+    int                m_analysisRecordCount;
+    AnalysisCodec      m_analysisPacker;        // record bodies of --analysis-save-compress
+    AnalysisCodec      m_analysisUnpacker;
+    ModeDecisionModel  m_mdModel;               // --md-model and --md-stats, shared by all analysis instances
+    CRFProbe           m_crfProbe;              // --crf-probe frame records
+    double*            m_ctuPsnrMap;            // --ctu-metrics maps of the last output frame
+    double*            m_ctuSsimMap;
+    MotionFeature      m_motionFeature;         // --perceptual-metrics motion of the input frames
     FILE*              m_naluFile;
     x265_param*        m_param;
     x265_param*        m_latestParam;     // Holds latest param during a reconfigure
@@ -250,6 +292,9 @@ public:
 
     Lock               m_rpsInSpsLock;
     int                m_rpsInSpsCount;
+
+    /* encode order of the frame allowed to pass NALs to nalOutputCallback */
+    ThreadSafeInteger  m_subFrameOutputOrder;
     /* For HDR*/
     double             m_cB;
     double             m_cR;
@@ -340,6 +385,12 @@ public:
 
     void readAnalysisFile(x265_analysis_data* analysis, int poc, const x265_picture* picIn, int paramBytes, cuLocation cuLoc);
 
+    bool loadAnalysisIndex();
+
+    bool writeAnalysisIndex();
+
+    bool packAnalysisRecord(int64_t recordStart);
+
     void computeDistortionOffset(x265_analysis_data* analysis);
 
     int getCUIndex(cuLocation* cuLoc, uint32_t* count, int bytes, int flag);
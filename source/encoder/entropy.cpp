@@ -331,7 +331,7 @@ void Entropy::codePPS( const PPS& pps, bool filerAcross, int iPPSInitQpMinus26 )
 {
     WRITE_UVLC(0,                          "pps_pic_parameter_set_id");
     WRITE_UVLC(0,                          "pps_seq_parameter_set_id");
-    WRITE_FLAG(0,                          "dependent_slice_segments_enabled_flag");
+    WRITE_FLAG(pps.bDependentSliceSegmentsEnabled, "dependent_slice_segments_enabled_flag");
     WRITE_FLAG(0,                          "output_flag_present_flag");
     WRITE_CODE(0, 3,                       "num_extra_slice_header_bits");
     WRITE_FLAG(pps.bSignHideEnabled,       "sign_data_hiding_flag");
@@ -354,8 +354,22 @@ void Entropy::codePPS( const PPS& pps, bool filerAcross, int iPPSInitQpMinus26 )
     WRITE_FLAG(pps.bUseWeightPred,            "weighted_pred_flag");
     WRITE_FLAG(pps.bUseWeightedBiPred,        "weighted_bipred_flag");
     WRITE_FLAG(pps.bTransquantBypassEnabled,  "transquant_bypass_enable_flag");
-    WRITE_FLAG(0,                             "tiles_enabled_flag");
+    WRITE_FLAG(pps.bTilesEnabled,             "tiles_enabled_flag");
     WRITE_FLAG(pps.bEntropyCodingSyncEnabled, "entropy_coding_sync_enabled_flag");
+    if (pps.bTilesEnabled)
+    {
+        WRITE_UVLC(pps.numTileColumns - 1,    "num_tile_columns_minus1");
+        WRITE_UVLC(pps.numTileRows - 1,       "num_tile_rows_minus1");
+        WRITE_FLAG(pps.bUniformTileSpacing,   "uniform_spacing_flag");
+        if (!pps.bUniformTileSpacing)
+        {
+            for (uint32_t i = 0; i < pps.numTileColumns - 1; i++)
+                WRITE_UVLC(pps.tileColBd[i + 1] - pps.tileColBd[i] - 1, "column_width_minus1");
+            for (uint32_t i = 0; i < pps.numTileRows - 1; i++)
+                WRITE_UVLC(pps.tileRowBd[i + 1] - pps.tileRowBd[i] - 1, "row_height_minus1");
+        }
+        WRITE_FLAG(1,                         "loop_filter_across_tiles_enabled_flag");
+    }
     WRITE_FLAG(filerAcross,                   "loop_filter_across_slices_enabled_flag");
 
     WRITE_FLAG(pps.bDeblockingFilterControlPresent, "deblocking_filter_control_present_flag");
@@ -590,7 +604,7 @@ void Entropy::codeAUD(const Slice& slice)
     WRITE_CODE(picType, 3, "pic_type");
 }
 
-void Entropy::codeSliceHeader(const Slice& slice, FrameData& encData, uint32_t slice_addr, uint32_t slice_addr_bits, int sliceQp)
+void Entropy::codeSliceHeader(const Slice& slice, FrameData& encData, uint32_t slice_addr, uint32_t slice_addr_bits, int sliceQp, bool bDependentSlice)
 {
     WRITE_FLAG((slice_addr == 0 ? 1 : 0), "first_slice_segment_in_pic_flag");
     if (slice.getRapPicFlag())
@@ -598,14 +612,19 @@ void Entropy::codeSliceHeader(const Slice& slice, FrameData& encData, uint32_t s
 
     WRITE_UVLC(0, "slice_pic_parameter_set_id");
 
-    /* x265 does not use dependent slices, so always write all this data */
+    X265_CHECK(!bDependentSlice || (slice_addr && slice.m_pps->bDependentSliceSegmentsEnabled), "invalid dependent slice segment\n");
     if (slice_addr)
     {
-        // if( dependent_slice_segments_enabled_flag )
-        //     dependent_slice_segment_flag             u(1)
+        if (slice.m_pps->bDependentSliceSegmentsEnabled)
+            WRITE_FLAG(bDependentSlice, "dependent_slice_segment_flag");
         WRITE_CODE(slice_addr, slice_addr_bits, "slice_segment_address");
     }
 
+    /* a dependent slice segment inherits the rest of the header from the
+     * slice it belongs to, the caller writes the entry points */
+    if (bDependentSlice)
+        return;
+
     WRITE_UVLC(slice.m_sliceType, "slice_type");
 
     if (!slice.getIdrPicFlag())
@@ -723,7 +742,7 @@ void Entropy::codeSliceHeader(const Slice& slice, FrameData& encData, uint32_t s
     }
 }
 
-/** write wavefront substreams sizes for the slice header */
+/** write wavefront or tile substreams sizes for the slice header */
 void Entropy::codeSliceHeaderWPPEntryPoints(const uint32_t *substreamSizes, uint32_t numSubStreams, uint32_t maxOffset)
 {
     uint32_t offsetLen = 1;
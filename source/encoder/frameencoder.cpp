@@ -48,9 +48,12 @@ FrameEncoder::FrameEncoder()
     m_slicetypeWaitTime = 0;
     m_activeWorkerCount = 0;
     m_completionCount = 0;
+    m_rowMetrics.master = this;
     m_outStreams = NULL;
     m_backupStreams = NULL;
     m_substreamSizes = NULL;
+    m_nextOutputRow = 0;
+    m_numNalOutput = 0;
     m_nr = NULL;
     m_tld = NULL;
     m_rows = NULL;
@@ -59,6 +62,11 @@ FrameEncoder::FrameEncoder()
     m_frame = NULL;
     m_cuGeoms = NULL;
     m_ctuGeomMap = NULL;
+    m_ctuTileScan = NULL;
+    m_tileCoders = NULL;
+    m_ctuPsnr = NULL;
+    m_ctuSsim = NULL;
+    m_msSsim = 0;
     m_localTldIdx = 0;
     memset(&m_rce, 0, sizeof(RateControlEntry));
 }
@@ -92,8 +100,14 @@ void FrameEncoder::destroy()
     X265_FREE(m_sliceMaxBlockRow);
     X265_FREE(m_cuGeoms);
     X265_FREE(m_ctuGeomMap);
+    X265_FREE(m_ctuTileScan);
+    delete[] m_tileCoders;
     X265_FREE(m_substreamSizes);
     X265_FREE(m_nr);
+    X265_FREE(m_ctuPsnr);
+    X265_FREE(m_ctuSsim);
+    X265_FREE(m_rowMetrics.m_rowReady);
+    m_msSsimMetric.destroy();
 
     m_frameFilter.destroy();
 
@@ -105,8 +119,6 @@ void FrameEncoder::destroy()
 
     if (m_param->bEnableTemporalFilter)
     {
-        delete m_frameEncTF->m_metld;
-
         for (int i = 0; i < (m_frameEncTF->m_range << 1); i++)
             m_frameEncTF->destroyRefPicInfo(&m_mcstfRefList[i]);
 
@@ -132,6 +144,10 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
     m_bAllRowsStop = X265_MALLOC(bool, m_param->maxSlices);
     m_vbvResetTriggerRow = X265_MALLOC(int, m_param->maxSlices);
     ok &= !!m_sliceBaseRow;
+    m_rowMetrics.m_rowReady = X265_MALLOC(bool, m_numRows);
+    ok &= !!m_rowMetrics.m_rowReady;
+    if (m_rowMetrics.m_rowReady)
+        memset(m_rowMetrics.m_rowReady, 0, sizeof(bool) * m_numRows);
     m_sliceGroupSize = (uint16_t)(m_numRows + m_param->maxSlices - 1) / m_param->maxSlices;
     uint32_t sliceGroupSizeAccu = (m_numRows << 8) / m_param->maxSlices;    
     uint32_t rowSum = sliceGroupSizeAccu;
@@ -183,6 +199,41 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
 
     m_frameFilter.init(top, this, numRows, numCols);
 
+    if (m_param->bCtuMetrics)
+    {
+        if (m_param->bEnablePsnr)
+        {
+            m_ctuPsnr = X265_MALLOC(double, numRows * numCols);
+            ok &= !!m_ctuPsnr;
+        }
+        if (m_param->bEnableSsim)
+        {
+            m_ctuSsim = X265_MALLOC(double, numRows * numCols);
+            ok &= !!m_ctuSsim;
+        }
+    }
+    if (m_param->bPerceptualMetrics)
+        ok &= m_msSsimMetric.create(m_param->sourceWidth - top->m_sps.conformanceWindow.rightOffset,
+                                    m_param->sourceHeight - top->m_sps.conformanceWindow.bottomOffset,
+                                    m_pool ? m_pool->m_numWorkers : 0);
+
+    const PPS& pps = top->m_pps;
+    if (pps.bTilesEnabled)
+    {
+        m_ctuTileScan = X265_MALLOC(uint32_t, numRows * numCols);
+        m_tileCoders = new Entropy[pps.numTileColumns];
+        ok &= !!m_ctuTileScan;
+        if (m_ctuTileScan)
+        {
+            uint32_t i = 0;
+            for (uint32_t tileRow = 0; tileRow < pps.numTileRows; tileRow++)
+                for (uint32_t tileCol = 0; tileCol < pps.numTileColumns; tileCol++)
+                    for (uint32_t row = pps.tileRowBd[tileRow]; row < pps.tileRowBd[tileRow + 1]; row++)
+                        for (uint32_t col = pps.tileColBd[tileCol]; col < pps.tileColBd[tileCol + 1]; col++)
+                            m_ctuTileScan[i++] = row * numCols + col;
+        }
+    }
+
     // initialize HRD parameters of SPS
     if (m_param->bEmitHRDSEI || !!m_param->interlaceMode)
     {
@@ -210,7 +261,10 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
     {
         m_frameEncTF = new TemporalFilter();
         if (m_frameEncTF)
+        {
             m_frameEncTF->init(m_param);
+            ok &= m_frameEncTF->create(m_pool);
+        }
 
         for (int i = 0; i < (m_frameEncTF->m_range << 1); i++)
             ok &= !!m_frameEncTF->createRefPicInfo(&m_mcstfRefList[i], m_param);
@@ -305,6 +359,8 @@ void FrameEncoder::threadMain()
 {
     THREAD_NAME("Frame", m_jpId);
 
+    ModeDecisionModel* mdModel = m_top->m_mdModel.hasModel() || m_top->m_mdModel.hasStats() ? &m_top->m_mdModel : NULL;
+
     if (m_pool)
     {
         m_pool->setCurrentThreadAffinity();
@@ -323,6 +379,7 @@ void FrameEncoder::threadMain()
             {
                 m_tld[i].analysis.initSearch(*m_param, m_top->m_scalingList);
                 m_tld[i].analysis.create(m_tld);
+                m_tld[i].analysis.m_mdModel = mdModel;
             }
 
             for (int i = 0; i < m_pool->m_numProviders; i++)
@@ -345,6 +402,7 @@ void FrameEncoder::threadMain()
         m_tld = new ThreadLocalData;
         m_tld->analysis.initSearch(*m_param, m_top->m_scalingList);
         m_tld->analysis.create(NULL);
+        m_tld->analysis.m_mdModel = mdModel;
         m_localTldIdx = 0;
     }
 
@@ -375,6 +433,23 @@ void FrameEncoder::WeightAnalysis::processTasks(int /* workerThreadId */)
     weightAnalyse(*frame->m_encData->m_slice, *frame, *master.m_param);
 }
 
+void FrameEncoder::TileRow::processTasks(int workerThreadId)
+{
+    ThreadLocalData& tld = master.m_tld[workerThreadId < 0 ? master.m_localTldIdx : workerThreadId];
+
+    m_lock.acquire();
+    while (m_jobAcquired < m_jobTotal)
+    {
+        uint32_t tileCol = m_jobAcquired++;
+        m_lock.release();
+
+        master.processTile(tileRow * m_jobTotal + tileCol, tld);
+
+        m_lock.acquire();
+    }
+    m_lock.release();
+}
+
 
 uint32_t getBsLength( int32_t code )
 {
@@ -461,6 +536,8 @@ void FrameEncoder::compressFrame()
     m_stallStartTime = 0;
 
     m_completionCount = 0;
+    m_nextOutputRow = 0;
+    m_numNalOutput = 0;
     memset((void*)m_bAllRowsStop, 0, sizeof(bool) * m_param->maxSlices);
     memset((void*)m_vbvResetTriggerRow, -1, sizeof(int) * m_param->maxSlices);
     m_rowSliceTotalBits[0] = 0;
@@ -579,7 +656,7 @@ void FrameEncoder::compressFrame()
             if ((bUseWeightP || bUseWeightB) && slice->m_weightPredTable[l][ref][0].wtPresent)
                 w = slice->m_weightPredTable[l][ref];
             slice->m_refReconPicList[l][ref] = slice->m_refFrameList[l][ref]->m_reconPic;
-            m_mref[l][ref].init(slice->m_refReconPicList[l][ref], w, *m_param);
+            m_mref[l][ref].init(slice->m_refReconPicList[l][ref], w, *m_param, slice->m_refFrameList[l][ref]->m_encData->m_hpelPlane);
         }
         if (m_param->analysisSave && (bUseWeightP || bUseWeightB))
         {
@@ -600,6 +677,15 @@ void FrameEncoder::compressFrame()
     int qp = m_top->m_rateControl->rateControlStart(m_frame, &m_rce, m_top);
     m_rce.newQp = qp;
 
+    /* size the access unit for the planned frame size while it only holds
+     * the headers, the slice NALs are then serialized without copies */
+    if (m_rce.frameSizePlanned > 0)
+        m_nalList.reserve((uint32_t)X265_MIN(m_rce.frameSizePlanned / 8, (double)(1 << 30)));
+
+    /* the motion feature reads the source picture before it is filtered */
+    if (m_param->bPerceptualMetrics)
+        m_top->m_motionFeature.waitForFrame(*m_frame);
+
     if (m_param->bEnableTemporalFilter)
     {
         m_frameEncTF->m_QP = qp;
@@ -673,7 +759,11 @@ void FrameEncoder::compressFrame()
     // reset slice counter for rate control update
     m_sliceCnt = 0;
 
-    uint32_t numSubstreams = m_param->bEnableWavefront ? slice->m_sps->numCuInHeight : m_param->maxSlices;
+    /* with tiles, every tile is a substream and the tile coders select their
+     * bitstream when they start a tile */
+    const bool bTiles = slice->m_pps->bTilesEnabled;
+    uint32_t numSubstreams = bTiles ? slice->m_pps->numTileColumns * slice->m_pps->numTileRows :
+                             m_param->bEnableWavefront ? slice->m_sps->numCuInHeight : m_param->maxSlices;
     X265_CHECK(m_param->bEnableWavefront || (m_param->maxSlices == 1), "Multiple slices without WPP unsupport now!");
     if (!m_outStreams)
     {
@@ -681,7 +771,7 @@ void FrameEncoder::compressFrame()
         if (!m_param->bEnableWavefront)
             m_backupStreams = new Bitstream[numSubstreams];
         m_substreamSizes = X265_MALLOC(uint32_t, numSubstreams);
-        if (!slice->m_bUseSao)
+        if (!slice->m_bUseSao && !bTiles)
         {
             for (uint32_t i = 0; i < numSubstreams; i++)
                 m_rows[i].rowGoOnCoder.setBitstream(&m_outStreams[i]);
@@ -692,6 +782,8 @@ void FrameEncoder::compressFrame()
         for (uint32_t i = 0; i < numSubstreams; i++)
         {
             m_outStreams[i].resetBits();
+            if (bTiles)
+                continue;
             if (!slice->m_bUseSao)
                 m_rows[i].rowGoOnCoder.setBitstream(&m_outStreams[i]);
             else
@@ -849,13 +941,16 @@ void FrameEncoder::compressFrame()
         computeAvgTrainingData();
 
     /* Analyze CTU rows, most of the hard work is done here.  Frame is
-     * compressed in a wave-front pattern if WPP is enabled. Row based loop
-     * filters runs behind the CTU compression and reconstruction */
+     * compressed in a wave-front pattern if WPP is enabled, or one tile row
+     * at a time with the tiles of each row in parallel if tiles are enabled.
+     * Row based loop filters runs behind the CTU compression and reconstruction */
 
     for (uint32_t sliceId = 0; sliceId < m_param->maxSlices; sliceId++)    
         m_rows[m_sliceBaseRow[sliceId]].active = true;
     
-    if (m_param->bEnableWavefront)
+    if (bTiles)
+        compressTiles(numPredDir, bUseWeightP || bUseWeightB);
+    else if (m_param->bEnableWavefront)
     {
         int i = 0;
         for (uint32_t rowInSlice = 0; rowInSlice < m_sliceGroupSize; rowInSlice++)
@@ -914,16 +1009,29 @@ void FrameEncoder::compressFrame()
                     enqueueRowEncoder(m_row_to_idx[row]); /* clear internal dependency, start wavefront */
                 }
                 tryWakeOne();
+
+                /* rows which completed while we waited for reference rows */
+                if (m_param->bSubFrameOutput)
+                    writeSubFrameRows();
             } // end of loop rowInSlice
         } // end of loop sliceId
 
         m_allRowsAvailableTime = x265_mdate();
         tryWakeOne(); /* ensure one thread is active or help-wanted flag is set prior to blocking */
         static const int block_ms = 250;
+        if (m_param->bSubFrameOutput)
+        {
+            while (m_nextOutputRow < m_numRows)
+            {
+                if (m_rowOutputEvent.timedWait(block_ms))
+                    tryWakeOne();
+                writeSubFrameRows();
+            }
+        }
         while (m_completionEvent.timedWait(block_ms))
             tryWakeOne();
     }
-    else
+    else if (!bTiles)
     {
         for (uint32_t i = 0; i < m_numRows + m_filterRowDelay; i++)
         {
@@ -962,6 +1070,8 @@ void FrameEncoder::compressFrame()
 #if ENABLE_LIBVMAF
     vmafFrameLevelScore();
 #endif
+    if (m_param->bPerceptualMetrics)
+        m_msSsim = m_msSsimMetric.compute(*m_frame->m_reconPic, *m_frame->m_fencPic, m_pool ? this : NULL);
 
     if (m_param->maxSlices > 1)
     {
@@ -982,7 +1092,6 @@ void FrameEncoder::compressFrame()
             memset(m_mcstfRefList[i].mvs1, 0, sizeof(MV) * ((m_param->sourceWidth / 16) * (m_param->sourceHeight / 16)));
             memset(m_mcstfRefList[i].mvs2, 0, sizeof(MV) * ((m_param->sourceWidth / 16) * (m_param->sourceHeight / 16)));
             memset(m_mcstfRefList[i].mvs,  0, sizeof(MV) * ((m_param->sourceWidth / 4) * (m_param->sourceHeight / 4)));
-            memset(m_mcstfRefList[i].noise, 0, sizeof(int) * ((m_param->sourceWidth / 4) * (m_param->sourceHeight / 4)));
             memset(m_mcstfRefList[i].error, 0, sizeof(int) * ((m_param->sourceWidth / 4) * (m_param->sourceHeight / 4)));
 
             m_frame->m_mcstf->m_numRef = 0;
@@ -990,16 +1099,45 @@ void FrameEncoder::compressFrame()
     }
 
 
-    if (m_param->rc.bStatWrite)
+    if (m_param->bAdaptiveSearch)
     {
-        int totalI = 0, totalP = 0, totalSkip = 0;
+        for (uint32_t i = 0; i < m_numRows; i++)
+            for (int m = 0; m <= X265_FULL_SEARCH; m++)
+                m_frame->m_encData->m_frameStats.cntSearchMethod[m] += m_rows[i].rowStats.cntSearchMethod[m];
+    }
+    if (m_param->bMEConfidence)
+    {
+        for (uint32_t i = 0; i < m_numRows; i++)
+        {
+            for (int c = 0; c < LOWRES_MV_CONFIDENCES; c++)
+                m_frame->m_encData->m_frameStats.cntLowresMVSearch[c] += m_rows[i].rowStats.cntLowresMVSearch[c];
+            m_frame->m_encData->m_frameStats.cntLowresMVHit += m_rows[i].rowStats.cntLowresMVHit;
+        }
+    }
+    if (m_param->analysisCache)
+    {
+        for (uint32_t i = 0; i < m_numRows; i++)
+            for (int l = 0; l < ANALYSIS_CACHE_LOOKUPS; l++)
+                m_frame->m_encData->m_frameStats.cntAnalysisCache[l] += m_rows[i].rowStats.cntAnalysisCache[l];
+    }
 
-        // accumulate intra,inter,skip cu count per frame for 2 pass
+    if (m_param->rc.bStatWrite || m_param->numCrfProbes)
+    {
         for (uint32_t i = 0; i < m_numRows; i++)
         {
             m_frame->m_encData->m_frameStats.mvBits    += m_rows[i].rowStats.mvBits;
             m_frame->m_encData->m_frameStats.coeffBits += m_rows[i].rowStats.coeffBits;
             m_frame->m_encData->m_frameStats.miscBits  += m_rows[i].rowStats.miscBits;
+        }
+    }
+
+    if (m_param->rc.bStatWrite)
+    {
+        int totalI = 0, totalP = 0, totalSkip = 0;
+
+        // accumulate intra,inter,skip cu count per frame for 2 pass
+        for (uint32_t i = 0; i < m_numRows; i++)
+        {
             totalI                                     += m_rows[i].rowStats.intra8x8Cnt;
             totalP                                     += m_rows[i].rowStats.inter8x8Cnt;
             totalSkip                                  += m_rows[i].rowStats.skip8x8Cnt;
@@ -1062,12 +1200,18 @@ void FrameEncoder::compressFrame()
     m_entropyCoder.setBitstream(&m_bs);
 
     // finish encode of each CTU row, only required when SAO is enabled
-    if (slice->m_bUseSao)
-        encodeSlice(0);
+    if (slice->m_bUseSao && !m_param->bSubFrameOutput)
+        encodeSlice(0, slice->m_sps->numCUsInFrame);
 
     m_entropyCoder.setBitstream(&m_bs);
 
-    if (m_param->maxSlices > 1)
+    if (m_param->bSubFrameOutput)
+    {
+        /* every row was written as its own slice segment while the frame was
+         * being compressed */
+        X265_CHECK(m_nextOutputRow == m_numRows, "sub-frame output rows missing\n");
+    }
+    else if (m_param->maxSlices > 1)
     {
         uint32_t nextSliceRow = 0;
 
@@ -1110,18 +1254,20 @@ void FrameEncoder::compressFrame()
         }
         m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, 0, 0, slice->m_sliceQp);
 
-        // serialize each row, record final lengths in slice header
+        // serialize each row (or tile), record final lengths in slice header
         uint32_t maxStreamSize = m_nalList.serializeSubstreams(m_substreamSizes, numSubstreams, m_outStreams);
 
-        // complete the slice header by writing WPP row-starts
+        // complete the slice header by writing WPP row-starts or tile entry points
         m_entropyCoder.setBitstream(&m_bs);
-        if (slice->m_pps->bEntropyCodingSyncEnabled)
-            m_entropyCoder.codeSliceHeaderWPPEntryPoints(m_substreamSizes, (slice->m_sps->numCuInHeight - 1), maxStreamSize);
+        if (slice->m_pps->bEntropyCodingSyncEnabled || bTiles)
+            m_entropyCoder.codeSliceHeaderWPPEntryPoints(m_substreamSizes, (numSubstreams - 1), maxStreamSize);
         m_bs.writeByteAlignment();
 
         m_nalList.serialize(slice->m_nalUnitType, m_bs, (!!m_param->bEnableTemporalSubLayers ? m_frame->m_tempLayer + 1 : (1 + (slice->m_nalUnitType == NAL_UNIT_CODED_SLICE_TSA_N))));
     }
 
+    m_rowMetrics.finish();
+
     if (m_param->decodedPictureHashSEI)
         writeTrailingSEIMessages();
 
@@ -1169,6 +1315,9 @@ void FrameEncoder::compressFrame()
         m_nalList.serialize(NAL_UNIT_UNSPECIFIED, m_bs);
     }
 
+    if (m_param->bSubFrameOutput)
+        outputSubFrameNals(true);
+
     m_endCompressTime = x265_mdate();
 
     /* Decrement referenced frame reference counts, allow them to be recycled */
@@ -1223,91 +1372,128 @@ void FrameEncoder::compressFrame()
     m_endFrameTime = x265_mdate();  
 }
 
-void FrameEncoder::initDecodedPictureHashSEI(int row, int cuAddr, int height)
+void FrameEncoder::RowMetrics::rowFiltered(int row)
 {
-    PicYuv *reconPic = m_frame->m_reconPic;
-    uint32_t width = reconPic->m_picWidth;	
-    intptr_t stride = reconPic->m_stride;
-    uint32_t maxCUHeight = m_param->maxCUSize;
+    m_lock.acquire();
+    m_rowReady[row] = true;
+    bool bIdle = !m_bActive;
+    m_lock.release();
 
-    const uint32_t hChromaShift = CHROMA_H_SHIFT(m_param->internalCsp);
-    const uint32_t vChromaShift = CHROMA_V_SHIFT(m_param->internalCsp);
+    if (bIdle && master->m_pool)
+        tryBondPeers(*master, 1);
+}
 
-    if (m_param->decodedPictureHashSEI == 1)
+void FrameEncoder::RowMetrics::processTasks(int /* workerThreadId */)
+{
+    /* the SSIM scratch buffer, the frame sums and the hashes are updated in
+     * row order, one thread at a time; with several slices rows may be
+     * filtered out of order, the loop stops at the first row not ready */
+    m_lock.acquire();
+    if (m_bActive)
     {
-        if (!row)
-            MD5Init(&m_seiReconPictureDigest.m_state[0]);
+        m_lock.release();
+        return;
+    }
 
-        updateMD5Plane(m_seiReconPictureDigest.m_state[0], reconPic->getLumaAddr(cuAddr), width, height, stride);
-        if (m_param->internalCsp != X265_CSP_I400)
-        {
-            if (!row)
-            {
-                MD5Init(&m_seiReconPictureDigest.m_state[1]);
-                MD5Init(&m_seiReconPictureDigest.m_state[2]);
-            }
+    m_bActive = true;
+    while (m_rowsDone < (int)master->m_numRows && m_rowReady[m_rowsDone])
+    {
+        int row = m_rowsDone;
+        m_lock.release();
 
-            width >>= hChromaShift;
-            height >>= vChromaShift;
-            stride = reconPic->m_strideC;
+        const x265_param* param = master->m_param;
+        if (param->bEnablePsnr || param->bEnableSsim)
+            master->m_frameFilter.measureRow(row);
 
-            updateMD5Plane(m_seiReconPictureDigest.m_state[1], reconPic->getCbAddr(cuAddr), width, height, stride);
-            updateMD5Plane(m_seiReconPictureDigest.m_state[2], reconPic->getCrAddr(cuAddr), width, height, stride);
+        if (param->decodedPictureHashSEI && param->maxSlices == 1)
+        {
+            const FrameFilter::ParallelFilter& rowFilter = master->m_frameFilter.m_parallelFilter[row];
+            master->initDecodedPictureHashSEI(row, rowFilter.m_rowAddr, rowFilter.getCUHeight());
         }
+
+        m_lock.acquire();
+        m_rowsDone++;
     }
-    else if (m_param->decodedPictureHashSEI == 2)
-    {
+    m_bActive = false;
+    m_lock.release();
+}
 
-        if (!row)
-            m_seiReconPictureDigest.m_crc[0] = 0xffff;
+void FrameEncoder::RowMetrics::finish()
+{
+    /* a bonded worker still in the loop processes the remaining rows itself */
+    processTasks(-1);
+    waitForExit();
+
+    X265_CHECK(!m_rowsDone || m_rowsDone == (int)master->m_numRows, "row metrics left unprocessed\n");
+    memset(m_rowReady, 0, sizeof(bool) * master->m_numRows);
+    m_rowsDone = 0;
+    m_bondedPeerCount = 0;
+    m_exitedPeerCount.set(0);
+}
 
-        updateCRC(reconPic->getLumaAddr(cuAddr), m_seiReconPictureDigest.m_crc[0], height, width, stride);
-        if (m_param->internalCsp != X265_CSP_I400)
-        {
-            width >>= hChromaShift;
-            height >>= vChromaShift;
-            stride = reconPic->m_strideC;
-            m_seiReconPictureDigest.m_crc[1] = m_seiReconPictureDigest.m_crc[2] = 0xffff;
+void FrameEncoder::initDecodedPictureHashSEI(int row, int cuAddr, int height)
+{
+    PicYuv *reconPic = m_frame->m_reconPic;
+    int planes = m_param->internalCsp != X265_CSP_I400 ? 3 : 1;
 
-            updateCRC(reconPic->getCbAddr(cuAddr), m_seiReconPictureDigest.m_crc[1], height, width, stride);
-            updateCRC(reconPic->getCrAddr(cuAddr), m_seiReconPictureDigest.m_crc[2], height, width, stride);
-        }
-    }
-    else if (m_param->decodedPictureHashSEI == 3)
+    for (int plane = 0; plane < planes; plane++)
     {
-        if (!row)
-            m_seiReconPictureDigest.m_checksum[0] = 0;
+        uint32_t width = reconPic->m_picWidth;
+        uint32_t planeHeight = height;
+        intptr_t stride = reconPic->m_stride;
+        uint32_t maxCUHeight = m_param->maxCUSize;
 
-        updateChecksum(reconPic->m_picOrg[0], m_seiReconPictureDigest.m_checksum[0], height, width, stride, row, maxCUHeight);
-        if (m_param->internalCsp != X265_CSP_I400)
+        if (plane)
         {
-            width >>= hChromaShift;
-            height >>= vChromaShift;
+            width >>= CHROMA_H_SHIFT(m_param->internalCsp);
+            planeHeight >>= CHROMA_V_SHIFT(m_param->internalCsp);
             stride = reconPic->m_strideC;
-            maxCUHeight >>= vChromaShift;
+            maxCUHeight >>= CHROMA_V_SHIFT(m_param->internalCsp);
+        }
 
+        if (m_param->decodedPictureHashSEI == 1)
+        {
             if (!row)
-                m_seiReconPictureDigest.m_checksum[1] = m_seiReconPictureDigest.m_checksum[2] = 0;
+                MD5Init(&m_seiReconPictureDigest.m_state[plane]);
 
-            updateChecksum(reconPic->m_picOrg[1], m_seiReconPictureDigest.m_checksum[1], height, width, stride, row, maxCUHeight);
-            updateChecksum(reconPic->m_picOrg[2], m_seiReconPictureDigest.m_checksum[2], height, width, stride, row, maxCUHeight);
+            updateMD5Plane(m_seiReconPictureDigest.m_state[plane], reconPic->getPlaneAddr(plane, cuAddr), width, planeHeight, stride);
+        }
+        else if (m_param->decodedPictureHashSEI == 2)
+        {
+            /* the chroma CRCs restart at every row */
+            if (!row || plane)
+                m_seiReconPictureDigest.m_crc[plane] = 0xffff;
+
+            updateCRC(reconPic->getPlaneAddr(plane, cuAddr), m_seiReconPictureDigest.m_crc[plane], planeHeight, width, stride);
+        }
+        else if (m_param->decodedPictureHashSEI == 3)
+        {
+            if (!row)
+                m_seiReconPictureDigest.m_checksum[plane] = 0;
+
+            updateChecksum(reconPic->m_picOrg[plane], m_seiReconPictureDigest.m_checksum[plane], planeHeight, width, stride, row, maxCUHeight);
         }
     }
 }
 
-void FrameEncoder::encodeSlice(uint32_t sliceAddr)
+void FrameEncoder::encodeSlice(uint32_t sliceAddr, uint32_t endAddr)
 {
     Slice* slice = m_frame->m_encData->m_slice;
     const uint32_t widthInLCUs = slice->m_sps->numCuInWidth;
-    const uint32_t lastCUAddr = (slice->m_endCUAddr + m_param->num4x4Partitions - 1) / m_param->num4x4Partitions;
+    const uint32_t lastCUAddr = X265_MIN(endAddr, (slice->m_endCUAddr + m_param->num4x4Partitions - 1) / m_param->num4x4Partitions);
     const uint32_t numSubstreams = m_param->bEnableWavefront ? slice->m_sps->numCuInHeight : 1;
+    const PPS& pps = *slice->m_pps;
 
     SAOParam* saoParam = slice->m_sps->bUseSAO && slice->m_bUseSao ? m_frame->m_encData->m_saoParam : NULL;
-    for (uint32_t cuAddr = sliceAddr; cuAddr < lastCUAddr; cuAddr++)
+    for (uint32_t ctuIdx = sliceAddr; ctuIdx < lastCUAddr; ctuIdx++)
     {
+        /* with tiles, CTUs are coded in tile scan order, one substream per tile */
+        uint32_t cuAddr = pps.bTilesEnabled ? m_ctuTileScan[ctuIdx] : ctuIdx;
         uint32_t col = cuAddr % widthInLCUs;
         uint32_t row = cuAddr / widthInLCUs;
-        uint32_t subStrm = row % numSubstreams;
+        uint32_t tileCol = pps.getTileColumn(col);
+        uint32_t tileRow = pps.getTileRow(row);
+        uint32_t subStrm = pps.bTilesEnabled ? tileRow * pps.numTileColumns + tileCol : row % numSubstreams;
         CUData* ctu = m_frame->m_encData->getPicCTU(cuAddr);
 
         m_entropyCoder.setBitstream(&m_outStreams[subStrm]);
@@ -1319,19 +1505,22 @@ void FrameEncoder::encodeSlice(uint32_t sliceAddr)
             m_entropyCoder.loadContexts(m_rows[row - 1].bufferedEntropy);
         }
 
-        // Initialize slice context
-        if (ctu->m_bFirstRowInSlice && !col)
+        // Initialize slice context, CABAC is also reset at the start of each tile
+        if ((ctu->m_bFirstRowInSlice && !col) || (ctu->m_bFirstRowInTile && ctu->m_bFirstColInTile))
             m_entropyCoder.load(m_initSliceContext);
 
         if (saoParam)
         {
             if (saoParam->bSaoFlag[0] || saoParam->bSaoFlag[1])
             {
-                int mergeLeft = col && saoParam->ctuParam[0][cuAddr].mergeMode == SAO_MERGE_LEFT;
-                int mergeUp = !ctu->m_bFirstRowInSlice && saoParam->ctuParam[0][cuAddr].mergeMode == SAO_MERGE_UP;
-                if (col)
+                /* SAO parameters are never merged across slice or tile boundaries */
+                bool bLeftAvail = !ctu->m_bFirstColInTile;
+                bool bAboveAvail = !ctu->m_bFirstRowInSlice && !ctu->m_bFirstRowInTile;
+                int mergeLeft = bLeftAvail && saoParam->ctuParam[0][cuAddr].mergeMode == SAO_MERGE_LEFT;
+                int mergeUp = bAboveAvail && saoParam->ctuParam[0][cuAddr].mergeMode == SAO_MERGE_UP;
+                if (bLeftAvail)
                     m_entropyCoder.codeSaoMerge(mergeLeft);
-                if (!ctu->m_bFirstRowInSlice && !mergeLeft)
+                if (bAboveAvail && !mergeLeft)
                     m_entropyCoder.codeSaoMerge(mergeUp);
                 if (!mergeLeft && !mergeUp)
                 {
@@ -1363,12 +1552,89 @@ void FrameEncoder::encodeSlice(uint32_t sliceAddr)
             if (col == widthInLCUs - 1)
                 m_entropyCoder.finishSlice();
         }
+        else if (pps.bTilesEnabled && col == pps.tileColBd[tileCol + 1] - 1 && row == pps.tileRowBd[tileRow + 1] - 1)
+            m_entropyCoder.finishSlice();
     }
 
-    if (!m_param->bEnableWavefront)
+    if (!m_param->bEnableWavefront && !pps.bTilesEnabled)
         m_entropyCoder.finishSlice();
 }
 
+/* Write each CTU row that is ready, in row order, as its own slice segment.
+ * A row is ready once its substream is final; with SAO the row is coded here
+ * after the loop filters have decided its SAO parameters. The first row of a
+ * slice is an independent slice segment, the others are dependent segments
+ * which need no entry points as they hold a single WPP substream */
+void FrameEncoder::writeSubFrameRows()
+{
+    Slice* slice = m_frame->m_encData->m_slice;
+    uint32_t numRowsWritten = 0;
+
+    while (m_nextOutputRow < m_numRows)
+    {
+        const uint32_t row = m_nextOutputRow;
+        if (slice->m_bUseSao ? !m_frame->m_reconRowFlag[row].get() : !m_rows[row].coded)
+            break;
+
+        if (slice->m_bUseSao)
+            encodeSlice(row * m_numCols, (row + 1) * m_numCols);
+
+        const bool bFirstRowInSlice = row == m_sliceBaseRow[m_rows[row].sliceId];
+        if (bFirstRowInSlice && m_param->bOptRefListLengthPPS)
+        {
+            ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
+            m_top->analyseRefIdx(slice->m_numRefIdx);
+        }
+
+        m_bs.resetBits();
+        m_entropyCoder.setBitstream(&m_bs);
+        m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, row * m_numCols, m_sliceAddrBits, slice->m_sliceQp, !bFirstRowInSlice);
+
+        uint32_t maxStreamSize = m_nalList.serializeSubstreams(&m_substreamSizes[row], 1, &m_outStreams[row]);
+
+        m_entropyCoder.setBitstream(&m_bs);
+        m_entropyCoder.codeSliceHeaderWPPEntryPoints(&m_substreamSizes[row], 0, maxStreamSize);
+        m_bs.writeByteAlignment();
+
+        m_nalList.serialize(slice->m_nalUnitType, m_bs, (!!m_param->bEnableTemporalSubLayers ? m_frame->m_tempLayer + 1 : (1 + (slice->m_nalUnitType == NAL_UNIT_CODED_SLICE_TSA_N))));
+
+        m_nextOutputRow++;
+        numRowsWritten++;
+    }
+
+    if (numRowsWritten)
+        outputSubFrameNals(false);
+}
+
+/* Pass the NAL units serialized since the last call to the application.
+ * Frames are delivered in encode order, so NALs of a frame are held back
+ * until the frame before it has been completely delivered; at the end of the
+ * frame this blocks for that to happen */
+void FrameEncoder::outputSubFrameNals(bool bEndOfFrame)
+{
+    if (!m_param->nalOutputCallback)
+        return;
+
+    ThreadSafeInteger& outputOrder = m_top->m_subFrameOutputOrder;
+    if (bEndOfFrame)
+    {
+        int order = outputOrder.get();
+        while (order != m_rce.encodeOrder)
+            order = outputOrder.waitForChange(order);
+    }
+    else if (outputOrder.get() != m_rce.encodeOrder)
+        return;
+
+    for (; m_numNalOutput < m_nalList.m_numNal; m_numNalOutput++)
+        m_param->nalOutputCallback(m_param->nalOutputOpaque, &m_nalList.m_nal[m_numNalOutput], m_frame->m_poc, 0);
+
+    if (bEndOfFrame)
+    {
+        m_param->nalOutputCallback(m_param->nalOutputOpaque, NULL, m_frame->m_poc, 1);
+        outputOrder.incr();
+    }
+}
+
 void FrameEncoder::processRow(int row, int threadId)
 {
     int64_t startTime = x265_mdate();
@@ -1432,8 +1698,6 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
     bool bIsVbv = m_param->rc.vbvBufferSize > 0 && m_param->rc.vbvMaxBitrate > 0;
 
     const uint32_t sliceId = curRow.sliceId;
-    uint32_t maxBlockCols = (m_frame->m_fencPic->m_picWidth + (16 - 1)) / 16;
-    uint32_t noOfBlocks = m_param->maxCUSize / 16;
     const uint32_t bFirstRowInSlice = ((row == 0) || (m_rows[row - 1].sliceId != curRow.sliceId)) ? 1 : 0;
     const uint32_t bLastRowInSlice = ((row == m_numRows - 1) || (m_rows[row + 1].sliceId != curRow.sliceId)) ? 1 : 0;
     const uint32_t endRowInSlicePlus1 = m_sliceBaseRow[sliceId + 1];
@@ -1451,47 +1715,13 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
         {
             if (m_param->bEnableWavefront || !row)
             {
-                double meanQPOff = 0;
-                bool isReferenced = IS_REFERENCED(m_frame);
-                double *qpoffs = (isReferenced && m_param->rc.cuTree) ? m_frame->m_lowres.qpCuTreeOffset : m_frame->m_lowres.qpAqOffset;
-                if (qpoffs)
+                uint32_t cuYStart = 0, height = m_frame->m_fencPic->m_picHeight;
+                if (m_param->bEnableWavefront)
                 {
-                    uint32_t loopIncr = (m_param->rc.qgSize == 8) ? 8 : 16;
-
-                    uint32_t cuYStart = 0, height = m_frame->m_fencPic->m_picHeight;
-                    if (m_param->bEnableWavefront)
-                    {
-                        cuYStart = intRow * m_param->maxCUSize;
-                        height = cuYStart + m_param->maxCUSize;
-                    }
-
-                    uint32_t qgSize = m_param->rc.qgSize, width = m_frame->m_fencPic->m_picWidth;
-                    uint32_t maxOffsetCols = (m_frame->m_fencPic->m_picWidth + (loopIncr - 1)) / loopIncr;
-                    uint32_t count = 0;
-                    for (uint32_t cuY = cuYStart; cuY < height && (cuY < m_frame->m_fencPic->m_picHeight); cuY += qgSize)
-                    {
-                        for (uint32_t cuX = 0; cuX < width; cuX += qgSize)
-                        {
-                            double qp_offset = 0;
-                            uint32_t cnt = 0;
-
-                            for (uint32_t block_yy = cuY; block_yy < cuY + qgSize && block_yy < m_frame->m_fencPic->m_picHeight; block_yy += loopIncr)
-                            {
-                                for (uint32_t block_xx = cuX; block_xx < cuX + qgSize && block_xx < width; block_xx += loopIncr)
-                                {
-                                    int idx = ((block_yy / loopIncr) * (maxOffsetCols)) + (block_xx / loopIncr);
-                                    qp_offset += qpoffs[idx];
-                                    cnt++;
-                                }
-                            }
-                            qp_offset /= cnt;
-                            meanQPOff += qp_offset;
-                            count++;
-                        }
-                    }
-                    meanQPOff /= count;
+                    cuYStart = intRow * m_param->maxCUSize;
+                    height = cuYStart + m_param->maxCUSize;
                 }
-                rowCoder.m_meanQP = slice->m_sliceQp + meanQPOff;
+                rowCoder.m_meanQP = slice->m_sliceQp + computeMeanQPOffset(cuYStart, height);
             }
             else
             {
@@ -1517,7 +1747,8 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
         const uint32_t col = curRow.completed;
         const uint32_t cuAddr = lineStartCUAddr + col;
         CUData* ctu = curEncData.getPicCTU(cuAddr);
-        const uint32_t bLastCuInSlice = (bLastRowInSlice & (col == numCols - 1)) ? 1 : 0;
+        /* with sub-frame output every row ends a slice segment */
+        const uint32_t bLastCuInSlice = ((bLastRowInSlice | m_param->bSubFrameOutput) & (col == numCols - 1)) ? 1 : 0;
         ctu->initCTU(*m_frame, cuAddr, slice->m_sliceQp, bFirstRowInSlice, bLastRowInSlice, bLastCuInSlice);
 
         if (bIsVbv)
@@ -1542,25 +1773,8 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
             else
                 cuStat.baseQp = curEncData.m_rowStat[row].rowQp;
 
-            /* TODO: use defines from slicetype.h for lowres block size */
-            uint32_t block_y = (ctu->m_cuPelY >> m_param->maxLog2CUSize) * noOfBlocks;
-            uint32_t block_x = (ctu->m_cuPelX >> m_param->maxLog2CUSize) * noOfBlocks;
             if (!m_param->analysisLoad || !m_param->bDisableLookahead)
-            {
-                cuStat.vbvCost = 0;
-                cuStat.intraVbvCost = 0;
-
-                for (uint32_t h = 0; h < noOfBlocks && block_y < m_sliceMaxBlockRow[sliceId + 1]; h++, block_y++)
-                {
-                    uint32_t idx = block_x + (block_y * maxBlockCols);
-
-                    for (uint32_t w = 0; w < noOfBlocks && (block_x + w) < maxBlockCols; w++, idx++)
-                    {
-                        cuStat.vbvCost += m_frame->m_lowres.lowresCostForRc[idx] & LOWRES_COST_MASK;
-                        cuStat.intraVbvCost += m_frame->m_lowres.intraCost[idx];
-                    }
-                }
-            }
+                computeVbvCost(cuStat, *ctu, sliceId);
         }
         else
             curEncData.m_cuStat[cuAddr].baseQp = curEncData.m_avgQpRc;
@@ -1647,43 +1861,13 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
         FrameStats frameLog;
         curEncData.m_rowStat[row].sumQpAq += collectCTUStatistics(*ctu, &frameLog);
 
-        // copy number of intra, inter cu per row into frame stats for 2 pass
-        if (m_param->rc.bStatWrite)
-        {
-            curRow.rowStats.mvBits    += best.mvBits;
-            curRow.rowStats.coeffBits += best.coeffBits;
-            curRow.rowStats.miscBits  += best.totalBits - (best.mvBits + best.coeffBits);
-
-            for (uint32_t depth = 0; depth <= m_param->maxCUDepth; depth++)
-            {
-                /* 1 << shift == number of 8x8 blocks at current depth */
-                int shift = 2 * (m_param->maxCUDepth - depth);
-                int cuSize = m_param->maxCUSize >> depth;
-
-                curRow.rowStats.intra8x8Cnt += (cuSize == 8) ? (int)(frameLog.cntIntra[depth] + frameLog.cntIntraNxN) :
-                                                               (int)(frameLog.cntIntra[depth] << shift);
-
-                curRow.rowStats.inter8x8Cnt += (int)(frameLog.cntInter[depth] << shift);
-                curRow.rowStats.skip8x8Cnt += (int)((frameLog.cntSkipCu[depth] + frameLog.cntMergeCu[depth]) << shift);
-            }
-        }
-        curRow.rowStats.totalCtu++;
-        curRow.rowStats.lumaDistortion   += best.lumaDistortion;
-        curRow.rowStats.chromaDistortion += best.chromaDistortion;
-        curRow.rowStats.psyEnergy        += best.psyEnergy;
-        curRow.rowStats.ssimEnergy       += best.ssimEnergy;
-        curRow.rowStats.resEnergy        += best.resEnergy;
-        curRow.rowStats.cntIntraNxN      += frameLog.cntIntraNxN;
-        curRow.rowStats.totalCu          += frameLog.totalCu;
-        for (uint32_t depth = 0; depth <= m_param->maxCUDepth; depth++)
-        {
-            curRow.rowStats.cntSkipCu[depth] += frameLog.cntSkipCu[depth];
-            curRow.rowStats.cntMergeCu[depth] += frameLog.cntMergeCu[depth];
-            for (int m = 0; m < INTER_MODES; m++)
-                curRow.rowStats.cuInterDistribution[depth][m] += frameLog.cuInterDistribution[depth][m];
-            for (int n = 0; n < INTRA_MODES; n++)
-                curRow.rowStats.cuIntraDistribution[depth][n] += frameLog.cuIntraDistribution[depth][n];
-        }
+        collectRowStats(curRow.rowStats, best, frameLog);
+        if (m_param->bAdaptiveSearch && slice->m_sliceType != I_SLICE)
+            curRow.rowStats.cntSearchMethod[tld.analysis.m_searchMethod]++;
+        if (m_param->bMEConfidence)
+            tld.analysis.collectLowresMVStats(curRow.rowStats);
+        if (m_param->analysisCache)
+            curRow.rowStats.cntAnalysisCache[tld.analysis.m_analysisCacheLookup]++;
 
         curEncData.m_cuStat[cuAddr].totalBits = best.totalBits;
         x265_emms();
@@ -1875,15 +2059,8 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
      * before referencees may begin encoding) */
     if (m_param->rc.rateControlMode == X265_RC_ABR || bIsVbv)
     {
-        uint32_t rowCount = 0;
         uint32_t maxRows = m_sliceBaseRow[sliceId + 1] - m_sliceBaseRow[sliceId];
-
-        if (!m_rce.encodeOrder)
-            rowCount = maxRows - 1; 
-        else if ((uint32_t)m_rce.encodeOrder <= 2 * (m_param->fpsNum / m_param->fpsDenom))
-            rowCount = X265_MIN((maxRows + 1) / 2, maxRows - 1);
-        else
-            rowCount = X265_MIN(m_refLagRows / m_param->maxSlices, maxRows - 1);
+        uint32_t rowCount = getRateControlUpdateRows(maxRows);
 
         if (rowInSlice == rowCount)
         {
@@ -1917,6 +2094,12 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
        if (!slice->m_bUseSao && (m_param->bEnableWavefront || bLastRowInSlice))
                rowCoder.finishSlice();
 
+    if (m_param->bSubFrameOutput)
+    {
+        curRow.coded = true;
+        m_rowOutputEvent.trigger();
+    }
+
 
     /* Processing left Deblock block with current threading */
     if ((m_param->bEnableLoopFilter | slice->m_bUseSao) & (rowInSlice >= 2))
@@ -1967,6 +2150,323 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
         m_completionEvent.trigger();
 }
 
+/* Compress the frame one tile row at a time. The tiles of a tile row do not
+ * depend on each other, so they are distributed over bonded worker threads
+ * while this thread compresses tiles as well. The row based loop filters run
+ * after each tile row, behind the CTU compression and reconstruction */
+void FrameEncoder::compressTiles(int numPredDir, bool bUseWeight)
+{
+    FrameData& curEncData = *m_frame->m_encData;
+    Slice* slice = curEncData.m_slice;
+    const PPS& pps = *slice->m_pps;
+    bool bIsVbv = m_param->rc.vbvBufferSize > 0 && m_param->rc.vbvMaxBitrate > 0;
+
+    // calculate mean QP for consistent deltaQP signalling calculation
+    if (m_param->bOptCUDeltaQP)
+    {
+        double meanQP = slice->m_sliceQp + computeMeanQPOffset(0, m_frame->m_fencPic->m_picHeight);
+        for (uint32_t i = 0; i < pps.numTileColumns; i++)
+            m_tileCoders[i].m_meanQP = meanQP;
+    }
+
+    /* tiles of a row complete out of order, so VBV does not adjust the QP
+     * per CTU row; every row is encoded at the frame QP */
+    if (bIsVbv)
+    {
+        for (uint32_t row = 0; row < m_numRows; row++)
+        {
+            curEncData.m_rowStat[row].rowQp = curEncData.m_avgQpRc;
+            curEncData.m_rowStat[row].rowQpScale = x265_qp2qScale(curEncData.m_avgQpRc);
+        }
+    }
+
+    bool bUpdateRateControl = m_param->rc.rateControlMode == X265_RC_ABR || bIsVbv;
+    uint32_t rateControlRows = getRateControlUpdateRows(m_numRows);
+    uint32_t filteredRows = 0;
+
+    for (uint32_t tileRow = 0; tileRow < pps.numTileRows; tileRow++)
+    {
+        const uint32_t endRow = pps.tileRowBd[tileRow + 1];
+
+        // block until all reference frames have reconstructed the rows we need
+        for (int l = 0; l < numPredDir; l++)
+        {
+            for (int ref = 0; ref < slice->m_numRefIdx[l]; ref++)
+            {
+                Frame *refpic = slice->m_refFrameList[l][ref];
+
+                const int rowIdx = X265_MIN(m_numRows - 1, (endRow - 1 + m_refLagRows));
+                while (refpic->m_reconRowFlag[rowIdx].get() == 0)
+                    refpic->m_reconRowFlag[rowIdx].waitForChange(0);
+
+                if (bUseWeight && m_mref[l][ref].isWeighted)
+                    m_mref[l][ref].applyWeight(rowIdx, m_numRows, m_numRows, 0);
+            }
+        }
+
+        if (!tileRow)
+            m_row0WaitTime = x265_mdate();
+        if (tileRow == pps.numTileRows - 1)
+            m_allRowsAvailableTime = x265_mdate();
+
+        TileRow tiles(*this, tileRow, pps.numTileColumns);
+        if (m_pool)
+            tiles.tryBondPeers(*m_pool, pps.numTileColumns - 1);
+        tiles.processTasks(-1);
+        tiles.waitForExit();
+
+        /* If encoding with ABR, update bits and complexity in rate control once
+         * the same number of rows as without tiles have been compressed */
+        if (bUpdateRateControl && endRow > rateControlRows)
+        {
+            m_rce.rowTotalBits = 0;
+            for (uint32_t cuAddr = 0; cuAddr < rateControlRows * m_numCols; cuAddr++)
+                m_rce.rowTotalBits += curEncData.m_cuStat[cuAddr].totalBits;
+            m_top->m_rateControl->rateControlUpdateStats(&m_rce);
+            bUpdateRateControl = false;
+        }
+
+        // Both Loopfilter and SAO Disabled
+        if (!(m_param->bEnableLoopFilter | slice->m_bUseSao))
+        {
+            for (uint32_t row = pps.tileRowBd[tileRow]; row < endRow; row++)
+                for (uint32_t col = 0; col < m_numCols; col++)
+                    m_frameFilter.m_parallelFilter[row].processPostCu(col);
+        }
+
+        // filter
+        uint32_t filterEnd = tileRow == pps.numTileRows - 1 ? m_numRows : X265_MAX(endRow, m_filterRowDelay) - m_filterRowDelay;
+        for (; filteredRows < filterEnd; filteredRows++)
+            m_frameFilter.processRow(filteredRows);
+    }
+}
+
+/* Compress and code the CTUs of one tile in raster order within the tile.
+ * Neighbor CTUs of other tiles are unavailable, and the tile's CABAC coder
+ * starts from the slice context */
+void FrameEncoder::processTile(uint32_t tileIdx, ThreadLocalData& tld)
+{
+    FrameData& curEncData = *m_frame->m_encData;
+    Slice *slice = curEncData.m_slice;
+    const PPS& pps = *slice->m_pps;
+    const uint32_t tileCol = tileIdx % pps.numTileColumns;
+    const uint32_t tileRow = tileIdx / pps.numTileColumns;
+    bool bIsVbv = m_param->rc.vbvBufferSize > 0 && m_param->rc.vbvMaxBitrate > 0;
+
+    ATOMIC_INC(&m_activeWorkerCount);
+
+    /* if SAO is disabled, the tile coder writes the final CTU bitstream */
+    Entropy& tileCoder = m_tileCoders[tileCol];
+    tileCoder.load(m_initSliceContext);
+    tileCoder.setBitstream(slice->m_bUseSao ? NULL : &m_outStreams[tileIdx]);
+
+    for (uint32_t row = pps.tileRowBd[tileRow]; row < pps.tileRowBd[tileRow + 1]; row++)
+    {
+        CTURow& curRow = m_rows[row];
+
+        // Initialize restrict on MV range in slices
+        tld.analysis.m_sliceMinY = -(int32_t)(row * m_param->maxCUSize * 4) + 3 * 4;
+        tld.analysis.m_sliceMaxY = (int32_t)((m_numRows - 1 - row) * (m_param->maxCUSize * 4) - 4 * 4);
+
+        // Handle single row slice
+        if (tld.analysis.m_sliceMaxY < tld.analysis.m_sliceMinY)
+            tld.analysis.m_sliceMaxY = tld.analysis.m_sliceMinY = 0;
+
+        for (uint32_t col = pps.tileColBd[tileCol]; col < pps.tileColBd[tileCol + 1]; col++)
+        {
+            ProfileScopeEvent(encodeCTU);
+
+            const uint32_t cuAddr = row * m_numCols + col;
+            CUData* ctu = curEncData.getPicCTU(cuAddr);
+            const uint32_t bLastCuInSlice = cuAddr == m_numRows * m_numCols - 1;
+            ctu->initCTU(*m_frame, cuAddr, slice->m_sliceQp, row == 0, row == m_numRows - 1, bLastCuInSlice);
+
+            FrameData::RCStatCU& cuStat = curEncData.m_cuStat[cuAddr];
+            cuStat.baseQp = curEncData.m_avgQpRc;
+            if (bIsVbv && (!m_param->analysisLoad || !m_param->bDisableLookahead))
+                computeVbvCost(cuStat, *ctu, 0);
+
+            if (m_param->dynamicRd && (int32_t)(m_rce.qpaRc - m_rce.qpNoVbv) > 0)
+                ctu->m_vbvAffected = true;
+
+            // Does all the CU analysis, returns best top level mode decision
+            Mode& best = tld.analysis.compressCTU(*ctu, *m_frame, m_cuGeoms[m_ctuGeomMap[cuAddr]], tileCoder);
+
+            // take a sample of the current active worker count
+            ATOMIC_ADD(&m_totalActiveWorkerCount, m_activeWorkerCount);
+            ATOMIC_INC(&m_activeWorkerCountSamples);
+
+            /* advance the tile coder to include the context of this CTU */
+            tileCoder.encodeCTU(*ctu, m_cuGeoms[m_ctuGeomMap[cuAddr]]);
+
+            /* SAO parameter estimation using non-deblocked pixels for CTU bottom and right boundary areas */
+            if (slice->m_bUseSao && m_param->bSaoNonDeblocked)
+                m_frameFilter.m_parallelFilter[row].m_sao.calcSaoStatsCu_BeforeDblk(m_frame, col, row);
+
+            FrameStats frameLog;
+            int sumQpAq = collectCTUStatistics(*ctu, &frameLog);
+            cuStat.totalBits = best.totalBits;
+            x265_emms();
+
+            /* the tiles of a tile row share the row statistics */
+            ScopedLock self(curRow.lock);
+
+            curRow.completed++;
+            curEncData.m_rowStat[row].sumQpAq += sumQpAq;
+
+            /* startPoint > encodeOrder is true when the start point changes for
+            a new GOP but few frames from the previous GOP is still incomplete.
+            The data of frames in this interval will not be used by any future frames. */
+            if (m_param->bDynamicRefine && m_top->m_startPoint <= m_frame->m_encodeOrder)
+                collectDynDataRow(*ctu, &curRow.rowStats);
+
+            collectRowStats(curRow.rowStats, best, frameLog);
+            if (m_param->bAdaptiveSearch && slice->m_sliceType != I_SLICE)
+                curRow.rowStats.cntSearchMethod[tld.analysis.m_searchMethod]++;
+            if (m_param->bMEConfidence)
+                tld.analysis.collectLowresMVStats(curRow.rowStats);
+            if (m_param->analysisCache)
+                curRow.rowStats.cntAnalysisCache[tld.analysis.m_analysisCacheLookup]++;
+
+            if (bIsVbv)
+            {
+                curEncData.m_rowStat[row].rowSatd += cuStat.vbvCost;
+                curEncData.m_rowStat[row].rowIntraSatd += cuStat.intraVbvCost;
+                curEncData.m_rowStat[row].encodedBits += cuStat.totalBits;
+                curEncData.m_rowStat[row].sumQpRc += cuStat.baseQp;
+                curEncData.m_rowStat[row].numEncodedCUs = X265_MAX(curEncData.m_rowStat[row].numEncodedCUs, cuAddr);
+            }
+        }
+    }
+
+    /* end_of_subset_one_bit / end_of_slice_segment_flag */
+    if (!slice->m_bUseSao)
+        tileCoder.finishSlice();
+
+    ATOMIC_DEC(&m_activeWorkerCount);
+}
+
+/* average AQ / cutree QP offset of the quantization groups within the given
+ * range of luma rows, used for consistent deltaQP signalling */
+double FrameEncoder::computeMeanQPOffset(uint32_t cuYStart, uint32_t height)
+{
+    double meanQPOff = 0;
+    bool isReferenced = IS_REFERENCED(m_frame);
+    double *qpoffs = (isReferenced && m_param->rc.cuTree) ? m_frame->m_lowres.qpCuTreeOffset : m_frame->m_lowres.qpAqOffset;
+    if (qpoffs)
+    {
+        uint32_t loopIncr = (m_param->rc.qgSize == 8) ? 8 : 16;
+
+        uint32_t qgSize = m_param->rc.qgSize, width = m_frame->m_fencPic->m_picWidth;
+        uint32_t maxOffsetCols = (m_frame->m_fencPic->m_picWidth + (loopIncr - 1)) / loopIncr;
+        uint32_t count = 0;
+        for (uint32_t cuY = cuYStart; cuY < height && (cuY < m_frame->m_fencPic->m_picHeight); cuY += qgSize)
+        {
+            for (uint32_t cuX = 0; cuX < width; cuX += qgSize)
+            {
+                double qp_offset = 0;
+                uint32_t cnt = 0;
+
+                for (uint32_t block_yy = cuY; block_yy < cuY + qgSize && block_yy < m_frame->m_fencPic->m_picHeight; block_yy += loopIncr)
+                {
+                    for (uint32_t block_xx = cuX; block_xx < cuX + qgSize && block_xx < width; block_xx += loopIncr)
+                    {
+                        int idx = ((block_yy / loopIncr) * (maxOffsetCols)) + (block_xx / loopIncr);
+                        qp_offset += qpoffs[idx];
+                        cnt++;
+                    }
+                }
+                qp_offset /= cnt;
+                meanQPOff += qp_offset;
+                count++;
+            }
+        }
+        meanQPOff /= count;
+    }
+    return meanQPOff;
+}
+
+void FrameEncoder::collectRowStats(FrameStats& rowStats, const Mode& best, const FrameStats& frameLog)
+{
+    if (m_param->rc.bStatWrite || m_param->numCrfProbes)
+    {
+        rowStats.mvBits    += best.mvBits;
+        rowStats.coeffBits += best.coeffBits;
+        rowStats.miscBits  += best.totalBits - (best.mvBits + best.coeffBits);
+    }
+
+    // copy number of intra, inter cu per row into frame stats for 2 pass
+    if (m_param->rc.bStatWrite)
+    {
+        for (uint32_t depth = 0; depth <= m_param->maxCUDepth; depth++)
+        {
+            /* 1 << shift == number of 8x8 blocks at current depth */
+            int shift = 2 * (m_param->maxCUDepth - depth);
+            int cuSize = m_param->maxCUSize >> depth;
+
+            rowStats.intra8x8Cnt += (cuSize == 8) ? (int)(frameLog.cntIntra[depth] + frameLog.cntIntraNxN) :
+                                                    (int)(frameLog.cntIntra[depth] << shift);
+
+            rowStats.inter8x8Cnt += (int)(frameLog.cntInter[depth] << shift);
+            rowStats.skip8x8Cnt += (int)((frameLog.cntSkipCu[depth] + frameLog.cntMergeCu[depth]) << shift);
+        }
+    }
+    rowStats.totalCtu++;
+    rowStats.lumaDistortion   += best.lumaDistortion;
+    rowStats.chromaDistortion += best.chromaDistortion;
+    rowStats.psyEnergy        += best.psyEnergy;
+    rowStats.ssimEnergy       += best.ssimEnergy;
+    rowStats.resEnergy        += best.resEnergy;
+    rowStats.cntIntraNxN      += frameLog.cntIntraNxN;
+    rowStats.totalCu          += frameLog.totalCu;
+    for (uint32_t depth = 0; depth <= m_param->maxCUDepth; depth++)
+    {
+        rowStats.cntSkipCu[depth] += frameLog.cntSkipCu[depth];
+        rowStats.cntMergeCu[depth] += frameLog.cntMergeCu[depth];
+        for (int m = 0; m < INTER_MODES; m++)
+            rowStats.cuInterDistribution[depth][m] += frameLog.cuInterDistribution[depth][m];
+        for (int n = 0; n < INTRA_MODES; n++)
+            rowStats.cuIntraDistribution[depth][n] += frameLog.cuIntraDistribution[depth][n];
+    }
+}
+
+/* sum the lowres inter and intra costs of the blocks covered by the CTU, used
+ * by VBV to predict the size of the remaining rows */
+void FrameEncoder::computeVbvCost(FrameData::RCStatCU& cuStat, const CUData& ctu, uint32_t sliceId)
+{
+    /* TODO: use defines from slicetype.h for lowres block size */
+    uint32_t maxBlockCols = (m_frame->m_fencPic->m_picWidth + (16 - 1)) / 16;
+    uint32_t noOfBlocks = m_param->maxCUSize / 16;
+    uint32_t block_y = (ctu.m_cuPelY >> m_param->maxLog2CUSize) * noOfBlocks;
+    uint32_t block_x = (ctu.m_cuPelX >> m_param->maxLog2CUSize) * noOfBlocks;
+
+    cuStat.vbvCost = 0;
+    cuStat.intraVbvCost = 0;
+
+    for (uint32_t h = 0; h < noOfBlocks && block_y < m_sliceMaxBlockRow[sliceId + 1]; h++, block_y++)
+    {
+        uint32_t idx = block_x + (block_y * maxBlockCols);
+
+        for (uint32_t w = 0; w < noOfBlocks && (block_x + w) < maxBlockCols; w++, idx++)
+        {
+            cuStat.vbvCost += m_frame->m_lowres.lowresCostForRc[idx] & LOWRES_COST_MASK;
+            cuStat.intraVbvCost += m_frame->m_lowres.intraCost[idx];
+        }
+    }
+}
+
+/* number of rows of a slice (or the frame, with tiles) after which ABR and VBV
+ * statistics are reported to rate control for the next frame's estimation */
+uint32_t FrameEncoder::getRateControlUpdateRows(uint32_t maxRows)
+{
+    if (!m_rce.encodeOrder)
+        return maxRows - 1;
+    else if ((uint32_t)m_rce.encodeOrder <= 2 * (m_param->fpsNum / m_param->fpsDenom))
+        return X265_MIN((maxRows + 1) / 2, maxRows - 1);
+    else
+        return X265_MIN(m_refLagRows / m_param->maxSlices, maxRows - 1);
+}
+
 void FrameEncoder::collectDynDataRow(CUData& ctu, FrameStats* rowStats)
 {
     for (uint32_t i = 0; i < X265_REFINE_INTER_LEVELS; i++)
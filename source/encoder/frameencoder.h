@@ -41,6 +41,7 @@
 #include "reference.h"
 #include "nal.h"
 #include "temporalfilter.h"
+#include "perceptual.h"
 
 namespace X265_NS {
 // private x265 namespace
@@ -100,6 +101,10 @@ struct CTURow
 
     volatile int      reEncode;
 
+    /* the row bitstream is final and may be written as a slice segment, only
+     * tracked for sub-frame output without SAO */
+    volatile bool     coded;
+
     /* called at the start of each frame to initialize state */
     void init(Entropy& initContext, unsigned int sid)
     {
@@ -109,6 +114,7 @@ struct CTURow
         avgQPComputed = 0;
         sliceId = sid;
         reEncode = 0;
+        coded = false;
         memset(&rowStats, 0, sizeof(rowStats));
         rowGoOnCoder.load(initContext);
     }
@@ -166,6 +172,7 @@ public:
     Event                    m_enable;
     Event                    m_done;
     Event                    m_completionEvent;
+    Event                    m_rowOutputEvent;  /* a CTU row may be ready for sub-frame output */
     int                      m_localTldIdx;
     bool                     m_reconfigure; /* reconfigure in progress */
     volatile bool            m_threadActive;
@@ -196,6 +203,10 @@ public:
     double                   m_ssim;
     uint64_t                 m_accessUnitBits;
     uint32_t                 m_ssimCnt;
+    double*                  m_ctuPsnr;     // per-CTU metrics of --ctu-metrics, raster order
+    double*                  m_ctuSsim;
+    MultiScaleSSIM           m_msSsimMetric;  // --perceptual-metrics
+    double                   m_msSsim;
 
     volatile int             m_activeWorkerCount;        // count of workers currently encoding or filtering CTUs
     volatile int             m_totalActiveWorkerCount;   // sum of m_activeWorkerCount sampled at end of each CTU
@@ -223,10 +234,17 @@ public:
     Bitstream*               m_outStreams;
     Bitstream*               m_backupStreams;
     uint32_t*                m_substreamSizes;
+    uint32_t                 m_nextOutputRow;   /* sub-frame output: next CTU row to write */
+    uint32_t                 m_numNalOutput;    /* sub-frame output: NALs given to the application */
 
     CUGeom*                  m_cuGeoms;
     uint32_t*                m_ctuGeomMap;
 
+    /* tiles: CTU raster addresses in tile scan order, and the CABAC coder of
+     * each tile column, reused by every tile row */
+    uint32_t*                m_ctuTileScan;
+    Entropy*                 m_tileCoders;
+
     Bitstream                m_bs;
     MotionReference          m_mref[2][MAX_NUM_REF + 1];
     Entropy                  m_entropyCoder;
@@ -253,6 +271,48 @@ public:
         WeightAnalysis operator=(const WeightAnalysis&);
     };
 
+    /* compresses the tiles of one tile row, one tile per bonded worker */
+    class TileRow : public BondedTaskGroup
+    {
+    public:
+
+        FrameEncoder& master;
+        uint32_t      tileRow;
+
+        TileRow(FrameEncoder& fe, uint32_t row, uint32_t numTiles) : master(fe), tileRow(row) { m_jobTotal = numTiles; }
+
+        void processTasks(int workerThreadId);
+
+    protected:
+
+        TileRow operator=(const TileRow&);
+    };
+
+    /* Measures (PSNR, SSIM) and hashes (decoded picture hash SEI) the
+     * reconstructed CTU rows in row order. As each row is filtered a worker
+     * bonded to this frame encoder is asked to process the rows ready so
+     * far, overlapping the encode of the next rows; whatever is left when
+     * the last row completes is done by the frame encoder thread before the
+     * SEI is written */
+    class RowMetrics : public BondedTaskGroup
+    {
+    public:
+
+        FrameEncoder* master;
+        bool*         m_rowReady;      // per CTU row, its reconstruction is final
+        int           m_rowsDone;
+        bool          m_bActive;       // a thread is in the row loop
+
+        RowMetrics() : master(NULL), m_rowReady(NULL), m_rowsDone(0), m_bActive(false) {}
+
+        void rowFiltered(int row);
+        void finish();
+
+        void processTasks(int workerThreadId);
+    };
+
+    RowMetrics               m_rowMetrics;
+
 protected:
 
     bool initializeGeoms();
@@ -261,7 +321,12 @@ protected:
     void compressFrame();
 
     /* called by compressFrame to generate final per-row bitstreams */
-    void encodeSlice(uint32_t sliceAddr);
+    void encodeSlice(uint32_t sliceAddr, uint32_t endAddr);
+
+    /* sub-frame output, write ready CTU rows as slice segments and hand new
+     * NAL units to the application */
+    void writeSubFrameRows();
+    void outputSubFrameNals(bool bEndOfFrame);
 
     void threadMain();
     int  collectCTUStatistics(const CUData& ctu, FrameStats* frameLog);
@@ -273,6 +338,15 @@ protected:
     virtual void processRow(int row, int threadId);
     virtual void processRowEncoder(int row, ThreadLocalData& tld);
 
+    /* compress and code one tile, called by TileRow workers */
+    void processTile(uint32_t tileIdx, ThreadLocalData& tld);
+    void compressTiles(int numPredDir, bool bUseWeight);
+
+    double computeMeanQPOffset(uint32_t cuYStart, uint32_t height);
+    void   collectRowStats(FrameStats& rowStats, const Mode& best, const FrameStats& frameLog);
+    uint32_t getRateControlUpdateRows(uint32_t maxRows);
+    void   computeVbvCost(FrameData::RCStatCU& cuStat, const CUData& ctu, uint32_t sliceId);
+
     void enqueueRowEncoder(int row) { WaveFront::enqueueRow(row * 2 + 0); }
     void enqueueRowFilter(int row)  { WaveFront::enqueueRow(row * 2 + 1); }
     void enableRowEncoder(int row)  { WaveFront::enableRow(row * 2 + 0); }
@@ -32,7 +32,8 @@
 
 using namespace X265_NS;
 
-static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, uint32_t width, uint32_t height, void *buf, uint32_t& cnt);
+static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, uint32_t width, uint32_t height, void *buf, uint32_t& cnt,
+                           double *ctuSsim = NULL, uint32_t ctuBlocks = 0);
 
 namespace X265_NS
 {
@@ -653,39 +654,79 @@ void FrameFilter::processRow(int row)
 
 void FrameFilter::processPostRow(int row)
 {
-    PicYuv *reconPic = m_frame->m_reconPic;
-    const uint32_t numCols = m_frame->m_encData->m_slice->m_sps->numCuInWidth;
-    const uint32_t lineStartCUAddr = row * numCols;
-
     /* Generate integral planes for SEA motion search */
     if(m_param->searchMethod == X265_SEA)
         computeMEIntegral(row);
+    /* Interpolate cached half-pel planes before references may read them */
+    if (m_frame->m_encData->m_hpelPlane[0])
+        computeHpelPlanes(row);
     // Notify other FrameEncoders that this row of reconstructed pixels is available
     m_frame->m_reconRowFlag[row].set(1);
+    if (m_param->bSubFrameOutput)
+        m_frameEncoder->m_rowOutputEvent.trigger();
+
+    /* PSNR, SSIM and the picture hash of the row are left to a deferred job */
+    if (m_param->bEnablePsnr || m_param->bEnableSsim || (m_param->decodedPictureHashSEI && m_param->maxSlices == 1))
+        m_frameEncoder->m_rowMetrics.rowFiltered(row);
+
+    if (ATOMIC_INC(&m_frameEncoder->m_completionCount) == 2 * (int)m_frameEncoder->m_numRows)
+    {
+        m_frameEncoder->m_completionEvent.trigger();
+    }
+}
+
+/* PSNR and SSIM of a reconstructed CTU row, run by the frame encoder's
+ * RowMetrics job in row order, one row at a time */
+void FrameFilter::measureRow(int row)
+{
+    PicYuv *reconPic = m_frame->m_reconPic;
+    const uint32_t numCols = m_frame->m_encData->m_slice->m_sps->numCuInWidth;
+    const uint32_t lineStartCUAddr = row * numCols;
 
     uint32_t cuAddr = lineStartCUAddr;
     if (m_param->bEnablePsnr)
     {
         PicYuv* fencPic = m_frame->m_fencPic;
+        double* ctuPsnr = m_frameEncoder->m_ctuPsnr;
 
-        intptr_t stride = reconPic->m_stride;
-        uint32_t width  = reconPic->m_picWidth - m_pad[0];
-        uint32_t height = m_parallelFilter[row].getCUHeight();
+        const uint32_t picWidth = reconPic->m_picWidth - m_pad[0];
+        const uint32_t height = m_parallelFilter[row].getCUHeight();
 
-        uint64_t ssdY = m_frameEncoder->m_top->computeSSD(fencPic->getLumaAddr(cuAddr), reconPic->getLumaAddr(cuAddr), stride, width, height, m_param);
-        m_frameEncoder->m_SSDY += ssdY;
-
-        if (m_param->internalCsp != X265_CSP_I400)
+        /* with --ctu-metrics the row is measured a CTU at a time, the sums of
+         * squared errors of the row are the same */
+        const uint32_t numCTUs = ctuPsnr ? numCols : 1;
+        for (uint32_t col = 0; col < numCTUs; col++)
         {
-            height >>= m_vChromaShift;
-            width >>= m_hChromaShift;
-            stride = reconPic->m_strideC;
+            uint32_t x = ctuPsnr ? col * m_param->maxCUSize : 0;
+            uint32_t width = ctuPsnr ? X265_MIN(m_param->maxCUSize, picWidth - x) : picWidth;
+            intptr_t stride = reconPic->m_stride;
+
+            uint64_t ssdY = m_frameEncoder->m_top->computeSSD(fencPic->getLumaAddr(cuAddr + col), reconPic->getLumaAddr(cuAddr + col), stride, width, height, m_param);
+            uint64_t ssdU = 0, ssdV = 0;
+            uint32_t widthC = 0, heightC = 0;
+            m_frameEncoder->m_SSDY += ssdY;
+
+            if (m_param->internalCsp != X265_CSP_I400)
+            {
+                heightC = height >> m_vChromaShift;
+                widthC = ((x + width) >> m_hChromaShift) - (x >> m_hChromaShift);
+                stride = reconPic->m_strideC;
+
+                ssdU = m_frameEncoder->m_top->computeSSD(fencPic->getCbAddr(cuAddr + col), reconPic->getCbAddr(cuAddr + col), stride, widthC, heightC, m_param);
+                ssdV = m_frameEncoder->m_top->computeSSD(fencPic->getCrAddr(cuAddr + col), reconPic->getCrAddr(cuAddr + col), stride, widthC, heightC, m_param);
 
-            uint64_t ssdU = m_frameEncoder->m_top->computeSSD(fencPic->getCbAddr(cuAddr), reconPic->getCbAddr(cuAddr), stride, width, height, m_param);
-            uint64_t ssdV = m_frameEncoder->m_top->computeSSD(fencPic->getCrAddr(cuAddr), reconPic->getCrAddr(cuAddr), stride, width, height, m_param);
+                m_frameEncoder->m_SSDU += ssdU;
+                m_frameEncoder->m_SSDV += ssdV;
+            }
 
-            m_frameEncoder->m_SSDU += ssdU;
-            m_frameEncoder->m_SSDV += ssdV;
+            if (ctuPsnr)
+            {
+                double maxval = 255 << (X265_DEPTH - 8);
+                double psnrY = ssdY ? 10.0 * log10(maxval * maxval * width * height / (double)ssdY) : 99.99;
+                double psnrU = ssdU ? 10.0 * log10(maxval * maxval * widthC * heightC / (double)ssdU) : 99.99;
+                double psnrV = ssdV ? 10.0 * log10(maxval * maxval * widthC * heightC / (double)ssdV) : 99.99;
+                ctuPsnr[cuAddr + col] = (psnrY * 6 + psnrU + psnrV) / 8;
+            }
         }
     }
 
@@ -705,20 +746,59 @@ void FrameFilter::processPostRow(int row)
         /* SSIM is done for each row in blocks of 4x4 . The First blocks are offset by 2 pixels to the right
         * to avoid alignment of ssim blocks with DCT blocks. */
         minPixY += bStart ? 2 : -6;
+        double* ctuSsim = m_frameEncoder->m_ctuSsim ? m_frameEncoder->m_ctuSsim + cuAddr : NULL;
+        const uint32_t ctuBlocks = m_param->maxCUSize >> 2;
+        if (ctuSsim)
+            memset(ctuSsim, 0, sizeof(double) * numCols);
         m_frameEncoder->m_ssim += calculateSSIM(rec + 2 + minPixY * stride1, stride1, fenc + 2 + minPixY * stride2, stride2,
-                                                m_param->sourceWidth - 2, maxPixY - minPixY, m_ssimBuf, ssim_cnt);
+                                                m_param->sourceWidth - 2, maxPixY - minPixY, m_ssimBuf, ssim_cnt, ctuSsim, ctuBlocks);
         m_frameEncoder->m_ssimCnt += ssim_cnt;
+
+        if (ctuSsim)
+        {
+            /* the CTUs average the windows whose first 4x4 block they hold */
+            const uint32_t windows = ((m_param->sourceWidth - 2) >> 2) - 1;
+            const uint32_t windowRows = ((maxPixY - minPixY) >> 2) - 1;
+            for (uint32_t col = 0; col < numCols; col++)
+            {
+                uint32_t first = col * ctuBlocks;
+                uint32_t cnt = first < windows ? (X265_MIN(first + ctuBlocks, windows) - first) * windowRows : 0;
+                ctuSsim[col] = cnt ? ctuSsim[col] / cnt : 1.0;
+            }
+        }
     }
 
-    if (m_param->maxSlices == 1)
-    {
-        uint32_t height = m_parallelFilter[row].getCUHeight();
-        m_frameEncoder->initDecodedPictureHashSEI(row, cuAddr, height);
-    } // end of (m_param->maxSlices == 1)
+}
 
-    if (ATOMIC_INC(&m_frameEncoder->m_completionCount) == 2 * (int)m_frameEncoder->m_numRows)
+/* Fill the lines of the half-pel planes whose filter taps are now final: the
+ * bottom lines of this row need the next row's pixels, so each row covers
+ * [row * cuHeight - 4, (row + 1) * cuHeight - 4) and the first and last rows
+ * extend into the padding. The 8x4 filters give the same pixels as the
+ * per-PU interpolation in MotionEstimate::subpelCompare() */
+void FrameFilter::computeHpelPlanes(int row)
+{
+    PicYuv* reconPic = m_frame->m_reconPic;
+    pixel* const* hpel = m_frame->m_encData->m_hpelPlane;
+    const intptr_t stride = reconPic->m_stride;
+    const int cuHeight = m_param->maxCUSize;
+    const int marginX = reconPic->m_lumaMarginX - HPEL_CACHE_BORDER_X;
+    const int marginY = reconPic->m_lumaMarginY - HPEL_CACHE_BORDER_Y;
+    const int width = reconPic->m_picWidth + 2 * marginX;
+
+    int startY = row ? row * cuHeight - NTAPS_LUMA / 2 : -marginY;
+    int endY = row == m_numRows - 1 ? (int)reconPic->m_picHeight + marginY : (row + 1) * cuHeight - NTAPS_LUMA / 2;
+
+    for (int y = startY; y < endY; y += 4)
     {
-        m_frameEncoder->m_completionEvent.trigger();
+        intptr_t offset = y * stride - marginX;
+        const pixel* src = reconPic->m_picOrg[0] + offset;
+
+        for (int x = 0; x < width; x += 8)
+        {
+            primitives.pu[LUMA_8x4].luma_hpp(src + x, stride, hpel[0] + offset + x, stride, 2);
+            primitives.pu[LUMA_8x4].luma_vpp(src + x, stride, hpel[1] + offset + x, stride, 2);
+            primitives.pu[LUMA_8x4].luma_hvpp(src + x, stride, hpel[2] + offset + x, stride, 2, 2);
+        }
     }
 }
 
@@ -825,7 +905,10 @@ void FrameFilter::computeMEIntegral(int row)
 }
 
 /* Function to calculate SSIM for each row */
-static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, uint32_t width, uint32_t height, void *buf, uint32_t& cnt)
+/* with ctuSsim, the sum of the SSIM windows is also accumulated per CTU of
+ * ctuBlocks 4x4 block columns, a multiple of the four windows per ssim_end_4 */
+static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t stride2, uint32_t width, uint32_t height, void *buf, uint32_t& cnt,
+                           double *ctuSsim, uint32_t ctuBlocks)
 {
     uint32_t z = 0;
     float ssim = 0.0;
@@ -845,7 +928,12 @@ static float calculateSSIM(pixel *pix1, intptr_t stride1, pixel *pix2, intptr_t
         }
 
         for (uint32_t x = 0; x < width - 1; x += 4)
-            ssim += primitives.ssim_end_4(sum0 + x, sum1 + x, X265_MIN(4, width - x - 1));
+        {
+            float s = primitives.ssim_end_4(sum0 + x, sum1 + x, X265_MIN(4, width - x - 1));
+            ssim += s;
+            if (ctuSsim)
+                ctuSsim[x / ctuBlocks] += s;
+        }
     }
 
     cnt = (height - 1) * (width - 1);
@@ -130,7 +130,9 @@ public:
 
     void processRow(int row);
     void processPostRow(int row);
+    void measureRow(int row);
     void computeMEIntegral(int row);
+    void computeHpelPlanes(int row);
 };
 }
 
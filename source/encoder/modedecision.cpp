@@ -0,0 +1,255 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "slice.h"
+#include "modedecision.h"
+
+using namespace X265_NS;
+
+/* Model file grammar, whitespace separated, '#' comments to end of line:
+ *
+ *   <split|rect> <sa8d|rd> <depth> linear <threshold> <bias> <w0> .. <w5>
+ *   <split|rect> <sa8d|rd> <depth> tree <threshold> <nodes> { <feature> <value> <left> <right> } * nodes
+ *
+ * Weights and tree features follow the Feature enum. A tree starts at node 0;
+ * an inner node goes to left when features[feature] < value, else to right,
+ * both of which must be later nodes. A leaf has feature -1 and value as its
+ * score, its child fields are ignored. Entries of the other cost type are
+ * parsed and dropped. */
+
+namespace {
+
+const char* const decisionNames[] = { "split", "rect" };
+const char* const costNames[] = { "sa8d", "rd" };
+
+/* index of token in names, or count when it is none of them */
+int findName(const char* token, const char* const* names, int count)
+{
+    int i = 0;
+    while (i < count && strcmp(token, names[i]))
+        i++;
+    return i;
+}
+
+/* next token of the model file, skipping comments */
+bool readToken(FILE* fp, char* token, int size)
+{
+    int c;
+    for (;;)
+    {
+        c = fgetc(fp);
+        if (c == '#')
+        {
+            while (c != EOF && c != '\n')
+                c = fgetc(fp);
+        }
+        if (c == EOF)
+            return false;
+        if (!isspace(c))
+            break;
+    }
+
+    int len = 0;
+    while (c != EOF && !isspace(c) && c != '#')
+    {
+        if (len < size - 1)
+            token[len++] = (char)c;
+        c = fgetc(fp);
+    }
+    if (c == '#')
+        ungetc(c, fp);
+    token[len] = 0;
+    return true;
+}
+
+bool readDouble(FILE* fp, double& value)
+{
+    char token[64], *end;
+    if (!readToken(fp, token, sizeof(token)))
+        return false;
+    value = strtod(token, &end);
+    return end != token && !*end;
+}
+
+bool readInt(FILE* fp, int& value)
+{
+    char token[64], *end;
+    if (!readToken(fp, token, sizeof(token)))
+        return false;
+    value = (int)strtol(token, &end, 10);
+    return end != token && !*end;
+}
+
+}
+
+ModeDecisionModel::ModeDecisionModel()
+{
+    memset(m_entries, 0, sizeof(m_entries));
+    m_bLoaded = false;
+    m_statsFile = NULL;
+    m_statsRdLevel = 0;
+}
+
+void ModeDecisionModel::destroy()
+{
+    for (int d = 0; d < MD_DECISIONS; d++)
+    {
+        for (int depth = 0; depth < NUM_CU_DEPTH; depth++)
+        {
+            delete [] m_entries[d][depth].nodes;
+            m_entries[d][depth].nodes = NULL;
+            m_entries[d][depth].type = ENTRY_NONE;
+        }
+    }
+    m_bLoaded = false;
+
+    if (m_statsFile)
+    {
+        fclose(m_statsFile);
+        m_statsFile = NULL;
+    }
+}
+
+bool ModeDecisionModel::load(const char* filename, const x265_param* param)
+{
+    FILE* fp = x265_fopen(filename, "r");
+    if (!fp)
+    {
+        x265_log_file(param, X265_LOG_ERROR, "md-model: unable to open %s\n", filename);
+        return false;
+    }
+
+    const int encoderCost = costType(param->rdLevel);
+    char token[64];
+    int numEntries = 0;
+    Entry other;
+    memset(&other, 0, sizeof(other));
+    bool ok = true;
+    while (ok && readToken(fp, token, sizeof(token)))
+    {
+        int decision = findName(token, decisionNames, MD_DECISIONS);
+        int cost = MD_COST_TYPES;
+        if (decision < MD_DECISIONS && readToken(fp, token, sizeof(token)))
+            cost = findName(token, costNames, MD_COST_TYPES);
+        int depth;
+        ok = cost < MD_COST_TYPES && readInt(fp, depth) && depth >= 0 && depth < NUM_CU_DEPTH;
+        if (!ok)
+            break;
+
+        Entry& e = cost == encoderCost ? m_entries[decision][depth] : other;
+        delete [] e.nodes;
+        memset(&e, 0, sizeof(e));
+        ok = readToken(fp, token, sizeof(token)) && readDouble(fp, e.threshold);
+        if (!ok)
+            break;
+
+        if (!strcmp(token, "linear"))
+        {
+            e.type = ENTRY_LINEAR;
+            ok = readDouble(fp, e.bias);
+            for (int f = 0; ok && f < MDF_FEATURES; f++)
+                ok = readDouble(fp, e.weight[f]);
+        }
+        else if (!strcmp(token, "tree"))
+        {
+            e.type = ENTRY_TREE;
+            ok = readInt(fp, e.numNodes) && e.numNodes > 0 && e.numNodes <= MAX_TREE_NODES;
+            if (ok)
+                e.nodes = new TreeNode[e.numNodes];
+            for (int i = 0; ok && i < e.numNodes; i++)
+            {
+                TreeNode& n = e.nodes[i];
+                ok = readInt(fp, n.feature) && readDouble(fp, n.value) && readInt(fp, n.child[0]) && readInt(fp, n.child[1]);
+                if (ok && n.feature >= 0)
+                    ok = n.feature < MDF_FEATURES &&
+                         n.child[0] > i && n.child[0] < e.numNodes &&
+                         n.child[1] > i && n.child[1] < e.numNodes;
+                else if (ok)
+                    ok = n.feature == -1;
+            }
+        }
+        else
+            ok = false;
+        numEntries += cost == encoderCost;
+    }
+    fclose(fp);
+    delete [] other.nodes;
+
+    if (!ok)
+    {
+        x265_log_file(param, X265_LOG_ERROR, "md-model: malformed entry in %s\n", filename);
+        destroy();
+        return false;
+    }
+    if (!numEntries)
+    {
+        x265_log_file(param, X265_LOG_ERROR, "md-model: no %s cost entries for --rd %d in %s\n",
+                      costNames[encoderCost], param->rdLevel, filename);
+        destroy();
+        return false;
+    }
+
+    m_bLoaded = true;
+    return true;
+}
+
+bool ModeDecisionModel::openStats(const char* filename, const x265_param* param)
+{
+    m_statsFile = x265_fopen(filename, "w");
+    if (!m_statsFile)
+    {
+        x265_log_file(param, X265_LOG_ERROR, "md-stats: unable to open %s\n", filename);
+        return false;
+    }
+    m_statsRdLevel = param->rdLevel;
+    fprintf(m_statsFile, "poc,slicetype,rd,depth,cansplit,variance,neighbour,lowrescost,qp,bestcost,skip,split,rect\n");
+    return true;
+}
+
+double ModeDecisionModel::score(const Entry& e, const double* features)
+{
+    if (e.type == ENTRY_LINEAR)
+    {
+        double s = e.bias;
+        for (int f = 0; f < MDF_FEATURES; f++)
+            s += e.weight[f] * features[f];
+        return s;
+    }
+
+    /* children always follow their parent, so the walk terminates */
+    int i = 0;
+    while (e.nodes[i].feature >= 0)
+        i = e.nodes[i].child[features[e.nodes[i].feature] >= e.nodes[i].value];
+    return e.nodes[i].value;
+}
+
+void ModeDecisionModel::writeStats(int poc, int sliceType, uint32_t depth, bool bCanSplit, const double* features, bool bSplit, bool bRect)
+{
+    char line[256];
+    int len = snprintf(line, sizeof(line), "%d,%c,%d,%u,%d", poc, sliceType == B_SLICE ? 'B' : 'P', m_statsRdLevel, depth, bCanSplit);
+    for (int f = 0; f < MDF_FEATURES; f++)
+        len += snprintf(line + len, sizeof(line) - len, ",%.4f", features[f]);
+    snprintf(line + len, sizeof(line) - len, ",%d,%d\n", bSplit, bRect);
+
+    ScopedLock _lock(m_statsLock);
+    fputs(line, m_statsFile);
+}
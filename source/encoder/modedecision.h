@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_MODEDECISION_H
+#define X265_MODEDECISION_H
+
+#include "common.h"
+#include "threading.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Early-termination model for inter mode decision (--md-model). For each
+ * decision and CU depth the model file holds either a linear classifier or a
+ * small binary decision tree over a few cheap CU features. The model scores
+ * how likely evaluating the split or the rect/AMP partitions is to pay off;
+ * analysis skips them when the score is below the entry's threshold, so the
+ * thresholds trade speed against quality. Decisions without an entry are
+ * always evaluated. The same features, with the partitioning the encoder
+ * finally chose, are written as CSV by --md-stats for offline training.
+ *
+ * The best cost feature is an sa8d cost at rd levels 0-4 and an RD cost at
+ * rd levels 5 and 6, which are not on the same scale; every model entry is
+ * tagged with the cost type it was trained on and only the entries of the
+ * encoder's cost type are loaded. */
+class ModeDecisionModel
+{
+public:
+
+    enum Decision
+    {
+        MD_SPLIT,     // evaluate the four sub-CUs
+        MD_RECT,      // evaluate rect and AMP partitions
+        MD_DECISIONS
+    };
+
+    enum Feature
+    {
+        MDF_VARIANCE,    // log2(1 + luma variance per pixel)
+        MDF_NEIGHBOUR,   // mean depth of the left, above and colocated CUs minus the CU depth
+        MDF_LOWRES_COST, // log2(1 + lowres cost per 8x8 lowres block, best of intra and L0 inter)
+        MDF_QP,          // CU QP
+        MDF_BEST_COST,   // log2(1 + cost per pixel of the best mode so far, merge/skip or 2Nx2N)
+        MDF_SKIP,        // 1 when the best mode so far is skip
+        MDF_FEATURES
+    };
+
+    enum CostType
+    {
+        MD_COST_SA8D, // --rd 0 to 4
+        MD_COST_RD,   // --rd 5 and 6
+        MD_COST_TYPES
+    };
+
+    enum { MAX_TREE_NODES = 255 };
+
+    static int costType(int rdLevel) { return rdLevel >= 5 ? MD_COST_RD : MD_COST_SA8D; }
+
+    ModeDecisionModel();
+    ~ModeDecisionModel() { destroy(); }
+
+    /* load the entries of a model file for the cost type of param->rdLevel,
+     * returns false with an error logged on failure */
+    bool load(const char* filename, const x265_param* param);
+
+    /* open the CSV training data output, returns false on failure */
+    bool openStats(const char* filename, const x265_param* param);
+
+    void destroy();
+
+    bool hasModel() const { return m_bLoaded; }
+    bool hasStats() const { return !!m_statsFile; }
+
+    /* true when the decision may be skipped for a CU with these features */
+    bool skip(int decision, uint32_t depth, const double* features) const
+    {
+        const Entry& e = m_entries[decision][depth];
+        return e.type != ENTRY_NONE && score(e, features) < e.threshold;
+    }
+
+    /* append one CU decision to the training data; labels are the chosen
+     * partitioning: split, or a non-2Nx2N inter partition */
+    void writeStats(int poc, int sliceType, uint32_t depth, bool bCanSplit, const double* features, bool bSplit, bool bRect);
+
+protected:
+
+    enum EntryType { ENTRY_NONE, ENTRY_LINEAR, ENTRY_TREE };
+
+    struct TreeNode
+    {
+        int    feature; // -1 for a leaf
+        double value;   // split value, or the leaf score
+        int    child[2];
+    };
+
+    struct Entry
+    {
+        int       type;
+        double    threshold;
+        double    bias;
+        double    weight[MDF_FEATURES];
+        TreeNode* nodes;
+        int       numNodes;
+    };
+
+    Entry m_entries[MD_DECISIONS][NUM_CU_DEPTH];
+    bool  m_bLoaded;
+    FILE* m_statsFile;
+    int   m_statsRdLevel;
+    Lock  m_statsLock;
+
+    static double score(const Entry& e, const double* features);
+};
+}
+
+#endif // ifndef X265_MODEDECISION_H
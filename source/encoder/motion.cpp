@@ -111,6 +111,8 @@ MotionEstimate::MotionEstimate()
     blockOffset = 0;
     bChromaSATD = false;
     chromaSatd = NULL;
+    satd_x4 = NULL;
+    hpelPlane[0] = hpelPlane[1] = hpelPlane[2] = NULL;
     for (int i = 0; i < INTEGRAL_PLANE_NUM; i++)
         integral[i] = NULL;
 }
@@ -171,6 +173,7 @@ void MotionEstimate::setSourcePU(pixel *fencY, intptr_t stride, intptr_t offset,
     sad = primitives.pu[partEnum].sad;
     ads = primitives.pu[partEnum].ads;
     satd = primitives.pu[partEnum].satd;
+    satd_x4 = primitives.pu[partEnum].satd_x4;
     sad_x3 = primitives.pu[partEnum].sad_x3;
     sad_x4 = primitives.pu[partEnum].sad_x4;
 
@@ -198,6 +201,7 @@ void MotionEstimate::setSourcePU(pixel *fencY, intptr_t stride, intptr_t offset,
     sad = primitives.pu[partEnum].sad;
     ads = primitives.pu[partEnum].ads;
     satd = primitives.pu[partEnum].satd;
+    satd_x4 = primitives.pu[partEnum].satd_x4;
     sad_x3 = primitives.pu[partEnum].sad_x3;
     sad_x4 = primitives.pu[partEnum].sad_x4;
 
@@ -223,6 +227,7 @@ void MotionEstimate::setSourcePU(const Yuv& srcFencYuv, int _ctuAddr, int cuPart
     sad = primitives.pu[partEnum].sad;
     ads = primitives.pu[partEnum].ads;
     satd = primitives.pu[partEnum].satd;
+    satd_x4 = primitives.pu[partEnum].satd_x4;
     sad_x3 = primitives.pu[partEnum].sad_x3;
     sad_x4 = primitives.pu[partEnum].sad_x4;
 
@@ -240,6 +245,7 @@ void MotionEstimate::setSourcePU(const Yuv& srcFencYuv, int _ctuAddr, int cuPart
     ctuAddr = _ctuAddr;
     absPartIdx = cuPartIdx + puPartIdx;
     blockwidth = pwidth;
+    blockheight = pheight;
     blockOffset = 0;
 
     /* copy PU from CU Yuv */
@@ -628,15 +634,16 @@ void MotionEstimate::StarPatternSearch(ReferencePlanes *ref,
     }
 }
 
-void MotionEstimate::refineMV(ReferencePlanes* ref,
-                              const MV&        mvmin,
-                              const MV&        mvmax,
-                              const MV&        qmvp,
-                              MV&              outQMv)
+int MotionEstimate::refineMV(ReferencePlanes* ref,
+                             const MV&        mvmin,
+                             const MV&        mvmax,
+                             const MV&        qmvp,
+                             MV&              outQMv)
 {
     ALIGN_VAR_16(int, costs[16]);
     if (ctuAddr >= 0)
         blockOffset = ref->reconPic->getLumaAddr(ctuAddr, absPartIdx) - ref->reconPic->getLumaAddr(0);
+    setHpelCache(ref);
     intptr_t stride = ref->lumaStride;
     pixel* fenc = fencPUYuv.m_buf[0];
     pixel* fref = ref->fpelPlane[0] + blockOffset;
@@ -698,30 +705,12 @@ void MotionEstimate::refineMV(ReferencePlanes* ref,
     // const SubpelWorkload& wl = workload[this->subpelRefine];
     const SubpelWorkload& wl = workload[5];
 
-    pixelcmp_t hpelcomp;
-
     if (wl.hpel_satd)
-    {
         bcost = subpelCompare(ref, bmv, satd) + mvcost(bmv);
-        hpelcomp = satd;
-    }
-    else
-        hpelcomp = sad;
 
     for (int iter = 0; iter < wl.hpel_iters; iter++)
     {
-        int bdir = 0;
-        for (int i = 1; i <= wl.hpel_dirs; i++)
-        {
-            MV qmv = bmv + square1[i] * 2;            
-
-            // check mv range for slice bound
-            if ((qmv.y < qmvmin.y) | (qmv.y > qmvmax.y))
-                continue;
-
-            int cost = subpelCompare(ref, qmv, hpelcomp) + mvcost(qmv);
-            COPY2_IF_LT(bcost, cost, bdir, i);
-        }
+        int bdir = subpelRefineDirs(ref, bmv, 2, wl.hpel_dirs, qmvmin, qmvmax, wl.hpel_satd, bcost);
 
         if (bdir)
             bmv += square1[bdir] * 2;            
@@ -735,18 +724,7 @@ void MotionEstimate::refineMV(ReferencePlanes* ref,
 
     for (int iter = 0; iter < wl.qpel_iters; iter++)
     {
-        int bdir = 0;
-        for (int i = 1; i <= wl.qpel_dirs; i++)
-        {
-            MV qmv = bmv + square1[i];
-            
-            // check mv range for slice bound
-            if ((qmv.y < qmvmin.y) | (qmv.y > qmvmax.y))
-                continue;
-
-            int cost = subpelCompare(ref, qmv, satd) + mvcost(qmv);
-            COPY2_IF_LT(bcost, cost, bdir, i);
-        }
+        int bdir = subpelRefineDirs(ref, bmv, 1, wl.qpel_dirs, qmvmin, qmvmax, true, bcost);
 
         if (bdir)
             bmv += square1[bdir];
@@ -759,6 +737,7 @@ void MotionEstimate::refineMV(ReferencePlanes* ref,
     
     x265_emms();
     outQMv = bmv;
+    return bcost;
 }
 
 int MotionEstimate::motionEstimate(ReferencePlanes *ref,
@@ -776,6 +755,7 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
     bool hme = srcReferencePlane && srcReferencePlane == ref->fpelLowerResPlane[0];
     if (ctuAddr >= 0)
         blockOffset = ref->reconPic->getLumaAddr(ctuAddr, absPartIdx) - ref->reconPic->getLumaAddr(0);
+    setHpelCache(ref);
     intptr_t stride = hme ? ref->lumaStride / 2 : ref->lumaStride;
     pixel* fenc = fencPUYuv.m_buf[0];
     pixel* fref = srcReferencePlane == 0 ? ref->fpelPlane[0] + blockOffset : srcReferencePlane + blockOffset;
@@ -1528,30 +1508,12 @@ me_hex2:
     }
     else
     {
-        pixelcmp_t hpelcomp;
-
         if (wl.hpel_satd)
-        {
             bcost = subpelCompare(ref, bmv, satd) + mvcost(bmv);
-            hpelcomp = satd;
-        }
-        else
-            hpelcomp = sad;
 
         for (int iter = 0; iter < wl.hpel_iters; iter++)
         {
-            int bdir = 0;
-            for (int i = 1; i <= wl.hpel_dirs; i++)
-            {
-                MV qmv = bmv + square1[i] * 2;
-
-                // check mv range for slice bound
-                if ((qmv.y < qmvmin.y) | (qmv.y > qmvmax.y))
-                    continue;
-
-                int cost = subpelCompare(ref, qmv, hpelcomp) + mvcost(qmv);
-                COPY2_IF_LT(bcost, cost, bdir, i);
-            }
+            int bdir = subpelRefineDirs(ref, bmv, 2, wl.hpel_dirs, qmvmin, qmvmax, wl.hpel_satd, bcost);
 
             if (bdir)
                 bmv += square1[bdir] * 2;
@@ -1565,18 +1527,7 @@ me_hex2:
 
         for (int iter = 0; iter < wl.qpel_iters; iter++)
         {
-            int bdir = 0;
-            for (int i = 1; i <= wl.qpel_dirs; i++)
-            {
-                MV qmv = bmv + square1[i];
-
-                // check mv range for slice bound
-                if ((qmv.y < qmvmin.y) | (qmv.y > qmvmax.y))
-                    continue;
-
-                int cost = subpelCompare(ref, qmv, satd) + mvcost(qmv);
-                COPY2_IF_LT(bcost, cost, bdir, i);
-            }
+            int bdir = subpelRefineDirs(ref, bmv, 1, wl.qpel_dirs, qmvmin, qmvmax, true, bcost);
 
             if (bdir)
                 bmv += square1[bdir];
@@ -1593,97 +1544,195 @@ me_hex2:
     return bcost;
 }
 
-int MotionEstimate::subpelCompare(ReferencePlanes *ref, const MV& qmv, pixelcmp_t cmp)
+void MotionEstimate::setHpelCache(ReferencePlanes* ref)
+{
+    if (!ref->hpelPlane[0] || ctuAddr < 0)
+    {
+        hpelPlane[0] = NULL;
+        return;
+    }
+
+    intptr_t refStride = ref->lumaStride;
+    int blockX = (int)(blockOffset % refStride);
+    int blockY = (int)(blockOffset / refStride);
+    int marginX = ref->reconPic->m_lumaMarginX - HPEL_CACHE_BORDER_X;
+    int marginY = ref->reconPic->m_lumaMarginY - HPEL_CACHE_BORDER_Y;
+
+    for (int i = 0; i < 3; i++)
+        hpelPlane[i] = ref->hpelPlane[i];
+    hpelMin = MV(-marginX - blockX, -marginY - blockY);
+    hpelMax = MV((int)ref->reconPic->m_picWidth + marginX - blockwidth - blockX,
+                 (int)ref->reconPic->m_picHeight + marginY - blockheight - blockY);
+}
+
+/* Returns the luma prediction of the PU at qmv: full-pel and cached half-pel
+ * positions point directly into the reference planes, others are
+ * interpolated into buf */
+const pixel* MotionEstimate::subpelLumaPred(ReferencePlanes* ref, const MV& qmv, pixel* buf, intptr_t& predStride)
 {
     intptr_t refStride = ref->lumaStride;
-    const pixel* fref = ref->fpelPlane[0] + blockOffset + (qmv.x >> 2) + (qmv.y >> 2) * refStride;
+    MV fmv = qmv >> 2;
+    intptr_t offset = blockOffset + fmv.x + fmv.y * refStride;
     int xFrac = qmv.x & 0x3;
     int yFrac = qmv.y & 0x3;
-    int cost;
-    const intptr_t fencStride = FENC_STRIDE;
-    X265_CHECK(fencPUYuv.m_size == FENC_STRIDE, "fenc buffer is assumed to have FENC_STRIDE by sad_x3 and sad_x4\n");
 
+    predStride = refStride;
+    if (!(yFrac | xFrac))
+        return ref->fpelPlane[0] + offset;
+
+    if (hpelPlane[0] && !((xFrac | yFrac) & 1) && fmv.checkRange(hpelMin, hpelMax))
+        return hpelPlane[(xFrac >> 1) + yFrac - 1] + offset;
+
+    /* we are taking a short-cut here if the reference is weighted. To be
+     * accurate we should be interpolating unweighted pixels and weighting
+     * the final 16bit values prior to rounding and down shifting. Instead we
+     * are simply interpolating the weighted full-pel pixels. Not 100%
+     * accurate but good enough for fast qpel ME */
+    const pixel* fref = ref->fpelPlane[0] + offset;
+    if (!yFrac)
+        primitives.pu[partEnum].luma_hpp(fref, refStride, buf, blockwidth, xFrac);
+    else if (!xFrac)
+        primitives.pu[partEnum].luma_vpp(fref, refStride, buf, blockwidth, yFrac);
+    else
+        primitives.pu[partEnum].luma_hvpp(fref, refStride, buf, blockwidth, xFrac, yFrac);
+
+    predStride = blockwidth;
+    return buf;
+}
+
+int MotionEstimate::subpelChromaCost(ReferencePlanes* ref, const MV& qmv)
+{
     ALIGN_VAR_32(pixel, subpelbuf[MAX_CU_SIZE * MAX_CU_SIZE]);
-    
+    int cost = 0;
+    int csp    = fencPUYuv.m_csp;
+    int hshift = fencPUYuv.m_hChromaShift;
+    int vshift = fencPUYuv.m_vChromaShift;
+    int mvx = qmv.x << (1 - hshift);
+    int mvy = qmv.y << (1 - vshift);
+    intptr_t fencStrideC = fencPUYuv.m_csize;
+
+    intptr_t refStrideC = ref->reconPic->m_strideC;
+    intptr_t refOffset = (mvx >> 3) + (mvy >> 3) * refStrideC;
+
+    const pixel* refCb = ref->getCbAddr(ctuAddr, absPartIdx) + refOffset;
+    const pixel* refCr = ref->getCrAddr(ctuAddr, absPartIdx) + refOffset;
+
+    X265_CHECK((hshift == 0) || (hshift == 1), "hshift must be 0 or 1\n");
+    X265_CHECK((vshift == 0) || (vshift == 1), "vshift must be 0 or 1\n");
+
+    int xFrac = mvx & 7;
+    int yFrac = mvy & 7;
+
     if (!(yFrac | xFrac))
-        cost = cmp(fencPUYuv.m_buf[0], fencStride, fref, refStride);
+    {
+        cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, refCb, refStrideC);
+        cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, refCr, refStrideC);
+    }
     else
     {
-        /* we are taking a short-cut here if the reference is weighted. To be
-         * accurate we should be interpolating unweighted pixels and weighting
-         * the final 16bit values prior to rounding and down shifting. Instead we
-         * are simply interpolating the weighted full-pel pixels. Not 100%
-         * accurate but good enough for fast qpel ME */
+        int blockwidthC = blockwidth >> hshift;
+
         if (!yFrac)
-            primitives.pu[partEnum].luma_hpp(fref, refStride, subpelbuf, blockwidth, xFrac);
+        {
+            primitives.chroma[csp].pu[partEnum].filter_hpp(refCb, refStrideC, subpelbuf, blockwidthC, xFrac);
+            cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, subpelbuf, blockwidthC);
+
+            primitives.chroma[csp].pu[partEnum].filter_hpp(refCr, refStrideC, subpelbuf, blockwidthC, xFrac);
+            cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, subpelbuf, blockwidthC);
+        }
         else if (!xFrac)
-            primitives.pu[partEnum].luma_vpp(fref, refStride, subpelbuf, blockwidth, yFrac);
+        {
+            primitives.chroma[csp].pu[partEnum].filter_vpp(refCb, refStrideC, subpelbuf, blockwidthC, yFrac);
+            cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, subpelbuf, blockwidthC);
+
+            primitives.chroma[csp].pu[partEnum].filter_vpp(refCr, refStrideC, subpelbuf, blockwidthC, yFrac);
+            cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, subpelbuf, blockwidthC);
+        }
         else
-            primitives.pu[partEnum].luma_hvpp(fref, refStride, subpelbuf, blockwidth, xFrac, yFrac);
-        cost = cmp(fencPUYuv.m_buf[0], fencStride, subpelbuf, blockwidth);
+        {
+            ALIGN_VAR_32(int16_t, immed[MAX_CU_SIZE * (MAX_CU_SIZE + NTAPS_LUMA - 1)]);
+            const int halfFilterSize = (NTAPS_CHROMA >> 1);
+
+            primitives.chroma[csp].pu[partEnum].filter_hps(refCb, refStrideC, immed, blockwidthC, xFrac, 1);
+            primitives.chroma[csp].pu[partEnum].filter_vsp(immed + (halfFilterSize - 1) * blockwidthC, blockwidthC, subpelbuf, blockwidthC, yFrac);
+            cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, subpelbuf, blockwidthC);
+
+            primitives.chroma[csp].pu[partEnum].filter_hps(refCr, refStrideC, immed, blockwidthC, xFrac, 1);
+            primitives.chroma[csp].pu[partEnum].filter_vsp(immed + (halfFilterSize - 1) * blockwidthC, blockwidthC, subpelbuf, blockwidthC, yFrac);
+            cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, subpelbuf, blockwidthC);
+        }
     }
 
-    if (bChromaSATD)
-    {
-        int csp    = fencPUYuv.m_csp;
-        int hshift = fencPUYuv.m_hChromaShift;
-        int vshift = fencPUYuv.m_vChromaShift;
-        int mvx = qmv.x << (1 - hshift);
-        int mvy = qmv.y << (1 - vshift);
-        intptr_t fencStrideC = fencPUYuv.m_csize;
+    return cost;
+}
 
-        intptr_t refStrideC = ref->reconPic->m_strideC;
-        intptr_t refOffset = (mvx >> 3) + (mvy >> 3) * refStrideC;
+int MotionEstimate::subpelCompare(ReferencePlanes *ref, const MV& qmv, pixelcmp_t cmp)
+{
+    X265_CHECK(fencPUYuv.m_size == FENC_STRIDE, "fenc buffer is assumed to have FENC_STRIDE by sad_x3 and sad_x4\n");
 
-        const pixel* refCb = ref->getCbAddr(ctuAddr, absPartIdx) + refOffset;
-        const pixel* refCr = ref->getCrAddr(ctuAddr, absPartIdx) + refOffset;
+    ALIGN_VAR_32(pixel, subpelbuf[MAX_CU_SIZE * MAX_CU_SIZE]);
+    intptr_t predStride;
+    const pixel* pred = subpelLumaPred(ref, qmv, subpelbuf, predStride);
+    int cost = cmp(fencPUYuv.m_buf[0], FENC_STRIDE, pred, predStride);
 
-        X265_CHECK((hshift == 0) || (hshift == 1), "hshift must be 0 or 1\n");
-        X265_CHECK((vshift == 0) || (vshift == 1), "vshift must be 0 or 1\n");
+    if (bChromaSATD)
+        cost += subpelChromaCost(ref, qmv);
 
-        xFrac = mvx & 7;
-        yFrac = mvy & 7;
+    return cost;
+}
 
-        if (!(yFrac | xFrac))
-        {
-            cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, refCb, refStrideC);
-            cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, refCr, refStrideC);
-        }
-        else
+/* Measures the candidates bmv + square1[1..numDirs] * scale in order and
+ * returns the direction of the best one improving on bcost (0 if none). The
+ * luma predictions of four candidates are formed first and scored with one
+ * x4 call, which gives the same costs and decisions as one subpelCompare()
+ * per candidate */
+int MotionEstimate::subpelRefineDirs(ReferencePlanes* ref, const MV& bmv, int scale, int numDirs, const MV& qmvmin, const MV& qmvmax, bool bSatd, int& bcost)
+{
+    ALIGN_VAR_32(pixel, subpelbuf[4][MAX_CU_SIZE * MAX_CU_SIZE]);
+    const pixel* pred[4];
+    intptr_t predStride[4];
+    MV qmv[4];
+    int dir[4];
+    ALIGN_VAR_16(int32_t, costs[4]);
+
+    pixelcmp_t cmp = bSatd ? satd : sad;
+    pixelcmp_x4_t cmp_x4 = bSatd ? satd_x4 : sad_x4;
+    const pixel* fenc = fencPUYuv.m_buf[0];
+    int bdir = 0;
+
+    for (int i = 1; i <= numDirs;)
+    {
+        int count = 0;
+        for (; i <= numDirs && count < 4; i++)
         {
-            int blockwidthC = blockwidth >> hshift;
-
-            if (!yFrac)
-            {
-                primitives.chroma[csp].pu[partEnum].filter_hpp(refCb, refStrideC, subpelbuf, blockwidthC, xFrac);
-                cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, subpelbuf, blockwidthC);
+            MV mv = bmv + square1[i] * scale;
 
-                primitives.chroma[csp].pu[partEnum].filter_hpp(refCr, refStrideC, subpelbuf, blockwidthC, xFrac);
-                cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, subpelbuf, blockwidthC);
-            }
-            else if (!xFrac)
-            {
-                primitives.chroma[csp].pu[partEnum].filter_vpp(refCb, refStrideC, subpelbuf, blockwidthC, yFrac);
-                cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, subpelbuf, blockwidthC);
+            // check mv range for slice bound
+            if ((mv.y < qmvmin.y) | (mv.y > qmvmax.y))
+                continue;
 
-                primitives.chroma[csp].pu[partEnum].filter_vpp(refCr, refStrideC, subpelbuf, blockwidthC, yFrac);
-                cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, subpelbuf, blockwidthC);
-            }
-            else
-            {
-                ALIGN_VAR_32(int16_t, immed[MAX_CU_SIZE * (MAX_CU_SIZE + NTAPS_LUMA - 1)]);
-                const int halfFilterSize = (NTAPS_CHROMA >> 1);
+            qmv[count] = mv;
+            dir[count] = i;
+            pred[count] = subpelLumaPred(ref, mv, subpelbuf[count], predStride[count]);
+            count++;
+        }
 
-                primitives.chroma[csp].pu[partEnum].filter_hps(refCb, refStrideC, immed, blockwidthC, xFrac, 1);
-                primitives.chroma[csp].pu[partEnum].filter_vsp(immed + (halfFilterSize - 1) * blockwidthC, blockwidthC, subpelbuf, blockwidthC, yFrac);
-                cost += chromaSatd(fencPUYuv.m_buf[1], fencStrideC, subpelbuf, blockwidthC);
+        if (count == 4 && predStride[0] == predStride[1] && predStride[0] == predStride[2] && predStride[0] == predStride[3])
+            cmp_x4(fenc, pred[0], pred[1], pred[2], pred[3], predStride[0], costs);
+        else
+        {
+            for (int k = 0; k < count; k++)
+                costs[k] = cmp(fenc, FENC_STRIDE, pred[k], predStride[k]);
+        }
 
-                primitives.chroma[csp].pu[partEnum].filter_hps(refCr, refStrideC, immed, blockwidthC, xFrac, 1);
-                primitives.chroma[csp].pu[partEnum].filter_vsp(immed + (halfFilterSize - 1) * blockwidthC, blockwidthC, subpelbuf, blockwidthC, yFrac);
-                cost += chromaSatd(fencPUYuv.m_buf[2], fencStrideC, subpelbuf, blockwidthC);
-            }
+        for (int k = 0; k < count; k++)
+        {
+            int cost = costs[k] + mvcost(qmv[k]);
+            if (bChromaSATD)
+                cost += subpelChromaCost(ref, qmv[k]);
+            COPY2_IF_LT(bcost, cost, bdir, dir[k]);
         }
     }
 
-    return cost;
+    return bdir;
 }
@@ -56,8 +56,15 @@ protected:
     pixelcmp_x4_t sad_x4;
     pixelcmp_ads_t ads;
     pixelcmp_t satd;
+    pixelcmp_x4_t satd_x4;
     pixelcmp_t chromaSatd;
 
+    /* --hpel-cache planes of the reference being searched, and the full-pel
+     * MV range over which the current PU lies inside them */
+    const pixel* hpelPlane[3];
+    MV hpelMin;
+    MV hpelMax;
+
     MotionEstimate& operator =(const MotionEstimate&);
 
 public:
@@ -94,13 +101,18 @@ public:
                chromaSatd(refYuv.getCrAddr(puPartIdx), refYuv.m_csize, fencPUYuv.m_buf[2], fencPUYuv.m_csize);
     }
 
-    void refineMV(ReferencePlanes* ref, const MV& mvmin, const MV& mvmax, const MV& qmvp, MV& outQMv);
+    int  refineMV(ReferencePlanes* ref, const MV& mvmin, const MV& mvmax, const MV& qmvp, MV& outQMv);
     int motionEstimate(ReferencePlanes* ref, const MV & mvmin, const MV & mvmax, const MV & qmvp, int numCandidates, const MV * mvc, int merange, MV & outQMv, uint32_t maxSlices, pixel *srcReferencePlane = 0);
 
     int subpelCompare(ReferencePlanes* ref, const MV &qmv, pixelcmp_t);
 
 protected:
 
+    void setHpelCache(ReferencePlanes* ref);
+    const pixel* subpelLumaPred(ReferencePlanes* ref, const MV& qmv, pixel* buf, intptr_t& predStride);
+    int subpelChromaCost(ReferencePlanes* ref, const MV& qmv);
+    int subpelRefineDirs(ReferencePlanes* ref, const MV& bmv, int scale, int numDirs, const MV& qmvmin, const MV& qmvmax, bool bSatd, int& bcost);
+
     inline void StarPatternSearch(ReferencePlanes *ref,
                                   const MV &       mvmin,
                                   const MV &       mvmax,
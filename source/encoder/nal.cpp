@@ -28,8 +28,74 @@
 
 using namespace X265_NS;
 
+namespace {
+// file private namespace
+
+/* returns the index of the first zero byte in src[i..size), or size. Tests
+ * eight bytes at a time, entropy coded data rarely contains zero bytes */
+inline uint32_t findZeroByte(const uint8_t* src, uint32_t i, uint32_t size)
+{
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, src + i, sizeof(v));
+        if ((v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL)
+            break;
+    }
+
+    while (i < size && src[i])
+        i++;
+    return i;
+}
+
+}
+
+/* spans without zero bytes are copied with memcpy, only the bytes following
+ * a zero byte are tested one at a time */
+uint32_t X265_NS::escapeBytes(uint8_t* out, const uint8_t* src, uint32_t size, int& zeros)
+{
+    uint32_t bytes = 0;
+    uint32_t i = 0;
+    while (i < size)
+    {
+        if (zeros < 2)
+        {
+            uint32_t next = findZeroByte(src, i, size);
+            if (next > i)
+            {
+                memcpy(out + bytes, src + i, next - i);
+                bytes += next - i;
+                zeros = 0;
+                i = next;
+                if (i == size)
+                    break;
+            }
+
+            out[bytes++] = 0;
+            zeros++;
+            i++;
+        }
+        else
+        {
+            uint8_t b = src[i++];
+            if (b <= 0x03)
+            {
+                /* inject 0x03 to prevent emulating a start code */
+                out[bytes++] = 0x03;
+                zeros = !b;
+            }
+            else
+                zeros = 0;
+            out[bytes++] = b;
+        }
+    }
+
+    return bytes;
+}
+
 NALList::NALList()
     : m_numNal(0)
+    , m_nalAllocCount(MAX_NAL_UNITS)
     , m_buffer(NULL)
     , m_occupancy(0)
     , m_allocSize(0)
@@ -37,7 +103,14 @@ NALList::NALList()
     , m_extraOccupancy(0)
     , m_extraAllocSize(0)
     , m_annexB(true)
-{}
+{
+    m_nal = X265_MALLOC(x265_nal, m_nalAllocCount);
+    if (!m_nal)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "Unable to allocate NAL unit list\n");
+        m_nalAllocCount = 0;
+    }
+}
 
 void NALList::takeContents(NALList& other)
 {
@@ -47,9 +120,15 @@ void NALList::takeContents(NALList& other)
     m_allocSize = other.m_allocSize;
     m_occupancy = other.m_occupancy;
 
-    /* copy packet data */
+    /* swap packet arrays, so each list keeps an array large enough for
+     * the access units it has seen */
+    x265_nal* nal = m_nal;
+    uint32_t nalAllocCount = m_nalAllocCount;
+    m_nal = other.m_nal;
+    m_nalAllocCount = other.m_nalAllocCount;
     m_numNal = other.m_numNal;
-    memcpy(m_nal, other.m_nal, sizeof(x265_nal) * m_numNal);
+    other.m_nal = nal;
+    other.m_nalAllocCount = nalAllocCount;
 
     /* reset other list, re-allocate their buffer with same size */
     other.m_numNal = 0;
@@ -57,6 +136,42 @@ void NALList::takeContents(NALList& other)
     other.m_buffer = X265_MALLOC(uint8_t, m_allocSize);
 }
 
+/* grow the access unit buffer to hold at least nextSize bytes. The buffer
+ * grows geometrically so an encode settles on a size which needs no more
+ * copies, and the buffer handed out by takeContents() keeps that size */
+bool NALList::growBuffer(uint32_t nextSize)
+{
+    uint32_t allocSize = X265_MAX(nextSize, m_allocSize + (m_allocSize >> 1));
+    uint8_t *temp = X265_MALLOC(uint8_t, allocSize);
+    if (!temp)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "Unable to realloc access unit buffer\n");
+        return false;
+    }
+
+    if (m_occupancy)
+    {
+        memcpy(temp, m_buffer, m_occupancy);
+
+        /* fixup existing payload pointers */
+        for (uint32_t i = 0; i < m_numNal; i++)
+            m_nal[i].payload = temp + (m_nal[i].payload - m_buffer);
+    }
+
+    X265_FREE(m_buffer);
+    m_buffer = temp;
+    m_allocSize = allocSize;
+    return true;
+}
+
+void NALList::reserve(uint32_t payloadBytes)
+{
+    /* same worst case escaping overhead as serialize() */
+    uint32_t nextSize = m_occupancy + payloadBytes + (payloadBytes >> 1);
+    if (nextSize > m_allocSize)
+        growBuffer(nextSize);
+}
+
 void NALList::serialize(NalUnitType nalUnitType, const Bitstream& bs, uint8_t temporalID)
 {
     static const char startCodePrefix[] = { 0, 0, 0, 1 };
@@ -67,26 +182,24 @@ void NALList::serialize(NalUnitType nalUnitType, const Bitstream& bs, uint8_t te
         return;
 
     uint32_t nextSize = m_occupancy + sizeof(startCodePrefix) + 2 + payloadSize + (payloadSize >> 1) + m_extraOccupancy;
-    if (nextSize > m_allocSize)
-    {
-        uint8_t *temp = X265_MALLOC(uint8_t, nextSize);
-        if (temp)
-        {
-            memcpy(temp, m_buffer, m_occupancy);
-
-            /* fixup existing payload pointers */
-            for (uint32_t i = 0; i < m_numNal; i++)
-                m_nal[i].payload = temp + (m_nal[i].payload - m_buffer);
+    if (nextSize > m_allocSize && !growBuffer(nextSize))
+        return;
 
-            X265_FREE(m_buffer);
-            m_buffer = temp;
-            m_allocSize = nextSize;
-        }
-        else
+    if (m_numNal == m_nalAllocCount)
+    {
+        /* an empty list is one whose first allocation failed */
+        uint32_t allocCount = m_nalAllocCount ? m_nalAllocCount * 2 : MAX_NAL_UNITS;
+        x265_nal* temp = X265_MALLOC(x265_nal, allocCount);
+        if (!temp)
         {
-            x265_log(NULL, X265_LOG_ERROR, "Unable to realloc access unit buffer\n");
+            x265_log(NULL, X265_LOG_ERROR, "Unable to realloc NAL unit list\n");
             return;
         }
+        if (m_numNal)
+            memcpy(temp, m_nal, sizeof(x265_nal) * m_numNal);
+        X265_FREE(m_nal);
+        m_nal = temp;
+        m_nalAllocCount = allocCount;
     }
 
     uint8_t *out = m_buffer + m_occupancy;
@@ -121,18 +234,18 @@ void NALList::serialize(NalUnitType nalUnitType, const Bitstream& bs, uint8_t te
      * any byte-aligned position:
      *  - 0x000000
      *  - 0x000001
-     *  - 0x000002 */
-    for (uint32_t i = 0; i < payloadSize; i++)
+     *  - 0x000002
+     * The last payload byte is not tested, a trailing zero is handled below */
+    if (nalUnitType == NAL_UNIT_UNSPECIFIED)
     {
-        if (i > 2 && !out[bytes - 2] && !out[bytes - 3] && out[bytes - 1] <= 0x03 && nalUnitType != NAL_UNIT_UNSPECIFIED)
-        {
-            /* inject 0x03 to prevent emulating a start code */
-            out[bytes] = out[bytes - 1];
-            out[bytes - 1] = 0x03;
-            bytes++;
-        }
-
-        out[bytes++] = bpayload[i];
+        memcpy(out + bytes, bpayload, payloadSize);
+        bytes += payloadSize;
+    }
+    else if (payloadSize)
+    {
+        int zeros = 0; /* the NAL header ends in a non-zero temporal ID */
+        bytes += escapeBytes(out + bytes, bpayload, payloadSize - 1, zeros);
+        out[bytes++] = bpayload[payloadSize - 1];
     }
 
     X265_CHECK(bytes <= 4 + 2 + payloadSize + (payloadSize >> 1), "NAL buffer overflow\n");
@@ -163,8 +276,6 @@ void NALList::serialize(NalUnitType nalUnitType, const Bitstream& bs, uint8_t te
 
     m_occupancy += bytes;
 
-    X265_CHECK(m_numNal < (uint32_t)MAX_NAL_UNITS, "NAL count overflow\n");
-
     x265_nal& nal = m_nal[m_numNal++];
     nal.type = nalUnitType;
     nal.sizeBytes = bytes;
@@ -183,6 +294,7 @@ uint32_t NALList::serializeSubstreams(uint32_t* streamSizeBytes, uint32_t stream
 
     if (estSize > m_extraAllocSize)
     {
+        estSize = X265_MAX(estSize, m_extraAllocSize + (m_extraAllocSize >> 1));
         uint8_t *temp = X265_MALLOC(uint8_t, estSize);
         if (temp)
         {
@@ -199,6 +311,7 @@ uint32_t NALList::serializeSubstreams(uint32_t* streamSizeBytes, uint32_t stream
 
     uint32_t bytes = 0;
     uint8_t *out = m_extraBuffer;
+    int zeros = 0; /* escaping state carries over the stream boundaries */
     for (uint32_t s = 0; s < streamCount; s++)
     {
         const Bitstream& stream = streams[s];
@@ -207,18 +320,7 @@ uint32_t NALList::serializeSubstreams(uint32_t* streamSizeBytes, uint32_t stream
         uint32_t prevBufSize = bytes;
 
         if (inBytes)
-        {
-            for (uint32_t i = 0; i < inSize; i++)
-            {
-                if (bytes >= 2 && !out[bytes - 2] && !out[bytes - 1] && inBytes[i] <= 0x03)
-                {
-                    /* inject 0x03 to prevent emulating a start code */
-                    out[bytes++] = 3;
-                }
-
-                out[bytes++] = inBytes[i];
-            }
-        }
+            bytes += escapeBytes(out + bytes, inBytes, inSize, zeros);
 
         if (s < streamCount - 1)
         {
@@ -32,6 +32,11 @@ namespace X265_NS {
 
 class Bitstream;
 
+/* copy src to out, injecting 0x03 before any byte <= 0x03 which follows two
+ * zero bytes. zeros carries the count of zero bytes ending the output (up to
+ * two) from one call to the next. Returns the number of bytes written */
+uint32_t escapeBytes(uint8_t* out, const uint8_t* src, uint32_t size, int& zeros);
+
 class NALList
 {
 public:
@@ -39,8 +44,10 @@ public:
 
 public:
 
-    x265_nal    m_nal[MAX_NAL_UNITS];
+    /* grown past MAX_NAL_UNITS when every CTU row is its own slice segment */
+    x265_nal*   m_nal;
     uint32_t    m_numNal;
+    uint32_t    m_nalAllocCount;
 
     uint8_t*    m_buffer;
     uint32_t    m_occupancy;
@@ -52,13 +59,21 @@ public:
     bool        m_annexB;
 
     NALList();
-    ~NALList() { X265_FREE(m_buffer); X265_FREE(m_extraBuffer); }
+    ~NALList() { X265_FREE(m_nal); X265_FREE(m_buffer); X265_FREE(m_extraBuffer); }
 
     void takeContents(NALList& other);
 
+    /* make room for payloadBytes more bytes of NAL payload, so an access unit
+     * sized from the rate control estimate is serialized without copies */
+    void reserve(uint32_t payloadBytes);
+
     void serialize(NalUnitType nalUnitType, const Bitstream& bs, uint8_t temporalID = 1);
 
     uint32_t serializeSubstreams(uint32_t* streamSizeBytes, uint32_t streamCount, const Bitstream* streams);
+
+protected:
+
+    bool growBuffer(uint32_t nextSize);
 };
 
 }
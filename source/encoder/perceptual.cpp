@@ -0,0 +1,383 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "frame.h"
+#include "picyuv.h"
+#include "perceptual.h"
+
+using namespace X265_NS;
+
+namespace {
+
+/* scale exponents of MS-SSIM, finest scale first */
+const double msSsimWeights[MS_SSIM_SCALES] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+
+/* 2x2 average of src into a dstWidth x dstHeight plane of stride dstWidth */
+void halvePlane(pixel* dst, const pixel* src, intptr_t srcStride, int dstWidth, int dstHeight)
+{
+    for (int y = 0; y < dstHeight; y++)
+    {
+        const pixel* s0 = src + 2 * y * srcStride;
+        const pixel* s1 = s0 + srcStride;
+        for (int x = 0; x < dstWidth; x++)
+            dst[x] = (pixel)((s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2);
+        dst += dstWidth;
+    }
+}
+
+/* reflect an index across the first and last sample, as VMAF pads */
+inline int mirror(int i, int n)
+{
+    return i < 0 ? -i : i >= n ? 2 * n - 2 - i : i;
+}
+
+}
+
+MultiScaleSSIM::MultiScaleSSIM()
+{
+    m_width = m_height = 0;
+    for (int s = 0; s < MS_SSIM_SCALES; s++)
+        m_rec[s] = m_src[s] = NULL;
+    m_bands = NULL;
+    m_sums = NULL;
+    m_sumsSize = 0;
+}
+
+bool MultiScaleSSIM::create(int width, int height, int numWorkers)
+{
+    m_width = width;
+    m_height = height;
+
+    /* ssim_4x4x2_core works on pairs of 4x4 blocks, the last one may cover
+     * a few samples past the end of the last line */
+    bool ok = true;
+    for (int s = 1; s < MS_SSIM_SCALES; s++)
+    {
+        int size = (width >> s) * (height >> s) + 8;
+        m_rec[s] = X265_MALLOC(pixel, size);
+        m_src[s] = X265_MALLOC(pixel, size);
+        ok &= m_rec[s] && m_src[s];
+    }
+
+    /* the windows of a scale are on rows 1 to (height >> 2) - 1 */
+    m_jobTotal = 0;
+    for (int s = 0; s < MS_SSIM_SCALES; s++)
+    {
+        int rows = (height >> s) >> 2;
+        if (rows > 1)
+            m_jobTotal += (rows - 1 + MS_SSIM_BAND_ROWS - 1) / MS_SSIM_BAND_ROWS;
+    }
+    m_bands = X265_MALLOC(Band, X265_MAX(m_jobTotal, 1));
+    if (m_bands)
+    {
+        int b = 0;
+        for (int s = 0; s < MS_SSIM_SCALES; s++)
+        {
+            int rows = (height >> s) >> 2;
+            for (int y = 1; y < rows; y += MS_SSIM_BAND_ROWS, b++)
+            {
+                m_bands[b].scale = s;
+                m_bands[b].startRow = y;
+                m_bands[b].endRow = X265_MIN(y + MS_SSIM_BAND_ROWS, rows);
+            }
+        }
+    }
+
+    /* the master (-1) and every worker of the pool own two lines */
+    m_sumsSize = 8 * (width / 4 + 3);
+    m_sums = X265_MALLOC(int, m_sumsSize * (numWorkers + 1));
+    return ok && m_bands && m_sums;
+}
+
+void MultiScaleSSIM::destroy()
+{
+    for (int s = 0; s < MS_SSIM_SCALES; s++)
+    {
+        X265_FREE(m_rec[s]);
+        X265_FREE(m_src[s]);
+        m_rec[s] = m_src[s] = NULL;
+    }
+    X265_FREE(m_bands);
+    X265_FREE(m_sums);
+    m_bands = NULL;
+    m_sums = NULL;
+}
+
+/* luminance and contrast-structure terms of the SSIM windows of one band,
+ * with the row sums of calculateSSIM() in the frame filter */
+void MultiScaleSSIM::measureBand(Band& band, int* sums)
+{
+    const double c1 = .01 * .01 * PIXEL_MAX * PIXEL_MAX * 64;
+    const double c2 = .03 * .03 * PIXEL_MAX * PIXEL_MAX * 64 * 63;
+
+    const int s = band.scale;
+    const pixel* rec = m_recPlane[s];
+    const pixel* src = m_srcPlane[s];
+    const intptr_t recStride = m_recStride[s];
+    const intptr_t srcStride = m_srcStride[s];
+    const int width = (m_width >> s) >> 2;
+
+    int(*sum0)[4] = (int(*)[4])sums;
+    int(*sum1)[4] = sum0 + width + 3;
+
+    double lumSum = 0, csSum = 0;
+    int z = band.startRow - 1;
+    for (int y = band.startRow; y < band.endRow; y++)
+    {
+        for (; z <= y; z++)
+        {
+            std::swap(sum0, sum1);
+            for (int x = 0; x < width; x += 2)
+                primitives.ssim_4x4x2_core(&rec[4 * (x + z * recStride)], recStride, &src[4 * (x + z * srcStride)], srcStride, &sum0[x]);
+        }
+
+        for (int x = 0; x < width - 1; x++)
+        {
+            /* the sums of squares of 12bit samples only fit unsigned */
+            double s1 = sum0[x][0] + sum0[x + 1][0] + sum1[x][0] + sum1[x + 1][0];
+            double s2 = sum0[x][1] + sum0[x + 1][1] + sum1[x][1] + sum1[x + 1][1];
+            double ss = (double)((uint32_t)sum0[x][2] + (uint32_t)sum0[x + 1][2] + (uint32_t)sum1[x][2] + (uint32_t)sum1[x + 1][2]);
+            double s12 = (double)((uint32_t)sum0[x][3] + (uint32_t)sum0[x + 1][3] + (uint32_t)sum1[x][3] + (uint32_t)sum1[x + 1][3]);
+            double vars = ss * 64 - s1 * s1 - s2 * s2;
+            double covar = s12 * 64 - s1 * s2;
+            lumSum += (2 * s1 * s2 + c1) / (s1 * s1 + s2 * s2 + c1);
+            csSum += (2 * covar + c2) / (vars + c2);
+        }
+    }
+
+    band.lumSum = lumSum;
+    band.csSum = csSum;
+}
+
+void MultiScaleSSIM::processTasks(int workerThreadId)
+{
+    int* sums = m_sums + (workerThreadId + 1) * m_sumsSize;
+
+    m_lock.acquire();
+    while (m_jobAcquired < m_jobTotal)
+    {
+        int band = m_jobAcquired++;
+        m_lock.release();
+
+        measureBand(m_bands[band], sums);
+
+        m_lock.acquire();
+    }
+    m_lock.release();
+}
+
+double MultiScaleSSIM::compute(const PicYuv& rec, const PicYuv& src, JobProvider* jp)
+{
+    m_recPlane[0] = rec.m_picOrg[0];
+    m_srcPlane[0] = src.m_picOrg[0];
+    m_recStride[0] = rec.m_stride;
+    m_srcStride[0] = src.m_stride;
+    for (int s = 1; s < MS_SSIM_SCALES; s++)
+    {
+        int width = m_width >> s, height = m_height >> s;
+        halvePlane(m_rec[s], m_recPlane[s - 1], m_recStride[s - 1], width, height);
+        halvePlane(m_src[s], m_srcPlane[s - 1], m_srcStride[s - 1], width, height);
+        m_recPlane[s] = m_rec[s];
+        m_srcPlane[s] = m_src[s];
+        m_recStride[s] = m_srcStride[s] = width;
+    }
+
+    m_jobAcquired = 0;
+    if (jp && jp->m_pool && m_jobTotal > 1)
+        tryBondPeers(*jp, m_jobTotal - 1);
+    processTasks(-1);
+    waitForExit();
+    m_bondedPeerCount = 0;
+    m_exitedPeerCount.set(0);
+
+    /* the band sums are added in a fixed order, whichever thread took them */
+    double msSsim = 1;
+    int b = 0;
+    for (int s = 0; s < MS_SSIM_SCALES; s++)
+    {
+        double lumSum = 0, csSum = 0;
+        for (; b < m_jobTotal && m_bands[b].scale == s; b++)
+        {
+            lumSum += m_bands[b].lumSum;
+            csSum += m_bands[b].csSum;
+        }
+
+        int width = (m_width >> s) >> 2, height = (m_height >> s) >> 2;
+        int cnt = (height - 1) * (width - 1);
+        double lum = cnt > 0 ? lumSum / cnt : 1;
+        double cs = cnt > 0 ? csSum / cnt : 1;
+        msSsim *= pow(X265_MAX(cs, 0.0), msSsimWeights[s]);
+        if (s == MS_SSIM_SCALES - 1)
+            msSsim *= pow(X265_MAX(lum, 0.0), msSsimWeights[s]);
+    }
+
+    return msSsim;
+}
+
+MotionFeature::MotionFeature()
+{
+    m_width = m_height = 0;
+    m_blur[0] = m_blur[1] = NULL;
+    m_rowSums = NULL;
+    m_cur = 0;
+    m_bHasPrev = false;
+    m_queue = NULL;
+    m_queueSize = m_queueHead = m_queueCount = 0;
+    m_framesQueued = 0;
+    m_bActive = false;
+}
+
+bool MotionFeature::create(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_blur[0] = X265_MALLOC(uint32_t, width * height);
+    m_blur[1] = X265_MALLOC(uint32_t, width * height);
+    m_rowSums = X265_MALLOC(uint32_t, width);
+    m_queueSize = 8;
+    m_queue = X265_MALLOC(Frame*, m_queueSize);
+    return m_blur[0] && m_blur[1] && m_rowSums && m_queue;
+}
+
+void MotionFeature::destroy()
+{
+    waitForExit();
+    X265_FREE(m_blur[0]);
+    X265_FREE(m_blur[1]);
+    X265_FREE(m_rowSums);
+    X265_FREE(m_queue);
+    m_blur[0] = m_blur[1] = NULL;
+    m_rowSums = NULL;
+    m_queue = NULL;
+}
+
+void MotionFeature::addFrame(Frame& frame, ThreadPool* pool)
+{
+    m_lock.acquire();
+    if (m_queueCount == m_queueSize)
+    {
+        Frame** queue = X265_MALLOC(Frame*, 2 * m_queueSize);
+        if (queue)
+        {
+            for (int i = 0; i < m_queueCount; i++)
+                queue[i] = m_queue[(m_queueHead + i) % m_queueSize];
+            X265_FREE(m_queue);
+            m_queue = queue;
+            m_queueSize *= 2;
+            m_queueHead = 0;
+        }
+        else
+        {
+            /* the queue cannot grow, it is emptied on this thread */
+            int queued = m_framesQueued;
+            m_lock.release();
+            waitForFrames(queued);
+            m_lock.acquire();
+        }
+    }
+
+    m_queue[(m_queueHead + m_queueCount) % m_queueSize] = &frame;
+    m_queueCount++;
+    frame.m_motionFrameNum = m_framesQueued++;
+    bool bIdle = !m_bActive;
+    m_lock.release();
+
+    if (bIdle && pool)
+        tryBondPeers(*pool, 1);
+}
+
+void MotionFeature::waitForFrame(const Frame& frame)
+{
+    waitForFrames(frame.m_motionFrameNum + 1);
+}
+
+void MotionFeature::waitForFrames(int count)
+{
+    /* a bonded worker still in the loop measures the frames itself */
+    measureFrames(count);
+
+    int done = m_framesDone.get();
+    while (done < count)
+        done = m_framesDone.waitForChange(done);
+}
+
+void MotionFeature::processTasks(int /* workerThreadId */)
+{
+    measureFrames(INT_MAX);
+}
+
+void MotionFeature::measureFrames(int count)
+{
+    /* each frame is measured against the blur of the previous one, so the
+     * queue is emptied in order by one thread at a time */
+    m_lock.acquire();
+    if (m_bActive)
+    {
+        m_lock.release();
+        return;
+    }
+
+    m_bActive = true;
+    while (m_queueCount && m_framesDone.get() < count)
+    {
+        Frame* frame = m_queue[m_queueHead];
+        m_lock.release();
+
+        frame->m_vmafMotion = measure(*frame->m_fencPic);
+
+        m_lock.acquire();
+        m_queueHead = (m_queueHead + 1) % m_queueSize;
+        m_queueCount--;
+        m_framesDone.incr();
+    }
+    m_bActive = false;
+    m_lock.release();
+}
+
+double MotionFeature::measure(const PicYuv& src)
+{
+    const pixel* plane = src.m_picOrg[0];
+    const intptr_t stride = src.m_stride;
+    const int width = m_width, height = m_height;
+    uint32_t* blur = m_blur[m_cur];
+
+    for (int y = 0; y < height; y++)
+    {
+        const pixel* lines[5];
+        for (int k = 0; k < 5; k++)
+            lines[k] = plane + mirror(y + k - 2, height) * stride;
+
+        primitives.motionBlur(blur + y * width, m_rowSums, lines, width);
+    }
+
+    double motion = 0;
+    if (m_bHasPrev)
+    {
+        uint64_t sad = primitives.motionSad(blur, m_blur[m_cur ^ 1], width * height);
+        motion = (double)sad / ((double)width * height * 256 * (1 << (X265_DEPTH - 8)));
+    }
+
+    m_bHasPrev = true;
+    m_cur ^= 1;
+    return motion;
+}
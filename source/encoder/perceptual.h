@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_PERCEPTUAL_H
+#define X265_PERCEPTUAL_H
+
+#include "common.h"
+#include "threadpool.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+class Frame;
+class PicYuv;
+
+#define MS_SSIM_SCALES 5
+#define MS_SSIM_BAND_ROWS 16   // rows of SSIM windows measured by one task
+
+/* Multi-scale SSIM of the luma planes (--perceptual-metrics). The pictures
+ * are halved four times with 2x2 averages; every scale contributes the mean
+ * contrast-structure term of its SSIM windows, the coarsest one also the
+ * mean luminance term, weighted by the exponents of Wang, Simoncelli and
+ * Bovik. The windows and constants are those of the SSIM of --ssim, 8x8
+ * windows on a 4x4 grid summed by the ssim_4x4x2_core primitive. Each frame
+ * encoder owns one for its scratch planes. Once the planes are downscaled,
+ * the window rows of all scales are split in bands measured by bonded
+ * workers of the frame encoder's pool */
+class MultiScaleSSIM : public BondedTaskGroup
+{
+public:
+
+    MultiScaleSSIM();
+    ~MultiScaleSSIM() { destroy(); }
+
+    /* numWorkers is the size of the pool lending workers to compute() */
+    bool create(int width, int height, int numWorkers);
+    void destroy();
+
+    double compute(const PicYuv& rec, const PicYuv& src, JobProvider* jp);
+
+    void processTasks(int workerThreadId);
+
+protected:
+
+    struct Band
+    {
+        int    scale;
+        int    startRow;   // window rows [startRow, endRow)
+        int    endRow;
+        double lumSum;
+        double csSum;
+    };
+
+    int          m_width;
+    int          m_height;
+    pixel*       m_rec[MS_SSIM_SCALES];   // downscaled planes, [0] unused
+    pixel*       m_src[MS_SSIM_SCALES];
+    const pixel* m_recPlane[MS_SSIM_SCALES];
+    const pixel* m_srcPlane[MS_SSIM_SCALES];
+    intptr_t     m_recStride[MS_SSIM_SCALES];
+    intptr_t     m_srcStride[MS_SSIM_SCALES];
+    Band*        m_bands;
+    int*         m_sums;       // two lines of window sums per thread
+    int          m_sumsSize;
+
+    void measureBand(Band& band, int* sums);
+};
+
+/* The motion feature of VMAF (--perceptual-metrics): the mean absolute
+ * difference between the luma of a frame and of the previous input frame,
+ * both blurred by VMAF's 5-tap filter, on the 8bit sample scale. Frames are
+ * queued in display order as the encoder receives them and measured one at
+ * a time by a worker bonded from the pool, the first one has no motion. The
+ * frame encoder waits for the motion of its frame before it may filter the
+ * source picture */
+class MotionFeature : public BondedTaskGroup
+{
+public:
+
+    MotionFeature();
+    ~MotionFeature() { destroy(); }
+
+    bool create(int width, int height);
+    void destroy();
+
+    void addFrame(Frame& frame, ThreadPool* pool);
+
+    /* measures the queued frames on the calling thread if no worker is */
+    void waitForFrame(const Frame& frame);
+
+    void processTasks(int workerThreadId);
+
+protected:
+
+    int       m_width;
+    int       m_height;
+    uint32_t* m_blur[2];     // blurred luma of the current and the previous frame, 8 fraction bits
+    uint32_t* m_rowSums;     // vertically filtered line
+    int       m_cur;
+    bool      m_bHasPrev;
+
+    Frame**   m_queue;       // ring of the frames not measured yet
+    int       m_queueSize;
+    int       m_queueHead;
+    int       m_queueCount;
+    int       m_framesQueued;
+    bool      m_bActive;
+    ThreadSafeInteger m_framesDone;
+
+    void waitForFrames(int count);
+    void measureFrames(int count);
+    double measure(const PicYuv& src);
+};
+}
+
+#endif // ifndef X265_PERCEPTUAL_H
@@ -71,6 +71,102 @@ namespace {
     }\
 }
 
+/* Binary stats file (--stats-binary), in native byte order:
+ *
+ *   StatsFileHeader
+ *   first pass options string, NUL terminated, padded to 8 bytes
+ *   per frame in encode order:
+ *     StatsFrameRecord
+ *     CU-tree offsets of a referenced frame, numCUs fix8 values padded to
+ *     8 bytes, at the record's cutreeOffset
+ *   frame index, numFrames uint64 record offsets in encode order
+ *
+ * The header's frame count and index offset are filled when the writing
+ * encoder closes; a file from an interrupted pass has neither */
+const char s_statsMagic[8] = { 'x', '2', '6', '5', 'r', 'c', 'b', 0 };
+#define STATS_BINARY_VERSION 1
+
+struct StatsFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t numCUs;            // CU-tree values per block, 0 without cutree
+    uint32_t numFrames;
+    uint64_t optionsHash;
+    uint64_t indexOffset;
+};
+
+struct StatsFrameRecord
+{
+    int32_t  poc;
+    int32_t  encodeOrder;
+    int32_t  coeffBits;
+    int32_t  mvBits;
+    int32_t  miscBits;
+    int32_t  numberOfPictures;
+    int32_t  numberOfNegativePictures;
+    int32_t  numberOfPositivePictures;
+    int32_t  deltaPOC[MAX_NUM_REF_PICS];
+    uint8_t  bUsed[MAX_NUM_REF_PICS];
+    char     type;              // as the text stats type
+    uint8_t  scenecut;
+    uint8_t  cutreeType;
+    uint8_t  reserved[5];
+    double   qpRc;
+    double   qpAq;
+    double   qpNoVbv;
+    double   qRceq;
+    double   iCuCount;
+    double   pCuCount;
+    double   skipCuCount;
+    uint64_t cutreeOffset;      // 0 when the frame has no CU-tree block
+};
+
+inline uint64_t statsAlign(uint64_t size)
+{
+    return (size + 7) & ~(uint64_t)7;
+}
+
+/* FNV-1a */
+uint64_t hashStatsOptions(const char* opts)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (; *opts; opts++)
+        hash = (hash ^ (uint8_t)*opts) * 0x100000001b3ULL;
+    return hash;
+}
+
+bool isBinaryStatsFile(const char* fileName)
+{
+    char magic[sizeof(s_statsMagic)];
+    FILE* fp = x265_fopen(fileName, "rb");
+    if (!fp)
+        return false;
+    bool bBinary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && !memcmp(magic, s_statsMagic, sizeof(magic));
+    fclose(fp);
+    return bBinary;
+}
+
+bool setStatsSliceType(RateControlEntry* rce, char picType)
+{
+    rce->keptAsRef = true;
+    rce->isIdr = false;
+    if (picType == 'b' || picType == 'p')
+        rce->keptAsRef = false;
+    if (picType == 'I')
+        rce->isIdr = true;
+    if (picType == 'I' || picType == 'i')
+        rce->sliceType = I_SLICE;
+    else if (picType == 'P' || picType == 'p')
+        rce->sliceType = P_SLICE;
+    else if (picType == 'B' || picType == 'b')
+        rce->sliceType = B_SLICE;
+    else
+        return false;
+    return true;
+}
+
 inline int calcScale(uint32_t x)
 {
     static uint8_t lut[16] = {4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
@@ -244,6 +340,15 @@ RateControl::RateControl(x265_param& p, Encoder *top)
     m_lastAbrResetPoc = -1;
     m_statFileOut = NULL;
     m_cutreeStatFileOut = m_cutreeStatFileIn = NULL;
+    m_statsMap = NULL;
+    m_statsMapSize = 0;
+    m_statsIndex = NULL;
+    m_cutreeStatPos = 0;
+    m_bStatBinaryOut = false;
+    m_statsOutPos = 0;
+    m_statsOutIndex = NULL;
+    m_numStatsOut = m_maxStatsOut = 0;
+    m_cutreeStatBuf = NULL;
     m_cutreeShrMem = NULL;
     m_rce2Pass = NULL;
     m_encOrder = NULL;
@@ -500,120 +605,55 @@ bool RateControl::init(const SPS& sps)
             {
                 m_expectedBitsSum = 0;
                 char *p, *statsIn, *statsBuf;
+                int numEntries;
                 /* read 1st pass stats */
-                statsIn = statsBuf = x265_slurp_file(fileName);
-                if (!statsBuf)
-                    return false;
-                if (m_param->rc.cuTree)
+                if (isBinaryStatsFile(fileName))
                 {
-                    char *tmpFile = strcatFilename(fileName, ".cutree");
-                    if (!tmpFile)
-                        return false;
-                    m_cutreeStatFileIn = x265_fopen(tmpFile, "rb");
-                    X265_FREE(tmpFile);
-                    if (!m_cutreeStatFileIn)
-                    {
-                        x265_log_file(m_param, X265_LOG_ERROR, "can't open stats file %s.cutree\n", fileName);
+                    statsBuf = mapBinaryStats(fileName, numEntries);
+                    if (!statsBuf || !checkFirstPassOptions(statsBuf))
                         return false;
-                    }
-                }
-
-                /* check whether 1st pass options were compatible with current options */
-                if (strncmp(statsBuf, "#options:", 9))
-                {
-                    x265_log(m_param, X265_LOG_ERROR, "options list in stats file not valid\n");
-                    return false;
                 }
+                else
                 {
-                    int i, j, m;
-                    uint32_t k, l;
-                    bool bErr = false;
-                    char *opts = statsBuf;
-                    statsIn = strchr(statsBuf, '\n');
-                    if (!statsIn)
-                    {
-                        x265_log(m_param, X265_LOG_ERROR, "Malformed stats file\n");
-                        return false;
-                    }
-                    *statsIn = '\0';
-                    statsIn++;
-                    if ((p = strstr(opts, " input-res=")) == 0 || sscanf(p, " input-res=%dx%d", &i, &j) != 2)
-                    {
-                        x265_log(m_param, X265_LOG_ERROR, "Resolution specified in stats file not valid\n");
-                        return false;
-                    }
-                    if ((p = strstr(opts, " fps=")) == 0 || sscanf(p, " fps=%u/%u", &k, &l) != 2)
-                    {
-                        x265_log(m_param, X265_LOG_ERROR, "fps specified in stats file not valid\n");
-                        return false;
-                    }
-                    if (((p = strstr(opts, " vbv-maxrate=")) == 0 || sscanf(p, " vbv-maxrate=%d", &m) != 1) && m_param->rc.rateControlMode == X265_RC_CRF)
-                    {
-                        x265_log(m_param, X265_LOG_ERROR, "Constant rate-factor is incompatible with 2pass without vbv-maxrate in the previous pass\n");
+                    statsIn = statsBuf = x265_slurp_file(fileName);
+                    if (!statsBuf)
                         return false;
-                    }
-                    if (k != m_param->fpsNum || l != m_param->fpsDenom)
-                    {
-                        x265_log(m_param, X265_LOG_ERROR, "fps mismatch with 1st pass (%u/%u vs %u/%u)\n",
-                            m_param->fpsNum, m_param->fpsDenom, k, l);
-                        return false;
-                    }
-                    if (m_param->analysisMultiPassRefine)
+                    if (m_param->rc.cuTree)
                     {
-                        p = strstr(opts, "ref=");
-                        sscanf(p, "ref=%d", &i);
-                        if (i > m_param->maxNumReferences)
-                        {
-                            x265_log(m_param, X265_LOG_ERROR, "maxNumReferences cannot be less than 1st pass (%d vs %d)\n",
-                                i, m_param->maxNumReferences);
+                        char *tmpFile = strcatFilename(fileName, ".cutree");
+                        if (!tmpFile)
                             return false;
-                        }
-                    }
-                    if (m_param->analysisMultiPassRefine || m_param->analysisMultiPassDistortion)
-                    {
-                        p = strstr(opts, "ctu=");
-                        sscanf(p, "ctu=%u", &k);
-                        if (k != m_param->maxCUSize)
+                        m_cutreeStatFileIn = x265_fopen(tmpFile, "rb");
+                        X265_FREE(tmpFile);
+                        if (!m_cutreeStatFileIn)
                         {
-                            x265_log(m_param, X265_LOG_ERROR, "maxCUSize mismatch with 1st pass (%u vs %u)\n",
-                                k, m_param->maxCUSize);
+                            x265_log_file(m_param, X265_LOG_ERROR, "can't open stats file %s.cutree\n", fileName);
                             return false;
                         }
                     }
-                    CMP_OPT_FIRST_PASS("bitdepth", m_param->internalBitDepth);
-                    CMP_OPT_FIRST_PASS("weightp", m_param->bEnableWeightedPred);
-                    CMP_OPT_FIRST_PASS("bframes", m_param->bframes);
-                    CMP_OPT_FIRST_PASS("b-pyramid", m_param->bBPyramid);
-                    CMP_OPT_FIRST_PASS("open-gop", m_param->bOpenGOP);
-                    CMP_OPT_FIRST_PASS(" keyint", m_param->keyframeMax);
-                    CMP_OPT_FIRST_PASS("scenecut", m_param->scenecutThreshold);
-                    CMP_OPT_FIRST_PASS("intra-refresh", m_param->bIntraRefresh);
-                    CMP_OPT_FIRST_PASS("frame-dup", m_param->bEnableFrameDuplication);
-                    if (m_param->bMultiPassOptRPS)
-                    {
-                        CMP_OPT_FIRST_PASS("multi-pass-opt-rps", m_param->bMultiPassOptRPS);
-                        CMP_OPT_FIRST_PASS("repeat-headers", m_param->bRepeatHeaders);
-                        CMP_OPT_FIRST_PASS("min-keyint", m_param->keyframeMin);
-                    }
 
-                    if ((p = strstr(opts, "b-adapt=")) != 0 && sscanf(p, "b-adapt=%d", &i) && i >= X265_B_ADAPT_NONE && i <= X265_B_ADAPT_TRELLIS)
+                    /* check whether 1st pass options were compatible with current options */
+                    if (strncmp(statsBuf, "#options:", 9))
                     {
-                        m_param->bFrameAdaptive = i;
+                        x265_log(m_param, X265_LOG_ERROR, "options list in stats file not valid\n");
+                        return false;
                     }
-                    else if (m_param->bframes)
+                    char *opts = statsBuf;
+                    statsIn = strchr(statsBuf, '\n');
+                    if (!statsIn)
                     {
-                        x265_log(m_param, X265_LOG_ERROR, "b-adapt method specified in stats file not valid\n");
+                        x265_log(m_param, X265_LOG_ERROR, "Malformed stats file\n");
                         return false;
                     }
-
-                    if ((p = strstr(opts, "rc-lookahead=")) != 0 && sscanf(p, "rc-lookahead=%d", &i))
-                        m_param->lookaheadDepth = i;
+                    *statsIn = '\0';
+                    statsIn++;
+                    if (!checkFirstPassOptions(opts))
+                        return false;
+                    /* find number of pics */
+                    p = statsIn;
+                    for (numEntries = -1; p; numEntries++)
+                        p = strchr(p + 1, ';');
                 }
-                /* find number of pics */
-                p = statsIn;
-                int numEntries;
-                for (numEntries = -1; p; numEntries++)
-                    p = strchr(p + 1, ';');
                 if (!numEntries)
                 {
                     x265_log(m_param, X265_LOG_ERROR, "empty stats file\n");
@@ -621,12 +661,14 @@ bool RateControl::init(const SPS& sps)
                 }
                 m_numEntries = numEntries;
 
-                if (m_param->totalFrames < m_numEntries && m_param->totalFrames > 0)
+                bool bSegment = m_param->statSegmentStart || m_param->statSegmentEnd;
+                /* a segment's frame count is checked by initStatSegment() */
+                if (!bSegment && m_param->totalFrames < m_numEntries && m_param->totalFrames > 0)
                 {
                     x265_log(m_param, X265_LOG_WARNING, "2nd pass has fewer frames than 1st pass (%d vs %d)\n",
                         m_param->totalFrames, m_numEntries);
                 }
-                if (m_param->totalFrames > m_numEntries && !m_param->bEnableFrameDuplication)
+                if (!bSegment && m_param->totalFrames > m_numEntries && !m_param->bEnableFrameDuplication)
                 {
                     x265_log(m_param, X265_LOG_ERROR, "2nd pass has more frames than 1st pass (%d vs %d)\n",
                         m_param->totalFrames, m_numEntries);
@@ -655,78 +697,74 @@ bool RateControl::init(const SPS& sps)
                     rce->newQp = 0;
                 }
                 /* read stats */
-                p = statsIn;
-                double totalQpAq = 0;
-                for (int i = 0; i < m_numEntries; i++)
+                if (m_statsMap)
                 {
-                    RateControlEntry *rce, *rcePocOrder;
-                    int frameNumber;
-                    int encodeOrder;
-                    char picType;
-                    int e;
-                    char *next;
-                    double qpRc, qpAq, qNoVbv, qRceq;
-                    next = strstr(p, ";");
-                    if (next)
-                        *next++ = 0;
-                    e = sscanf(p, " in:%d out:%d", &frameNumber, &encodeOrder);
-                    if (frameNumber < 0 || frameNumber >= m_numEntries)
-                    {
-                        x265_log(m_param, X265_LOG_ERROR, "bad frame number (%d) at stats line %d\n", frameNumber, i);
+                    if (!readBinaryStats())
                         return false;
-                    }
-                    rce = &m_rce2Pass[encodeOrder];
-                    rcePocOrder = &m_rce2Pass[frameNumber];
-                    m_encOrder[frameNumber] = encodeOrder;
-                    if (!m_param->bMultiPassOptRPS)
-                    {
-                        int scenecut = 0;
-                        e += sscanf(p, " in:%*d out:%*d type:%c q:%lf q-aq:%lf q-noVbv:%lf q-Rceq:%lf tex:%d mv:%d misc:%d icu:%lf pcu:%lf scu:%lf sc:%d",
-                            &picType, &qpRc, &qpAq, &qNoVbv, &qRceq, &rce->coeffBits,
-                            &rce->mvBits, &rce->miscBits, &rce->iCuCount, &rce->pCuCount,
-                            &rce->skipCuCount, &scenecut);
-                        rcePocOrder->scenecut = scenecut != 0;
-                    }
-                    else
-                    {
-                        char deltaPOC[128];
-                        char bUsed[40];
-                        memset(deltaPOC, 0, sizeof(deltaPOC));
-                        memset(bUsed, 0, sizeof(bUsed));
-                        e += sscanf(p, " in:%*d out:%*d type:%c q:%lf q-aq:%lf q-noVbv:%lf q-Rceq:%lf tex:%d mv:%d misc:%d icu:%lf pcu:%lf scu:%lf nump:%d numnegp:%d numposp:%d deltapoc:%s bused:%s",
-                            &picType, &qpRc, &qpAq, &qNoVbv, &qRceq, &rce->coeffBits,
-                            &rce->mvBits, &rce->miscBits, &rce->iCuCount, &rce->pCuCount,
-                            &rce->skipCuCount, &rce->rpsData.numberOfPictures, &rce->rpsData.numberOfNegativePictures, &rce->rpsData.numberOfPositivePictures, deltaPOC, bUsed);
-                        splitdeltaPOC(deltaPOC, rce);
-                        splitbUsed(bUsed, rce);
-                        rce->rpsIdx = -1;
-                    }
-                    rce->keptAsRef = true;
-                    rce->isIdr = false;
-                    if (picType == 'b' || picType == 'p')
-                        rce->keptAsRef = false;
-                    if (picType == 'I')
-                        rce->isIdr = true;
-                    if (picType == 'I' || picType == 'i')
-                        rce->sliceType = I_SLICE;
-                    else if (picType == 'P' || picType == 'p')
-                        rce->sliceType = P_SLICE;
-                    else if (picType == 'B' || picType == 'b')
-                        rce->sliceType = B_SLICE;
-                    else
-                        e = -1;
-                    if (e < 10)
+                }
+                else
+                {
+                    p = statsIn;
+                    double totalQpAq = 0;
+                    for (int i = 0; i < m_numEntries; i++)
                     {
-                        x265_log(m_param, X265_LOG_ERROR, "statistics are damaged at line %d, parser out=%d\n", i, e);
-                        return false;
+                        RateControlEntry *rce, *rcePocOrder;
+                        int frameNumber;
+                        int encodeOrder;
+                        char picType;
+                        int e;
+                        char *next;
+                        double qpRc, qpAq, qNoVbv, qRceq;
+                        next = strstr(p, ";");
+                        if (next)
+                            *next++ = 0;
+                        e = sscanf(p, " in:%d out:%d", &frameNumber, &encodeOrder);
+                        if (frameNumber < 0 || frameNumber >= m_numEntries)
+                        {
+                            x265_log(m_param, X265_LOG_ERROR, "bad frame number (%d) at stats line %d\n", frameNumber, i);
+                            return false;
+                        }
+                        rce = &m_rce2Pass[encodeOrder];
+                        rcePocOrder = &m_rce2Pass[frameNumber];
+                        m_encOrder[frameNumber] = encodeOrder;
+                        if (!m_param->bMultiPassOptRPS)
+                        {
+                            int scenecut = 0;
+                            e += sscanf(p, " in:%*d out:%*d type:%c q:%lf q-aq:%lf q-noVbv:%lf q-Rceq:%lf tex:%d mv:%d misc:%d icu:%lf pcu:%lf scu:%lf sc:%d",
+                                &picType, &qpRc, &qpAq, &qNoVbv, &qRceq, &rce->coeffBits,
+                                &rce->mvBits, &rce->miscBits, &rce->iCuCount, &rce->pCuCount,
+                                &rce->skipCuCount, &scenecut);
+                            rcePocOrder->scenecut = scenecut != 0;
+                        }
+                        else
+                        {
+                            char deltaPOC[128];
+                            char bUsed[40];
+                            memset(deltaPOC, 0, sizeof(deltaPOC));
+                            memset(bUsed, 0, sizeof(bUsed));
+                            e += sscanf(p, " in:%*d out:%*d type:%c q:%lf q-aq:%lf q-noVbv:%lf q-Rceq:%lf tex:%d mv:%d misc:%d icu:%lf pcu:%lf scu:%lf nump:%d numnegp:%d numposp:%d deltapoc:%s bused:%s",
+                                &picType, &qpRc, &qpAq, &qNoVbv, &qRceq, &rce->coeffBits,
+                                &rce->mvBits, &rce->miscBits, &rce->iCuCount, &rce->pCuCount,
+                                &rce->skipCuCount, &rce->rpsData.numberOfPictures, &rce->rpsData.numberOfNegativePictures, &rce->rpsData.numberOfPositivePictures, deltaPOC, bUsed);
+                            splitdeltaPOC(deltaPOC, rce);
+                            splitbUsed(bUsed, rce);
+                            rce->rpsIdx = -1;
+                        }
+                        if (!setStatsSliceType(rce, picType))
+                            e = -1;
+                        if (e < 10)
+                        {
+                            x265_log(m_param, X265_LOG_ERROR, "statistics are damaged at line %d, parser out=%d\n", i, e);
+                            return false;
+                        }
+                        rce->qScale = rce->newQScale = x265_qp2qScale(qpRc);
+                        totalQpAq += qpAq;
+                        rce->qpNoVbv = qNoVbv;
+                        rce->qpaRc = qpRc;
+                        rce->qpAq = qpAq;
+                        rce->qRceq = qRceq;
+                        p = next;
                     }
-                    rce->qScale = rce->newQScale = x265_qp2qScale(qpRc);
-                    totalQpAq += qpAq;
-                    rce->qpNoVbv = qNoVbv;
-                    rce->qpaRc = qpRc;
-                    rce->qpAq = qpAq;
-                    rce->qRceq = qRceq;
-                    p = next;
                 }
                 X265_FREE(statsBuf);
                 if (m_param->rc.rateControlMode != X265_RC_CQP)
@@ -736,6 +774,8 @@ bool RateControl::init(const SPS& sps)
                     if (!initPass2())
                         return false;
                 } /* else we're using constant quant, so no need to run the bitrate allocation */
+                if (bSegment && !initStatSegment())
+                    return false;
             }
             else // X265_SHARE_MODE_SHAREDMEM == m_param->rc.dataShareMode
             {
@@ -765,10 +805,21 @@ bool RateControl::init(const SPS& sps)
                 return false;
             }
             p = x265_param2string(m_param, sps.conformanceWindow.rightOffset, sps.conformanceWindow.bottomOffset);
-            if (p)
+            /* CU-tree data is kept in a binary stats file, so a pass reading
+             * one rewrites it in full */
+            m_bStatBinaryOut = m_param->bStatBinary || m_statsMap;
+            if (m_bStatBinaryOut)
+            {
+                if (!writeBinaryStatsHeader(p))
+                {
+                    X265_FREE(p);
+                    return false;
+                }
+            }
+            else if (p)
                 fprintf(m_statFileOut, "#options: %s\n", p);
             X265_FREE(p);
-            if (m_param->rc.cuTree && !m_param->rc.bStatRead)
+            if (m_param->rc.cuTree && !m_param->rc.bStatRead && !m_bStatBinaryOut)
             {
                 if (X265_SHARE_MODE_FILE == m_param->rc.dataShareMode)
                 {
@@ -1098,6 +1149,160 @@ fail:
     return false;
 }
 
+/* Narrow the two-pass entries, planned for the whole sequence, to the
+ * segment this encoder encodes (--stats-segment). Its frames become a
+ * sequence of their own from POC 0, with the segment's share of the planned
+ * bits and the VBV fullness planned at its start */
+bool RateControl::initStatSegment()
+{
+    int first = m_param->statSegmentStart;
+    int last = m_param->statSegmentEnd ? m_param->statSegmentEnd : m_numEntries - 1;
+    if (first >= m_numEntries || last >= m_numEntries)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "stats segment %d-%d is beyond the %d frames of the 1st pass\n", first, last, m_numEntries);
+        return false;
+    }
+    int numFrames = last - first + 1;
+    if (m_param->totalFrames > numFrames && !m_param->bEnableFrameDuplication)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "2nd pass has more frames than the stats segment (%d vs %d)\n",
+                 m_param->totalFrames, numFrames);
+        return false;
+    }
+
+    /* a closed segment occupies the same positions in encode order as in
+     * display order */
+    if (m_encOrder[first] != first || !m_rce2Pass[first].isIdr)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "stats segment must start at an IDR frame of the 1st pass\n");
+        return false;
+    }
+    for (int i = first; i <= last; i++)
+    {
+        if (m_encOrder[i] < first || m_encOrder[i] > last)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "stats segment ends within a GOP of the 1st pass\n");
+            return false;
+        }
+    }
+
+    if (m_isVbv && first && m_param->rc.rateControlMode == X265_RC_ABR)
+    {
+        m_bufferFillFinal = m_bufferFillActual = m_rce2Pass[first - 1].expectedVbv;
+        m_param->rc.vbvBufferInit = m_bufferFillFinal / m_bufferSize;
+    }
+
+    /* skip the CU-tree data of the frames before the segment */
+    if (m_param->rc.cuTree)
+    {
+        if (m_statsMap)
+            m_cutreeStatPos = first;
+        else
+        {
+            int ncu = m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu;
+            int64_t numRef = 0;
+            for (int i = 0; i < first; i++)
+                numRef += m_rce2Pass[i].keptAsRef;
+            if (fseeko(m_cutreeStatFileIn, numRef * (1 + ncu * sizeof(uint16_t)), SEEK_SET))
+            {
+                x265_log(m_param, X265_LOG_ERROR, "Incomplete CU-tree stats file.\n");
+                return false;
+            }
+        }
+    }
+
+    uint64_t bitsBefore = m_rce2Pass[first].expectedBits;
+    memmove(m_rce2Pass, m_rce2Pass + first, sizeof(RateControlEntry) * numFrames);
+    for (int i = 0; i < numFrames; i++)
+    {
+        m_rce2Pass[i].expectedBits -= bitsBefore;
+        m_encOrder[i] = m_encOrder[first + i] - first;
+    }
+    m_numEntries = numFrames;
+    return true;
+}
+
+/* check whether 1st pass options were compatible with current options */
+bool RateControl::checkFirstPassOptions(char* opts)
+{
+    char *p;
+    int i, j, m;
+    uint32_t k, l;
+    bool bErr = false;
+    if ((p = strstr(opts, " input-res=")) == 0 || sscanf(p, " input-res=%dx%d", &i, &j) != 2)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "Resolution specified in stats file not valid\n");
+        return false;
+    }
+    if ((p = strstr(opts, " fps=")) == 0 || sscanf(p, " fps=%u/%u", &k, &l) != 2)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "fps specified in stats file not valid\n");
+        return false;
+    }
+    if (((p = strstr(opts, " vbv-maxrate=")) == 0 || sscanf(p, " vbv-maxrate=%d", &m) != 1) && m_param->rc.rateControlMode == X265_RC_CRF)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "Constant rate-factor is incompatible with 2pass without vbv-maxrate in the previous pass\n");
+        return false;
+    }
+    if (k != m_param->fpsNum || l != m_param->fpsDenom)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "fps mismatch with 1st pass (%u/%u vs %u/%u)\n",
+            m_param->fpsNum, m_param->fpsDenom, k, l);
+        return false;
+    }
+    if (m_param->analysisMultiPassRefine)
+    {
+        p = strstr(opts, "ref=");
+        sscanf(p, "ref=%d", &i);
+        if (i > m_param->maxNumReferences)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "maxNumReferences cannot be less than 1st pass (%d vs %d)\n",
+                i, m_param->maxNumReferences);
+            return false;
+        }
+    }
+    if (m_param->analysisMultiPassRefine || m_param->analysisMultiPassDistortion)
+    {
+        p = strstr(opts, "ctu=");
+        sscanf(p, "ctu=%u", &k);
+        if (k != m_param->maxCUSize)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "maxCUSize mismatch with 1st pass (%u vs %u)\n",
+                k, m_param->maxCUSize);
+            return false;
+        }
+    }
+    CMP_OPT_FIRST_PASS("bitdepth", m_param->internalBitDepth);
+    CMP_OPT_FIRST_PASS("weightp", m_param->bEnableWeightedPred);
+    CMP_OPT_FIRST_PASS("bframes", m_param->bframes);
+    CMP_OPT_FIRST_PASS("b-pyramid", m_param->bBPyramid);
+    CMP_OPT_FIRST_PASS("open-gop", m_param->bOpenGOP);
+    CMP_OPT_FIRST_PASS(" keyint", m_param->keyframeMax);
+    CMP_OPT_FIRST_PASS("scenecut", m_param->scenecutThreshold);
+    CMP_OPT_FIRST_PASS("intra-refresh", m_param->bIntraRefresh);
+    CMP_OPT_FIRST_PASS("frame-dup", m_param->bEnableFrameDuplication);
+    if (m_param->bMultiPassOptRPS)
+    {
+        CMP_OPT_FIRST_PASS("multi-pass-opt-rps", m_param->bMultiPassOptRPS);
+        CMP_OPT_FIRST_PASS("repeat-headers", m_param->bRepeatHeaders);
+        CMP_OPT_FIRST_PASS("min-keyint", m_param->keyframeMin);
+    }
+
+    if ((p = strstr(opts, "b-adapt=")) != 0 && sscanf(p, "b-adapt=%d", &i) && i >= X265_B_ADAPT_NONE && i <= X265_B_ADAPT_TRELLIS)
+    {
+        m_param->bFrameAdaptive = i;
+    }
+    else if (m_param->bframes)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "b-adapt method specified in stats file not valid\n");
+        return false;
+    }
+
+    if ((p = strstr(opts, "rc-lookahead=")) != 0 && sscanf(p, "rc-lookahead=%d", &i))
+        m_param->lookaheadDepth = i;
+    return true;
+}
+
 bool RateControl::initPass2()
 {
     uint64_t allConstBits = 0, allCodedBits = 0;
@@ -1777,7 +1982,12 @@ bool RateControl::cuTreeReadFor2Pass(Frame* frame)
             {
                 m_cuTreeStats.qpBufPos++;
 
-                if (X265_SHARE_MODE_FILE == m_param->rc.dataShareMode)
+                if (m_statsMap)
+                {
+                    if (!readBinaryCUTree(type, m_cuTreeStats.qpBuffer[m_cuTreeStats.qpBufPos], ncu))
+                        goto fail;
+                }
+                else if (X265_SHARE_MODE_FILE == m_param->rc.dataShareMode)
                 {
                     if (!fread(&type, 1, 1, m_cutreeStatFileIn))
                         goto fail;
@@ -3147,6 +3357,13 @@ int RateControl::writeRateControlFrameStats(Frame* curFrame, RateControlEntry* r
     char cType = rce->sliceType == I_SLICE ? (curFrame->m_lowres.sliceType == X265_TYPE_IDR ? 'I' : 'i')
         : rce->sliceType == P_SLICE ? 'P'
         : IS_REFERENCED(curFrame) ? 'B' : 'b';
+
+    if (m_bStatBinaryOut)
+    {
+        if (!writeBinaryFrameStats(curFrame, rce, cType))
+            goto writeFailure;
+        return 0;
+    }
     
     if (!curEncData.m_param->bMultiPassOptRPS)
     {
@@ -3230,6 +3447,248 @@ int RateControl::writeRateControlFrameStats(Frame* curFrame, RateControlEntry* r
     x265_log(m_param, X265_LOG_ERROR, "RatecontrolEnd: stats file write failure\n");
     return 1;
 }
+
+bool RateControl::writeBinaryStatsHeader(const char* opts)
+{
+    if (!opts)
+        opts = "";
+
+    StatsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, s_statsMagic, sizeof(header.magic));
+    header.version = STATS_BINARY_VERSION;
+    header.recordSize = sizeof(StatsFrameRecord);
+    header.numCUs = m_param->rc.cuTree ? (m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu) : 0;
+    header.optionsHash = hashStatsOptions(opts);
+
+    static const uint8_t zero[8] = { 0 };
+    size_t optsSize = strlen(opts) + 1;
+    if (fwrite(&header, sizeof(header), 1, m_statFileOut) != 1 ||
+        fwrite(opts, 1, optsSize, m_statFileOut) != optsSize ||
+        fwrite(zero, 1, (size_t)(statsAlign(optsSize) - optsSize), m_statFileOut) != statsAlign(optsSize) - optsSize)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "stats file write failure\n");
+        return false;
+    }
+    m_statsOutPos = sizeof(header) + statsAlign(optsSize);
+
+    if (header.numCUs)
+    {
+        m_cutreeStatBuf = X265_MALLOC(uint16_t, header.numCUs);
+        if (!m_cutreeStatBuf)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "cutree stats buffer cannot be allocated\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RateControl::writeBinaryFrameStats(Frame* curFrame, RateControlEntry* rce, char cType)
+{
+    FrameData& curEncData = *curFrame->m_encData;
+    const RPS& rps = curEncData.m_slice->m_rps;
+
+    StatsFrameRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.poc = rce->poc;
+    rec.encodeOrder = rce->encodeOrder;
+    rec.type = cType;
+    rec.qpRc = curEncData.m_avgQpRc;
+    rec.qpAq = curEncData.m_avgQpAq;
+    rec.qpNoVbv = rce->qpNoVbv;
+    rec.qRceq = rce->qRceq;
+    rec.coeffBits = curEncData.m_frameStats.coeffBits;
+    rec.mvBits = curEncData.m_frameStats.mvBits;
+    rec.miscBits = curEncData.m_frameStats.miscBits;
+    rec.iCuCount = curEncData.m_frameStats.percent8x8Intra * m_ncu;
+    rec.pCuCount = curEncData.m_frameStats.percent8x8Inter * m_ncu;
+    rec.skipCuCount = curEncData.m_frameStats.percent8x8Skip * m_ncu;
+    rec.scenecut = curFrame->m_lowres.bScenecut;
+    rec.numberOfPictures = rps.numberOfPictures;
+    rec.numberOfNegativePictures = rps.numberOfNegativePictures;
+    rec.numberOfPositivePictures = rps.numberOfPositivePictures;
+    for (int i = 0; i < rps.numberOfPictures; i++)
+    {
+        rec.deltaPOC[i] = rps.deltaPOC[i];
+        rec.bUsed[i] = rps.bUsed[i];
+    }
+
+    uint32_t ncu = m_cutreeStatBuf && IS_REFERENCED(curFrame) ? (m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu) : 0;
+    if (ncu)
+    {
+        rec.cutreeType = (uint8_t)rce->sliceType;
+        rec.cutreeOffset = m_statsOutPos + sizeof(rec);
+        primitives.fix8Pack(m_cutreeStatBuf, curFrame->m_lowres.qpCuTreeOffset, ncu);
+    }
+
+    if (m_numStatsOut == m_maxStatsOut)
+    {
+        int maxStats = X265_MAX(m_maxStatsOut * 2, 256);
+        uint64_t* index = X265_MALLOC(uint64_t, maxStats);
+        if (!index)
+            return false;
+        if (m_statsOutIndex)
+            memcpy(index, m_statsOutIndex, sizeof(uint64_t) * m_numStatsOut);
+        X265_FREE(m_statsOutIndex);
+        m_statsOutIndex = index;
+        m_maxStatsOut = maxStats;
+    }
+    m_statsOutIndex[m_numStatsOut++] = m_statsOutPos;
+
+    if (fwrite(&rec, sizeof(rec), 1, m_statFileOut) != 1)
+        return false;
+    m_statsOutPos += sizeof(rec);
+    if (ncu)
+    {
+        static const uint8_t zero[8] = { 0 };
+        size_t pad = (size_t)(statsAlign(ncu * sizeof(uint16_t)) - ncu * sizeof(uint16_t));
+        if (fwrite(m_cutreeStatBuf, sizeof(uint16_t), ncu, m_statFileOut) != ncu ||
+            fwrite(zero, 1, pad, m_statFileOut) != pad)
+            return false;
+        m_statsOutPos += ncu * sizeof(uint16_t) + pad;
+    }
+    return true;
+}
+
+/* append the frame index and complete the header */
+bool RateControl::finishBinaryStats()
+{
+    uint32_t numFrames = m_numStatsOut;
+    uint64_t indexOffset = m_statsOutPos;
+    return fwrite(m_statsOutIndex, sizeof(uint64_t), m_numStatsOut, m_statFileOut) == (size_t)m_numStatsOut &&
+           !fseek(m_statFileOut, offsetof(StatsFileHeader, numFrames), SEEK_SET) &&
+           fwrite(&numFrames, sizeof(numFrames), 1, m_statFileOut) == 1 &&
+           !fseek(m_statFileOut, offsetof(StatsFileHeader, indexOffset), SEEK_SET) &&
+           fwrite(&indexOffset, sizeof(indexOffset), 1, m_statFileOut) == 1;
+}
+
+/* returns the first pass options, checked against their hash, and the
+ * number of frames of a binary stats file, which stays mapped for the
+ * frame records and CU-tree data */
+char* RateControl::mapBinaryStats(const char* fileName, int& numEntries)
+{
+    m_statsMap = (char*)x265_map_file(fileName, &m_statsMapSize);
+    if (!m_statsMap)
+        return NULL;
+
+    const StatsFileHeader* header = (const StatsFileHeader*)m_statsMap;
+    if (m_statsMapSize < sizeof(StatsFileHeader) || header->version != STATS_BINARY_VERSION ||
+        header->recordSize != sizeof(StatsFrameRecord))
+    {
+        x265_log(m_param, X265_LOG_ERROR, "unsupported binary stats file version\n");
+        return NULL;
+    }
+    if (!header->indexOffset || header->indexOffset > m_statsMapSize ||
+        (m_statsMapSize - header->indexOffset) / sizeof(uint64_t) < header->numFrames ||
+        header->numFrames > INT_MAX)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "binary stats file is incomplete\n");
+        return NULL;
+    }
+    uint32_t ncu = m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu;
+    if (m_param->rc.cuTree && header->numCUs != ncu)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "binary stats file has no cutree data for this encode\n");
+        return NULL;
+    }
+
+    const char* opts = m_statsMap + sizeof(StatsFileHeader);
+    size_t optsSize = strnlen(opts, (size_t)header->indexOffset - sizeof(StatsFileHeader)) + 1;
+    if (optsSize > header->indexOffset - sizeof(StatsFileHeader) || hashStatsOptions(opts) != header->optionsHash)
+    {
+        x265_log(m_param, X265_LOG_ERROR, "options list in stats file not valid\n");
+        return NULL;
+    }
+    char* optsCopy = X265_MALLOC(char, optsSize);
+    if (optsCopy)
+        memcpy(optsCopy, opts, optsSize);
+
+    m_statsIndex = (const uint64_t*)(m_statsMap + header->indexOffset);
+    m_cutreeStatPos = 0;
+    numEntries = (int)header->numFrames;
+    return optsCopy;
+}
+
+bool RateControl::readBinaryStats()
+{
+    const StatsFileHeader* header = (const StatsFileHeader*)m_statsMap;
+    uint64_t cutreeSize = header->numCUs * sizeof(uint16_t);
+    for (int i = 0; i < m_numEntries; i++)
+    {
+        uint64_t offset = m_statsIndex[i];
+        if (offset & 7 || offset < sizeof(StatsFileHeader) || offset > header->indexOffset - sizeof(StatsFrameRecord))
+        {
+            x265_log(m_param, X265_LOG_ERROR, "statistics are damaged at frame %d\n", i);
+            return false;
+        }
+        const StatsFrameRecord* rec = (const StatsFrameRecord*)(m_statsMap + offset);
+        if (rec->poc < 0 || rec->poc >= m_numEntries || rec->encodeOrder < 0 || rec->encodeOrder >= m_numEntries)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "bad frame number (%d) at stats frame %d\n", rec->poc, i);
+            return false;
+        }
+        if ((rec->cutreeOffset && (rec->cutreeOffset & 7 || rec->cutreeOffset > header->indexOffset - cutreeSize)) ||
+            (uint32_t)rec->numberOfPictures > MAX_NUM_REF_PICS)
+        {
+            x265_log(m_param, X265_LOG_ERROR, "statistics are damaged at frame %d\n", i);
+            return false;
+        }
+
+        RateControlEntry* rce = &m_rce2Pass[rec->encodeOrder];
+        m_encOrder[rec->poc] = rec->encodeOrder;
+        if (!setStatsSliceType(rce, rec->type))
+        {
+            x265_log(m_param, X265_LOG_ERROR, "statistics are damaged at frame %d\n", i);
+            return false;
+        }
+        if (!m_param->bMultiPassOptRPS)
+            m_rce2Pass[rec->poc].scenecut = rec->scenecut != 0;
+        else
+        {
+            rce->rpsData.numberOfPictures = rec->numberOfPictures;
+            rce->rpsData.numberOfNegativePictures = rec->numberOfNegativePictures;
+            rce->rpsData.numberOfPositivePictures = rec->numberOfPositivePictures;
+            for (int j = 0; j < rec->numberOfPictures; j++)
+            {
+                rce->rpsData.deltaPOC[j] = rec->deltaPOC[j];
+                rce->rpsData.bUsed[j] = rec->bUsed[j] != 0;
+            }
+            rce->rpsIdx = -1;
+        }
+        rce->coeffBits = rec->coeffBits;
+        rce->mvBits = rec->mvBits;
+        rce->miscBits = rec->miscBits;
+        rce->iCuCount = rec->iCuCount;
+        rce->pCuCount = rec->pCuCount;
+        rce->skipCuCount = rec->skipCuCount;
+        rce->qScale = rce->newQScale = x265_qp2qScale(rec->qpRc);
+        rce->qpNoVbv = rec->qpNoVbv;
+        rce->qpaRc = rec->qpRc;
+        rce->qpAq = rec->qpAq;
+        rce->qRceq = rec->qRceq;
+    }
+    return true;
+}
+
+/* CU-tree data of the next referenced frame in encode order, read from the
+ * mapping only when a frame needs it */
+bool RateControl::readBinaryCUTree(uint8_t& type, uint16_t* qpBuffer, int ncu)
+{
+    /* m_numEntries may have been narrowed to a segment */
+    int numFrames = (int)((const StatsFileHeader*)m_statsMap)->numFrames;
+    while (m_cutreeStatPos < numFrames)
+    {
+        const StatsFrameRecord* rec = (const StatsFrameRecord*)(m_statsMap + m_statsIndex[m_cutreeStatPos++]);
+        if (rec->cutreeOffset)
+        {
+            type = rec->cutreeType;
+            memcpy(qpBuffer, m_statsMap + rec->cutreeOffset, ncu * sizeof(uint16_t));
+            return true;
+        }
+    }
+    return false;
+}
 #if defined(_MSC_VER)
 #pragma warning(disable: 4996) // POSIX function names are just fine, thank you
 #endif
@@ -3261,6 +3720,8 @@ void RateControl::destroy()
 
     if (m_statFileOut)
     {
+        if (m_bStatBinaryOut && !finishBinaryStats())
+            x265_log(m_param, X265_LOG_ERROR, "stats file write failure\n");
         fclose(m_statFileOut);
         char *tmpFileName = strcatFilename(fileName, ".temp");
         int bError = 1;
@@ -3297,6 +3758,9 @@ void RateControl::destroy()
 
     if (m_cutreeStatFileIn)
         fclose(m_cutreeStatFileIn);
+    x265_unmap_file(m_statsMap, m_statsMapSize);
+    X265_FREE(m_statsOutIndex);
+    X265_FREE(m_cutreeStatBuf);
 
     if (m_cutreeShrMem)
     {
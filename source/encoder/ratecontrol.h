@@ -236,6 +236,16 @@ public:
     FILE*   m_statFileOut;
     FILE*   m_cutreeStatFileOut;
     FILE*   m_cutreeStatFileIn;
+    char*   m_statsMap;          /* binary stats file read, mapped */
+    size_t  m_statsMapSize;
+    const uint64_t* m_statsIndex;
+    int     m_cutreeStatPos;     /* next record to look for CU-tree data at */
+    bool    m_bStatBinaryOut;
+    uint64_t  m_statsOutPos;     /* bytes of binary stats written */
+    uint64_t* m_statsOutIndex;
+    int     m_numStatsOut;
+    int     m_maxStatsOut;
+    uint16_t* m_cutreeStatBuf;
     ///< store the cutree data in memory instead of file
     RingMem *m_cutreeShrMem;
     double  m_lastAccumPNorm;
@@ -298,6 +308,15 @@ protected:
     double tuneQScaleForZone(RateControlEntry *rce, double qScale); // Tune qScale to adhere to zone budget
     void   accumPQpUpdate();
 
+    bool   checkFirstPassOptions(char* opts);
+    bool   initStatSegment();
+    char*  mapBinaryStats(const char* fileName, int& numEntries);
+    bool   readBinaryStats();
+    bool   readBinaryCUTree(uint8_t& type, uint16_t* qpBuffer, int ncu);
+    bool   writeBinaryStatsHeader(const char* opts);
+    bool   writeBinaryFrameStats(Frame* curFrame, RateControlEntry* rce, char cType);
+    bool   finishBinaryStats();
+
     int    getPredictorType(int lowresSliceType, int sliceType);
     int    updateVbv(int64_t bits, RateControlEntry* rce);
     void   updatePredictor(Predictor *p, double q, double var, double bits);
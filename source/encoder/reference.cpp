@@ -48,7 +48,7 @@ MotionReference::~MotionReference()
     X265_FREE(weightBuffer[2]);
 }
 
-int MotionReference::init(PicYuv* recPic, WeightParam *wp, const x265_param& p)
+int MotionReference::init(PicYuv* recPic, WeightParam *wp, const x265_param& p, pixel* const hpel[3])
 {
     reconPic = recPic;
     lumaStride = recPic->m_stride;
@@ -70,6 +70,10 @@ int MotionReference::init(PicYuv* recPic, WeightParam *wp, const x265_param& p)
     fpelPlane[2] = recPic->m_picOrg[2];
     isWeighted = false;
 
+    /* the cached half-pel planes are interpolated from unweighted pixels */
+    for (int i = 0; i < 3; i++)
+        hpelPlane[i] = !wp && hpel[0] ? hpel[i] : NULL;
+
     if (wp)
     {
         uint32_t numCUinHeight = (reconPic->m_picHeight + p.maxCUSize - 1) / p.maxCUSize;
@@ -41,7 +41,7 @@ public:
 
     MotionReference();
     ~MotionReference();
-    int  init(PicYuv*, WeightParam* wp, const x265_param& p);
+    int  init(PicYuv*, WeightParam* wp, const x265_param& p, pixel* const hpel[3]);
     void applyWeight(uint32_t finishedRows, uint32_t maxNumRows, uint32_t maxNumRowsInSlice, uint32_t sliceId);
 
     pixel*      weightBuffer[3];
@@ -1237,7 +1237,7 @@ void SAO::rdoSaoUnitCu(SAOParam* saoParam, int rowBaseAddr, int idxX, int addr)
     lambda[0] = (int64_t)floor(256.0 * x265_lambda2_tab[qp]);
     lambda[1] = (int64_t)floor(256.0 * x265_lambda2_tab[qpCb]); // Use Cb QP for SAO chroma
 
-    const bool allowMerge[2] = {(idxX != 0), (rowBaseAddr != 0)}; // left, up
+    const bool allowMerge[2] = {(idxX != 0) && !cu->m_bFirstColInTile, (rowBaseAddr != 0) && !cu->m_bFirstRowInTile}; // left, up
 
     const int addrMerge[2] = {(idxX ? addr - 1 : -1), (rowBaseAddr ? addr - m_numCuInWidth : -1)};// left, up
 
@@ -91,6 +91,11 @@ bool Search::initSearch(const x265_param& param, ScalingList& scalingList)
      * available for motion reference.  See refLagRows in FrameEncoder::compressCTURows() */
     m_refLagPixels = m_bFrameParallel ? param.searchRange : param.sourceHeight;
 
+    m_searchMethod = param.searchMethod;
+    m_searchRange = param.searchRange;
+    memset(m_lowresMVSearches, 0, sizeof(m_lowresMVSearches));
+    m_lowresMVHits = 0;
+
     uint32_t sizeL = 1 << (maxLog2CUSize * 2);
     uint32_t sizeC = sizeL >> (m_hChromaShift + m_vChromaShift);
     uint32_t numPartitions = 1 << (maxLog2CUSize - LOG2_UNIT_SIZE) * 2;
@@ -1964,27 +1969,205 @@ uint32_t Search::mergeEstimation(CUData& cu, const CUGeom& cuGeom, const Predict
     return outCost;
 }
 
-/* find the lowres motion vector from lookahead in middle of current PU */
-MV Search::getLowresMV(const CUData& cu, const PredictionUnit& pu, int list, int ref)
+/* find the lowres motion vector from lookahead in middle of current PU. When
+ * confidence is given (--me-confidence) it receives how far the vector can be
+ * trusted, and references beyond the lookahead's reach get the vector of the
+ * furthest measured distance scaled by the POC distance */
+MV Search::getLowresMV(const CUData& cu, const PredictionUnit& pu, int list, int ref, int* confidence)
 {
+    const Lowres& lowres = m_frame->m_lowres;
     int diffPoc = abs(m_slice->m_poc - m_slice->m_refPOCList[list][ref]);
-    if (diffPoc > m_param->bframes + 1)
+    int dist = diffPoc;
+
+    if (confidence)
+    {
+        *confidence = LOWRES_MV_LOW;
+        for (dist = X265_MIN(diffPoc, m_param->bframes + 1); dist > 0; dist--)
+            if (lowres.lowresMvs[list][dist][0].x != 0x7FFF)
+                break;
+        if (!dist)
+            return 0;
+    }
+    else if (diffPoc > m_param->bframes + 1)
         /* poc difference is out of range for lookahead */
         return 0;
 
-    MV* mvs = m_frame->m_lowres.lowresMvs[list][diffPoc];
+    MV* mvs = lowres.lowresMvs[list][dist];
     if (mvs[0].x == 0x7FFF)
         /* this motion search was not estimated by lookahead */
         return 0;
 
     uint32_t block_x = (cu.m_cuPelX + g_zscanToPelX[pu.puAbsPartIdx] + pu.width / 2) >> 4;
     uint32_t block_y = (cu.m_cuPelY + g_zscanToPelY[pu.puAbsPartIdx] + pu.height / 2) >> 4;
-    uint32_t idx = block_y * m_frame->m_lowres.maxBlocksInRow + block_x;
+    uint32_t idx = block_y * lowres.maxBlocksInRow + block_x;
+
+    X265_CHECK(block_x < lowres.maxBlocksInRow, "block_x is too high\n");
+    X265_CHECK(block_y < lowres.maxBlocksInCol, "block_y is too high\n");
+
+    MV lmv = mvs[idx];
+    if (confidence)
+    {
+        /* coherence: largest deviation of the neighbouring lowres vectors */
+        int maxDev = 0;
+        for (uint32_t y = block_y ? block_y - 1 : 0; y <= X265_MIN(block_y + 1, lowres.maxBlocksInCol - 1); y++)
+        {
+            for (uint32_t x = block_x ? block_x - 1 : 0; x <= X265_MIN(block_x + 1, lowres.maxBlocksInRow - 1); x++)
+            {
+                const MV& nmv = mvs[y * lowres.maxBlocksInRow + x];
+                maxDev = X265_MAX(maxDev, X265_MAX(abs(nmv.x - lmv.x), abs(nmv.y - lmv.y)));
+            }
+        }
+
+        int64_t cost = lowres.lowresMvCosts[list][dist][idx];
+        int64_t intraCost = lowres.intraCost[idx];
+        if (dist != diffPoc)
+        {
+            /* constant motion assumed over the longer distance */
+            lmv.x = (lmv.x * diffPoc + (lmv.x >= 0 ? dist / 2 : -dist / 2)) / dist;
+            lmv.y = (lmv.y * diffPoc + (lmv.y >= 0 ? dist / 2 : -dist / 2)) / dist;
+            maxDev = maxDev * diffPoc / dist;
+        }
+
+        /* deviations in lowres qpel: 2 is one full-res pixel */
+        if (dist == diffPoc && pu.width >= 16 && pu.height >= 16 && maxDev <= 2 && cost * 4 <= intraCost)
+            *confidence = LOWRES_MV_REFINE;
+        else if (maxDev <= 8 && cost * 2 <= intraCost)
+            *confidence = LOWRES_MV_NARROW;
+    }
+
+    return lmv << 1; /* scale up lowres mv */
+}
+
+void Search::countLowresMVSearch(int confidence, const MV& lmv, const MV& outmv)
+{
+    m_lowresMVSearches[confidence]++;
+    if (confidence != LOWRES_MV_LOW && abs(outmv.x - lmv.x) <= 4 && abs(outmv.y - lmv.y) <= 4)
+        m_lowresMVHits++;
+}
+
+/* move the --me-confidence counters of the last CTU into row stats */
+void Search::collectLowresMVStats(FrameStats& stats)
+{
+    for (int c = 0; c < LOWRES_MV_CONFIDENCES; c++)
+        stats.cntLowresMVSearch[c] += m_lowresMVSearches[c];
+    stats.cntLowresMVHit += m_lowresMVHits;
+    memset(m_lowresMVSearches, 0, sizeof(m_lowresMVSearches));
+    m_lowresMVHits = 0;
+}
+
+/* move the --me-confidence counters of a pmode slave into its group */
+void Search::moveLowresMVStats(uint32_t* searches, uint32_t& hits)
+{
+    for (int c = 0; c < LOWRES_MV_CONFIDENCES; c++)
+        searches[c] += m_lowresMVSearches[c];
+    hits += m_lowresMVHits;
+    memset(m_lowresMVSearches, 0, sizeof(m_lowresMVSearches));
+    m_lowresMVHits = 0;
+}
+
+void Search::addLowresMVStats(const uint32_t* searches, uint32_t hits)
+{
+    for (int c = 0; c < LOWRES_MV_CONFIDENCES; c++)
+        m_lowresMVSearches[c] += searches[c];
+    m_lowresMVHits += hits;
+}
+
+/* --me-confidence: motion search of one reference around a lowres vector of
+ * REFINE or NARROW confidence. A reliable vector only gets the square and
+ * sub-pel refinement, a fairly reliable one a short search window. Costs are
+ * measured against lmv as MVP, the caller corrects the MVD bits with
+ * updateMVP() */
+int Search::lowresMotionSearch(const CUData& cu, int list, int ref, const MV& lmv, int confidence,
+                               int numMvc, const MV* mvc, int merange, MV& outmv)
+{
+    MV mvmin, mvmax;
+    pixel* srcRefPlane = m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0;
+
+    /* refineMV always measures against the reconstructed reference */
+    if (confidence == LOWRES_MV_REFINE && !srcRefPlane)
+    {
+        setSearchRange(cu, lmv, 1, mvmin, mvmax);
+        return m_me.refineMV(&m_slice->m_mref[list][ref], mvmin, mvmax, lmv, outmv);
+    }
+
+    merange = X265_MIN(merange, 8);
+    setSearchRange(cu, lmv, merange, mvmin, mvmax);
+    return m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, lmv, numMvc, mvc, merange, outmv, m_param->maxSlices, srcRefPlane);
+}
+
+/* Pick the motion search method and range of a CTU. With --adaptive-me the
+ * lookahead's lowres vectors of the nearest reference in each list classify
+ * the CTU: near-static motion gets DIA over a short range, coherent moderate
+ * motion HEX over a range covering the vector spread, and fast, incoherent or
+ * poorly predicted motion (lowres inter cost not below intra cost) gets the
+ * configured method, at least UMH, over the full range */
+void Search::setCTUSearch(const CUData& ctu)
+{
+    m_searchMethod = m_param->searchMethod;
+    m_searchRange = m_param->searchRange;
+
+    if (!m_param->bAdaptiveSearch || m_slice->isIntra())
+        return;
 
-    X265_CHECK(block_x < m_frame->m_lowres.maxBlocksInRow, "block_x is too high\n");
-    X265_CHECK(block_y < m_frame->m_lowres.maxBlocksInCol, "block_y is too high\n");
+    const Lowres& lowres = m_frame->m_lowres;
+    uint32_t blockX0 = ctu.m_cuPelX >> 4;
+    uint32_t blockY0 = ctu.m_cuPelY >> 4;
+    uint32_t blockX1 = X265_MIN((ctu.m_cuPelX + m_param->maxCUSize) >> 4, lowres.maxBlocksInRow);
+    uint32_t blockY1 = X265_MIN((ctu.m_cuPelY + m_param->maxCUSize) >> 4, lowres.maxBlocksInCol);
 
-    return mvs[idx] << 1; /* scale up lowres mv */
+    int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+    int maxLen = 0, numBlocks = 0, numPoor = 0;
+
+    for (int list = 0; list < m_slice->isInterB() + 1; list++)
+    {
+        int diffPoc = abs(m_slice->m_poc - m_slice->m_refPOCList[list][0]);
+        if (diffPoc > m_param->bframes + 1)
+            continue;
+
+        const MV* mvs = lowres.lowresMvs[list][diffPoc];
+        const int32_t* mvCosts = lowres.lowresMvCosts[list][diffPoc];
+        if (mvs[0].x == 0x7FFF)
+            continue;
+
+        for (uint32_t y = blockY0; y < blockY1; y++)
+        {
+            for (uint32_t x = blockX0; x < blockX1; x++)
+            {
+                uint32_t idx = y * lowres.maxBlocksInRow + x;
+
+                /* lowres qpel vectors are half-scale, so >> 1 gives full-res pels */
+                int mvx = mvs[idx].x >> 1;
+                int mvy = mvs[idx].y >> 1;
+                minX = X265_MIN(minX, mvx);
+                maxX = X265_MAX(maxX, mvx);
+                minY = X265_MIN(minY, mvy);
+                maxY = X265_MAX(maxY, mvy);
+                maxLen = X265_MAX(maxLen, X265_MAX(abs(mvx), abs(mvy)));
+                numPoor += mvCosts[idx] >= lowres.intraCost[idx];
+                numBlocks++;
+            }
+        }
+    }
+
+    if (!numBlocks)
+        return; /* no lookahead motion for this CTU */
+
+    int spread = X265_MAX(maxX - minX, maxY - minY);
+    if (numPoor * 4 > numBlocks || maxLen > m_param->searchRange / 2 || spread > 16)
+    {
+        if (m_searchMethod < X265_UMH_SEARCH)
+            m_searchMethod = X265_UMH_SEARCH;
+    }
+    else if (maxLen <= 2 && spread <= 2)
+    {
+        m_searchMethod = X265_DIA_SEARCH;
+        m_searchRange = X265_MIN(m_searchRange, 16);
+    }
+    else
+    {
+        m_searchMethod = X265_MIN(m_searchMethod, X265_HEX_SEARCH);
+        m_searchRange = X265_MIN(m_searchRange, X265_MAX(16, 2 * spread + 8));
+    }
 }
 
 /* Pick between the two AMVP candidates which is the best one to use as
@@ -2057,7 +2240,7 @@ void Search::processPME(PME& pme, Search& slave)
         slave.m_param = m_param;
         slave.setLambdaFromQP(pme.mode.cu, m_rdCost.m_qp);
         bool bChroma = slave.m_frame->m_fencPic->m_picCsp != X265_CSP_I400;
-        slave.m_me.setSourcePU(*pme.mode.fencYuv, pme.pu.ctuAddr, pme.pu.cuAbsPartIdx, pme.pu.puAbsPartIdx, pme.pu.width, pme.pu.height, m_param->searchMethod, m_param->subpelRefine, bChroma);
+        slave.m_me.setSourcePU(*pme.mode.fencYuv, pme.pu.ctuAddr, pme.pu.cuAbsPartIdx, pme.pu.puAbsPartIdx, pme.pu.width, pme.pu.height, m_searchMethod, m_param->subpelRefine, bChroma);
     }
 
     /* Perform ME, repeat until no more work is available */
@@ -2097,27 +2280,37 @@ void Search::singleMotionEstimation(Search& master, Mode& interMode, const Predi
     const MV* amvp = interMode.amvpCand[list][ref];
     int mvpIdx = selectMVP(interMode.cu, pu, amvp, list, ref);
     bool bLowresMVP = false;
-    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx], mvp_lowres;
+    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx], mvp_lowres, lmv;
+    int lowresConf = LOWRES_MV_LOW;
 
     if (!m_param->analysisSave && !m_param->analysisLoad) /* Prevents load/save outputs from diverging if lowresMV is not available */
     {
-        MV lmv = getLowresMV(interMode.cu, pu, list, ref);
+        lmv = getLowresMV(interMode.cu, pu, list, ref, m_param->bMEConfidence ? &lowresConf : NULL);
         if (lmv.notZero())
             mvc[numMvc++] = lmv;
         if (m_param->bEnableHME)
             mvp_lowres = lmv;
     }
 
-    setSearchRange(interMode.cu, mvp, m_param->searchRange, mvmin, mvmax);
-
-    int satdCost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvp, numMvc, mvc, m_param->searchRange, outmv, m_param->maxSlices, 
-      m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
+    int satdCost;
+    if (lowresConf != LOWRES_MV_LOW)
+    {
+        satdCost = lowresMotionSearch(interMode.cu, list, ref, lmv, lowresConf, numMvc, mvc, master.m_searchRange, outmv);
+        mvp_lowres = lmv;
+        bLowresMVP = true;
+    }
+    else
+    {
+        setSearchRange(interMode.cu, mvp, master.m_searchRange, mvmin, mvmax);
+        satdCost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvp, numMvc, mvc, master.m_searchRange, outmv, m_param->maxSlices, 
+          m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
+    }
 
-    if (m_param->bEnableHME && mvp_lowres.notZero() && mvp_lowres != mvp)
+    if (m_param->bEnableHME && !bLowresMVP && mvp_lowres.notZero() && mvp_lowres != mvp)
     {
         MV outmv_lowres;
-        setSearchRange(interMode.cu, mvp_lowres, m_param->searchRange, mvmin, mvmax);
-        int lowresMvCost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvp_lowres, numMvc, mvc, m_param->searchRange, outmv_lowres, m_param->maxSlices,
+        setSearchRange(interMode.cu, mvp_lowres, master.m_searchRange, mvmin, mvmax);
+        int lowresMvCost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvp_lowres, numMvc, mvc, master.m_searchRange, outmv_lowres, m_param->maxSlices,
             m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
         if (lowresMvCost < satdCost)
         {
@@ -2140,6 +2333,8 @@ void Search::singleMotionEstimation(Search& master, Mode& interMode, const Predi
 
     /* tie goes to the smallest ref ID, just like --no-pme */
     ScopedLock _lock(master.m_meLock);
+    if (m_param->bMEConfidence)
+        master.countLowresMVSearch(lowresConf, lmv, outmv);
     if (cost < bestME[list].cost ||
        (cost == bestME[list].cost && ref < bestME[list].ref))
     {
@@ -2167,8 +2362,8 @@ void Search::searchMV(Mode& interMode, int list, int ref, MV& outmv, MV mvp[3],
         MV bestMV;
         mv = mvp[cand++];
         cu.clipMv(mv);
-        setSearchRange(cu, mv, m_param->searchRange, mvmin, mvmax);
-        int cost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mv, numMvc, mvc, m_param->searchRange, bestMV, m_param->maxSlices,
+        setSearchRange(cu, mv, m_searchRange, mvmin, mvmax);
+        int cost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mv, numMvc, mvc, m_searchRange, bestMV, m_param->maxSlices,
         m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
         if (bestcost > cost)
         {
@@ -2203,7 +2398,7 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
     {
         MotionData* bestME = interMode.bestME[puIdx];
         PredictionUnit pu(cu, cuGeom, puIdx);
-        m_me.setSourcePU(*interMode.fencYuv, pu.ctuAddr, pu.cuAbsPartIdx, pu.puAbsPartIdx, pu.width, pu.height, m_param->searchMethod, m_param->subpelRefine, bChromaMC);
+        m_me.setSourcePU(*interMode.fencYuv, pu.ctuAddr, pu.cuAbsPartIdx, pu.puAbsPartIdx, pu.width, pu.height, m_searchMethod, m_param->subpelRefine, bChromaMC);
         useAsMVP = false;
         x265_analysis_inter_data* interDataCTU = NULL;
         int cuIdx;
@@ -2263,7 +2458,7 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
                     for (int planes = 0; planes < INTEGRAL_PLANE_NUM; planes++)
                         m_me.integral[planes] = interMode.fencYuv->m_integral[list][ref][planes] + puX * pu.width + puY * pu.height * m_slice->m_refFrameList[list][ref]->m_reconPic->m_stride;
                 }
-                setSearchRange(cu, mvp, m_param->searchRange, mvmin, mvmax);
+                setSearchRange(cu, mvp, m_searchRange, mvmin, mvmax);
                 MV mvpIn = mvp;
                 int satdCost;
                 if (m_param->analysisMultiPassRefine && m_param->rc.bStatRead && mvpIdx == bestME[list].mvpIdx)
@@ -2287,8 +2482,8 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
                     {
                         if (cand && (mvpSel[cand] == mvpSel[cand - 1] || (cand == 2 && mvpSel[cand] == mvpSel[cand - 2])))
                             continue;
-                        setSearchRange(cu, mvpSel[cand], m_param->searchRange, mvmin, mvmax);
-                        int bcost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvpSel[cand], numMvc, mvc, m_param->searchRange, bestmv, m_param->maxSlices,
+                        setSearchRange(cu, mvpSel[cand], m_searchRange, mvmin, mvmax);
+                        int bcost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvpSel[cand], numMvc, mvc, m_searchRange, bestmv, m_param->maxSlices,
                             m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
                         if (satdCost > bcost)
                         {
@@ -2302,7 +2497,7 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
                 }
                 else
                 {
-                    satdCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvpIn, numMvc, mvc, m_param->searchRange, outmv, m_param->maxSlices,
+                    satdCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvpIn, numMvc, mvc, m_searchRange, outmv, m_param->maxSlices,
                         m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
                 }
 
@@ -2407,12 +2602,13 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
 
                     const MV* amvp = interMode.amvpCand[list][ref];
                     int mvpIdx = selectMVP(cu, pu, amvp, list, ref);
-                    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx], mvp_lowres;
+                    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx], mvp_lowres, lmv;
                     bool bLowresMVP = false;
+                    int lowresConf = LOWRES_MV_LOW;
 
                     if (!m_param->analysisSave && !m_param->analysisLoad) /* Prevents load/save outputs from diverging when lowresMV is not available */
                     {
-                        MV lmv = getLowresMV(cu, pu, list, ref);
+                        lmv = getLowresMV(cu, pu, list, ref, m_param->bMEConfidence ? &lowresConf : NULL);
                         if (lmv.notZero())
                             mvc[numMvc++] = lmv;
                         if (m_param->bEnableHME)
@@ -2425,15 +2621,25 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
                         for (int planes = 0; planes < INTEGRAL_PLANE_NUM; planes++)
                             m_me.integral[planes] = interMode.fencYuv->m_integral[list][ref][planes] + puX * pu.width + puY * pu.height * m_slice->m_refFrameList[list][ref]->m_reconPic->m_stride;
                     }
-                    setSearchRange(cu, mvp, m_param->searchRange, mvmin, mvmax);
-                    int satdCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvp, numMvc, mvc, m_param->searchRange, outmv, m_param->maxSlices, 
-                      m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
+                    int satdCost;
+                    if (lowresConf != LOWRES_MV_LOW)
+                    {
+                        satdCost = lowresMotionSearch(cu, list, ref, lmv, lowresConf, numMvc, mvc, m_searchRange, outmv);
+                        mvp_lowres = lmv;
+                        bLowresMVP = true;
+                    }
+                    else
+                    {
+                        setSearchRange(cu, mvp, m_searchRange, mvmin, mvmax);
+                        satdCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvp, numMvc, mvc, m_searchRange, outmv, m_param->maxSlices, 
+                          m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
+                    }
 
-                    if (m_param->bEnableHME && mvp_lowres.notZero() && mvp_lowres != mvp)
+                    if (m_param->bEnableHME && !bLowresMVP && mvp_lowres.notZero() && mvp_lowres != mvp)
                     {
                         MV outmv_lowres;
-                        setSearchRange(cu, mvp_lowres, m_param->searchRange, mvmin, mvmax);
-                        int lowresMvCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvp_lowres, numMvc, mvc, m_param->searchRange, outmv_lowres, m_param->maxSlices,
+                        setSearchRange(cu, mvp_lowres, m_searchRange, mvmin, mvmax);
+                        int lowresMvCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvp_lowres, numMvc, mvc, m_searchRange, outmv_lowres, m_param->maxSlices,
                             m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
                         if (lowresMvCost < satdCost)
                         {
@@ -2454,6 +2660,9 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
                     /* Refine MVP selection, updates: mvpIdx, bits, cost */
                     mvp = checkBestMVP(amvp, outmv, mvpIdx, bits, cost);
 
+                    if (m_param->bMEConfidence)
+                        countLowresMVSearch(lowresConf, lmv, outmv);
+
                     if (cost < bestME[list].cost)
                     {
                         bestME[list].mv      = outmv;
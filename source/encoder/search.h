@@ -286,6 +286,15 @@ public:
     int32_t         m_sliceMaxY;
     int32_t         m_sliceMinY;
 
+    /* motion search method and range of the current CTU, --adaptive-me */
+    int             m_searchMethod;
+    int             m_searchRange;
+
+    /* motion searches per lowres MV confidence and confident searches ending
+     * within a pixel of the lowres MV, --me-confidence */
+    uint32_t        m_lowresMVSearches[LOWRES_MV_CONFIDENCES];
+    uint32_t        m_lowresMVHits;
+
 #if DETAILED_CU_STATS
     /* Accumulate CU statistics separately for each frame encoder */
     CUStats         m_stats[X265_MAX_FRAME_THREADS];
@@ -327,7 +336,14 @@ public:
     void checkDQP(Mode& mode, const CUGeom& cuGeom);
     void checkDQPForSplitPred(Mode& mode, const CUGeom& cuGeom);
 
-    MV getLowresMV(const CUData& cu, const PredictionUnit& pu, int list, int ref);
+    MV getLowresMV(const CUData& cu, const PredictionUnit& pu, int list, int ref, int* confidence = NULL);
+    int lowresMotionSearch(const CUData& cu, int list, int ref, const MV& lmv, int confidence,
+                           int numMvc, const MV* mvc, int merange, MV& outmv);
+    void countLowresMVSearch(int confidence, const MV& lmv, const MV& outmv);
+    void collectLowresMVStats(FrameStats& stats);
+    void moveLowresMVStats(uint32_t* searches, uint32_t& hits);
+    void addLowresMVStats(const uint32_t* searches, uint32_t hits);
+    void setCTUSearch(const CUData& ctu);
 
     class PME : public BondedTaskGroup
     {
@@ -703,21 +703,16 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
 
 void LookaheadTLD::lowresIntraEstimate(Lowres& fenc, uint32_t qgSize)
 {
-    ALIGN_VAR_32(pixel, prediction[X265_LOWRES_CU_SIZE * X265_LOWRES_CU_SIZE]);
-    pixel fencIntra[X265_LOWRES_CU_SIZE * X265_LOWRES_CU_SIZE];
-    pixel neighbours[2][X265_LOWRES_CU_SIZE * 4 + 1];
-    pixel* samples = neighbours[0], *filtered = neighbours[1];
+    /* blocks handed to the batched intra cost primitive per call */
+    const int batchSize = 16;
+    int32_t batchCosts[batchSize];
+    uint8_t batchModes[batchSize];
 
     const int lookAheadLambda = (int)x265_lambda_tab[X265_LOOKAHEAD_QP];
     const int intraPenalty = 5 * lookAheadLambda;
     const int lowresPenalty = 4; /* fixed CU cost overhead */
 
     const int cuSize  = X265_LOWRES_CU_SIZE;
-    const int cuSize2 = cuSize << 1;
-    const int sizeIdx = X265_LOWRES_CU_BITS - 2;
-
-    pixelcmp_t satd = primitives.pu[sizeIdx].satd;
-    int planar = !!(cuSize >= 8);
 
     int costEst = 0, costEstAq = 0;
 
@@ -727,61 +722,17 @@ void LookaheadTLD::lowresIntraEstimate(Lowres& fenc, uint32_t qgSize)
 
         for (int cuX = 0; cuX < widthInCU; cuX++)
         {
-            const int cuXY = cuX + cuY * widthInCU;
-            const intptr_t pelOffset = cuSize * cuX + cuSize * cuY * fenc.lumaStride;
-            pixel *pixCur = fenc.lowresPlane[0] + pelOffset;
-
-            /* copy fenc pixels */
-            primitives.cu[sizeIdx].copy_pp(fencIntra, cuSize, pixCur, fenc.lumaStride);
-
-            /* collect reference sample pixels */
-            pixCur -= fenc.lumaStride + 1;
-            memcpy(samples, pixCur, (2 * cuSize + 1) * sizeof(pixel)); /* top */
-            for (int i = 1; i <= 2 * cuSize; i++)
-                samples[cuSize2 + i] = pixCur[i * fenc.lumaStride];    /* left */
-
-            primitives.cu[sizeIdx].intra_filter(samples, filtered);
-
-            int cost, icost = me.COST_MAX;
-            uint32_t ilowmode = 0;
-
-            /* DC and planar */
-            primitives.cu[sizeIdx].intra_pred[DC_IDX](prediction, cuSize, samples, 0, cuSize <= 16);
-            cost = satd(fencIntra, cuSize, prediction, cuSize);
-            COPY2_IF_LT(icost, cost, ilowmode, DC_IDX);
-
-            primitives.cu[sizeIdx].intra_pred[PLANAR_IDX](prediction, cuSize, neighbours[planar], 0, 0);
-            cost = satd(fencIntra, cuSize, prediction, cuSize);
-            COPY2_IF_LT(icost, cost, ilowmode, PLANAR_IDX);
-
-            /* scan angular predictions */
-            int filter, acost = me.COST_MAX;
-            uint32_t mode, alowmode = 4;
-            for (mode = 5; mode < 35; mode += 5)
-            {
-                filter = !!(g_intraFilterFlags[mode] & cuSize);
-                primitives.cu[sizeIdx].intra_pred[mode](prediction, cuSize, neighbours[filter], mode, cuSize <= 16);
-                cost = satd(fencIntra, cuSize, prediction, cuSize);
-                COPY2_IF_LT(acost, cost, alowmode, mode);
-            }
-            for (uint32_t dist = 2; dist >= 1; dist--)
+            const int batchIdx = cuX % batchSize;
+            if (!batchIdx)
             {
-                int minusmode = alowmode - dist;
-                int plusmode = alowmode + dist;
-
-                mode = minusmode;
-                filter = !!(g_intraFilterFlags[mode] & cuSize);
-                primitives.cu[sizeIdx].intra_pred[mode](prediction, cuSize, neighbours[filter], mode, cuSize <= 16);
-                cost = satd(fencIntra, cuSize, prediction, cuSize);
-                COPY2_IF_LT(acost, cost, alowmode, mode);
-
-                mode = plusmode;
-                filter = !!(g_intraFilterFlags[mode] & cuSize);
-                primitives.cu[sizeIdx].intra_pred[mode](prediction, cuSize, neighbours[filter], mode, cuSize <= 16);
-                cost = satd(fencIntra, cuSize, prediction, cuSize);
-                COPY2_IF_LT(acost, cost, alowmode, mode);
+                const intptr_t pelOffset = cuSize * cuX + cuSize * cuY * fenc.lumaStride;
+                int numBlocks = X265_MIN(batchSize, widthInCU - cuX);
+                primitives.lowresIntraCost(fenc.lowresPlane[0] + pelOffset, fenc.lumaStride, numBlocks, batchCosts, batchModes);
             }
-            COPY2_IF_LT(icost, acost, ilowmode, alowmode);
+
+            const int cuXY = cuX + cuY * widthInCU;
+            int icost = batchCosts[batchIdx];
+            uint32_t ilowmode = batchModes[batchIdx];
 
             icost += intraPenalty + lowresPenalty; /* estimate intra signal cost */
 
@@ -21,10 +21,18 @@
  * For more information, contact us at license @ x265.com.
  *****************************************************************************/
 
+#define _FILE_OFFSET_BITS 64
+#define _LARGEFILE_SOURCE
 #include "input.h"
 #include "yuv.h"
 #include "y4m.h"
 
+#if !_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace X265_NS;
 
 InputFile* InputFile::open(InputFileInfo& info, bool bForceY4m)
@@ -36,3 +44,73 @@ InputFile* InputFile::open(InputFileInfo& info, bool bForceY4m)
     else
         return new YUVInput(info);
 }
+
+bool MappedFile::map(FILE* fp)
+{
+#if _WIN32
+    (void)fp;
+    return false;
+#else
+    struct stat st;
+    int fd = fileno(fp);
+    if (fd < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return false;
+    if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX)
+        return false;
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        return false;
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    m_base = (char*)base;
+    m_size = st.st_size;
+    return true;
+#endif
+}
+
+void MappedFile::unmap()
+{
+#if !_WIN32
+    if (m_base)
+        munmap(m_base, (size_t)m_size);
+#endif
+    m_base = NULL;
+    m_size = 0;
+}
+
+void MappedFile::discard(const char* p, int64_t len) const
+{
+#if !_WIN32
+    if (!m_base || p < m_base || len <= 0)
+        return;
+
+    /* only pages wholly inside the range, the neighbouring frames may still
+     * be in use */
+    int64_t page = sysconf(_SC_PAGESIZE);
+    int64_t start = (p - m_base + page - 1) & ~(page - 1);
+    int64_t end = X265_MIN(p - m_base + len, m_size) & ~(page - 1);
+    if (end > start)
+        madvise(m_base + start, (size_t)(end - start), MADV_DONTNEED);
+#else
+    (void)p;
+    (void)len;
+#endif
+}
+
+void MappedFile::prefetch(int64_t offset, int64_t len) const
+{
+#if !_WIN32
+    if (!m_base || offset >= m_size || len <= 0)
+        return;
+    if (offset + len > m_size)
+        len = m_size - offset;
+
+    int64_t page = sysconf(_SC_PAGESIZE);
+    int64_t start = offset & ~(page - 1);
+    madvise(m_base + start, (size_t)(offset + len - start), MADV_WILLNEED);
+#else
+    (void)offset;
+    (void)len;
+#endif
+}
@@ -56,6 +56,41 @@ struct InputFileInfo
     const char *filename;
 };
 
+/* Private, read-only view of a whole regular file. Frames handed out from
+ * the mapping stay valid until it is unmapped, so readers need neither a ring
+ * buffer nor a copy; the kernel page cache does the buffering */
+class MappedFile
+{
+public:
+
+    MappedFile() : m_base(NULL), m_size(0) {}
+
+    ~MappedFile()                 { unmap(); }
+
+    /* returns false for pipes, devices, or when the address space is short */
+    bool map(FILE* fp);
+
+    void unmap();
+
+    /* drop the pages of a consumed byte range from the process, they are
+     * read again from the page cache if touched later */
+    void discard(const char* p, int64_t len) const;
+
+    /* start asynchronous read-ahead of a byte range */
+    void prefetch(int64_t offset, int64_t len) const;
+
+    bool isMapped() const         { return !!m_base; }
+
+    char* data() const            { return m_base; }
+
+    int64_t size() const          { return m_size; }
+
+protected:
+
+    char*   m_base;
+    int64_t m_size;
+};
+
 class InputFile
 {
 protected:
@@ -78,6 +113,14 @@ public:
 
     virtual bool isFail() = 0;
 
+    /* true when pictures returned by readPicture() stay valid until release(),
+     * callers may then keep the plane pointers instead of copying the frame */
+    virtual bool isMapped() const { return false; }
+
+    /* a mapped reader releases the memory of a picture no encoder reads
+     * any more; the picture must not be touched afterwards */
+    virtual void releasePicture(const x265_picture&) {}
+
     virtual const char *getName() const = 0;
 
     virtual int getWidth() const = 0;
@@ -55,6 +55,7 @@ Y4MInput::Y4MInput(InputFileInfo& info)
     rateDenom = info.fpsDenom;
     depth = info.depth;
     framesize = 0;
+    mapPos = 0;
 
     ifs = NULL;
     if (!strcmp(info.filename, "-"))
@@ -76,14 +77,18 @@ Y4MInput::Y4MInput(InputFileInfo& info)
         }
 
         threadActive = true;
-        for (int q = 0; q < QUEUE_SIZE; q++)
+        /* regular files are mapped and read in place, pipes go through the ring */
+        if (ifs == stdin || !map.map(ifs))
         {
-            buf[q] = X265_MALLOC(char, framesize);
-            if (!buf[q])
+            for (int q = 0; q < QUEUE_SIZE; q++)
             {
-                x265_log(NULL, X265_LOG_ERROR, "y4m: buffer allocation failure, aborting");
-                threadActive = false;
-                break;
+                buf[q] = X265_MALLOC(char, framesize);
+                if (!buf[q])
+                {
+                    x265_log(NULL, X265_LOG_ERROR, "y4m: buffer allocation failure, aborting");
+                    threadActive = false;
+                    break;
+                }
             }
         }
     }
@@ -118,7 +123,16 @@ Y4MInput::Y4MInput(InputFileInfo& info)
                 info.frameCount = (int)((size - cur) / estFrameSize);
         }
     }
-    if (info.skipFrames)
+    if (map.isMapped())
+    {
+        /* frame headers are parsed in place, so skipping is exact */
+        mapPos = ftello(ifs);
+        for (int i = 0; i < info.skipFrames; i++)
+            if (!nextMappedFrame())
+                break;
+        map.prefetch(mapPos, (int64_t)estFrameSize * QUEUE_SIZE);
+    }
+    else if (info.skipFrames)
     {
         if (ifs != stdin)
             fseeko(ifs, (int64_t)estFrameSize * info.skipFrames, SEEK_CUR);
@@ -130,6 +144,7 @@ Y4MInput::Y4MInput(InputFileInfo& info)
 }
 Y4MInput::~Y4MInput()
 {
+    map.unmap();
     if (ifs && ifs != stdin)
         fclose(ifs);
     for (int i = 0; i < QUEUE_SIZE; i++)
@@ -311,7 +326,7 @@ bool Y4MInput::parseHeader()
 void Y4MInput::startReader()
 {
 #if ENABLE_THREADING
-    if (threadActive)
+    if (threadActive && !map.isMapped())
         start();
 #endif
 }
@@ -365,8 +380,41 @@ bool Y4MInput::populateFrameQueue()
         return false;
 }
 
+char* Y4MInput::nextMappedFrame()
+{
+    char* data = map.data();
+    int64_t size = map.size();
+    if (mapPos + (int64_t)sizeof(header) + 1 > size || memcmp(data + mapPos, header, sizeof(header)))
+    {
+        if (mapPos < size)
+            x265_log(NULL, X265_LOG_ERROR, "y4m: frame header missing\n");
+        return NULL;
+    }
+    /* consume bytes up to line feed */
+    char* lf = (char*)memchr(data + mapPos + sizeof(header), '\n', (size_t)(size - mapPos - sizeof(header)));
+    if (!lf || (lf + 1 - data) + (int64_t)framesize > size)
+        return NULL;
+
+    char* frame = lf + 1;
+    mapPos = (frame - data) + framesize;
+    return frame;
+}
+
 bool Y4MInput::readPicture(x265_picture& pic)
 {
+    if (map.isMapped())
+    {
+        char* frame = threadActive ? nextMappedFrame() : NULL;
+        if (!frame)
+            return false;
+
+        fillPicture(pic, frame);
+        /* keep the kernel QUEUE_SIZE frames ahead of the encoder */
+        int64_t frameBytes = (int64_t)framesize + sizeof(header) + 1;
+        map.prefetch(mapPos + frameBytes * (QUEUE_SIZE - 1), frameBytes);
+        return true;
+    }
+
     int read = readCount.get();
     int written = writeCount.get();
 
@@ -384,18 +432,7 @@ bool Y4MInput::readPicture(x265_picture& pic)
 
     if (read < written)
     {
-        int pixelbytes = depth > 8 ? 2 : 1;
-        pic.bitDepth = depth;
-        pic.framesize = framesize;
-        pic.height = height;
-        pic.width = width;
-        pic.colorSpace = colorSpace;
-        pic.stride[0] = width * pixelbytes;
-        pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
-        pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
-        pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
-        pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+        fillPicture(pic, buf[read % QUEUE_SIZE]);
         readCount.incr();
         return true;
     }
@@ -403,3 +440,19 @@ bool Y4MInput::readPicture(x265_picture& pic)
         return false;
 }
 
+void Y4MInput::fillPicture(x265_picture& pic, char* frame)
+{
+    int pixelbytes = depth > 8 ? 2 : 1;
+    pic.bitDepth = depth;
+    pic.framesize = framesize;
+    pic.height = height;
+    pic.width = width;
+    pic.colorSpace = colorSpace;
+    pic.stride[0] = width * pixelbytes;
+    pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
+    pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
+    pic.planes[0] = frame;
+    pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
+    pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+}
+
@@ -62,22 +62,32 @@ protected:
     ThreadSafeInteger writeCount;
     char* buf[QUEUE_SIZE];
     FILE *ifs;
+    MappedFile map;
+    int64_t mapPos;
     bool parseHeader();
     void threadMain();
 
     bool populateFrameQueue();
 
+    char* nextMappedFrame();
+
+    void fillPicture(x265_picture& pic, char* frame);
+
 public:
 
     Y4MInput(InputFileInfo& info);
 
     virtual ~Y4MInput();
     void release();
-    bool isEof() const            { return ifs && feof(ifs); }
+    bool isEof() const            { return map.isMapped() ? mapPos + (int64_t)framesize > map.size() : ifs && feof(ifs); }
     bool isFail()                 { return !(ifs && !ferror(ifs) && threadActive); }
     void startReader();
     bool readPicture(x265_picture&);
 
+    bool isMapped() const         { return map.isMapped(); }
+
+    void releasePicture(const x265_picture& pic) { map.discard((const char*)pic.planes[0], pic.framesize); }
+
     const char *getName() const   { return "y4m"; }
 
     int getWidth() const                          { return width; }
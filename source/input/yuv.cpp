@@ -51,6 +51,7 @@ YUVInput::YUVInput(InputFileInfo& info)
     colorSpace = info.csp;
     threadActive = false;
     ifs = NULL;
+    mapPos = 0;
 
     uint32_t pixelbytes = depth > 8 ? 2 : 1;
     framesize = 0;
@@ -85,14 +86,18 @@ YUVInput::YUVInput(InputFileInfo& info)
         return;
     }
 
-    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+    /* regular files are mapped and read in place, pipes go through the ring */
+    if (ifs == stdin || !map.map(ifs))
     {
-        buf[i] = X265_MALLOC(char, framesize);
-        if (buf[i] == NULL)
+        for (uint32_t i = 0; i < QUEUE_SIZE; i++)
         {
-            x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
-            threadActive = false;
-            return;
+            buf[i] = X265_MALLOC(char, framesize);
+            if (buf[i] == NULL)
+            {
+                x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
+                threadActive = false;
+                return;
+            }
         }
     }
 
@@ -119,9 +124,15 @@ YUVInput::YUVInput(InputFileInfo& info)
                 if (fread(buf[0], framesize, 1, ifs) != 1)
                     break;
     }
+    if (map.isMapped())
+    {
+        mapPos = ftello(ifs);
+        map.prefetch(mapPos, (int64_t)framesize * QUEUE_SIZE);
+    }
 }
 YUVInput::~YUVInput()
 {
+    map.unmap();
     if (ifs && ifs != stdin)
         fclose(ifs);
     for (int i = 0; i < QUEUE_SIZE; i++)
@@ -139,7 +150,7 @@ void YUVInput::release()
 void YUVInput::startReader()
 {
 #if ENABLE_THREADING
-    if (threadActive)
+    if (threadActive && !map.isMapped())
         start();
 #endif
 }
@@ -182,6 +193,18 @@ bool YUVInput::populateFrameQueue()
 
 bool YUVInput::readPicture(x265_picture& pic)
 {
+    if (map.isMapped())
+    {
+        if (!threadActive || mapPos + framesize > map.size())
+            return false;
+
+        fillPicture(pic, map.data() + mapPos);
+        mapPos += framesize;
+        /* keep the kernel QUEUE_SIZE frames ahead of the encoder */
+        map.prefetch(mapPos + (int64_t)framesize * (QUEUE_SIZE - 1), framesize);
+        return true;
+    }
+
     int read = readCount.get();
     int written = writeCount.get();
 
@@ -199,21 +222,26 @@ bool YUVInput::readPicture(x265_picture& pic)
 
     if (read < written)
     {
-        uint32_t pixelbytes = depth > 8 ? 2 : 1;
-        pic.colorSpace = colorSpace;
-        pic.bitDepth = depth;
-        pic.framesize = framesize;
-        pic.height = height;
-        pic.width = width;
-        pic.stride[0] = width * pixelbytes;
-        pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
-        pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
-        pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
-        pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+        fillPicture(pic, buf[read % QUEUE_SIZE]);
         readCount.incr();
         return true;
     }
     else
         return false;
 }
+
+void YUVInput::fillPicture(x265_picture& pic, char* frame)
+{
+    uint32_t pixelbytes = depth > 8 ? 2 : 1;
+    pic.colorSpace = colorSpace;
+    pic.bitDepth = depth;
+    pic.framesize = framesize;
+    pic.height = height;
+    pic.width = width;
+    pic.stride[0] = width * pixelbytes;
+    pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
+    pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
+    pic.planes[0] = frame;
+    pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
+    pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+}
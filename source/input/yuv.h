@@ -54,23 +54,31 @@ protected:
     ThreadSafeInteger writeCount;
     char* buf[QUEUE_SIZE];
     FILE *ifs;
+    MappedFile map;
+    int64_t mapPos;
     int guessFrameCount();
     void threadMain();
 
     bool populateFrameQueue();
 
+    void fillPicture(x265_picture& pic, char* frame);
+
 public:
 
     YUVInput(InputFileInfo& info);
 
     virtual ~YUVInput();
     void release();
-    bool isEof() const                            { return ifs && feof(ifs); }
+    bool isEof() const                            { return map.isMapped() ? mapPos + framesize > map.size() : ifs && feof(ifs); }
     bool isFail()                                 { return !(ifs && !ferror(ifs) && threadActive); }
     void startReader();
 
     bool readPicture(x265_picture&);
 
+    bool isMapped() const                         { return map.isMapped(); }
+
+    void releasePicture(const x265_picture& pic)  { map.discard((const char*)pic.planes[0], pic.framesize); }
+
     const char *getName() const                   { return "yuv"; }
 
     int getWidth() const                          { return width; }
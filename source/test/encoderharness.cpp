@@ -0,0 +1,477 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * Authors: Min Chen <chenm003@163.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "frame.h"
+#include "picyuv.h"
+#include "temporalfilter.h"
+#include "nal.h"
+#include "modedecision.h"
+#include "encoderharness.h"
+
+using namespace X265_NS;
+
+namespace {
+
+/* textured planes moved by (dx, dy) luma samples, with a little noise for
+ * the bilateral filter, borders extended like the encoder's input pictures */
+void fillPicture(PicYuv& pic, int dx, int dy)
+{
+    int planes = pic.m_picCsp != X265_CSP_I400 ? 3 : 1;
+    for (int c = 0; c < planes; c++)
+    {
+        int hShift = c ? pic.m_hChromaShift : 0;
+        int vShift = c ? pic.m_vChromaShift : 0;
+        int width = pic.m_picWidth >> hShift;
+        int height = pic.m_picHeight >> vShift;
+        intptr_t stride = c ? pic.m_strideC : pic.m_stride;
+        pixel* plane = pic.m_picOrg[c];
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                int u = x + (dx >> hShift), v = y + (dy >> vShift);
+                int val = ((u * 5 + v * 3) & 127) + (((u >> 3) ^ (v >> 3)) & 7) * 12 + c * 16 + rand() % 7;
+                plane[y * stride + x] = (pixel)(val << (X265_DEPTH - 8));
+            }
+        }
+
+        extendPicBorder(plane, stride, width, height, c ? pic.m_chromaMarginX : pic.m_lumaMarginX, c ? pic.m_chromaMarginY : pic.m_lumaMarginY);
+    }
+}
+
+void subsampleLuma(PicYuv& dst, const PicYuv& src)
+{
+    primitives.frameSubSampleLuma(src.m_picOrg[0], dst.m_picOrg[0], src.m_stride, dst.m_stride, dst.m_picWidth, dst.m_picHeight);
+    extendPicBorder(dst.m_picOrg[0], dst.m_stride, dst.m_picWidth, dst.m_picHeight, dst.m_lumaMarginX, dst.m_lumaMarginY);
+}
+
+/* pool workers start out on the first job provider of the pool */
+class IdleProvider : public JobProvider
+{
+public:
+
+    void findJob(int) {}
+};
+
+bool samePicture(const PicYuv& a, const PicYuv& b)
+{
+    int planes = a.m_picCsp != X265_CSP_I400 ? 3 : 1;
+    for (int c = 0; c < planes; c++)
+    {
+        int width = a.m_picWidth >> (c ? a.m_hChromaShift : 0);
+        int height = a.m_picHeight >> (c ? a.m_vChromaShift : 0);
+        intptr_t stride = c ? a.m_strideC : a.m_stride;
+        for (int y = 0; y < height; y++)
+            if (memcmp(a.m_picOrg[c] + y * stride, b.m_picOrg[c] + y * stride, width * sizeof(pixel)))
+                return false;
+    }
+
+    return true;
+}
+
+/* emulation prevention one byte at a time, as the spec describes it */
+uint32_t escapeBytesRef(uint8_t* out, const uint8_t* src, uint32_t size, int& zeros)
+{
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        if (zeros == 2 && src[i] <= 0x03)
+        {
+            out[bytes++] = 0x03;
+            zeros = 0;
+        }
+        zeros = src[i] ? 0 : zeros + 1;
+        out[bytes++] = src[i];
+    }
+
+    return bytes;
+}
+
+/* load a model file with the given contents */
+bool loadModel(ModeDecisionModel& model, const char* text, x265_param* param)
+{
+    const char* filename = "testbench-md-model.txt";
+    FILE* fp = fopen(filename, "w");
+    if (!fp)
+        return false;
+    fputs(text, fp);
+    fclose(fp);
+
+    bool ok = model.load(filename, param);
+    remove(filename);
+    return ok;
+}
+
+}
+
+EncoderHarness::EncoderHarness()
+{
+    m_bTested = false;
+}
+
+/* The motion estimation levels and the bilateral filter of MCSTF are split in
+ * block-row jobs for bonded pool workers; the result must not depend on which
+ * thread ran a row or in which order, so it is compared with a filter that
+ * has no pool and runs every row on the calling thread */
+bool EncoderHarness::check_mcstf_row_jobs()
+{
+    static const int csps[] = { X265_CSP_I420, X265_CSP_I444 };
+    static const int16_t offsets[MCSTF_REFS] = { -2, -1, 1, 2 };
+    static const int shifts[MCSTF_REFS][2] = { { -6, 3 }, { -3, 1 }, { 2, -2 }, { 5, -4 } };
+
+    x265_param* param = x265_param_alloc();
+    ThreadPool pool;
+    IdleProvider provider;
+    if (!param || !pool.create(MCSTF_WORKERS, 1, 1))
+    {
+        x265_param_free(param);
+        return false;
+    }
+
+    provider.m_pool = &pool;
+    provider.m_jpId = pool.m_numProviders++;
+    pool.m_jpTable[provider.m_jpId] = &provider;
+    if (!pool.start())
+    {
+        x265_param_free(param);
+        return false;
+    }
+
+    /* workers can only be bonded once they sleep */
+    for (int i = 0; i < MCSTF_WORKERS; i++)
+        while (!pool.m_sleepBitmap.isSet(i))
+            GIVE_UP_TIME();
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < sizeof(csps) / sizeof(csps[0]); i++)
+    {
+        x265_param_default(param);
+        param->sourceWidth = MCSTF_WIDTH;
+        param->sourceHeight = MCSTF_HEIGHT;
+        param->internalCsp = csps[i];
+
+        PicYuv orig, origSub2, origSub4;
+        PicYuv refPic[MCSTF_REFS], refSub2[MCSTF_REFS], refSub4[MCSTF_REFS];
+        orig.create(param);
+        origSub2.createScaledPicYUV(param, 2);
+        origSub4.createScaledPicYUV(param, 4);
+        fillPicture(orig, 0, 0);
+        subsampleLuma(origSub2, orig);
+        subsampleLuma(origSub4, origSub2);
+        for (int r = 0; r < MCSTF_REFS; r++)
+        {
+            refPic[r].create(param);
+            refSub2[r].createScaledPicYUV(param, 2);
+            refSub4[r].createScaledPicYUV(param, 4);
+            fillPicture(refPic[r], shifts[r][0], shifts[r][1]);
+            subsampleLuma(refSub2[r], refPic[r]);
+            subsampleLuma(refSub4[r], refSub2[r]);
+        }
+
+        /* [0] without a pool, [1] with row jobs */
+        TemporalFilter* filter[2];
+        PicYuv filtered[2];
+        TemporalFilterRefPicInfo refs[2][MCSTF_REFS];
+        memset(refs, 0, sizeof(refs));
+        for (int j = 0; j < 2; j++)
+        {
+            filter[j] = new TemporalFilter;
+            filter[j]->init(param);
+            filter[j]->create(j ? &pool : NULL);
+            filter[j]->m_QP = 32;
+            filter[j]->m_numRef = MCSTF_REFS;
+
+            filtered[j].create(param);
+            filtered[j].copyFromFrame(&orig);
+
+            for (int r = 0; r < MCSTF_REFS; r++)
+            {
+                filter[j]->createRefPicInfo(&refs[j][r], param);
+                refs[j][r].picBuffer = &refPic[r];
+                refs[j][r].picBufferSubSampled2 = &refSub2[r];
+                refs[j][r].picBufferSubSampled4 = &refSub4[r];
+                refs[j][r].origOffset = offsets[r];
+            }
+
+            Frame frame;
+            frame.m_fencPic = &filtered[j];
+            frame.m_fencPicSubsampled2 = &origSub2;
+            frame.m_fencPicSubsampled4 = &origSub4;
+            frame.m_mcstf = filter[j];
+            filter[j]->motionEstimation(&frame, refs[j], MCSTF_REFS);
+            filter[j]->bilateralFilter(&frame, refs[j], param->temporalFilterStrength);
+        }
+
+        const int blocks4 = (MCSTF_WIDTH / 4) * (MCSTF_HEIGHT / 4);
+        const int blocks16 = (MCSTF_WIDTH / 16) * (MCSTF_HEIGHT / 16);
+        for (int r = 0; r < MCSTF_REFS; r++)
+        {
+            const TemporalFilterRefPicInfo& a = refs[0][r];
+            const TemporalFilterRefPicInfo& b = refs[1][r];
+            if (memcmp(a.mvs0, b.mvs0, blocks16 * sizeof(MV)) ||
+                memcmp(a.mvs1, b.mvs1, blocks16 * sizeof(MV)) ||
+                memcmp(a.mvs2, b.mvs2, blocks16 * sizeof(MV)) ||
+                memcmp(a.mvs, b.mvs, blocks4 * sizeof(MV)) ||
+                memcmp(a.error, b.error, blocks4 * sizeof(int)))
+            {
+                printf("mcstf csp %d: motion of reference %d differs\n", csps[i], offsets[r]);
+                ok = false;
+            }
+        }
+
+        if (ok && !samePicture(filtered[0], filtered[1]))
+        {
+            printf("mcstf csp %d: filtered picture differs\n", csps[i]);
+            ok = false;
+        }
+
+        for (int j = 0; j < 2; j++)
+        {
+            for (int r = 0; r < MCSTF_REFS; r++)
+                filter[j]->destroyRefPicInfo(&refs[j][r]);
+            delete filter[j];
+            filtered[j].destroy();
+        }
+        for (int r = 0; r < MCSTF_REFS; r++)
+        {
+            refPic[r].destroy();
+            refSub2[r].destroy();
+            refSub4[r].destroy();
+        }
+        orig.destroy();
+        origSub2.destroy();
+        origSub4.destroy();
+    }
+
+    pool.stopWorkers();
+    x265_param_free(param);
+    return ok;
+}
+
+/* escapeBytes() skips zero-free spans eight bytes at a time; compare it with
+ * the byte-wise reference on 00 00 0x patterns at every offset of a word, in
+ * the tail bytes and across calls, and on zero-heavy random buffers */
+bool EncoderHarness::check_escape_bytes()
+{
+    uint8_t src[ESCAPE_MAX_SIZE + 8];
+    uint8_t outRef[2 * ESCAPE_MAX_SIZE];
+    uint8_t outOpt[2 * ESCAPE_MAX_SIZE];
+
+    for (int i = 0; i < ESCAPE_ITERS; i++)
+    {
+        uint32_t size;
+        int offset = rand() & 7;
+        uint8_t* buf = src + offset;
+        if (i < 24 * 5)
+        {
+            /* 00 00 x placed at each position of a 24 byte buffer */
+            int pos = i / 5;
+            size = 24;
+            memset(buf, 0xAA, size);
+            buf[pos] = 0;
+            if (pos + 1 < (int)size)
+                buf[pos + 1] = 0;
+            if (pos + 2 < (int)size)
+                buf[pos + 2] = (uint8_t)(i % 5);
+        }
+        else
+        {
+            size = rand() % (ESCAPE_MAX_SIZE + 1);
+            for (uint32_t j = 0; j < size; j++)
+            {
+                int r = rand() % 8;
+                buf[j] = r < 4 ? 0 : r < 6 ? (uint8_t)(rand() & 3) : (uint8_t)rand();
+            }
+        }
+
+        int zerosIn = rand() % 3;
+        int zerosRef = zerosIn, zerosOpt = zerosIn;
+        memset(outRef, 0xCD, sizeof(outRef));
+        memset(outOpt, 0xCD, sizeof(outOpt));
+
+        /* split the buffer in two calls, the zero count carries over */
+        uint32_t split = size ? rand() % (size + 1) : 0;
+        uint32_t bytesRef = escapeBytesRef(outRef, buf, size, zerosRef);
+        uint32_t bytesOpt = escapeBytes(outOpt, buf, split, zerosOpt);
+        bytesOpt += escapeBytes(outOpt + bytesOpt, buf + split, size - split, zerosOpt);
+
+        if (bytesRef != bytesOpt || zerosRef != zerosOpt || memcmp(outRef, outOpt, bytesRef))
+        {
+            printf("escapeBytes: size %u, split %u, %d zeros in: wrote %u bytes, expected %u\n",
+                   size, split, zerosIn, bytesOpt, bytesRef);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* the --md-model parser must keep the entries of the encoder's cost type,
+ * score them as documented and reject every malformed file */
+bool EncoderHarness::check_md_model()
+{
+    typedef ModeDecisionModel MD;
+
+    static const char* const validModel =
+        "# early-termination model\n"
+        "split sa8d 0 linear 0.5  1.0 0.25 0 0 0 0 -1  # bias, w0..w5\n"
+        "rect rd 1 tree 0.5 3  2 1.5 1 2  -1 0 0 0  -1 1 0 0\n"
+        "rect sa8d 2 tree 0.5 3  0 3.0 1 2  -1 0.25 0 0  -1 0.75 0 0\n";
+
+    static const char* const badModels[] =
+    {
+        "",
+        "# only a comment\n",
+        "rect rd 1 linear 0.5 0 0 0 0 0 0 0\n",              // no entry of the sa8d cost type
+        "merge sa8d 0 linear 0.5 0 0 0 0 0 0 0\n",           // unknown decision
+        "split sad 0 linear 0.5 0 0 0 0 0 0 0\n",            // unknown cost type
+        "split 0 linear 0.5 0 0 0 0 0 0 0\n",                // no cost type
+        "split sa8d 4 linear 0.5 0 0 0 0 0 0 0\n",           // depth out of range
+        "split sa8d -1 linear 0.5 0 0 0 0 0 0 0\n",
+        "split sa8d 0 logistic 0.5 0 0 0 0 0 0 0\n",         // unknown entry type
+        "split sa8d 0 linear 0.5 1 2 3\n",                   // missing weights
+        "split sa8d 0 linear 0.5x 0 0 0 0 0 0 0\n",          // not a number
+        "split sa8d 0 tree 0.5 0\n",                         // no nodes
+        "split sa8d 0 tree 0.5 256 -1 0 0 0\n",              // too many nodes
+        "split sa8d 0 tree 0.5 2  0 1.0 0 1  -1 0 0 0\n",    // child before its parent
+        "split sa8d 0 tree 0.5 2  0 1.0 1 2  -1 0 0 0\n",    // child past the last node
+        "split sa8d 0 tree 0.5 2  6 1.0 1 1  -1 0 0 0\n",    // feature out of range
+        "split sa8d 0 tree 0.5 2  -2 1.0 1 1  -1 0 0 0\n",   // bad leaf
+        "split sa8d 0 tree 0.5 2  0 1.0 1 1\n",              // truncated tree
+        "split sa8d 0 linear 0.5 0 0 0 0 0 0 0\n"
+        "split rd 0 linear 0.5 0 0\n",                       // malformed entry of the other cost type
+    };
+
+    x265_param* param = x265_param_alloc();
+    if (!param)
+        return false;
+    x265_param_default(param);
+    param->logLevel = X265_LOG_NONE;
+
+    double features[MD::MDF_FEATURES];
+    memset(features, 0, sizeof(features));
+    bool ok = true;
+
+    /* --rd 3: the sa8d entries, the rd entry is dropped */
+    param->rdLevel = 3;
+    {
+        MD model;
+        ok &= loadModel(model, validModel, param) && model.hasModel();
+
+        /* 1 + 0.25 * 2 = 1.5 is kept, 1 - 1 = 0 is skipped */
+        features[MD::MDF_VARIANCE] = 2;
+        features[MD::MDF_SKIP] = 0;
+        ok &= !model.skip(MD::MD_SPLIT, 0, features);
+        features[MD::MDF_VARIANCE] = 0;
+        features[MD::MDF_SKIP] = 1;
+        ok &= model.skip(MD::MD_SPLIT, 0, features);
+
+        /* tree on feature 0: left leaf 0.25 is skipped, right leaf 0.75 kept */
+        features[MD::MDF_VARIANCE] = 2.9;
+        ok &= model.skip(MD::MD_RECT, 2, features);
+        features[MD::MDF_VARIANCE] = 3.0;
+        ok &= !model.skip(MD::MD_RECT, 2, features);
+
+        /* decisions without an entry of this cost type are always evaluated */
+        features[MD::MDF_LOWRES_COST] = 0;
+        ok &= !model.skip(MD::MD_RECT, 1, features);
+        ok &= !model.skip(MD::MD_SPLIT, 1, features);
+        if (!ok)
+            printf("md-model: sa8d cost entries not loaded or scored as expected\n");
+    }
+
+    /* --rd 6: only the rd entry */
+    param->rdLevel = 6;
+    if (ok)
+    {
+        MD model;
+        ok &= loadModel(model, validModel, param) && model.hasModel();
+
+        features[MD::MDF_LOWRES_COST] = 1.0;
+        ok &= model.skip(MD::MD_RECT, 1, features);
+        features[MD::MDF_LOWRES_COST] = 1.5;
+        ok &= !model.skip(MD::MD_RECT, 1, features);
+
+        features[MD::MDF_VARIANCE] = 0;
+        features[MD::MDF_SKIP] = 1;
+        ok &= !model.skip(MD::MD_SPLIT, 0, features);
+        ok &= !model.skip(MD::MD_RECT, 2, features);
+        if (!ok)
+            printf("md-model: rd cost entries not loaded or scored as expected\n");
+    }
+
+    param->rdLevel = 3;
+    for (size_t i = 0; ok && i < sizeof(badModels) / sizeof(badModels[0]); i++)
+    {
+        MD model;
+        if (loadModel(model, badModels[i], param) || model.hasModel())
+        {
+            printf("md-model: accepted bad model file \"%s\"\n", badModels[i]);
+            ok = false;
+        }
+    }
+
+    x265_param_free(param);
+    return ok;
+}
+
+bool EncoderHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives&)
+{
+    /* these checks do not depend on the optimized primitives, run them once
+     * with the C primitives in the global table */
+    if (m_bTested)
+        return true;
+    m_bTested = true;
+
+    EncoderPrimitives saved;
+    memcpy(&saved, &primitives, sizeof(EncoderPrimitives));
+    memcpy(&primitives, &ref, sizeof(EncoderPrimitives));
+
+    bool ok = true;
+    if (!check_mcstf_row_jobs())
+    {
+        printf("mcstf row jobs failed\n");
+        ok = false;
+    }
+
+    if (!check_escape_bytes())
+    {
+        printf("escape bytes failed\n");
+        ok = false;
+    }
+
+    if (!check_md_model())
+    {
+        printf("md model parser failed\n");
+        ok = false;
+    }
+
+    memcpy(&primitives, &saved, sizeof(EncoderPrimitives));
+    return ok;
+}
+
+void EncoderHarness::measureSpeed(const EncoderPrimitives&, const EncoderPrimitives&)
+{
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2020 MulticoreWare, Inc
+ *
+ * Authors: Min Chen <chenm003@163.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef _ENCODERHARNESS_H_1
+#define _ENCODERHARNESS_H_1 1
+
+#include "testharness.h"
+#include "primitives.h"
+
+/* Checks of encoder tools that are built on the primitives but are not
+ * primitives themselves. They run once against the C primitive table */
+class EncoderHarness : public TestHarness
+{
+protected:
+
+    enum { MCSTF_WIDTH = 256 };
+    enum { MCSTF_HEIGHT = 144 };
+    enum { MCSTF_REFS = 4 };
+    enum { MCSTF_WORKERS = 4 };
+    enum { ESCAPE_MAX_SIZE = 96 };
+    enum { ESCAPE_ITERS = 20000 };
+
+    bool m_bTested;
+
+    bool check_mcstf_row_jobs();
+    bool check_escape_bytes();
+    bool check_md_model();
+
+public:
+
+    EncoderHarness();
+
+    const char *getName() const { return "encoder"; }
+
+    bool testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+
+    void measureSpeed(const EncoderPrimitives& ref, const EncoderPrimitives& opt);
+};
+
+#endif // ifndef _ENCODERHARNESS_H_1
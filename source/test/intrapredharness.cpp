@@ -210,6 +210,48 @@ bool IntraPredHarness::check_intra_filter_primitive(const intra_filter_t ref, co
     }
     return true;
 }
+
+bool IntraPredHarness::check_lowres_intra_cost(lowres_intra_cost_t ref, lowres_intra_cost_t opt)
+{
+    const int maxBlocks = 12;
+    const intptr_t stride = 2 * STRIDE;
+    int32_t ref_costs[maxBlocks], opt_costs[maxBlocks];
+    uint8_t ref_modes[maxBlocks], opt_modes[maxBlocks];
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int numBlocks = 1 + rand() % maxBlocks;
+
+        /* neighbours are read above and left of the first block */
+        const pixel* src = pixel_buff + j + stride + 8;
+        ref(src, stride, numBlocks, ref_costs, ref_modes);
+        checked(opt, src, stride, numBlocks, opt_costs, opt_modes);
+
+        if (memcmp(ref_costs, opt_costs, numBlocks * sizeof(int32_t)) ||
+            memcmp(ref_modes, opt_modes, numBlocks * sizeof(uint8_t)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    /* flat minimum and maximum pictures */
+    for (int index = 1; index < TEST_CASES; index++)
+    {
+        const pixel* src = pixel_test_buff[index] + STRIDE + 8;
+        ref(src, STRIDE, 4, ref_costs, ref_modes);
+        checked(opt, src, STRIDE, 4, opt_costs, opt_modes);
+
+        if (memcmp(ref_costs, opt_costs, 4 * sizeof(int32_t)) || memcmp(ref_modes, opt_modes, 4))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
 bool IntraPredHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPrimitives& opt)
 {
     for (int i = BLOCK_4x4; i <= BLOCK_32x32; i++)
@@ -256,6 +298,15 @@ bool IntraPredHarness::testCorrectness(const EncoderPrimitives& ref, const Encod
         }
     }
 
+    if (opt.lowresIntraCost)
+    {
+        if (!check_lowres_intra_cost(ref.lowresIntraCost, opt.lowresIntraCost))
+        {
+            printf("lowresIntraCost failed\n");
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -315,4 +366,12 @@ void IntraPredHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderP
             REPORT_SPEEDUP(opt.cu[i].intra_filter, ref.cu[i].intra_filter, pixel_buff, pixel_out_c);
         }
     }
+
+    if (opt.lowresIntraCost)
+    {
+        int32_t costs[12];
+        uint8_t modes[12];
+        printf("lowresIntraCost[12 blocks]");
+        REPORT_SPEEDUP(opt.lowresIntraCost, ref.lowresIntraCost, pixel_buff + 2 * STRIDE + 8, 2 * STRIDE, 12, costs, modes);
+    }
 }
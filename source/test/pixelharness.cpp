@@ -2346,6 +2346,306 @@ bool PixelHarness::check_normFact(normFactor_t ref, normFactor_t opt, int block)
     return true;
 }
 
+bool PixelHarness::check_mcstf_motion_error(mcstf_motion_error_t ref, mcstf_motion_error_t opt)
+{
+    /* leave room for the 6-tap filter support above and left of the block */
+    const int offset = 3 * STRIDE + 3;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index1 = rand() % TEST_CASES;
+        int index2 = rand() % TEST_CASES;
+        int bs = (rand() & 1) ? 16 : 8;
+        int fracX = rand() & 15;
+        int fracY = rand() & 15;
+        int bestError = (rand() & 1) ? INT_MAX : rand() % (bs * bs * 64);
+
+        int ref_err = ref(pixel_test_buff[index1] + offset + j, STRIDE, pixel_test_buff[index2] + offset + j, STRIDE, bs, fracX, fracY, bestError);
+        int opt_err = (int)checked(opt, pixel_test_buff[index1] + offset + j, STRIDE, pixel_test_buff[index2] + offset + j, STRIDE, bs, fracX, fracY, bestError);
+
+        if (ref_err != opt_err)
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_mcstf_apply_motion(mcstf_apply_motion_t ref, mcstf_apply_motion_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[64 * 64]);
+    ALIGN_VAR_16(pixel, opt_dest[64 * 64]);
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    const int offset = 3 * STRIDE + 3;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        int width = 4 << (rand() % 3);
+        int height = 4 << (rand() % 3);
+        int fracX = rand() & 15;
+        int fracY = rand() & 15;
+
+        ref(pixel_test_buff[index] + offset + j, STRIDE, ref_dest, 64, width, height, fracX, fracY);
+        checked(opt, pixel_test_buff[index] + offset + j, STRIDE, opt_dest, 64, width, height, fracX, fracY);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_mcstf_weight_acc(mcstf_weight_acc_t ref, mcstf_weight_acc_t opt)
+{
+    ALIGN_VAR_32(double, ref_val[8 * 8]);
+    ALIGN_VAR_32(double, opt_val[8 * 8]);
+    ALIGN_VAR_32(double, ref_weight[8 * 8]);
+    ALIGN_VAR_32(double, opt_weight[8 * 8]);
+    static double expTable[PIXEL_MAX + 1];
+
+    for (int d = 0; d <= PIXEL_MAX; d++)
+        expTable[d] = exp(-(double)(d * d) / (2 * 1.3 * 900));
+
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index1 = rand() % TEST_CASES;
+        int index2 = rand() % TEST_CASES;
+        int width = 1 + rand() % 8;
+        int height = 1 + rand() % 8;
+        double scale = (rand() % 1000) / 1000.0;
+
+        for (int k = 0; k < 8 * 8; k++)
+        {
+            ref_val[k] = opt_val[k] = (double)pbuf1[k];
+            ref_weight[k] = opt_weight[k] = 1.0;
+        }
+
+        ref(pixel_test_buff[index1] + j, STRIDE, pixel_test_buff[index2] + j, STRIDE, width, height, expTable, scale, ref_val, ref_weight, 8);
+        checked(opt, pixel_test_buff[index1] + j, STRIDE, pixel_test_buff[index2] + j, STRIDE, width, height, expTable, scale, opt_val, opt_weight, 8);
+
+        if (memcmp(ref_val, opt_val, sizeof(ref_val)) || memcmp(ref_weight, opt_weight, sizeof(ref_weight)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_scaler_hfilter(scaler_hfilter_t ref, scaler_hfilter_t opt, int depth)
+{
+    static const int filterSizes[] = { 4, 8, 12, 16, 24 };
+    const int srcW = 2 * STRIDE;
+    ALIGN_VAR_32(int16_t, ref_dest[STRIDE]);
+    ALIGN_VAR_32(int16_t, opt_dest[STRIDE]);
+    ALIGN_VAR_32(int16_t, filter[STRIDE * 24]);
+    ALIGN_VAR_32(uint16_t, src16[2 * STRIDE]);
+    ALIGN_VAR_32(uint8_t, src8[2 * STRIDE]);
+    int32_t filterPos[STRIDE];
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int filterSize = filterSizes[rand() % 5];
+        int dstW = 1 + rand() % STRIDE;
+
+        /* samples of the kernel's depth whatever the build depth, every
+         * other iteration at the extremes to exercise the overflow edge */
+        const int maxVal = (1 << depth) - 1;
+        for (int k = 0; k < srcW; k++)
+        {
+            int v = (i & 1) ? ((rand() & 1) ? maxVal : 0) : rand() & maxVal;
+            src16[k] = (uint16_t)v;
+            src8[k] = (uint8_t)v;
+        }
+
+        /* monotonic positions which keep every tap inside the source row */
+        for (int k = 0; k < dstW; k++)
+            filterPos[k] = X265_MIN(2 * k + (rand() & 1), srcW - filterSize);
+        for (int k = 0; k < dstW * filterSize; k++)
+            filter[k] = (int16_t)(rand() % 4096 - 2048);
+
+        const uint8_t* src = depth == 8 ? src8 : (const uint8_t*)src16;
+        ref(ref_dest, dstW, src, filter, filterPos, filterSize);
+        checked(opt, opt_dest, dstW, src, filter, filterPos, filterSize);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_scaler_vfilter(scaler_vfilter_t ref, scaler_vfilter_t opt)
+{
+    /* room for STRIDE samples of either depth */
+    ALIGN_VAR_32(uint16_t, ref_dest[STRIDE]);
+    ALIGN_VAR_32(uint16_t, opt_dest[STRIDE]);
+    int16_t filter[16];
+    const int16_t* src[16];
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = rand() % TEST_CASES;
+        int filterSize = 1 + rand() % 16;
+        int dstW = 1 + rand() % STRIDE;
+
+        for (int k = 0; k < filterSize; k++)
+        {
+            filter[k] = (int16_t)(rand() % 2048 - 512);
+            src[k] = short_test_buff[index] + j + k * STRIDE;
+        }
+
+        ref(filter, filterSize, src, (uint8_t*)ref_dest, dstW);
+        checked(opt, filter, filterSize, src, (uint8_t*)opt_dest, dstW);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_picture_crc(picture_crc_t ref, picture_crc_t opt)
+{
+    /* lines of every length mod 16 bytes, several blocks long */
+    intptr_t stride = 2 * STRIDE + 7;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = rand() % TEST_CASES;
+        int width = 1 + rand() % (2 * STRIDE);
+        int height = 1 + rand() % 16;
+        uint32_t crc = rand() & 0xffff;
+
+        uint32_t cres = ref(pixel_test_buff[index] + j, stride, width, height, crc);
+        uint32_t vres = (uint32_t)checked(opt, pixel_test_buff[index] + j, stride, width, height, crc);
+
+        if (vres != cres)
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_picture_checksum(picture_checksum_t ref, picture_checksum_t opt)
+{
+    intptr_t stride = 2 * STRIDE + 7;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = rand() % TEST_CASES;
+        int width = 1 + rand() % (2 * STRIDE);
+        int height = 1 + rand() % 16;
+        int firstLine = rand() % 1024;
+        uint32_t sum = (uint32_t)rand();
+
+        uint32_t cres = ref(pixel_test_buff[index] + j, stride, width, height, firstLine, sum);
+        uint32_t vres = (uint32_t)checked(opt, pixel_test_buff[index] + j, stride, width, height, firstLine, sum);
+
+        if (vres != cres)
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_motion_blur(motion_blur_t ref, motion_blur_t opt)
+{
+    ALIGN_VAR_32(uint32_t, ref_dest[STRIDE]);
+    ALIGN_VAR_32(uint32_t, opt_dest[STRIDE]);
+    ALIGN_VAR_32(uint32_t, rowSums[STRIDE]);
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = rand() % TEST_CASES;
+        int width = 3 + rand() % (STRIDE - 2);
+
+        /* lines in any order, repeated as at the picture edges */
+        const pixel* lines[5];
+        for (int k = 0; k < 5; k++)
+            lines[k] = pixel_test_buff[index] + j + (rand() % 4) * STRIDE;
+
+        memset(ref_dest, 0xCD, sizeof(ref_dest));
+        memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+        ref(ref_dest, rowSums, lines, width);
+        checked(opt, opt_dest, rowSums, lines, width);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_motion_sad(motion_sad_t ref, motion_sad_t opt)
+{
+    ALIGN_VAR_32(uint32_t, cur[4 * STRIDE]);
+    ALIGN_VAR_32(uint32_t, prev[4 * STRIDE]);
+
+    /* blurred samples have 8 fraction bits over the sample range */
+    const uint32_t maxBlur = (1 << (X265_DEPTH + 8)) - 1;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        for (int k = 0; k < 4 * STRIDE; k++)
+        {
+            cur[k] = i % 3 == 1 ? maxBlur : (uint32_t)rand() & maxBlur;
+            prev[k] = i % 3 == 2 ? maxBlur : (uint32_t)rand() & maxBlur;
+        }
+        int count = 1 + rand() % (4 * STRIDE);
+
+        uint64_t cres = ref(cur, prev, count);
+        uint64_t vres = (uint64_t)checked(opt, cur, prev, count);
+
+        if (vres != cres)
+            return false;
+
+        reportfail();
+    }
+
+    return true;
+}
+
 bool PixelHarness::testPU(int part, const EncoderPrimitives& ref, const EncoderPrimitives& opt)
 {
     if (opt.pu[part].satd)
@@ -2383,6 +2683,15 @@ bool PixelHarness::testPU(int part, const EncoderPrimitives& ref, const EncoderP
             return false;
         }
     }
+
+    if (opt.pu[part].satd_x4)
+    {
+        if (!check_pixelcmp_x4(ref.pu[part].satd_x4, opt.pu[part].satd_x4))
+        {
+            printf("satd_x4[%s]: failed!\n", lumaPartStr[part]);
+            return false;
+        }
+    }
     if (opt.pu[part].pixelavg_pp[NONALIGNED])
     {
         if (!check_pixelavg_pp(ref.pu[part].pixelavg_pp[NONALIGNED], opt.pu[part].pixelavg_pp[NONALIGNED]))
@@ -3200,6 +3509,99 @@ bool PixelHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    if (opt.mcstfSubpelSAD)
+    {
+        if (!check_mcstf_motion_error(ref.mcstfSubpelSAD, opt.mcstfSubpelSAD))
+        {
+            printf("mcstfSubpelSAD failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.mcstfSubpelSSD)
+    {
+        if (!check_mcstf_motion_error(ref.mcstfSubpelSSD, opt.mcstfSubpelSSD))
+        {
+            printf("mcstfSubpelSSD failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.mcstfApplyMotion)
+    {
+        if (!check_mcstf_apply_motion(ref.mcstfApplyMotion, opt.mcstfApplyMotion))
+        {
+            printf("mcstfApplyMotion failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.mcstfWeightAcc)
+    {
+        if (!check_mcstf_weight_acc(ref.mcstfWeightAcc, opt.mcstfWeightAcc))
+        {
+            printf("mcstfWeightAcc failed!\n");
+            return false;
+        }
+    }
+
+    for (int d = 0; d < NUM_SCALER_DEPTHS; d++)
+    {
+        if (opt.scalerHFilter[d])
+        {
+            if (!check_scaler_hfilter(ref.scalerHFilter[d], opt.scalerHFilter[d], d == SCALER_8BIT ? 8 : 10))
+            {
+                printf("scalerHFilter[%d] failed!\n", d == SCALER_8BIT ? 8 : 10);
+                return false;
+            }
+        }
+
+        if (opt.scalerVFilter[d])
+        {
+            if (!check_scaler_vfilter(ref.scalerVFilter[d], opt.scalerVFilter[d]))
+            {
+                printf("scalerVFilter[%d] failed!\n", d == SCALER_8BIT ? 8 : 10);
+                return false;
+            }
+        }
+    }
+
+    if (opt.pictureCRC)
+    {
+        if (!check_picture_crc(ref.pictureCRC, opt.pictureCRC))
+        {
+            printf("pictureCRC failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.pictureChecksum)
+    {
+        if (!check_picture_checksum(ref.pictureChecksum, opt.pictureChecksum))
+        {
+            printf("pictureChecksum failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.motionBlur)
+    {
+        if (!check_motion_blur(ref.motionBlur, opt.motionBlur))
+        {
+            printf("motionBlur failed!\n");
+            return false;
+        }
+    }
+
+    if (opt.motionSad)
+    {
+        if (!check_motion_sad(ref.motionSad, opt.motionSad))
+        {
+            printf("motionSad failed!\n");
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -3244,6 +3646,12 @@ void PixelHarness::measurePartition(int part, const EncoderPrimitives& ref, cons
         REPORT_SPEEDUP(opt.pu[part].sad_x4, ref.pu[part].sad_x4, pbuf1, fref, fref + 1, fref - 1, fref - INCR, FENC_STRIDE + 5, &cres[0]);
     }
 
+    if (opt.pu[part].satd_x4)
+    {
+        HEADER("satd_x4[%s]", lumaPartStr[part]);
+        REPORT_SPEEDUP(opt.pu[part].satd_x4, ref.pu[part].satd_x4, pbuf1, fref, fref + 1, fref - 1, fref - INCR, FENC_STRIDE + 5, &cres[0]);
+    }
+
     if (opt.pu[part].copy_pp)
     {
         HEADER("copy_pp[%s]", lumaPartStr[part]);
@@ -3858,4 +4266,86 @@ void PixelHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
             REPORT_SPEEDUP(opt.cu[i].normFact, ref.cu[i].normFact, pixel_test_buff[0], blockSize, shift, &dst);
         }
     }
+
+    if (opt.mcstfSubpelSAD)
+    {
+        HEADER0("mcstfSubpelSAD[16x16]");
+        REPORT_SPEEDUP(opt.mcstfSubpelSAD, ref.mcstfSubpelSAD, pbuf1 + 3 * STRIDE + 3, STRIDE, pbuf2 + 3 * STRIDE + 3, STRIDE, 16, 5, 11, INT_MAX);
+    }
+
+    if (opt.mcstfSubpelSSD)
+    {
+        HEADER0("mcstfSubpelSSD[16x16]");
+        REPORT_SPEEDUP(opt.mcstfSubpelSSD, ref.mcstfSubpelSSD, pbuf1 + 3 * STRIDE + 3, STRIDE, pbuf2 + 3 * STRIDE + 3, STRIDE, 16, 5, 11, INT_MAX);
+    }
+
+    if (opt.mcstfApplyMotion)
+    {
+        HEADER0("mcstfApplyMotion[8x8]");
+        REPORT_SPEEDUP(opt.mcstfApplyMotion, ref.mcstfApplyMotion, pbuf1 + 3 * STRIDE + 3, STRIDE, pbuf3, STRIDE, 8, 8, 5, 11);
+    }
+
+    if (opt.mcstfWeightAcc)
+    {
+        ALIGN_VAR_32(double, sumVal[8 * 8]);
+        ALIGN_VAR_32(double, sumWeight[8 * 8]);
+        static double expTable[PIXEL_MAX + 1];
+        for (int k = 0; k < 8 * 8; k++)
+            sumVal[k] = sumWeight[k] = 1.0;
+        HEADER0("mcstfWeightAcc[8x8]");
+        REPORT_SPEEDUP(opt.mcstfWeightAcc, ref.mcstfWeightAcc, pbuf1, STRIDE, pbuf2, STRIDE, 8, 8, expTable, 0.5, sumVal, sumWeight, 8);
+    }
+
+    for (int d = 0; d < NUM_SCALER_DEPTHS; d++)
+    {
+        const int depth = d == SCALER_8BIT ? 8 : 10;
+        if (opt.scalerHFilter[d])
+        {
+            ALIGN_VAR_32(int16_t, filter[STRIDE * 8]);
+            ALIGN_VAR_32(uint16_t, src[2 * STRIDE + 8]);
+            int32_t filterPos[STRIDE];
+            for (int k = 0; k < STRIDE; k++)
+                filterPos[k] = 2 * k;
+            for (int k = 0; k < STRIDE * 8; k++)
+                filter[k] = (int16_t)((k & 7) < 4 ? 2048 : -(k & 3) * 64);
+            for (int k = 0; k < 2 * STRIDE + 8; k++)
+                src[k] = (uint16_t)(rand() & 255);
+            HEADER("scalerHFilter[64x8] %dbit", depth);
+            REPORT_SPEEDUP(opt.scalerHFilter[d], ref.scalerHFilter[d], sbuf1, STRIDE, (const uint8_t*)src, filter, filterPos, 8);
+        }
+
+        if (opt.scalerVFilter[d])
+        {
+            ALIGN_VAR_32(uint16_t, dst[STRIDE]);
+            int16_t filter[4] = { -256, 2304, 2304, -256 };
+            const int16_t* src[4] = { sbuf2, sbuf2 + STRIDE, sbuf2 + 2 * STRIDE, sbuf2 + 3 * STRIDE };
+            HEADER("scalerVFilter[64x4] %dbit", depth);
+            REPORT_SPEEDUP(opt.scalerVFilter[d], ref.scalerVFilter[d], filter, 4, src, (uint8_t*)dst, STRIDE);
+        }
+    }
+
+    if (opt.pictureCRC)
+    {
+        HEADER0("pictureCRC[64x64]");
+        REPORT_SPEEDUP(opt.pictureCRC, ref.pictureCRC, pbuf1, STRIDE, STRIDE, MAX_HEIGHT, 0xffff);
+    }
+
+    if (opt.pictureChecksum)
+    {
+        HEADER0("pictureChecksum[64x64]");
+        REPORT_SPEEDUP(opt.pictureChecksum, ref.pictureChecksum, pbuf1, STRIDE, STRIDE, MAX_HEIGHT, 0, 0);
+    }
+
+    if (opt.motionBlur)
+    {
+        const pixel* lines[5] = { pbuf1, pbuf1 + STRIDE, pbuf1 + 2 * STRIDE, pbuf1 + 3 * STRIDE, pbuf1 + 4 * STRIDE };
+        HEADER0("motionBlur[64]");
+        REPORT_SPEEDUP(opt.motionBlur, ref.motionBlur, (uint32_t*)ibuf1, (uint32_t*)ibuf1 + STRIDE, lines, STRIDE);
+    }
+
+    if (opt.motionSad)
+    {
+        HEADER0("motionSad[64x64]");
+        REPORT_SPEEDUP(opt.motionSad, ref.motionSad, (uint32_t*)ibuf1, (uint32_t*)ibuf1 + STRIDE * MAX_HEIGHT, STRIDE * MAX_HEIGHT);
+    }
 }
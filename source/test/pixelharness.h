@@ -139,6 +139,15 @@ protected:
     bool check_ssimDist(ssimDistortion_t ref, ssimDistortion_t opt);
     bool check_normFact(normFactor_t ref, normFactor_t opt, int block);
     bool check_downscaleluma_t(downscaleluma_t ref, downscaleluma_t opt);
+    bool check_mcstf_motion_error(mcstf_motion_error_t ref, mcstf_motion_error_t opt);
+    bool check_mcstf_apply_motion(mcstf_apply_motion_t ref, mcstf_apply_motion_t opt);
+    bool check_mcstf_weight_acc(mcstf_weight_acc_t ref, mcstf_weight_acc_t opt);
+    bool check_scaler_hfilter(scaler_hfilter_t ref, scaler_hfilter_t opt, int depth);
+    bool check_scaler_vfilter(scaler_vfilter_t ref, scaler_vfilter_t opt);
+    bool check_picture_crc(picture_crc_t ref, picture_crc_t opt);
+    bool check_picture_checksum(picture_checksum_t ref, picture_checksum_t opt);
+    bool check_motion_blur(motion_blur_t ref, motion_blur_t opt);
+    bool check_motion_sad(motion_sad_t ref, motion_sad_t opt);
 
 public:
 
@@ -176,6 +176,7 @@ static bool parseAbrConfig(FILE* abrConfig, CLIOptions cliopt[], uint8_t numEnco
         char *head[X265_HEAD_ENTRIES];
         cliopt[i].encId = i;
         cliopt[i].isAbrLadderConfig = true;
+        cliopt[i].scaleInput = i ? &cliopt[0] : NULL;
 
         while (id && (idCount <= X265_HEAD_ENTRIES))
         {
@@ -40,6 +40,10 @@ extern "C" {
  *      opaque handler for encoder */
 typedef struct x265_encoder x265_encoder;
 
+/* x265_analysis_cache:
+ *      opaque handler for an in-memory analysis cache shared by encoders */
+typedef struct x265_analysis_cache x265_analysis_cache;
+
 /* x265_picyuv:
  *      opaque handler for PicYuv */
 typedef struct x265_picyuv x265_picyuv;
@@ -313,6 +317,20 @@ typedef struct x265_frame_stats
     double           bufferFillFinal;
     double           unclippedBufferFillFinal;
     uint8_t          tLayer;
+
+    /* with bCtuMetrics, the PSNR ((6 * Y + U + V) / 8 as psnr) and SSIM of
+     * each CTU in raster order, ctuMapWidth x ctuMapHeight entries, or NULL
+     * for a metric which is not enabled. They remain valid until the next
+     * call to x265_encoder_encode() */
+    double*          ctuPsnr;
+    double*          ctuSsim;
+    int              ctuMapWidth;
+    int              ctuMapHeight;
+
+    /* with bPerceptualMetrics, the luma MS-SSIM of the frame and its VMAF
+     * motion feature */
+    double           msSsim;
+    double           vmafMotion;
 } x265_frame_stats;
 
 typedef struct x265_ctu_info_t
@@ -534,6 +552,7 @@ typedef enum
                                              * new SLOW flags. */
 #define X265_CPU_SLOW_PSHUFB     (1 << 24)  /* such as on the Intel Atom */
 #define X265_CPU_SLOW_PALIGNR    (1 << 25)  /* such as on the AMD Bobcat */
+#define X265_CPU_PCLMUL          (1 << 26)  /* carry-less multiply, PCLMULQDQ */
 
 /* ARM */
 #define X265_CPU_ARMV6           0x0000001
@@ -566,6 +585,9 @@ typedef enum
 
 #define X265_BFRAME_MAX         16
 #define X265_MAX_FRAME_THREADS  16
+#define X265_MAX_TILE_COLUMNS   20
+#define X265_MAX_TILE_ROWS      22
+#define X265_MAX_CRF_PROBES     16
 
 #define X265_TYPE_AUTO          0x0000  /* Let x265 choose the right type */
 #define X265_TYPE_IDR           0x0001
@@ -680,6 +702,18 @@ typedef struct x265_stats
     uint16_t              maxFALL;              /* maximum frame average light level */
 } x265_stats;
 
+/* Rate and quality predicted for a scene at each probe CRF, see
+ * x265_param.crfProbes */
+typedef struct x265_crf_probe_scene
+{
+    int                   firstPoc;             /* first picture of the scene, in display order */
+    int                   numFrames;
+    int                   numProbes;
+    double                crf[X265_MAX_CRF_PROBES];
+    double                bitrate[X265_MAX_CRF_PROBES]; /* predicted kbps */
+    double                psnr[X265_MAX_CRF_PROBES];    /* predicted global PSNR */
+} x265_crf_probe_scene;
+
 /* String values accepted by x265_param_parse() (and CLI) for various parameters */
 static const char * const x265_motion_est_names[] = { "dia", "hex", "umh", "star", "sea", "full", 0 };
 static const char * const x265_source_csp_names[] = { "i400", "i420", "i422", "i444", "nv12", "nv16", 0 };
@@ -2256,6 +2290,158 @@ typedef struct x265_param
 
     /*SBRC*/
     int      bEnableSBRC;
+
+    /* Pack the frame records of analysis-save files (run-length coded arrays
+     * and MV deltas). analysis-load detects packed records on its own, so
+     * this only needs to be set for the saving encode. Default disabled */
+    int      bAnalysisSaveCompress;
+
+    /* Schedule thread pool work with per-worker deques and randomized
+     * stealing instead of waking workers through the shared sleep bitmap.
+     * Wavefront row hints and bonded task groups (pmode, pme, lookahead)
+     * are stolen by idle workers. Default disabled */
+    int      bWorkStealing;
+
+    /* Number of tile columns and rows each picture is partitioned into. When
+     * there is more than one tile, the CTUs of each tile are coded in their
+     * own substream without prediction from other tiles, and all tiles of a
+     * tile row are compressed in parallel by the thread pool. Tiles replace
+     * WPP and multiple slices. Tile columns must be at least 256 luma samples
+     * wide and tile rows at least 64 luma samples high. Default 1x1 (off) */
+    int      tileColumns;
+    int      tileRows;
+
+    /* Explicit tile column widths and tile row heights, in CTUs. When the
+     * first entry is non-zero the grid uses these sizes instead of uniform
+     * spacing; all but the last tile column (row) are listed, the last one
+     * covers the remainder of the picture. Default all zero (uniform) */
+    int      tileColumnWidths[X265_MAX_TILE_COLUMNS - 1];
+    int      tileRowHeights[X265_MAX_TILE_ROWS - 1];
+
+    /* Code every CTU row as its own slice segment (dependent slice segments
+     * after the first row of each slice) and hand each segment to
+     * nalOutputCallback as soon as the row is coded, instead of waiting for
+     * the whole frame. Requires WPP and is disabled when tiles are in use.
+     * x265_encoder_encode() still returns the complete access unit. Default
+     * disabled */
+    int      bSubFrameOutput;
+
+    /* Called from a frame encoder thread for each NAL of a frame in encode
+     * order when bSubFrameOutput is enabled; bEndOfFrame is set for the last
+     * call of each picture (nal is NULL for that call). The payload is only
+     * valid for the duration of the call. Default NULL */
+    void     (*nalOutputCallback)(void* opaque, const x265_nal* nal, int poc, int bEndOfFrame);
+    void*    nalOutputOpaque;
+
+    /* Keep the three half-pel interpolations of each reconstructed reference
+     * picture's luma in memory, computed once per CTU row after loop filtering,
+     * so sub-pel motion refinement reads half-pel candidates instead of
+     * interpolating them for every PU. Costs three luma planes per referenced
+     * frame; has no effect on the output bitstream. Not supported with
+     * multiple slices. Default disabled */
+    int      bHpelCache;
+
+    /* Choose the motion search method and range per CTU from the lookahead's
+     * lowres motion vectors and costs: near-static areas use DIA with a short
+     * range, coherent moderate motion uses HEX, and fast or poorly predicted
+     * areas use searchMethod (at least UMH) with the full searchRange. The
+     * range never exceeds searchRange. Default disabled */
+    int      bAdaptiveSearch;
+
+    /* Derive a confidence for each PU's lookahead motion vector from its
+     * lowres inter cost relative to the lowres intra cost and from how well it
+     * agrees with the neighbouring lowres vectors. Reliable predictions skip
+     * the integer search and only refine around the lowres vector, fairly
+     * reliable ones search a short window around it; the rest use the normal
+     * search. References further away than the lookahead measured get a
+     * lowres vector scaled from the furthest measured distance. Default
+     * disabled */
+    int      bMEConfidence;
+
+    /* Text file of early-termination models for inter mode decision, loaded
+     * when the encoder is opened: for each CU depth a linear classifier or a
+     * small decision tree over the CU's variance, neighbour depths, lowres
+     * cost, QP and best merge/skip cost, with a threshold below which the
+     * split or the rect/AMP partitions of the CU are not evaluated. See the
+     * documentation of --md-model for the file format. Not used with
+     * distributed mode analysis. Default NULL, disabled */
+    const char* mdModel;
+
+    /* File to which inter mode decision writes one CSV line per CU with the
+     * mdModel features and the partitioning finally chosen, as training data
+     * for mdModel. Default NULL, disabled */
+    const char* mdStats;
+
+    /* In-memory cache of CTU mode decisions, allocated with
+     * x265_analysis_cache_alloc(), shared by sequential encodes of the same
+     * content in one process (for instance CRF probes). Each CTU reuses the
+     * partitioning a previous encode chose for the same POC and CTU when it
+     * was decided at a CTU QP within analysisCacheQpDelta and for the same
+     * slice type; otherwise it is analysed fully and the cached decisions are
+     * replaced. Encoders sharing a cache must use the same resolution and CTU
+     * sizes and must not run concurrently. Not used with analysis save/load,
+     * ctu-info or distributed mode analysis. Default NULL, disabled */
+    x265_analysis_cache* analysisCache;
+
+    /* Largest difference between a CTU's QP and the QP its cached decisions
+     * were made at for them to be reused. Default 4 */
+    int      analysisCacheQpDelta;
+
+    /* Number of pictures, from POC 0, whose decisions are cached; later
+     * pictures are analysed fully and not cached. The cache holds
+     * numCTUs * (3 + (maxCUSize / minCUSize)^2 / 2) bytes per picture, about
+     * 18KB at 1080p and 71KB at 2160p with 64x64 CTUs and 8x8 minimum CUs, so
+     * the default bounds it near 18MB at 1080p. 0 caches every picture.
+     * Default 1000 */
+    int      analysisCacheFrames;
+
+    /* CRF values at which to predict the bitrate and PSNR of each scene of a
+     * CRF encode, from the frame QPs, bit split and PSNR of this encode. A
+     * CRF change shifts all rate-control QPs by the same amount, so each
+     * frame's texture and motion bits are re-costed at its shifted QP with
+     * power laws of the qscale as in the two-pass rate model and its MSE is
+     * scaled with the qscale. Scenes start at scenecuts. The prediction
+     * ignores VBV and zones; the bitrate is typically within 10% at 4 CRF
+     * from the encode's, 16% at 12 CRF, but grainy sources can be off by
+     * 40-80%. Enables PSNR calculation. Read the table with
+     * x265_encoder_crf_probe(). Default 0 */
+    int      numCrfProbes;
+    double   crfProbes[X265_MAX_CRF_PROBES];
+
+    /* CSV file the CRF probe table is written to when the encoder is closed.
+     * Default NULL, not written */
+    const char* crfProbeCsv;
+
+    /* Write the multi-pass stats as a binary file of fixed-size frame
+     * records, with the CU-tree offsets embedded instead of a separate
+     * .cutree file and a frame index, which the next pass maps into memory
+     * instead of parsing. Passes reading stats detect the format. Default 0,
+     * text stats */
+    int       bStatBinary;
+
+    /* First and last first-pass frame, in display order, of the segment a
+     * multi-pass encode reading stats encodes. The input starts at the first
+     * frame of the segment. Every segment encoder runs the rate allocation
+     * of the whole sequence and encodes its own frames with their share of
+     * the bits and, in ABR mode, the VBV fullness planned for the segment,
+     * so independent encodes of consecutive segments add up to the planned
+     * size and their bitstreams may be concatenated. The segment must start
+     * at an IDR frame of the first pass and not share a GOP with the frames
+     * after it. statSegmentEnd 0 means the last frame of the stats. Default
+     * 0, 0 (whole sequence) */
+    int       statSegmentStart;
+    int       statSegmentEnd;
+
+    /* Report the PSNR and SSIM of each CTU, for the metrics enabled by
+     * bEnablePsnr and bEnableSsim, as maps in x265_frame_stats. Default
+     * disabled */
+    int       bCtuMetrics;
+
+    /* Compute the multi-scale SSIM of the luma of each frame and the motion
+     * feature of VMAF, the blurred luma difference to the previous input
+     * frame, and report them in x265_frame_stats and the frame CSV. Requires
+     * pictures of at least 128x128. Default disabled */
+    int       bPerceptualMetrics;
 } x265_param;
 
 /* x265_param_alloc:
@@ -2384,6 +2570,15 @@ void x265_alloc_analysis_data(x265_param *param, x265_analysis_data* analysis);
 *    Free the allocated memory for x265_analysis_data object's internal structures. */
 void x265_free_analysis_data(x265_param *param, x265_analysis_data* analysis);
 
+/* x265_analysis_cache_alloc:
+ *     Allocate an empty in-memory analysis cache for x265_param.analysisCache.
+ *     Returns NULL on failure. */
+x265_analysis_cache* x265_analysis_cache_alloc(void);
+
+/* x265_analysis_cache_free:
+ *     Free an analysis cache once no encoder using it remains open. */
+void x265_analysis_cache_free(x265_analysis_cache* cache);
+
 /* Force a link error in the case of linking against an incompatible API version.
  * Glue #defines exist to force correct macro expansion; the final output of the macro
  * is x265_encoder_open_##X265_BUILD (for purposes of dlopen). */
@@ -2445,6 +2640,13 @@ int x265_encoder_reconfig_zone(x265_encoder *, x265_zone *);
  *       returns encoder statistics */
 void x265_encoder_get_stats(x265_encoder *encoder, x265_stats *, uint32_t statsSizeBytes);
 
+/* x265_encoder_crf_probe:
+ *       predicted rate and quality per scene of the pictures encoded so far
+ *       at each of the param's crfProbes. Returns the number of scenes and
+ *       sets *scenes to a table that stays valid until the next call or the
+ *       encoder is closed; returns 0 if crfProbes is not used. */
+int x265_encoder_crf_probe(x265_encoder *encoder, const x265_crf_probe_scene **scenes);
+
 /* x265_encoder_log:
  *       write a line to the configured CSV file.  If a CSV filename was not
  *       configured, or file open failed, this function will perform no write. */
@@ -2594,6 +2796,9 @@ typedef struct x265_api
     void          (*vmaf_encoder_log)(x265_encoder*, int, char**, x265_param *, x265_vmaf_data *);
 #endif
     int           (*zone_param_parse)(x265_param*, const char*, const char*);
+    x265_analysis_cache* (*analysis_cache_alloc)(void);
+    void          (*analysis_cache_free)(x265_analysis_cache*);
+    int           (*encoder_crf_probe)(x265_encoder*, const x265_crf_probe_scene**);
     /* add new pointers to the end, or increment X265_MAJOR_VERSION */
 } x265_api;
 
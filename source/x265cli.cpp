@@ -91,6 +91,8 @@ namespace X265_NS {
         H0("\nQuality reporting metrics:\n");
         H0("   --[no-]ssim                   Enable reporting SSIM metric scores. Default %s\n", OPT(param->bEnableSsim));
         H0("   --[no-]psnr                   Enable reporting PSNR metric scores. Default %s\n", OPT(param->bEnablePsnr));
+        H1("   --[no-]ctu-metrics            Report the PSNR and SSIM of each CTU with the frame stats. Default %s\n", OPT(param->bCtuMetrics));
+        H1("   --[no-]perceptual-metrics     Report the luma MS-SSIM and VMAF motion feature of each frame. Default %s\n", OPT(param->bPerceptualMetrics));
         H0("\nProfile, Level, Tier:\n");
         H0("-P/--profile <string>            Enforce an encode profile: main, main10, mainstillpicture\n");
         H0("   --level-idc <integer|float>   Force a minimum required decoder level (as '5.0' or '50')\n");
@@ -101,8 +103,13 @@ namespace X265_NS {
         H0("   --pools <integer,...>         Comma separated thread count per thread pool (pool per NUMA node)\n");
         H0("                                 '-' implies no threads on node, '+' implies one thread per core on node\n");
         H0("-F/--frame-threads <integer>     Number of concurrently encoded frames. 0: auto-determined by core count\n");
+        H1("   --[no-]work-stealing          Schedule thread pool work with per-worker deques and stealing. Default %s\n", OPT(param->bWorkStealing));
         H0("   --[no-]wpp                    Enable Wavefront Parallel Processing. Default %s\n", OPT(param->bEnableWavefront));
         H0("   --[no-]slices <integer>       Enable Multiple Slices feature. Default %d\n", param->maxSlices);
+        H0("   --tiles <CxR>                 Split each frame into C tile columns and R tile rows. Default %dx%d\n", param->tileColumns, param->tileRows);
+        H1("   --tile-column-widths <list>   Comma separated tile column widths in CTUs, the last column is implied. Default uniform\n");
+        H1("   --tile-row-heights <list>     Comma separated tile row heights in CTUs, the last row is implied. Default uniform\n");
+        H1("   --[no-]sub-frame-output       Code each CTU row as its own slice segment for low-delay output. Default %s\n", OPT(param->bSubFrameOutput));
         H0("   --[no-]pmode                  Parallel mode analysis. Default %s\n", OPT(param->bDistributeModeAnalysis));
         H0("   --[no-]pme                    Parallel motion estimation. Default %s\n", OPT(param->bDistributeMotionEstimation));
         H0("   --[no-]asm <bool|int|string>  Override CPU detection. Default: auto\n");
@@ -150,7 +157,12 @@ namespace X265_NS {
         H0("   --limit-refs <0|1|2|3>        Limit references per depth (1) or CU (2) or both (3). Default %d\n", param->limitReferences);
         H0("   --me <string>                 Motion search method dia hex umh star full. Default %d\n", param->searchMethod);
         H0("-m/--subme <integer>             Amount of subpel refinement to perform (0:least .. 7:most). Default %d \n", param->subpelRefine);
+        H1("   --[no-]hpel-cache             Cache half-pel interpolated luma planes of reference frames. Default %s\n", OPT(param->bHpelCache));
         H0("   --merange <integer>           Motion search range. Default %d\n", param->searchRange);
+        H1("   --[no-]adaptive-me            Pick motion search method and range per CTU from lookahead motion. Default %s\n", OPT(param->bAdaptiveSearch));
+        H1("   --[no-]me-confidence          Narrow or skip the integer motion search where the lookahead MV is reliable. Default %s\n", OPT(param->bMEConfidence));
+        H1("   --md-model <filename>         Skip split and rect/AMP evaluation where the early-termination model in the file predicts no gain. Default disabled\n");
+        H1("   --md-stats <filename>         Write per-CU mode decision features and choices as CSV, for training --md-model. Default disabled\n");
         H0("   --[no-]rect                   Enable rectangular motion partitions Nx2N and 2NxN. Default %s\n", OPT(param->bEnableRectInter));
         H0("   --[no-]amp                    Enable asymmetric motion partitions, requires --rect. Default %s\n", OPT(param->bEnableAMP));
         H0("   --[no-]limit-modes            Limit rectangular and asymmetric motion predictions. Default %d\n", param->limitModes);
@@ -209,6 +221,8 @@ namespace X265_NS {
         H1("                                 May cause VBV underflows!\n");
         H1("   --crf-min <float>             With CRF+VBV, limit RF to this value. Default %f\n", param->rc.rfConstantMin);
         H1("                                 this specifies a minimum rate factor value for encode!\n");
+        H1("   --crf-probe <float,..>        Predict bitrate and PSNR per scene at these CRFs from a CRF encode. Default disabled\n");
+        H1("   --crf-probe-csv <filename>    Write the --crf-probe table per scene as CSV. Default disabled\n");
         H0("   --vbv-maxrate <integer>       Max local bitrate (kbit/s). Default %d\n", param->rc.vbvMaxBitrate);
         H0("   --vbv-bufsize <integer>       Set size of the VBV buffer (kbit). Default %d\n", param->rc.vbvBufferSize);
         H0("   --vbv-init <float>            Initial VBV buffer occupancy (fraction of bufsize or in kbits). Default %.2f\n", param->rc.vbvBufferInit);
@@ -226,6 +240,8 @@ namespace X265_NS {
         H0("   --[no-]multi-pass-opt-distortion Use distortion of CTU from pass 1 to refine qp in 2 pass\n");
         H0("   --[no-]vbv-live-multi-pass    Enable realtime VBV in rate control 2 pass.Default %s\n", OPT(param->bliveVBV2pass));
         H0("   --stats                       Filename for stats file in multipass pass rate control. Default x265_2pass.log\n");
+        H1("   --[no-]stats-binary           Write the stats file in the indexed binary format with embedded cutree data. Default %s\n", OPT(param->bStatBinary));
+        H1("   --stats-segment <first,last>  Encode only these first pass frames with their share of the multi-pass rate plan. Default disabled\n");
         H0("   --[no-]analyze-src-pics       Motion estimation uses source frame planes. Default disable\n");
         H0("   --[no-]slow-firstpass         Enable a slow first pass in a multipass rate control mode. Default %s\n", OPT(param->rc.bEnableSlowFirstPass));
         H0("   --[no-]strict-cbr             Enable stricter conditions and tolerance for bitrate deviations in CBR mode. Default %s\n", OPT(param->rc.bStrictCbr));
@@ -234,6 +250,7 @@ namespace X265_NS {
         H0("   --analysis-reuse-file <filename>    Specify file name used for either dumping or reading analysis data. Deault x265_analysis.dat\n");
         H0("   --analysis-reuse-level <1..10>      Level of analysis reuse indicates amount of info stored/reused in save/load mode, 1:least..10:most. Now deprecated. Default %d\n", param->analysisReuseLevel);
         H0("   --analysis-save-reuse-level <1..10> Indicates the amount of analysis info stored in save mode, 1:least..10:most. Default %d\n", param->analysisSaveReuseLevel);
+        H0("   --[no-]analysis-save-compress Pack the frame records written by analysis-save. Default %s\n", OPT(param->bAnalysisSaveCompress));
         H0("   --analysis-load-reuse-level <1..10> Indicates the amount of analysis info reused in load mode, 1:least..10:most. Default %d\n", param->analysisLoadReuseLevel);
         H0("   --refine-analysis-type <string>     Reuse anlaysis information received through API call. Supported options are avc and hevc. Default disabled - %d\n", param->bAnalysisType);
         H0("   --scale-factor <int>          Specify factor by which input video is scaled down for analysis save mode. Default %d\n", param->scaleFactor);
@@ -387,6 +404,7 @@ namespace X265_NS {
 #endif
         H0(" ABR-ladder settings\n");
         H0("   --abr-ladder <file>           File containing config settings required for the generation of ABR-ladder\n");
+        H0("   --abr-scale                   In an ABR-ladder rung: scale the pictures of a larger rung to --input-res instead of reading --input\n");
         H1("\nExecutable return codes:\n");
         H1("    0 - encode successful\n");
         H1("    1 - unable to parse command line\n");
@@ -716,6 +734,7 @@ namespace X265_NS {
                 OPT("recon") reconfn = optarg;
                 OPT("input-depth") inputBitDepth = (uint32_t)x265_atoi(optarg, bError);
                 OPT("dither") this->bDither = true;
+                OPT("abr-scale") this->enableScaler = true;
                 OPT("recon-depth") reconFileBitDepth = (uint32_t)x265_atoi(optarg, bError);
                 OPT("y4m") this->bForceY4m = true;
                 OPT("profile") /* handled above */;
@@ -787,6 +806,21 @@ namespace X265_NS {
             showHelp(param);
         }
 
+        if (enableScaler)
+        {
+            if (!scaleInput)
+            {
+                x265_log(param, X265_LOG_ERROR, "--abr-scale is only valid in the rungs of an ABR-ladder config after the first\n");
+                return true;
+            }
+            if (inputfn || !param->sourceWidth || !param->sourceHeight)
+            {
+                x265_log(param, X265_LOG_ERROR, "a rung scaled with --abr-scale takes --input-res and no input file\n");
+                return true;
+            }
+            inputfn = scaleInput->inputName;
+        }
+
         if (!inputfn || !outputfn)
         {
             x265_log(param, X265_LOG_ERROR, "input or output file not specified, try --help for help\n");
@@ -813,6 +847,7 @@ namespace X265_NS {
 
         InputFileInfo info;
         info.filename = inputfn;
+        this->inputName = enableScaler ? NULL : inputfn;
         info.depth = inputBitDepth;
         info.csp = param->internalCsp;
         info.width = param->sourceWidth;
@@ -825,12 +860,34 @@ namespace X265_NS {
         info.frameCount = 0;
         getParamAspectRatio(param, info.sarWidth, info.sarHeight);
 
-
-        this->input = InputFile::open(info, this->bForceY4m);
-        if (!this->input || this->input->isFail())
+        if (enableScaler)
         {
-            x265_log_file(param, X265_LOG_ERROR, "unable to open input file <%s>\n", inputfn);
-            return true;
+            /* the pictures of the first rung's input, scaled to --input-res */
+            x265_param* srcParam = scaleInput->param;
+            info.depth = srcParam->sourceBitDepth;
+            info.csp = srcParam->internalCsp;
+            info.fpsNum = srcParam->fpsNum;
+            info.fpsDenom = srcParam->fpsDenom;
+            getParamAspectRatio(srcParam, info.sarWidth, info.sarHeight);
+            info.skipFrames = 0;
+            info.frameCount = scaleInput->framesToBeEncoded;
+            this->seek = 0;
+
+            /* the scaler has kernels for 8 and 10-bit samples */
+            if (info.depth != 8 && info.depth != 10)
+            {
+                x265_log(param, X265_LOG_ERROR, "--abr-scale needs 8 or 10-bit input, the input is %d-bit\n", info.depth);
+                return true;
+            }
+        }
+        else
+        {
+            this->input = InputFile::open(info, this->bForceY4m);
+            if (!this->input || this->input->isFail())
+            {
+                x265_log_file(param, X265_LOG_ERROR, "unable to open input file <%s>\n", inputfn);
+                return true;
+            }
         }
 
         if (info.depth < 8 || info.depth > 16)
@@ -902,10 +959,11 @@ namespace X265_NS {
             else
                 sprintf(buf + p, " frames %u - %d of %d", this->seek, this->seek + this->framesToBeEncoded - 1, info.frameCount);
 
-            general_log(param, input->getName(), X265_LOG_INFO, "%s\n", buf);
+            general_log(param, input ? input->getName() : "scale", X265_LOG_INFO, "%s\n", buf);
         }
 
-        this->input->startReader();
+        if (this->input)
+            this->input->startReader();
 
         if (reconfn)
         {
@@ -931,6 +989,11 @@ namespace X265_NS {
             x265_log(param, X265_LOG_ERROR, "recon file must be specified to get VMAF score, try --help for help\n");
             return true;
         }
+        if (enableScaler)
+        {
+            x265_log(param, X265_LOG_ERROR, "VMAF needs the input file of the rung, not a scaled one\n");
+            return true;
+        }
         const char *str = strrchr(info.filename, '.');
 
         if (!strcmp(str, ".y4m"))
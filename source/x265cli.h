@@ -56,6 +56,8 @@ static const struct option long_options[] =
     { "no-asm",               no_argument, NULL, 0 },
     { "pools",          required_argument, NULL, 0 },
     { "numa-pools",     required_argument, NULL, 0 },
+    { "work-stealing",        no_argument, NULL, 0 },
+    { "no-work-stealing",     no_argument, NULL, 0 },
     { "preset",         required_argument, NULL, 'p' },
     { "tune",           required_argument, NULL, 't' },
     { "frame-threads",  required_argument, NULL, 'F' },
@@ -103,7 +105,15 @@ static const struct option long_options[] =
     { "limit-tu",       required_argument, NULL, 0 },
     { "me",             required_argument, NULL, 0 },
     { "subme",          required_argument, NULL, 'm' },
+    { "hpel-cache",           no_argument, NULL, 0 },
+    { "no-hpel-cache",        no_argument, NULL, 0 },
     { "merange",        required_argument, NULL, 0 },
+    { "adaptive-me",          no_argument, NULL, 0 },
+    { "no-adaptive-me",       no_argument, NULL, 0 },
+    { "me-confidence",        no_argument, NULL, 0 },
+    { "no-me-confidence",     no_argument, NULL, 0 },
+    { "md-model",       required_argument, NULL, 0 },
+    { "md-stats",       required_argument, NULL, 0 },
     { "max-merge",      required_argument, NULL, 0 },
     { "no-temporal-mvp",      no_argument, NULL, 0 },
     { "temporal-mvp",         no_argument, NULL, 0 },
@@ -170,6 +180,8 @@ static const struct option long_options[] =
     { "crf",            required_argument, NULL, 0 },
     { "crf-max",        required_argument, NULL, 0 },
     { "crf-min",        required_argument, NULL, 0 },
+    { "crf-probe",      required_argument, NULL, 0 },
+    { "crf-probe-csv",  required_argument, NULL, 0 },
     { "vbv-maxrate",    required_argument, NULL, 0 },
     { "vbv-bufsize",    required_argument, NULL, 0 },
     { "vbv-init",       required_argument, NULL, 0 },
@@ -226,6 +238,10 @@ static const struct option long_options[] =
     { "ssim",                 no_argument, NULL, 0 },
     { "no-psnr",              no_argument, NULL, 0 },
     { "psnr",                 no_argument, NULL, 0 },
+    { "no-ctu-metrics",       no_argument, NULL, 0 },
+    { "ctu-metrics",          no_argument, NULL, 0 },
+    { "no-perceptual-metrics", no_argument, NULL, 0 },
+    { "perceptual-metrics",   no_argument, NULL, 0 },
     { "hash",           required_argument, NULL, 0 },
     { "no-strong-intra-smoothing", no_argument, NULL, 0 },
     { "strong-intra-smoothing",    no_argument, NULL, 0 },
@@ -280,6 +296,9 @@ static const struct option long_options[] =
     { "nr-intra",       required_argument, NULL, 0 },
     { "nr-inter",       required_argument, NULL, 0 },
     { "stats",          required_argument, NULL, 0 },
+    { "stats-binary",         no_argument, NULL, 0 },
+    { "no-stats-binary",      no_argument, NULL, 0 },
+    { "stats-segment",  required_argument, NULL, 0 },
     { "pass",           required_argument, NULL, 0 },
     { "multi-pass-opt-analysis", no_argument, NULL, 0 },
     { "no-multi-pass-opt-analysis",    no_argument, NULL, 0 },
@@ -295,6 +314,8 @@ static const struct option long_options[] =
     { "analysis-reuse-file", required_argument, NULL, 0 },
     { "analysis-reuse-level", required_argument, NULL, 0 }, /* DEPRECATED */
     { "analysis-save-reuse-level", required_argument, NULL, 0 },
+    { "analysis-save-compress", no_argument, NULL, 0 },
+    { "no-analysis-save-compress", no_argument, NULL, 0 },
     { "analysis-load-reuse-level", required_argument, NULL, 0 },
     { "analysis-save",  required_argument, NULL, 0 },
     { "analysis-load",  required_argument, NULL, 0 },
@@ -310,6 +331,11 @@ static const struct option long_options[] =
     { "analyze-src-pics", no_argument, NULL, 0 },
     { "no-analyze-src-pics", no_argument, NULL, 0 },
     { "slices",         required_argument, NULL, 0 },
+    { "tiles",          required_argument, NULL, 0 },
+    { "tile-column-widths", required_argument, NULL, 0 },
+    { "tile-row-heights", required_argument, NULL, 0 },
+    { "sub-frame-output",     no_argument, NULL, 0 },
+    { "no-sub-frame-output",  no_argument, NULL, 0 },
     { "aq-motion",            no_argument, NULL, 0 },
     { "no-aq-motion",         no_argument, NULL, 0 },
     { "ssim-rd",              no_argument, NULL, 0 },
@@ -378,6 +404,7 @@ static const struct option long_options[] =
     { "no-cll", no_argument, NULL, 0 },
     { "hme-range", required_argument, NULL, 0 },
     { "abr-ladder", required_argument, NULL, 0 },
+    { "abr-scale", no_argument, NULL, 0 },
     { "min-vbv-fullness", required_argument, NULL, 0 },
     { "max-vbv-fullness", required_argument, NULL, 0 },
     { "scenecut-qp-config", required_argument, NULL, 0 },
@@ -416,7 +443,9 @@ static const struct option long_options[] =
 
         /* ABR ladder settings */
         bool isAbrLadderConfig;
-        bool enableScaler;
+        bool enableScaler;          // rung scaled from a larger rung to its --input-res (--abr-scale)
+        const CLIOptions* scaleInput; // first rung, whose input properties a scaled rung inherits
+        const char* inputName;      // ABR encodes reading the same input share its pictures
         char*    encName;
         char*    reuseName;
         uint32_t encId;
@@ -449,6 +478,8 @@ static const struct option long_options[] =
             bDither = false;
             isAbrLadderConfig = false;
             enableScaler = false;
+            scaleInput = NULL;
+            inputName = NULL;
             encName = NULL;
             reuseName = NULL;
             encId = 0;